@@ -3,12 +3,15 @@
 
 #include "constants.h"
 
-layout(set = 0, binding = 2) uniform sampler2D base_color_texture_sampler;
-layout(location = 0) in vec2 g_tex_coord;
+layout(set = 0, binding = 1) uniform sampler2D base_color_texture_sampler;
+
+layout(location = 0) in vec3 f_position;
+layout(location = 1) in vec2 f_tex_coord;
+layout(location = 2) in vec3 f_normal;
 
 void main() 
 {	
-	float alpha = texture(base_color_texture_sampler, g_tex_coord).a;
+	float alpha = texture(base_color_texture_sampler, f_tex_coord).a;
 	if (alpha < MIN_SHADOW_ALPHA)
 	{
 		discard;
@@ -1,16 +1,28 @@
 #version 450
+#extension GL_GOOGLE_include_directive : enable
 
+#include "constants.h"
+
+// packed positions are unorm16 relative to the mesh bounds
 layout (location = 0) in vec3 position;
 
 layout(push_constant) uniform PCO 
 {
 	layout (offset = 0) mat4 mvp;
+	layout (offset = 80) vec4 position_offset;
+	layout (offset = 96) vec4 position_scale;
 } pco;
 
 layout (location = 0) out vec3 f_uvw;
 
 void main()
 {
-	f_uvw = position;
-	gl_Position = pco.mvp * vec4(position.xyz, 1.0);
-}
+#if PACKED_MESH_VERTEX
+	vec3 mesh_position = pco.position_offset.xyz + position * pco.position_scale.xyz;
+#else
+	vec3 mesh_position = position;
+#endif
+
+	f_uvw = mesh_position;
+	gl_Position = pco.mvp * vec4(mesh_position, 1.0);
+}
\ No newline at end of file
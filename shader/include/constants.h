@@ -6,25 +6,52 @@
 #define HALF_PI (PI * 0.5)
 
 #define INVALID_BONE -1
+#define INVALID_TEXTURE_INDEX -1
 #define MAX_BONE_NUM 128
 #define BONE_NUM_PER_VERTEX 4
 
+// material feature bits, material pipelines are specialized on them and compile out the unused texture paths
+#define MATERIAL_FEATURE_BASE_COLOR_TEXTURE 0x1
+#define MATERIAL_FEATURE_METALLIC_ROUGHNESS_OCCLUSION_TEXTURE 0x2
+#define MATERIAL_FEATURE_NORMAL_TEXTURE 0x4
+#define MATERIAL_FEATURE_EMISSIVE_TEXTURE 0x8
+
+// mesh vertex buffers store positions relative to the mesh bounds as unorm16, half float uvs,
+// octahedral snorm16 normals, uint8 bone indices and unorm16 bone weights
+#define PACKED_MESH_VERTEX 1
+
 #define STD_GAMMA 2.2
 #define DIELECTRIC_F0 0.04
 #define TONEMAP_EXPOSURE 4.5
 #define EPSILON 0.001
 
-#define MAX_POINT_LIGHT_NUM 8
-#define MAX_SPOT_LIGHT_NUM 8
+#define MAX_POINT_LIGHT_NUM 1024
+#define MAX_SPOT_LIGHT_NUM 1024
+#define INVALID_SHADOW_INDEX -1
+
+// lights are culled into a froxel grid, uniform in screen space and exponential in view depth
+#define LIGHT_CLUSTER_X_NUM 16
+#define LIGHT_CLUSTER_Y_NUM 9
+#define LIGHT_CLUSTER_Z_NUM 24
+#define MAX_CLUSTER_LIGHT_NUM 128
+
 #define SHADOW_CASCADE_NUM 4
 #define SHADOW_FACE_NUM 6
 #define MIN_SHADOW_ALPHA 0.001
 #define MIN_OUTLINE_ALPHA 0.001
 #define DIRECTIONAL_LIGHT_SHADOW_BIAS 0.002
+#define POINT_LIGHT_SHADOW_BIAS 0.001
 #define SPOT_LIGHT_SHADOW_BIAS 0.001
 #define PCF_DELTA_SCALE 0.75
 #define PCF_SAMPLE_RANGE 1
 
+#define CULL_FLAG_FRUSTUM 1
+#define CULL_FLAG_OCCLUSION 2
+#define CULL_GROUP_SIZE 64
+#define HIZ_GROUP_SIZE 8
+#define INVALID_BATCH_INDEX 0xffffffffu
+#define MESH_LOD_NUM 4
+
 #define OUTLINE_THICKNESS 2
 #define DEBUG_SHADER_DEPTH_MULTIPLIER 0.02
 
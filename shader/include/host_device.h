@@ -8,6 +8,7 @@
 using vec2 = glm::vec2;
 using vec3 = glm::vec3;
 using vec4 = glm::vec4;
+using uvec4 = glm::uvec4;
 using mat4 = glm::mat4;
 using uint = unsigned int;
 #endif
@@ -17,6 +18,10 @@ using uint = unsigned int;
 struct BoneUBO
 {
 	mat4 bone_matrices[MAX_BONE_NUM];
+
+	// dequantizes packed skeletal mesh positions before skinning
+	vec4 position_offset;
+	vec4 position_scale;
 };
 
 struct TransformPCO
@@ -26,18 +31,68 @@ struct TransformPCO
     mat4 mvp;
 };
 
+// static mesh object of the gpu scene, cpu instanced draw lists only write the transforms and the color
+struct ObjectData
+{
+    mat4 m;
+    mat4 nm;
+    vec4 color; // encoded entity id in pick pass
+    vec4 bounds_min; // world space bounding box
+    vec4 bounds_max;
+    uvec4 lod_first_indices; // index ranges of the sub mesh's lods
+    uvec4 lod_index_counts;
+    uint lod_count;
+    uint material_index;
+    uint batch_index; // INVALID_BATCH_INDEX if the object slot is free
+    uint padding0;
+};
+
+struct DrawCommand
+{
+    uint index_count;
+    uint instance_count;
+    uint first_index;
+    int vertex_offset;
+    uint first_instance;
+};
+
+struct CullPCO
+{
+    mat4 view_proj;
+    vec4 lod_camera; // xyz: camera position the lods are selected from, w: lod bias
+    vec2 hiz_size;
+    float lod_scale; // 1 / tan(fovy / 2)
+    uint object_count;
+    uint cull_flags;
+};
+
+struct HiZPCO
+{
+    uint src_width;
+    uint src_height;
+    uint dst_width;
+    uint dst_height;
+};
+
 struct MaterialPCO
+{
+    uint material_index;
+};
+
+struct MaterialData
 {
     vec4 base_color_factor;
     vec4 emissive_factor;
-	float m_metallic_factor;
-	float m_roughness_factor;
-
-    int has_base_color_texture; 
-    int has_emissive_texture;
-    int has_metallic_roughness_occlusion_texture;
+    float metallic_factor;
+    float roughness_factor;
     int contains_occlusion_channel;
-    int has_normal_texture;
+    int padding0;
+
+    // bindless texture indices, INVALID_TEXTURE_INDEX if the material doesn't have the texture
+    int base_color_texture_index;
+    int metallic_roughness_occlusion_texture_index;
+    int normal_texture_index;
+    int emissive_texture_index;
 };
 
 struct SkyLight
@@ -57,7 +112,7 @@ struct DirectionalLight
 struct PointLight
 {
 	vec3 position; 
-    float padding0; // inner_cutoff for SpotLight, cast shadow for PointLight
+    float padding0; // inner_cutoff for SpotLight
 
 	vec3 color; 
     float padding1; // outer_cutoff for SpotLight
@@ -65,14 +120,29 @@ struct PointLight
     float radius;
 	float linear_attenuation;
 	float quadratic_attenuation;
-    int cast_shadow;
+    int shadow_index; // index of the first shadow view, or INVALID_SHADOW_INDEX
 };
 
 struct SpotLight
 {
     PointLight _pl;
     vec3 direction; float padding0;
+};
+
+// a point light's shadow has one view per cube face, a spot light's shadow has one view
+struct ShadowView
+{
     mat4 view_proj;
+    vec4 atlas_rect; // uv offset and scale of the view's tile in the shadow atlas
+};
+
+// range of a cluster's lights in the light index buffer, point light indices come first
+struct LightCluster
+{
+    uint offset;
+    uint point_light_num;
+    uint spot_light_num;
+    uint padding0;
 };
 
 struct LightingUBO
@@ -81,19 +151,24 @@ struct LightingUBO
     vec3 camera_pos;
     float exposure;
     mat4 camera_view;
+    mat4 camera_view_proj;
     mat4 inv_camera_view_proj;
 
-    // lights
+    // lights, point and spot lights live in storage buffers
     SkyLight sky_light;
     DirectionalLight directional_light;
-    PointLight point_lights[MAX_POINT_LIGHT_NUM];
-    SpotLight spot_lights[MAX_SPOT_LIGHT_NUM];
 
     int has_sky_light;
     int has_directional_light;
     int point_light_num;
     int spot_light_num;
 
+    // the light cluster slice of a view depth is log(depth) * light_cluster_z_scale - light_cluster_z_bias
+    float light_cluster_z_scale;
+    float light_cluster_z_bias;
+    float padding0;
+    float padding1;
+
     // debug
     vec3 camera_dir;
     int shader_debug_option;
@@ -110,14 +185,4 @@ struct MaterialInfo
     float occlusion;
 };
 
-struct ShadowCascadeUBO
-{
-    mat4 cascade_view_projs[SHADOW_CASCADE_NUM];
-};
-
-struct ShadowCubeUBO
-{
-    mat4 face_view_projs[SHADOW_FACE_NUM];
-};
-
 #endif
\ No newline at end of file
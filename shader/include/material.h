@@ -5,24 +5,31 @@
 
 layout(push_constant) uniform _MaterialPCO { layout(offset = 192) MaterialPCO material_pco; };
 
-layout(set = 0, binding = 1) uniform sampler2D base_color_texture_sampler;
-layout(set = 0, binding = 2) uniform sampler2D metallic_roughness_occlusion_texture_sampler;
-layout(set = 0, binding = 3) uniform sampler2D normal_texture_sampler;
-layout(set = 0, binding = 4) uniform sampler2D emissive_texture_sampler;
+// bindless materials and textures, the material index is the same for the whole draw
+layout(std430, set = 1, binding = 0) readonly buffer _MaterialSSBO { MaterialData materials[]; };
+layout(set = 1, binding = 1) uniform sampler2D bindless_textures[];
+
+// texture paths of the material, the pipeline is specialized per feature mask, so missing textures are never sampled
+layout(constant_id = 0) const uint MATERIAL_FEATURES = 0u;
+
+bool has_material_feature(uint feature)
+{
+	return (MATERIAL_FEATURES & feature) != 0u;
+}
 
 layout(location = 0) in vec3 f_position;
 layout(location = 1) in vec2 f_tex_coord;
 layout(location = 2) in vec3 f_normal;
 
-vec3 calc_normal()
+vec3 calc_normal(MaterialData material)
 {
-	if (!bool(material_pco.has_normal_texture))
+	if (!has_material_feature(MATERIAL_FEATURE_NORMAL_TEXTURE))
 	{
 		return f_normal;
 	}
 
 	// Perturb normal, see http://www.thetenthplanet.de/archives/1180
-	vec4 texel = texture(normal_texture_sampler, f_tex_coord);
+	vec4 texel = texture(bindless_textures[material.normal_texture_index], f_tex_coord);
 	vec3 tangent_normal = texel.xyz;
 	if (texel.w > 0.999)
 	{
@@ -49,34 +56,35 @@ vec3 calc_normal()
 
 MaterialInfo calc_material_info()
 {
+	MaterialData material = materials[material_pco.material_index];
 	MaterialInfo mat_info;
 
 	// position
 	mat_info.position = f_position;
 
 	// normal
-	mat_info.normal = calc_normal();
+	mat_info.normal = calc_normal(material);
 
 	// base color
-	mat_info.base_color = material_pco.base_color_factor;
-	if (bool(material_pco.has_base_color_texture))
+	mat_info.base_color = material.base_color_factor;
+	if (has_material_feature(MATERIAL_FEATURE_BASE_COLOR_TEXTURE))
 	{
-		mat_info.base_color *= texture(base_color_texture_sampler, f_tex_coord);
+		mat_info.base_color *= texture(bindless_textures[material.base_color_texture_index], f_tex_coord);
 	}
 
 	// emissive color
-	mat_info.emissive_color = material_pco.emissive_factor;
-	if (bool(material_pco.has_emissive_texture))
+	mat_info.emissive_color = material.emissive_factor;
+	if (has_material_feature(MATERIAL_FEATURE_EMISSIVE_TEXTURE))
 	{
-		mat_info.emissive_color = texture(emissive_texture_sampler, f_tex_coord);
+		mat_info.emissive_color = texture(bindless_textures[material.emissive_texture_index], f_tex_coord);
 	}
 
 	// metallic_roughness_occlusion
-	vec3 metallic_roughness_occlusion = vec3(material_pco.m_metallic_factor, material_pco.m_roughness_factor, 1.0);
-	if (bool(material_pco.has_metallic_roughness_occlusion_texture))
+	vec3 metallic_roughness_occlusion = vec3(material.metallic_factor, material.roughness_factor, 1.0);
+	if (has_material_feature(MATERIAL_FEATURE_METALLIC_ROUGHNESS_OCCLUSION_TEXTURE))
 	{
-		vec4 pack_params = texture(metallic_roughness_occlusion_texture_sampler, f_tex_coord);
-		metallic_roughness_occlusion.xyz *= vec3(pack_params.b, pack_params.g, bool(material_pco.contains_occlusion_channel) ? pack_params.r : 1.0);
+		vec4 pack_params = texture(bindless_textures[material.metallic_roughness_occlusion_texture_index], f_tex_coord);
+		metallic_roughness_occlusion.xyz *= vec3(pack_params.b, pack_params.g, bool(material.contains_occlusion_channel) ? pack_params.r : 1.0);
 	}
 	mat_info.metallic = metallic_roughness_occlusion.x;
 	mat_info.roughness = metallic_roughness_occlusion.y;
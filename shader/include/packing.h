@@ -0,0 +1,14 @@
+#ifndef PACKING
+#define PACKING
+
+// decode an octahedral encoded unit vector, the lower hemisphere is folded over the diagonals
+vec3 octDecode(vec2 e)
+{
+	vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+	float t = max(-n.z, 0.0);
+	n.x += n.x >= 0.0 ? -t : t;
+	n.y += n.y >= 0.0 ? -t : t;
+	return normalize(n);
+}
+
+#endif
\ No newline at end of file
@@ -11,12 +11,18 @@ layout(set = 0, binding = 7) uniform sampler2D brdf_lut_texture_sampler;
 
 // shadow textures
 layout(set = 0, binding = 8) uniform sampler2DArray directional_light_shadow_texture_sampler;
-layout(set = 0, binding = 9) uniform samplerCube point_light_shadow_texture_samplers[MAX_POINT_LIGHT_NUM];
-layout(set = 0, binding = 10) uniform sampler2D spot_light_shadow_texture_samplers[MAX_SPOT_LIGHT_NUM];
+layout(set = 0, binding = 9) uniform sampler2D shadow_atlas_sampler;
+layout(std430, set = 0, binding = 10) readonly buffer _ShadowViewSSBO { ShadowView shadow_views[]; };
 
 // lighting ubo
 layout(set = 0, binding = 11) uniform _LightingUBO { LightingUBO lighting_ubo; };
 
+// clustered lights
+layout(std430, set = 0, binding = 12) readonly buffer _PointLightSSBO { PointLight point_lights[]; };
+layout(std430, set = 0, binding = 13) readonly buffer _SpotLightSSBO { SpotLight spot_lights[]; };
+layout(std430, set = 0, binding = 14) readonly buffer _LightClusterSSBO { LightCluster light_clusters[]; };
+layout(std430, set = 0, binding = 15) readonly buffer _LightIndexSSBO { uint light_indices[]; };
+
 struct PBRInfo
 {
 	float NdotL;                  // cos angle between normal and light direction
@@ -150,6 +156,53 @@ float filterPCF(vec4 shadow_coord, uint cascade_index)
 	return shadow / count;
 }
 
+// depth test against the atlas tile of a shadow view, uvs are clamped into the tile so its neighbors never bleed in
+float sampleShadowAtlas(ShadowView shadow_view, vec3 position, float bias)
+{
+	vec4 shadow_coord = shadow_view.view_proj * vec4(position, 1.0);
+	shadow_coord = shadow_coord / shadow_coord.w;
+	if (shadow_coord.z <= 0.0 || shadow_coord.z >= 1.0)
+	{
+		return 1.0;
+	}
+
+	vec2 half_texel = 0.5 / vec2(textureSize(shadow_atlas_sampler, 0));
+	vec2 uv = shadow_view.atlas_rect.xy + (shadow_coord.xy * 0.5 + 0.5) * shadow_view.atlas_rect.zw;
+	uv = clamp(uv, shadow_view.atlas_rect.xy + half_texel, shadow_view.atlas_rect.xy + shadow_view.atlas_rect.zw - half_texel);
+
+	float depth = texture(shadow_atlas_sampler, uv).r;
+	return depth < shadow_coord.z - bias ? 0.0 : 1.0;
+}
+
+// cube face of a direction from a point light, in the +x, -x, +y, -y, +z, -z order of its shadow views
+uint getCubeFaceIndex(vec3 v)
+{
+	vec3 a = abs(v);
+	if (a.x >= a.y && a.x >= a.z)
+	{
+		return v.x > 0.0 ? 0 : 1;
+	}
+	if (a.y >= a.z)
+	{
+		return v.y > 0.0 ? 2 : 3;
+	}
+	return v.z > 0.0 ? 4 : 5;
+}
+
+// froxel of a world position, tiles are uniform in screen space and slices are exponential in view depth
+uint getLightClusterIndex(vec3 position)
+{
+	vec4 clip_pos = lighting_ubo.camera_view_proj * vec4(position, 1.0);
+	vec2 uv = clamp(clip_pos.xy / clip_pos.w * 0.5 + 0.5, 0.0, 0.999);
+	uvec2 tile = uvec2(uv * vec2(LIGHT_CLUSTER_X_NUM, LIGHT_CLUSTER_Y_NUM));
+
+	float depth = -(lighting_ubo.camera_view * vec4(position, 1.0)).z;
+	float slice = floor(log(max(depth, EPSILON)) * lighting_ubo.light_cluster_z_scale - lighting_ubo.light_cluster_z_bias);
+	uint z = uint(clamp(slice, 0.0, float(LIGHT_CLUSTER_Z_NUM - 1)));
+
+	return (z * LIGHT_CLUSTER_Y_NUM + tile.y) * LIGHT_CLUSTER_X_NUM + tile.x;
+}
+
 bool is_debug_lit() { return lighting_ubo.shader_debug_option == 0; }
 bool is_debug_unlit() { return lighting_ubo.shader_debug_option == 1; }
 bool is_debug_wireframe() { return lighting_ubo.shader_debug_option == 2; }
@@ -267,10 +320,11 @@ vec4 calc_pbr(MaterialInfo mat_info)
 		light_color += getLightContribution(pbr_info, n, v, -directional_light.direction, directional_light.color) * shadow;
 	}
 
-	// point lights
-	for (int i = 0; i < lighting_ubo.point_light_num; ++i)
+	// point lights of the cluster
+	LightCluster light_cluster = light_clusters[getLightClusterIndex(mat_info.position)];
+	for (uint i = 0; i < light_cluster.point_light_num; ++i)
 	{
-		PointLight point_light = lighting_ubo.point_lights[i];
+		PointLight point_light = point_lights[light_indices[light_cluster.offset + i]];
 		
 		float distance = distance(point_light.position, mat_info.position);
 		if (distance < point_light.radius)
@@ -281,24 +335,20 @@ vec4 calc_pbr(MaterialInfo mat_info)
 			vec3 l = normalize(point_light.position - mat_info.position);
 
 			float shadow = 1.0;
-			if (bool(point_light.cast_shadow))
+			if (point_light.shadow_index != INVALID_SHADOW_INDEX)
 			{
-				vec3 sample_vector = mat_info.position - point_light.position;
-				float depth = texture(point_light_shadow_texture_samplers[i], sample_vector).x;
-				if (length(sample_vector) > depth)
-				{
-					shadow = 0.0;
-				}
+				uint face_index = getCubeFaceIndex(mat_info.position - point_light.position);
+				shadow = sampleShadowAtlas(shadow_views[point_light.shadow_index + face_index], mat_info.position, POINT_LIGHT_SHADOW_BIAS);
 			}
 
 			light_color += getLightContribution(pbr_info, n, v, l, c) * shadow;
 		}
 	}
 
-	// spot lights
-	for (int i = 0; i < lighting_ubo.spot_light_num; ++i)
+	// spot lights of the cluster
+	for (uint i = 0; i < light_cluster.spot_light_num; ++i)
 	{
-		SpotLight spot_light = lighting_ubo.spot_lights[i];
+		SpotLight spot_light = spot_lights[light_indices[light_cluster.offset + light_cluster.point_light_num + i]];
 		PointLight point_light = spot_light._pl;
 
 		float distance = distance(point_light.position, mat_info.position);
@@ -314,19 +364,9 @@ vec4 calc_pbr(MaterialInfo mat_info)
 			vec3 l = normalize(point_light.position - mat_info.position);
 
 			float shadow = 1.0;
-			if (bool(point_light.cast_shadow))
+			if (point_light.shadow_index != INVALID_SHADOW_INDEX)
 			{
-				vec4 shadow_coord = (k_shadow_bias_mat * spot_light.view_proj) * vec4(mat_info.position, 1.0);
-				shadow_coord = shadow_coord / shadow_coord.w;
-
-				if (shadow_coord.z > 0.0 && shadow_coord.z < 1.0) 
-				{
-					float depth = texture(spot_light_shadow_texture_samplers[i], shadow_coord.xy).r;
-					if (depth < shadow_coord.z - SPOT_LIGHT_SHADOW_BIAS) 
-					{
-						shadow = 0.0;
-					}
-				}
+				shadow = sampleShadowAtlas(shadow_views[point_light.shadow_index], mat_info.position, SPOT_LIGHT_SHADOW_BIAS);
 			}
 
 			light_color += getLightContribution(pbr_info, n, v, l, c) * shadow;
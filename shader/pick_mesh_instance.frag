@@ -0,0 +1,13 @@
+#version 450
+
+layout(location = 0) in vec3 f_position;
+layout(location = 1) in vec2 f_tex_coord;
+layout(location = 2) in vec3 f_normal;
+layout(location = 3) flat in vec4 f_color;
+
+layout(location = 0) out vec4 o_color;
+
+void main()
+{
+	o_color = f_color;
+}
\ No newline at end of file
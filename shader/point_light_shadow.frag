@@ -3,25 +3,17 @@
 
 #include "constants.h"
 
-layout(push_constant) uniform PCO { 
-    layout(offset = 192) 
-    vec4 light_pos;
-} pco;
+layout(set = 0, binding = 1) uniform sampler2D base_color_texture_sampler;
 
-layout(set = 0, binding = 2) uniform sampler2D base_color_texture_sampler;
-
-layout(location = 0) in vec3 g_position;
-layout(location = 1) in vec2 g_tex_coord;
-
-layout(location = 0) out float o_depth;
+layout(location = 0) in vec3 f_position;
+layout(location = 1) in vec2 f_tex_coord;
+layout(location = 2) in vec3 f_normal;
 
 void main() 
-{   
-    float alpha = texture(base_color_texture_sampler, g_tex_coord).a;
-    if (alpha < MIN_SHADOW_ALPHA)
-    {
-        discard;
-    }
-
-    o_depth = length(pco.light_pos.xyz - g_position);
+{	
+	float alpha = texture(base_color_texture_sampler, f_tex_coord).a;
+	if (alpha < MIN_SHADOW_ALPHA)
+	{
+		discard;
+	}
 }
\ No newline at end of file
@@ -2,14 +2,21 @@
 #extension GL_GOOGLE_include_directive : enable
 
 #include "host_device.h"
+#include "packing.h"
 
 layout(set = 0, binding = 0) uniform _BoneUBO { BoneUBO bone_ubo; };
 layout(push_constant) uniform _TransformPCO { TransformPCO transform_pco; };
 
-layout(location = 0) in vec3 position;
+// packed positions are unorm16 relative to the mesh bounds, bone_ubo dequantizes them before skinning
+layout(location = 0) in vec4 position;
 layout(location = 1) in vec2 tex_coord;
+#if PACKED_MESH_VERTEX
+layout(location = 2) in vec2 oct_normal;
+layout(location = 3) in uvec4 bones;
+#else
 layout(location = 2) in vec3 normal;
 layout(location = 3) in ivec4 bones;
+#endif
 layout(location = 4) in vec4 weights;
 
 layout(location = 0) out vec3 f_position;
@@ -18,13 +25,20 @@ layout(location = 2) out vec3 f_normal;
 
 void main()
 {
+#if PACKED_MESH_VERTEX
+	vec3 normal = octDecode(oct_normal);
+	vec3 mesh_position = bone_ubo.position_offset.xyz + position.xyz * bone_ubo.position_scale.xyz;
+#else
+	vec3 mesh_position = position.xyz;
+#endif
+
 	mat4 blend_bone_matrix = mat4(0.0);
 	for (int i = 0; i < BONE_NUM_PER_VERTEX; ++i)
 	{
 		blend_bone_matrix += bone_ubo.bone_matrices[bones[i]] * weights[i];
 	}
 
-	vec4 local_position = blend_bone_matrix * vec4(position, 1.0);
+	vec4 local_position = blend_bone_matrix * vec4(mesh_position, 1.0);
 	vec3 local_normal = mat3(blend_bone_matrix) * normal;
 	
 	f_position = (transform_pco.m * local_position).xyz;
@@ -2,19 +2,19 @@
 #extension GL_GOOGLE_include_directive : enable
 
 #include "host_device.h"
+#include "packing.h"
 
 layout(push_constant) uniform _TransformPCO { TransformPCO transform_pco; };
 
-layout(location = 0) in vec3 position;
-layout(location = 1) in vec2 tex_coord;
-layout(location = 2) in vec3 normal;
+// packed positions are unorm16 relative to the mesh bounds, transform_pco.m dequantizes them
+layout(location = 0) in vec4 position;
 
 layout (location = 0) out vec3 f_uvw;
 
 void main()
 {	
-	f_uvw = position.xyz;
+	f_uvw = (transform_pco.m * position).xyz;
 
-	vec4 pos = transform_pco.mvp * vec4(position, 1.0);
+	vec4 pos = transform_pco.mvp * position;
 	gl_Position = pos.xyww;
 }
\ No newline at end of file
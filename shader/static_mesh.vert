@@ -2,12 +2,18 @@
 #extension GL_GOOGLE_include_directive : enable
 
 #include "host_device.h"
+#include "packing.h"
 
 layout(push_constant) uniform _TransformPCO { TransformPCO transform_pco; };
 
-layout(location = 0) in vec3 position;
+// packed positions are unorm16 relative to the mesh bounds, w is always one
+layout(location = 0) in vec4 position;
 layout(location = 1) in vec2 tex_coord;
+#if PACKED_MESH_VERTEX
+layout(location = 2) in vec2 oct_normal;
+#else
 layout(location = 2) in vec3 normal;
+#endif
 
 layout(location = 0) out vec3 f_position;
 layout(location = 1) out vec2 f_tex_coord;
@@ -15,9 +21,13 @@ layout(location = 2) out vec3 f_normal;
 
 void main()
 {	
-	f_position = (transform_pco.m * vec4(position, 1.0)).xyz;
+#if PACKED_MESH_VERTEX
+	vec3 normal = octDecode(oct_normal);
+#endif
+
+	f_position = (transform_pco.m * position).xyz;
 	f_tex_coord = tex_coord;
 	f_normal = normalize(mat3(transform_pco.nm) * normal);
 
-	gl_Position = transform_pco.mvp * vec4(position, 1.0);
+	gl_Position = transform_pco.mvp * position;
 }
\ No newline at end of file
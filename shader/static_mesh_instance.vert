@@ -0,0 +1,41 @@
+#version 450
+#extension GL_GOOGLE_include_directive : enable
+
+#include "host_device.h"
+#include "packing.h"
+
+// transform_pco.mvp holds the view projection matrix, model matrices are read from the gpu scene's object buffer
+// or a draw list's instance buffer, whose object index is the instance index
+layout(push_constant) uniform _TransformPCO { TransformPCO transform_pco; };
+layout(std430, set = 0, binding = 0) readonly buffer _ObjectSSBO { ObjectData objects[]; };
+
+// packed positions are unorm16 relative to the mesh bounds, w is always one
+layout(location = 0) in vec4 position;
+layout(location = 1) in vec2 tex_coord;
+#if PACKED_MESH_VERTEX
+layout(location = 2) in vec2 oct_normal;
+#else
+layout(location = 2) in vec3 normal;
+#endif
+
+layout(location = 0) out vec3 f_position;
+layout(location = 1) out vec2 f_tex_coord;
+layout(location = 2) out vec3 f_normal;
+layout(location = 3) flat out vec4 f_color;
+
+void main()
+{	
+#if PACKED_MESH_VERTEX
+	vec3 normal = octDecode(oct_normal);
+#endif
+
+	ObjectData object = objects[gl_InstanceIndex];
+	vec4 position_ws = object.m * position;
+
+	f_position = position_ws.xyz;
+	f_tex_coord = tex_coord;
+	f_normal = normalize(mat3(object.nm) * normal);
+	f_color = object.color;
+
+	gl_Position = transform_pco.mvp * position_ws;
+}
\ No newline at end of file
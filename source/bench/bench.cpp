@@ -0,0 +1,268 @@
+#include "bench.h"
+#include "engine/engine.h"
+#include "engine/core/base/macro.h"
+#include "engine/core/vulkan/vulkan_rhi.h"
+#include "engine/core/time/frame_pacer.h"
+#include "engine/core/service/service_locator.h"
+#include "engine/function/framework/world/world_manager.h"
+#include "engine/function/framework/component/camera_component.h"
+#include "engine/function/framework/component/transform_component.h"
+#include "engine/function/render/render_system.h"
+#include "engine/function/render/gpu_profiler.h"
+#include "engine/platform/file/file_system.h"
+#include "engine/platform/string/string_util.h"
+#include "engine/platform/timer/timer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace Bamboo
+{
+	static const char* k_usage =
+		"usage: BambooBench <world_url> [--frames N] [--warmup N] [--width W] [--height H] [--orbit_radius R] [--output file.json]";
+
+	bool Bench::init(int argc, char** argv)
+	{
+		if (!parseOptions(argc, argv))
+		{
+			std::cerr << k_usage << std::endl;
+			return false;
+		}
+
+		// render offscreen without a window, surface or swapchain
+		g_engine.setHeadless(true);
+		m_engine = new Engine;
+		if (!m_engine->initialize())
+		{
+			std::cerr << "[ERROR] Failed to initialize engine" << std::endl;
+			delete m_engine;
+			m_engine = nullptr;
+			return false;
+		}
+
+		// frames are measured as fast as they can be rendered, the configured pacing would only add sleeps and fence waits
+		std::shared_ptr<FramePacer> frame_pacer = Services().getService<FramePacer>();
+		frame_pacer->setTargetFrameRate(0);
+		frame_pacer->setLowLatency(false);
+
+		if (!g_engine.fileSystem()->exists(m_options.world_url))
+		{
+			LOG_ERROR("world {} doesn't exist", m_options.world_url);
+			return false;
+		}
+		return true;
+	}
+
+	void Bench::destroy()
+	{
+		if (m_engine)
+		{
+			m_engine->shutdown();
+			delete m_engine;
+			m_engine = nullptr;
+		}
+	}
+
+	bool Bench::run()
+	{
+		if (!m_engine)
+		{
+			return false;
+		}
+
+		// the world is opened by the first tick, which also uploads its assets and isn't measured
+		g_engine.worldManager()->openWorld(URL(m_options.world_url));
+		g_engine.renderSystem()->resize(m_options.width, m_options.height);
+		g_engine.renderSystem()->getGPUProfiler()->setEnabled(true);
+		m_engine->tick();
+
+		uint32_t total_frame_count = m_options.warmup_frame_count + m_options.frame_count;
+		m_samples.reserve(m_options.frame_count);
+		StopWatch stop_watch;
+		for (uint32_t i = 0; i < total_frame_count; ++i)
+		{
+			if (!updateCamera(i))
+			{
+				LOG_ERROR("world {} has no camera", m_options.world_url);
+				return false;
+			}
+
+			stop_watch.start();
+			if (!m_engine->tick())
+			{
+				LOG_ERROR("engine stopped at frame {}", i);
+				return false;
+			}
+			float cpu_time_ms = stop_watch.stop() * 1000.0f;
+
+			sampleMemory();
+			if (i < m_options.warmup_frame_count)
+			{
+				continue;
+			}
+
+			// gpu times are read back when a frame's fence is waited, so they lag the cpu times by the frames in flight
+			DrawStats draw_stats = g_engine.renderSystem()->getDrawStats();
+			m_samples.push_back({ cpu_time_ms, g_engine.renderSystem()->getGPUProfiler()->getFrameTimeMs(),
+				draw_stats.draw_count, draw_stats.instance_count });
+		}
+		g_engine.renderSystem()->flush();
+		VulkanRHI::get().waitDeviceIdle();
+
+		std::string json = toJson();
+		std::cout << json << std::endl;
+		if (!m_options.output_filename.empty())
+		{
+			std::ofstream ofs(m_options.output_filename);
+			if (!ofs.is_open())
+			{
+				LOG_ERROR("failed to write bench result {}", m_options.output_filename);
+				return false;
+			}
+			ofs << json;
+		}
+		return true;
+	}
+
+	bool Bench::parseOptions(int argc, char** argv)
+	{
+		for (int i = 1; i < argc; ++i)
+		{
+			const char* arg = argv[i];
+			if (arg[0] != '-')
+			{
+				m_options.world_url = arg;
+				continue;
+			}
+
+			if (i + 1 >= argc)
+			{
+				return false;
+			}
+			const char* value = argv[++i];
+			if (std::strcmp(arg, "--frames") == 0)
+			{
+				m_options.frame_count = std::max(std::atoi(value), 1);
+			}
+			else if (std::strcmp(arg, "--warmup") == 0)
+			{
+				m_options.warmup_frame_count = std::max(std::atoi(value), 0);
+			}
+			else if (std::strcmp(arg, "--width") == 0)
+			{
+				m_options.width = std::max(std::atoi(value), 1);
+			}
+			else if (std::strcmp(arg, "--height") == 0)
+			{
+				m_options.height = std::max(std::atoi(value), 1);
+			}
+			else if (std::strcmp(arg, "--orbit_radius") == 0)
+			{
+				m_options.orbit_radius = static_cast<float>(std::atof(value));
+			}
+			else if (std::strcmp(arg, "--output") == 0)
+			{
+				m_options.output_filename = value;
+			}
+			else
+			{
+				return false;
+			}
+		}
+
+		return !m_options.world_url.empty();
+	}
+
+	bool Bench::updateCamera(uint32_t frame_index)
+	{
+		std::shared_ptr<CameraComponent> camera_component = g_engine.worldManager()->getCameraComponent().lock();
+		if (!camera_component)
+		{
+			return false;
+		}
+
+		// orbit once around the point the camera initially looks at, driven by the frame index so runs are comparable
+		std::shared_ptr<TransformComponent> transform_component = camera_component->getTransformComponent();
+		if (!m_is_camera_inited)
+		{
+			m_initial_yaw = transform_component->m_rotation.y;
+			m_orbit_center = transform_component->m_position + transform_component->getForwardVector() * m_options.orbit_radius;
+			m_is_camera_inited = true;
+		}
+
+		uint32_t total_frame_count = m_options.warmup_frame_count + m_options.frame_count;
+		transform_component->m_rotation.y = m_initial_yaw + 360.0f * frame_index / total_frame_count;
+		transform_component->m_position = m_orbit_center - transform_component->getForwardVector() * m_options.orbit_radius;
+		camera_component->m_aspect_ratio = static_cast<float>(m_options.width) / m_options.height;
+		return true;
+	}
+
+	void Bench::sampleMemory()
+	{
+		// sum up the device local heaps, on unified memory devices that's all the memory
+		VmaAllocator allocator = VulkanRHI::get().getAllocator();
+		const VkPhysicalDeviceMemoryProperties* p_memory_properties = nullptr;
+		vmaGetMemoryProperties(allocator, &p_memory_properties);
+		std::vector<VmaBudget> budgets(p_memory_properties->memoryHeapCount);
+		vmaGetHeapBudgets(allocator, budgets.data());
+
+		const double k_mb = 1024.0 * 1024.0;
+		m_allocation_mb = m_usage_mb = m_budget_mb = 0.0;
+		for (uint32_t i = 0; i < p_memory_properties->memoryHeapCount; ++i)
+		{
+			if (p_memory_properties->memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT)
+			{
+				m_allocation_mb += budgets[i].statistics.allocationBytes / k_mb;
+				m_usage_mb += budgets[i].usage / k_mb;
+				m_budget_mb += budgets[i].budget / k_mb;
+			}
+		}
+		m_peak_allocation_mb = std::max(m_peak_allocation_mb, m_allocation_mb);
+	}
+
+	std::string Bench::toJson()
+	{
+		// nearest rank percentiles of the measured frames
+		auto percentiles = [this](float FrameSample::* member) {
+			std::vector<float> values;
+			double sum = 0.0;
+			for (const FrameSample& sample : m_samples)
+			{
+				values.push_back(sample.*member);
+				sum += sample.*member;
+			}
+			std::sort(values.begin(), values.end());
+			auto percentile = [&values](float p) {
+				size_t rank = static_cast<size_t>(std::ceil(p * values.size()));
+				return values[std::clamp(rank, (size_t)1, values.size()) - 1];
+			};
+			return StringUtil::format("{\"mean\":%.3f,\"p50\":%.3f,\"p90\":%.3f,\"p95\":%.3f,\"p99\":%.3f,\"max\":%.3f}",
+				sum / values.size(), percentile(0.5f), percentile(0.9f), percentile(0.95f), percentile(0.99f), values.back());
+		};
+
+		double draw_count = 0.0, instance_count = 0.0;
+		for (const FrameSample& sample : m_samples)
+		{
+			draw_count += sample.draw_count;
+			instance_count += sample.instance_count;
+		}
+
+		const VkPhysicalDeviceProperties& properties = VulkanRHI::get().getPhysicalDeviceProperties();
+		std::string json = "{\n";
+		json += StringUtil::format("\"world\":\"%s\",\n", m_options.world_url.c_str());
+		json += StringUtil::format("\"device\":\"%s\",\n", properties.deviceName);
+		json += StringUtil::format("\"width\":%u,\"height\":%u,\"frames\":%u,\"warmup_frames\":%u,\n",
+			m_options.width, m_options.height, m_options.frame_count, m_options.warmup_frame_count);
+		json += "\"cpu_frame_ms\":" + percentiles(&FrameSample::cpu_time_ms) + ",\n";
+		json += "\"gpu_frame_ms\":" + percentiles(&FrameSample::gpu_time_ms) + ",\n";
+		json += StringUtil::format("\"draws\":{\"draw_count\":%.1f,\"instance_count\":%.1f},\n",
+			draw_count / m_samples.size(), instance_count / m_samples.size());
+		json += StringUtil::format("\"memory_mb\":{\"allocation\":%.2f,\"peak_allocation\":%.2f,\"usage\":%.2f,\"budget\":%.2f}\n",
+			m_allocation_mb, m_peak_allocation_mb, m_usage_mb, m_budget_mb);
+		json += "}";
+		return json;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <string>
+#include <vector>
+
+namespace Bamboo
+{
+	struct BenchOptions
+	{
+		std::string world_url;
+		uint32_t frame_count = 300;
+		uint32_t warmup_frame_count = 60;
+		uint32_t width = 1280;
+		uint32_t height = 720;
+		float orbit_radius = 10.0f;
+		std::string output_filename;
+	};
+
+	// renders frames of a world headless while the camera orbits the point it initially looks at,
+	// then reports cpu/gpu frame time percentiles, draw counts and gpu memory as json
+	class Bench
+	{
+	public:
+		bool init(int argc, char** argv);
+		void destroy();
+		bool run();
+
+	private:
+		struct FrameSample
+		{
+			float cpu_time_ms;
+			float gpu_time_ms;
+			uint32_t draw_count;
+			uint32_t instance_count;
+		};
+
+		bool parseOptions(int argc, char** argv);
+		bool updateCamera(uint32_t frame_index);
+		void sampleMemory();
+		std::string toJson();
+
+		class Engine* m_engine = nullptr;
+		BenchOptions m_options;
+
+		bool m_is_camera_inited = false;
+		float m_initial_yaw = 0.0f;
+		glm::vec3 m_orbit_center = glm::vec3(0.0f);
+
+		std::vector<FrameSample> m_samples;
+		double m_allocation_mb = 0.0;
+		double m_peak_allocation_mb = 0.0;
+		double m_usage_mb = 0.0;
+		double m_budget_mb = 0.0;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,10 @@
+#include "bench.h"
+
+int main(int argc, char** argv)
+{
+	Bamboo::Bench bench;
+	bool result = bench.init(argc, argv) && bench.run();
+	bench.destroy();
+
+	return result ? 0 : 1;
+}
\ No newline at end of file
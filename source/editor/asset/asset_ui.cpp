@@ -348,6 +348,12 @@ namespace Bamboo
 					static bool combine_meshes = true;
 					ImGui::Checkbox("combine meshes", &combine_meshes);
 
+					static bool optimize_meshes = true;
+					ImGui::Checkbox("optimize meshes", &optimize_meshes);
+
+					static bool generate_lods = true;
+					ImGui::Checkbox("generate lods", &generate_lods);
+
 					ImGui::SeparatorText("Material");
 					static bool contains_occlusion_channel = true;
 					ImGui::Checkbox("contain occlusion channel", &contains_occlusion_channel);
@@ -359,7 +365,7 @@ namespace Bamboo
 						StopWatch stop_watch;
 						stop_watch.start();
 
-						as->importGltf(import_file, import_folder, { combine_meshes, force_static_mesh, contains_occlusion_channel });
+						as->importGltf(import_file, import_folder, { combine_meshes, force_static_mesh, optimize_meshes, generate_lods, contains_occlusion_channel });
 						LOG_INFO("import gltf {} to {}, elapsed time: {}ms", import_file, import_folder, stop_watch.stopMs());
 						iter = m_imported_files.erase(iter);
 					}
@@ -7,11 +7,13 @@
 #include "editor/simulation/simulation_ui.h"
 #include "editor/asset/asset_ui.h"
 #include "editor/log/log_ui.h"
+#include "editor/profiler/profiler_ui.h"
 
 #include "engine/engine.h"
 #include "engine/core/base/macro.h"
 #include "engine/core/vulkan/vulkan_rhi.h"
 #include "engine/core/event/event_system.h"
+#include "engine/function/render/render_system.h"
 
 namespace Bamboo
 {
@@ -32,8 +34,9 @@ namespace Bamboo
         std::shared_ptr<EditorUI> property_ui = std::make_shared<PropertyUI>();
         std::shared_ptr<EditorUI> asset_ui = std::make_shared<AssetUI>();
         std::shared_ptr<EditorUI> log_ui = std::make_shared<LogUI>();
+        std::shared_ptr<EditorUI> profiler_ui = std::make_shared<ProfilerUI>();
         m_simulation_ui = std::make_shared<SimulationUI>();
-        m_editor_uis = { menu_ui, tool_ui, world_ui, property_ui, asset_ui, m_simulation_ui, log_ui };
+        m_editor_uis = { menu_ui, tool_ui, world_ui, property_ui, asset_ui, m_simulation_ui, log_ui, profiler_ui };
 
 
         //m_editor_uis = {log_ui };
@@ -49,7 +52,8 @@ namespace Bamboo
 
     void Editor::destroy()
     {
-		// wait all gpu operations done
+		// wait all ticked frames rendered and all gpu operations done
+		g_engine.renderSystem()->flush();
 		VulkanRHI::get().waitDeviceIdle();
 
 		// destroy all editor uis
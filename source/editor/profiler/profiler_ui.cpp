@@ -0,0 +1,135 @@
+#include "profiler_ui.h"
+#include "engine/core/base/macro.h"
+#include "engine/function/render/render_system.h"
+#include "engine/function/render/gpu_profiler.h"
+#include "engine/core/profile/cpu_profiler.h"
+#include "engine/core/time/frame_pacer.h"
+#include "engine/core/service/service_locator.h"
+#include "engine/core/vulkan/vulkan_rhi.h"
+
+namespace Bamboo
+{
+	void ProfilerUI::init()
+	{
+		m_title = "Profiler";
+	}
+
+	void ProfilerUI::construct()
+	{
+		sprintf(m_title_buf, "%s %s###%s", ICON_FA_TACHOMETER_ALT, m_title.c_str(), m_title.c_str());
+		if (!ImGui::Begin(m_title_buf))
+		{
+			ImGui::End();
+			return;
+		}
+
+		std::shared_ptr<GPUProfiler> gpu_profiler = g_engine.renderSystem()->getGPUProfiler();
+		bool enabled = gpu_profiler->isEnabled();
+		if (ImGui::Checkbox("gpu timestamps", &enabled))
+		{
+			gpu_profiler->setEnabled(enabled);
+		}
+
+		ImGui::SameLine();
+		ImGui::BeginDisabled(!gpu_profiler->isPipelineStatisticsSupported());
+		bool pipeline_statistics_enabled = gpu_profiler->isPipelineStatisticsEnabled();
+		if (ImGui::Checkbox("pipeline statistics", &pipeline_statistics_enabled))
+		{
+			gpu_profiler->setPipelineStatisticsEnabled(pipeline_statistics_enabled);
+		}
+		ImGui::EndDisabled();
+
+		// cpu traces are exported to the log directory as chrome trace json
+		const uint32_t k_capture_frame_count = 10;
+		ImGui::SameLine();
+		ImGui::BeginDisabled(CPUProfiler::get().isCapturing());
+		if (ImGui::Button("capture cpu trace"))
+		{
+			CPUProfiler::get().captureFrames(k_capture_frame_count);
+		}
+		ImGui::EndDisabled();
+
+		// frame pacing, a changed present mode recreates the swapchain before the next frame
+		const std::vector<std::pair<const char*, VkPresentModeKHR>> k_present_modes = {
+			{ "fifo", VK_PRESENT_MODE_FIFO_KHR }, { "mailbox", VK_PRESENT_MODE_MAILBOX_KHR }, { "immediate", VK_PRESENT_MODE_IMMEDIATE_KHR }
+		};
+		VkPresentModeKHR present_mode = VulkanRHI::get().getPresentMode();
+		const char* present_mode_name = "";
+		for (const auto& iter : k_present_modes)
+		{
+			if (iter.second == present_mode)
+			{
+				present_mode_name = iter.first;
+			}
+		}
+
+		ImGui::SetNextItemWidth(100.0f);
+		if (ImGui::BeginCombo("present mode", present_mode_name))
+		{
+			for (const auto& iter : k_present_modes)
+			{
+				if (ImGui::Selectable(iter.first, iter.second == present_mode))
+				{
+					VulkanRHI::get().setPresentMode(iter.second);
+				}
+			}
+			ImGui::EndCombo();
+		}
+
+		std::shared_ptr<FramePacer> frame_pacer = Services().getService<FramePacer>();
+		if (frame_pacer)
+		{
+			ImGui::SameLine();
+			ImGui::SetNextItemWidth(100.0f);
+			int target_frame_rate = frame_pacer->getTargetFrameRate();
+			if (ImGui::InputInt("target fps", &target_frame_rate, 10, 30))
+			{
+				frame_pacer->setTargetFrameRate(target_frame_rate);
+			}
+
+			ImGui::SameLine();
+			bool low_latency = frame_pacer->isLowLatency();
+			if (ImGui::Checkbox("low latency", &low_latency))
+			{
+				frame_pacer->setLowLatency(low_latency);
+			}
+		}
+
+		float frame_time_ms = gpu_profiler->getFrameTimeMs();
+		ImGui::Text("gpu frame: %.3f ms", frame_time_ms);
+
+		ImGuiTableFlags table_flags = ImGuiTableFlags_BordersV | ImGuiTableFlags_BordersOuterH | ImGuiTableFlags_Resizable | ImGuiTableFlags_RowBg;
+		if (ImGui::BeginTable("gpu_profile_scopes", 5, table_flags))
+		{
+			ImGui::TableSetupColumn("pass", ImGuiTableColumnFlags_WidthFixed, 140.0f);
+			ImGui::TableSetupColumn("time", ImGuiTableColumnFlags_WidthStretch);
+			ImGui::TableSetupColumn("vertices", ImGuiTableColumnFlags_WidthFixed, 90.0f);
+			ImGui::TableSetupColumn("fragments", ImGuiTableColumnFlags_WidthFixed, 90.0f);
+			ImGui::TableSetupColumn("compute", ImGuiTableColumnFlags_WidthFixed, 90.0f);
+			ImGui::TableHeadersRow();
+
+			for (const GPUProfileScope& scope : gpu_profiler->getScopes())
+			{
+				ImGui::TableNextRow();
+				ImGui::TableNextColumn();
+				ImGui::Text("%s", scope.name.c_str());
+
+				// bar of the scope's share of the gpu frame
+				ImGui::TableNextColumn();
+				char time_buf[32];
+				sprintf(time_buf, "%.3f ms", scope.time_ms);
+				ImGui::ProgressBar(frame_time_ms > 0.0f ? scope.time_ms / frame_time_ms : 0.0f, ImVec2(-1.0f, 0.0f), time_buf);
+
+				ImGui::TableNextColumn();
+				ImGui::Text("%llu", (unsigned long long)scope.vertex_invocations);
+				ImGui::TableNextColumn();
+				ImGui::Text("%llu", (unsigned long long)scope.fragment_invocations);
+				ImGui::TableNextColumn();
+				ImGui::Text("%llu", (unsigned long long)scope.compute_invocations);
+			}
+			ImGui::EndTable();
+		}
+
+		ImGui::End();
+	}
+}
\ No newline at end of file
@@ -0,0 +1,14 @@
+#pragma once
+
+#include "editor/base/editor_ui.h"
+
+namespace Bamboo
+{
+	// per render pass gpu times and pipeline statistics of the gpu profiler
+	class ProfilerUI : public EditorUI
+	{
+	public:
+		virtual void init() override;
+		virtual void construct() override;
+	};
+}
\ No newline at end of file
@@ -164,7 +164,7 @@ namespace Bamboo
 
 		static std::vector<std::pair<std::string, bool>> shows = {
 			{ "anti-aliasing", false }, { "bounding boxes", false }, { "collision", false }, { "grid", false }, 
-			{ "static meshes", true }, { "skeletal meshes", true }, { "translucency", true }
+			{ "static meshes", true }, { "skeletal meshes", true }, { "translucency", true }, { "render stats", false }
 		};
 		constructCheckboxPopup("show", shows);
 		ImGui::PopStyleVar(3);
@@ -172,6 +172,8 @@ namespace Bamboo
 		constructOperationModeButtons();
 		ImGui::PopStyleColor();
 
+		constructRenderStats();
+
 		constructImGuizmo();
 
 		ImGui::End();
@@ -318,6 +320,24 @@ namespace Bamboo
 		}
 	}
 
+	void SimulationUI::constructRenderStats()
+	{
+		if ((g_engine.renderSystem()->getShowDebugOption() & (1 << 7)) == 0)
+		{
+			return;
+		}
+
+		DrawStats draw_stats = g_engine.renderSystem()->getDrawStats();
+		ImGui::SetCursorPos(ImVec2(10, 60));
+		ImGui::Text("draws: %u", draw_stats.draw_count);
+		ImGui::SetCursorPosX(10);
+		ImGui::Text("instances: %u", draw_stats.instance_count);
+		ImGui::SetCursorPosX(10);
+		ImGui::Text("binds: %u", draw_stats.bind_count);
+		ImGui::SetCursorPosX(10);
+		ImGui::Text("saved binds: %u", draw_stats.saved_bind_count);
+	}
+
 	void SimulationUI::constructImGuizmo()
 	{
  		if (!m_selected_entity.lock())
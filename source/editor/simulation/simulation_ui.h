@@ -28,6 +28,7 @@ namespace Bamboo
 		bool constructRadioButtonPopup(const std::string& popup_name, const std::vector<std::string>& values, int& index);
 		void constructCheckboxPopup(const std::string& popup_name, std::vector<std::pair<std::string, bool>>& values);
 		void constructOperationModeButtons();
+		void constructRenderStats();
 		void constructImGuizmo();
 
 		void onKey(const std::shared_ptr<class Event>& event);
@@ -43,4 +43,40 @@ namespace Bamboo
 		return m_config_node["is_editor"].as<bool>();
 	}
 
+	int ConfigManager::getProfileCaptureFrames()
+	{
+		const YAML::Node& node = m_config_node["profile_capture_frames"];
+		return node ? node.as<int>() : 0;
+	}
+
+	bool ConfigManager::isRenderThreadEnabled()
+	{
+		const YAML::Node& node = m_config_node["render_thread"];
+		return node ? node.as<bool>() : false;
+	}
+
+	int ConfigManager::getFramesInFlight()
+	{
+		const YAML::Node& node = m_config_node["frames_in_flight"];
+		return node ? node.as<int>() : 2;
+	}
+
+	std::string ConfigManager::getPresentMode()
+	{
+		const YAML::Node& node = m_config_node["present_mode"];
+		return node ? node.as<std::string>() : "mailbox";
+	}
+
+	int ConfigManager::getTargetFrameRate()
+	{
+		const YAML::Node& node = m_config_node["target_frame_rate"];
+		return node ? node.as<int>() : 0;
+	}
+
+	bool ConfigManager::isLowLatencyEnabled()
+	{
+		const YAML::Node& node = m_config_node["low_latency"];
+		return node ? node.as<bool>() : false;
+	}
+
 }
\ No newline at end of file
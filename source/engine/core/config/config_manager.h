@@ -20,6 +20,13 @@ namespace Bamboo
 		bool getSaveLayout();
 		
 		bool isEditor();
+		int getProfileCaptureFrames();
+		bool isRenderThreadEnabled();
+
+		int getFramesInFlight();
+		std::string getPresentMode();
+		int getTargetFrameRate();
+		bool isLowLatencyEnabled();
 
 	private:
 		YAML::Node m_config_node;
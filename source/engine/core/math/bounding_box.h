@@ -1,7 +1,7 @@
 #pragma once
 
 #include <glm/glm.hpp>
-#include <cereal/access.hpp>
+#include <cereal/cereal.hpp>
 #include <limits>
 
 namespace Bamboo
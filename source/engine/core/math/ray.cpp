@@ -0,0 +1,88 @@
+#include "ray.h"
+#include <algorithm>
+
+namespace Bamboo
+{
+	Ray Ray::unproject(const glm::vec2& ndc_pos, const glm::mat4& inv_view_proj)
+	{
+		glm::vec4 near_pos = inv_view_proj * glm::vec4(ndc_pos, 0.0f, 1.0f);
+		glm::vec4 far_pos = inv_view_proj * glm::vec4(ndc_pos, 1.0f, 1.0f);
+
+		Ray ray;
+		ray.m_origin = glm::vec3(near_pos) / near_pos.w;
+		ray.m_direction = glm::vec3(far_pos) / far_pos.w - ray.m_origin;
+		return ray;
+	}
+
+	Ray Ray::transform(const glm::mat4& m) const
+	{
+		Ray ray;
+		ray.m_origin = m * glm::vec4(m_origin, 1.0f);
+		ray.m_direction = glm::mat3(m) * m_direction;
+		return ray;
+	}
+
+	glm::vec3 Ray::at(float t) const
+	{
+		return m_origin + m_direction * t;
+	}
+
+	bool Ray::intersect(const BoundingBox& bounding_box, float max_t, float& t) const
+	{
+		// slab test, divisions by zero give infinities which compare correctly
+		glm::vec3 inv_direction = 1.0f / m_direction;
+		glm::vec3 t0 = (bounding_box.m_min - m_origin) * inv_direction;
+		glm::vec3 t1 = (bounding_box.m_max - m_origin) * inv_direction;
+		glm::vec3 t_min = glm::min(t0, t1);
+		glm::vec3 t_max = glm::max(t0, t1);
+
+		float enter_t = std::max(std::max(t_min.x, t_min.y), std::max(t_min.z, 0.0f));
+		float exit_t = std::min(std::min(t_max.x, t_max.y), std::min(t_max.z, max_t));
+		if (enter_t > exit_t)
+		{
+			return false;
+		}
+
+		t = enter_t;
+		return true;
+	}
+
+	bool Ray::intersect(const glm::vec3& v0, const glm::vec3& v1, const glm::vec3& v2, float max_t, float& t) const
+	{
+		// moller-trumbore
+		const float k_epsilon = 1e-9f;
+
+		glm::vec3 e1 = v1 - v0;
+		glm::vec3 e2 = v2 - v0;
+		glm::vec3 p = glm::cross(m_direction, e2);
+		float det = glm::dot(e1, p);
+		if (std::abs(det) < k_epsilon)
+		{
+			return false;
+		}
+
+		float inv_det = 1.0f / det;
+		glm::vec3 s = m_origin - v0;
+		float u = glm::dot(s, p) * inv_det;
+		if (u < 0.0f || u > 1.0f)
+		{
+			return false;
+		}
+
+		glm::vec3 q = glm::cross(s, e1);
+		float v = glm::dot(m_direction, q) * inv_det;
+		if (v < 0.0f || u + v > 1.0f)
+		{
+			return false;
+		}
+
+		float hit_t = glm::dot(e2, q) * inv_det;
+		if (hit_t < 0.0f || hit_t > max_t)
+		{
+			return false;
+		}
+
+		t = hit_t;
+		return true;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "bounding_box.h"
+
+namespace Bamboo
+{
+	// ray points are origin + direction * t, the direction isn't normalized,
+	// so t stays the same if the ray is transformed by an affine matrix
+	struct Ray
+	{
+		glm::vec3 m_origin;
+		glm::vec3 m_direction;
+
+		// ray from the near to the far plane through a normalized device position
+		static Ray unproject(const glm::vec2& ndc_pos, const glm::mat4& inv_view_proj);
+
+		Ray transform(const glm::mat4& m) const;
+		glm::vec3 at(float t) const;
+
+		// entry t of the box, which is 0 if the origin is inside of it
+		bool intersect(const BoundingBox& bounding_box, float max_t, float& t) const;
+
+		// two-sided triangle intersection
+		bool intersect(const glm::vec3& v0, const glm::vec3& v1, const glm::vec3& v2, float max_t, float& t) const;
+	};
+}
\ No newline at end of file
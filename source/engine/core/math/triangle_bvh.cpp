@@ -0,0 +1,156 @@
+#include "triangle_bvh.h"
+#include <algorithm>
+#include <numeric>
+
+namespace Bamboo
+{
+	const uint32_t k_max_leaf_triangle_count = 4;
+	const uint32_t k_max_traversal_depth = 64;
+
+	void TriangleBVH::build(const std::vector<glm::vec3>& positions, const std::vector<uint32_t>& indices)
+	{
+		clear();
+
+		uint32_t triangle_count = static_cast<uint32_t>(indices.size() / 3);
+		if (triangle_count == 0)
+		{
+			return;
+		}
+
+		m_triangles.resize(triangle_count * 3);
+		std::vector<glm::vec3> centroids(triangle_count);
+		for (uint32_t i = 0; i < triangle_count; ++i)
+		{
+			for (uint32_t v = 0; v < 3; ++v)
+			{
+				m_triangles[i * 3 + v] = positions[indices[i * 3 + v]];
+			}
+			centroids[i] = (m_triangles[i * 3] + m_triangles[i * 3 + 1] + m_triangles[i * 3 + 2]) / 3.0f;
+		}
+
+		m_nodes.reserve(triangle_count * 2 / k_max_leaf_triangle_count + 1);
+		m_nodes.emplace_back();
+		buildNode(0, 0, triangle_count, centroids);
+	}
+
+	void TriangleBVH::clear()
+	{
+		m_nodes.clear();
+		m_triangles.clear();
+	}
+
+	bool TriangleBVH::intersect(const Ray& ray, float max_t, float& t) const
+	{
+		if (m_nodes.empty())
+		{
+			return false;
+		}
+
+		// visit the nearer child first, so farther subtrees are mostly rejected by their entry t
+		bool hit = false;
+		uint32_t stack[k_max_traversal_depth];
+		uint32_t stack_size = 0;
+		stack[stack_size++] = 0;
+		while (stack_size > 0)
+		{
+			uint32_t node_index = stack[--stack_size];
+			const Node& node = m_nodes[node_index];
+			float node_t;
+			if (!ray.intersect(node.bounding_box, max_t, node_t))
+			{
+				continue;
+			}
+
+			if (node.triangle_count > 0)
+			{
+				for (uint32_t i = node.offset; i < node.offset + node.triangle_count; ++i)
+				{
+					float triangle_t;
+					if (ray.intersect(m_triangles[i * 3], m_triangles[i * 3 + 1], m_triangles[i * 3 + 2], max_t, triangle_t))
+					{
+						max_t = triangle_t;
+						hit = true;
+					}
+				}
+				continue;
+			}
+
+			uint32_t left = node_index + 1;
+			uint32_t right = node.offset;
+			float left_t, right_t;
+			bool left_hit = ray.intersect(m_nodes[left].bounding_box, max_t, left_t);
+			bool right_hit = ray.intersect(m_nodes[right].bounding_box, max_t, right_t);
+			if (left_hit && right_hit && left_t < right_t)
+			{
+				std::swap(left, right);
+			}
+			if (right_hit)
+			{
+				stack[stack_size++] = right;
+			}
+			if (left_hit)
+			{
+				stack[stack_size++] = left;
+			}
+		}
+
+		if (hit)
+		{
+			t = max_t;
+		}
+		return hit;
+	}
+
+	void TriangleBVH::buildNode(uint32_t node_index, uint32_t first_triangle, uint32_t triangle_count, std::vector<glm::vec3>& centroids)
+	{
+		BoundingBox bounding_box, centroid_box;
+		bounding_box.m_max = centroid_box.m_max = glm::vec3(-std::numeric_limits<float>::max());
+		for (uint32_t i = first_triangle; i < first_triangle + triangle_count; ++i)
+		{
+			bounding_box.combine(m_triangles[i * 3]);
+			bounding_box.combine(m_triangles[i * 3 + 1]);
+			bounding_box.combine(m_triangles[i * 3 + 2]);
+			centroid_box.combine(centroids[i]);
+		}
+		m_nodes[node_index].bounding_box = bounding_box;
+
+		// split at the centroid median of the longest axis, the tree depth stays logarithmic
+		glm::vec3 centroid_extent = centroid_box.m_max - centroid_box.m_min;
+		if (triangle_count <= k_max_leaf_triangle_count || 
+			(centroid_extent.x <= 0.0f && centroid_extent.y <= 0.0f && centroid_extent.z <= 0.0f))
+		{
+			m_nodes[node_index].offset = first_triangle;
+			m_nodes[node_index].triangle_count = triangle_count;
+			return;
+		}
+
+		int axis = centroid_extent.x > centroid_extent.y ? (centroid_extent.x > centroid_extent.z ? 0 : 2) : (centroid_extent.y > centroid_extent.z ? 1 : 2);
+		std::vector<uint32_t> order(triangle_count);
+		std::iota(order.begin(), order.end(), first_triangle);
+		uint32_t left_count = triangle_count / 2;
+		std::nth_element(order.begin(), order.begin() + left_count, order.end(), [&centroids, axis](uint32_t a, uint32_t b) {
+			return centroids[a][axis] < centroids[b][axis];
+		});
+
+		// reorder the node's triangles and centroids
+		std::vector<glm::vec3> triangles(triangle_count * 3);
+		std::vector<glm::vec3> node_centroids(triangle_count);
+		for (uint32_t i = 0; i < triangle_count; ++i)
+		{
+			std::copy_n(&m_triangles[order[i] * 3], 3, &triangles[i * 3]);
+			node_centroids[i] = centroids[order[i]];
+		}
+		std::copy(triangles.begin(), triangles.end(), m_triangles.begin() + first_triangle * 3);
+		std::copy(node_centroids.begin(), node_centroids.end(), centroids.begin() + first_triangle);
+
+		uint32_t left = static_cast<uint32_t>(m_nodes.size());
+		m_nodes.emplace_back();
+		m_nodes[node_index].triangle_count = 0;
+		buildNode(left, first_triangle, left_count, centroids);
+
+		uint32_t right = static_cast<uint32_t>(m_nodes.size());
+		m_nodes.emplace_back();
+		m_nodes[node_index].offset = right;
+		buildNode(right, first_triangle + left_count, triangle_count - left_count, centroids);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "ray.h"
+#include <vector>
+
+namespace Bamboo
+{
+	// bounding volume hierarchy over a mesh's triangles for cpu ray casts,
+	// nodes are stored depth first, so an interior node's left child directly follows it
+	class TriangleBVH
+	{
+	public:
+		void build(const std::vector<glm::vec3>& positions, const std::vector<uint32_t>& indices);
+		void clear();
+		bool empty() const { return m_nodes.empty(); }
+
+		// closest hit t of the ray up to max_t
+		bool intersect(const Ray& ray, float max_t, float& t) const;
+
+	private:
+		struct Node
+		{
+			BoundingBox bounding_box;
+
+			// right child of interior nodes, or first triangle of leaves
+			uint32_t offset;
+			uint32_t triangle_count;
+		};
+
+		void buildNode(uint32_t node_index, uint32_t first_triangle, uint32_t triangle_count, std::vector<glm::vec3>& centroids);
+
+		std::vector<Node> m_nodes;
+
+		// three vertices per triangle in leaf order
+		std::vector<glm::vec3> m_triangles;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,203 @@
+#include "cpu_profiler.h"
+#include "engine/platform/string/string_util.h"
+#include <algorithm>
+#include <chrono>
+#include <stack>
+
+namespace Bamboo
+{
+	// power of two, so a buffer keeps a few hundred frames of a heavily instrumented thread
+	const uint64_t k_thread_buffer_capacity = 1 << 16;
+
+	thread_local CPUProfiler::ThreadBufferHandle CPUProfiler::s_thread_buffer_handle;
+
+	CPUProfiler::ThreadBufferHandle::~ThreadBufferHandle()
+	{
+		if (buffer)
+		{
+			CPUProfiler& cpu_profiler = CPUProfiler::get();
+			std::lock_guard<std::mutex> lock(cpu_profiler.m_mutex);
+			cpu_profiler.m_free_thread_buffers.push_back(buffer);
+		}
+	}
+
+	void CPUProfiler::markFrame()
+	{
+		writeEvent(nullptr, EProfileEventType::Frame);
+		m_frame_index++;
+
+		// a capture starts at the next frame marker and is exported at the marker ending its last frame
+		if (m_capture_frame_count == 0)
+		{
+			return;
+		}
+
+		if (m_capture_begin_ns == 0)
+		{
+			m_capture_begin_ns = getTimeNs();
+			return;
+		}
+
+		if (--m_capture_frame_count == 0)
+		{
+			exportTrace(m_capture_begin_ns);
+			m_capture_begin_ns = 0;
+		}
+	}
+
+	const char* CPUProfiler::internName(const std::string& name)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_interned_names.insert(name).first->c_str();
+	}
+
+	void CPUProfiler::setThreadName(const std::string& name)
+	{
+		ThreadBuffer* buffer = acquireThreadBuffer();
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_thread_names[buffer->thread_id] = name;
+	}
+
+	void CPUProfiler::captureFrames(uint32_t frame_count)
+	{
+#if ENABLE_CPU_PROFILER
+		m_capture_frame_count = frame_count;
+		m_capture_begin_ns = 0;
+		LOG_INFO("capture cpu trace of the next {} frames", frame_count);
+#else
+		LOG_WARNING("cpu profiler is compiled out, nothing to capture");
+#endif
+	}
+
+	std::string CPUProfiler::exportTrace(uint64_t begin_ns)
+	{
+		// snapshot every ring buffer, events overwritten by their thread while being copied are dropped
+		std::vector<ProfileEvent> events;
+		std::map<uint32_t, std::string> thread_names;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			for (const auto& buffer : m_thread_buffers)
+			{
+				uint64_t head = buffer->head.load(std::memory_order_acquire);
+				uint64_t tail = head > k_thread_buffer_capacity ? head - k_thread_buffer_capacity : 0;
+				std::vector<ProfileEvent> buffer_events;
+				for (uint64_t i = tail; i < head; ++i)
+				{
+					buffer_events.push_back(buffer->events[i & (k_thread_buffer_capacity - 1)]);
+				}
+
+				uint64_t new_head = buffer->head.load(std::memory_order_acquire);
+				uint64_t valid_tail = new_head > k_thread_buffer_capacity ? new_head - k_thread_buffer_capacity : 0;
+				size_t overwritten_count = static_cast<size_t>(std::min(std::max(valid_tail, tail) - tail, head - tail));
+				events.insert(events.end(), buffer_events.begin() + overwritten_count, buffer_events.end());
+			}
+			thread_names = m_thread_names;
+		}
+
+		// pair begin and end events of every thread into complete events, pairs cut off by the ring buffer are dropped
+		std::stable_sort(events.begin(), events.end(), [](const ProfileEvent& a, const ProfileEvent& b) { return a.thread_id < b.thread_id; });
+		std::vector<std::string> trace_events;
+		auto escape = [](const char* name) {
+			std::string str;
+			for (const char* p = name; *p; ++p)
+			{
+				if (*p == '"' || *p == '\\')
+				{
+					str += '\\';
+				}
+				str += *p;
+			}
+			return str;
+		};
+		std::stack<const ProfileEvent*> begin_events;
+		for (size_t i = 0; i < events.size(); ++i)
+		{
+			const ProfileEvent& event = events[i];
+			if (i > 0 && events[i - 1].thread_id != event.thread_id)
+			{
+				begin_events = {};
+			}
+
+			if (event.type == EProfileEventType::Begin)
+			{
+				begin_events.push(&event);
+			}
+			else if (event.type == EProfileEventType::End && !begin_events.empty())
+			{
+				const ProfileEvent* begin_event = begin_events.top();
+				begin_events.pop();
+				if (begin_event->time_ns >= begin_ns)
+				{
+					trace_events.push_back(StringUtil::format("{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":0,\"tid\":%u}",
+						escape(begin_event->name).c_str(), begin_event->time_ns * 1e-3, (event.time_ns - begin_event->time_ns) * 1e-3, event.thread_id));
+				}
+			}
+			else if (event.type == EProfileEventType::Frame && event.time_ns >= begin_ns)
+			{
+				trace_events.push_back(StringUtil::format("{\"name\":\"frame\",\"ph\":\"i\",\"s\":\"g\",\"ts\":%.3f,\"pid\":0,\"tid\":%u}",
+					event.time_ns * 1e-3, event.thread_id));
+			}
+		}
+
+		for (const auto& iter : thread_names)
+		{
+			trace_events.push_back(StringUtil::format("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+				iter.first, escape(iter.second.c_str()).c_str()));
+		}
+		std::string json = "{\"traceEvents\":[\n";
+		for (size_t i = 0; i < trace_events.size(); ++i)
+		{
+			json += trace_events[i] + (i + 1 < trace_events.size() ? ",\n" : "\n");
+		}
+		json += "]}";
+
+		const auto& fs = g_engine.fileSystem();
+		std::string filename = fs->combine(fs->getLogDir(), StringUtil::format("bamboo_trace_%u.json", m_frame_index));
+		if (!fs->writeString(filename, json))
+		{
+			LOG_ERROR("failed to write cpu trace {}", filename);
+			return "";
+		}
+		LOG_INFO("exported cpu trace {}", filename);
+		return filename;
+	}
+
+	void CPUProfiler::writeEvent(const char* name, EProfileEventType type)
+	{
+		// only the owning thread writes its buffer, the release store publishes the event to exportTrace
+		ThreadBuffer* buffer = acquireThreadBuffer();
+		uint64_t head = buffer->head.load(std::memory_order_relaxed);
+		buffer->events[head & (k_thread_buffer_capacity - 1)] = { name, getTimeNs(), buffer->thread_id, type };
+		buffer->head.store(head + 1, std::memory_order_release);
+	}
+
+	CPUProfiler::ThreadBuffer* CPUProfiler::acquireThreadBuffer()
+	{
+		ThreadBufferHandle& handle = s_thread_buffer_handle;
+		if (handle.buffer)
+		{
+			return handle.buffer;
+		}
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (!m_free_thread_buffers.empty())
+		{
+			handle.buffer = m_free_thread_buffers.back();
+			m_free_thread_buffers.pop_back();
+		}
+		else
+		{
+			m_thread_buffers.push_back(std::make_unique<ThreadBuffer>());
+			handle.buffer = m_thread_buffers.back().get();
+			handle.buffer->events.resize(k_thread_buffer_capacity);
+		}
+		handle.buffer->thread_id = m_next_thread_id++;
+		return handle.buffer;
+	}
+
+	uint64_t CPUProfiler::getTimeNs()
+	{
+		static const auto k_start_time = std::chrono::steady_clock::now();
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - k_start_time).count();
+	}
+}
\ No newline at end of file
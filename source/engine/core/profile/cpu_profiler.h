@@ -0,0 +1,107 @@
+#pragma once
+
+#include "engine/core/base/macro.h"
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#define ENABLE_CPU_PROFILER DEBUG
+
+#if ENABLE_CPU_PROFILER
+#define PROFILE_CONCAT_IMPL(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_IMPL(a, b)
+#define PROFILE_SCOPE(name) Bamboo::ProfileScope PROFILE_CONCAT(profile_scope_, __LINE__)(name)
+#define PROFILE_FRAME() Bamboo::CPUProfiler::get().markFrame()
+#else
+#define PROFILE_SCOPE(name)
+#define PROFILE_FRAME()
+#endif
+
+namespace Bamboo
+{
+	enum class EProfileEventType : uint32_t
+	{
+		Begin, End, Frame
+	};
+
+	struct ProfileEvent
+	{
+		const char* name;
+		uint64_t time_ns;
+		uint32_t thread_id;
+		EProfileEventType type;
+	};
+
+	// every thread writes begin and end events into its own lock-free ring buffer, which only keeps the latest events.
+	// event names aren't copied, so they have to be string literals or interned names.
+	// traces are exported as chrome trace json, which chrome://tracing and perfetto open
+	class CPUProfiler
+	{
+	public:
+		void beginEvent(const char* name) { writeEvent(name, EProfileEventType::Begin); }
+		void endEvent() { writeEvent(nullptr, EProfileEventType::End); }
+
+		// called once per frame on the main thread, finishes a pending capture
+		void markFrame();
+
+		// returns a name which lives as long as the profiler, for names built at runtime
+		const char* internName(const std::string& name);
+		void setThreadName(const std::string& name);
+
+		// exports the events of the next frame_count frames once they're finished
+		void captureFrames(uint32_t frame_count);
+		bool isCapturing() { return m_capture_frame_count > 0; }
+
+		// exports all buffered events since begin_ns, returns the trace filename
+		std::string exportTrace(uint64_t begin_ns = 0);
+
+		static CPUProfiler& get()
+		{
+			static CPUProfiler cpu_profiler;
+			return cpu_profiler;
+		}
+
+	private:
+		struct ThreadBuffer
+		{
+			std::vector<ProfileEvent> events;
+			std::atomic<uint64_t> head = 0;
+			uint32_t thread_id = 0;
+		};
+
+		// buffers of finished threads are reused by new threads, their events keep the old thread id
+		struct ThreadBufferHandle
+		{
+			ThreadBuffer* buffer = nullptr;
+			~ThreadBufferHandle();
+		};
+
+		void writeEvent(const char* name, EProfileEventType type);
+		ThreadBuffer* acquireThreadBuffer();
+		uint64_t getTimeNs();
+
+		std::mutex m_mutex;
+		std::vector<std::unique_ptr<ThreadBuffer>> m_thread_buffers;
+		std::vector<ThreadBuffer*> m_free_thread_buffers;
+		uint32_t m_next_thread_id = 0;
+		std::map<uint32_t, std::string> m_thread_names;
+		std::unordered_set<std::string> m_interned_names;
+
+		uint32_t m_frame_index = 0;
+		uint32_t m_capture_frame_count = 0;
+		uint64_t m_capture_begin_ns = 0;
+
+		static thread_local ThreadBufferHandle s_thread_buffer_handle;
+	};
+
+	class ProfileScope
+	{
+	public:
+		ProfileScope(const char* name) { CPUProfiler::get().beginEvent(name); }
+		~ProfileScope() { CPUProfiler::get().endEvent(); }
+	};
+}
\ No newline at end of file
@@ -0,0 +1,121 @@
+#include "frame_pacer.h"
+#include "engine/core/profile/cpu_profiler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <timeapi.h>
+#endif
+
+namespace Bamboo
+{
+    FramePacer::FramePacer()
+        : m_target_frame_rate(0)
+        , m_low_latency(false)
+        , m_high_timer_resolution(false)
+        , m_next_frame_time(std::chrono::steady_clock::now())
+        , m_sleep_estimate(0.005)
+        , m_sleep_mean(0.005)
+        , m_sleep_m2(0.0)
+        , m_sleep_count(1)
+    {
+    }
+
+    FramePacer::~FramePacer()
+    {
+        setHighTimerResolution(false);
+    }
+
+    void FramePacer::wait()
+    {
+        if (m_target_frame_rate <= 0)
+        {
+            return;
+        }
+
+        PROFILE_SCOPE("FramePacer::wait");
+        auto frame_duration = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double>(1.0 / m_target_frame_rate));
+        auto now = std::chrono::steady_clock::now();
+
+        // a frame which took too long restarts the schedule, instead of catching up with shorter frames
+        if (now < m_next_frame_time)
+        {
+            preciseSleep(m_next_frame_time);
+            m_next_frame_time += frame_duration;
+        }
+        else
+        {
+            m_next_frame_time = now + frame_duration;
+        }
+    }
+
+    void FramePacer::setTargetFrameRate(int frame_rate)
+    {
+        m_target_frame_rate = std::max(frame_rate, 0);
+        m_next_frame_time = std::chrono::steady_clock::now();
+        setHighTimerResolution(m_target_frame_rate > 0);
+    }
+
+    void FramePacer::setHighTimerResolution(bool high_timer_resolution)
+    {
+        if (m_high_timer_resolution == high_timer_resolution)
+        {
+            return;
+        }
+        m_high_timer_resolution = high_timer_resolution;
+
+        // windows rounds sleeps up to its default 15.6 ms timer tick, other platforms sleep with sub millisecond precision
+#ifdef _WIN32
+        if (high_timer_resolution)
+        {
+            timeBeginPeriod(1);
+        }
+        else
+        {
+            timeEndPeriod(1);
+        }
+#endif
+    }
+
+    void FramePacer::preciseSleep(std::chrono::steady_clock::time_point deadline)
+    {
+        // sleep in short periods while the remaining time is longer than a sleep is expected to take
+        const uint64_t k_max_sleep_count = 1000;
+        while (true)
+        {
+            auto start = std::chrono::steady_clock::now();
+            double remaining = std::chrono::duration<double>(deadline - start).count();
+            if (remaining <= m_sleep_estimate)
+            {
+                break;
+            }
+
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            double observed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+            // welford's online mean and variance, restarted now and then to follow the scheduler's current behavior
+            if (m_sleep_count >= k_max_sleep_count)
+            {
+                m_sleep_m2 = 0.0;
+                m_sleep_count = 1;
+            }
+            ++m_sleep_count;
+            double delta = observed - m_sleep_mean;
+            m_sleep_mean += delta / m_sleep_count;
+            m_sleep_m2 += delta * (observed - m_sleep_mean);
+            m_sleep_estimate = m_sleep_mean + std::sqrt(m_sleep_m2 / (m_sleep_count - 1));
+        }
+
+        // only the sub millisecond rest is shorter than a sleep can be relied on, give up the time slice until the deadline
+        while (std::chrono::steady_clock::now() < deadline)
+        {
+            std::this_thread::yield();
+        }
+    }
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <chrono>
+
+namespace Bamboo
+{
+    /**
+     * @brief Frame rate limiter
+     * Sleeps at the end of each frame until the target frame time has passed.
+     */
+    class FramePacer
+    {
+    public:
+        FramePacer();
+        ~FramePacer();
+
+        /**
+         * @brief Sleeps until the next frame should start, returns at once without a target frame rate.
+         */
+        void wait();
+
+        /**
+         * @brief Sets the target frame rate.
+         * @param frame_rate Frames per second, 0 disables pacing
+         */
+        void setTargetFrameRate(int frame_rate);
+        int getTargetFrameRate() const { return m_target_frame_rate; }
+
+        /**
+         * @brief Sets whether the gpu is waited for before input is sampled.
+         * Trades throughput for latency, as the cpu no longer runs ahead of the gpu.
+         */
+        void setLowLatency(bool low_latency) { m_low_latency = low_latency; }
+        bool isLowLatency() const { return m_low_latency; }
+
+    private:
+        void preciseSleep(std::chrono::steady_clock::time_point deadline);
+
+        /**
+         * @brief Raises the system timer resolution to 1 ms while pacing, so short sleeps aren't rounded up to the default tick.
+         */
+        void setHighTimerResolution(bool high_timer_resolution);
+
+        int m_target_frame_rate;
+        bool m_low_latency;
+        bool m_high_timer_resolution;
+        std::chrono::steady_clock::time_point m_next_frame_time;
+
+        // running estimate of how long a short sleep actually takes, including the scheduler's overshoot
+        double m_sleep_estimate;
+        double m_sleep_mean;
+        double m_sleep_m2;
+        uint64_t m_sleep_count;
+    };
+}
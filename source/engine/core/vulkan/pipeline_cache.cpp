@@ -0,0 +1,80 @@
+#include "pipeline_cache.h"
+#include "vulkan_rhi.h"
+#include "engine/platform/file/file_system.h"
+
+#include <cstring>
+
+namespace Bamboo
+{
+	const uint32_t k_pipeline_cache_magic = 0x43504242;
+
+	static std::string getPipelineCacheFilename()
+	{
+		const auto& fs = g_engine.fileSystem();
+		return fs->combine(fs->getCacheDir(), std::string("pipeline_cache.bin"));
+	}
+
+	void PipelineCache::init()
+	{
+		// reuse the cached data if its header matches this device and driver
+		std::vector<uint8_t> data;
+		std::string filename = getPipelineCacheFilename();
+		if (g_engine.fileSystem()->exists(filename) && g_engine.fileSystem()->loadBinary(filename, data) && data.size() >= sizeof(Header))
+		{
+			Header header;
+			memcpy(&header, data.data(), sizeof(Header));
+			Header expected_header = createHeader(static_cast<uint32_t>(data.size() - sizeof(Header)));
+			m_warm = memcmp(&header, &expected_header, sizeof(Header)) == 0;
+			if (!m_warm)
+			{
+				LOG_INFO("discard pipeline cache of another device or driver version");
+			}
+		}
+
+		VkPipelineCacheCreateInfo pipeline_cache_ci{};
+		pipeline_cache_ci.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+		if (m_warm)
+		{
+			pipeline_cache_ci.initialDataSize = data.size() - sizeof(Header);
+			pipeline_cache_ci.pInitialData = data.data() + sizeof(Header);
+		}
+
+		VkResult result = vkCreatePipelineCache(VulkanRHI::get().getDevice(), &pipeline_cache_ci, nullptr, &m_pipeline_cache);
+		CHECK_VULKAN_RESULT(result, "create pipeline cache");
+	}
+
+	void PipelineCache::destroy()
+	{
+		save();
+		vkDestroyPipelineCache(VulkanRHI::get().getDevice(), m_pipeline_cache, nullptr);
+	}
+
+	void PipelineCache::save()
+	{
+		size_t data_size = 0;
+		vkGetPipelineCacheData(VulkanRHI::get().getDevice(), m_pipeline_cache, &data_size, nullptr);
+
+		std::vector<uint8_t> data(sizeof(Header) + data_size);
+		VkResult result = vkGetPipelineCacheData(VulkanRHI::get().getDevice(), m_pipeline_cache, &data_size, data.data() + sizeof(Header));
+		CHECK_VULKAN_RESULT(result, "get pipeline cache data");
+
+		Header header = createHeader(static_cast<uint32_t>(data_size));
+		memcpy(data.data(), &header, sizeof(Header));
+		data.resize(sizeof(Header) + data_size);
+		g_engine.fileSystem()->writeBinary(getPipelineCacheFilename(), data);
+	}
+
+	PipelineCache::Header PipelineCache::createHeader(uint32_t data_size)
+	{
+		const VkPhysicalDeviceProperties& properties = VulkanRHI::get().getPhysicalDeviceProperties();
+
+		Header header{};
+		header.magic = k_pipeline_cache_magic;
+		header.data_size = data_size;
+		header.vendor_id = properties.vendorID;
+		header.device_id = properties.deviceID;
+		header.driver_version = properties.driverVersion;
+		memcpy(header.pipeline_cache_uuid, properties.pipelineCacheUUID, VK_UUID_SIZE);
+		return header;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "vulkan_util.h"
+
+namespace Bamboo
+{
+	// pipeline cache shared by all render passes, it's loaded from and saved to the cache dir.
+	// cached data is discarded if it was written by another device or driver version
+	class PipelineCache
+	{
+	public:
+		void init();
+		void destroy();
+
+		// write the cache data, it's also saved on destroy
+		void save();
+
+		VkPipelineCache get() { return m_pipeline_cache; }
+
+		// whether pipelines were created from cached data of a previous run
+		bool isWarm() { return m_warm; }
+
+	private:
+		// prepended to the cache data, vulkan's own header isn't trusted by all drivers
+		struct Header
+		{
+			uint32_t magic;
+			uint32_t data_size;
+			uint32_t vendor_id;
+			uint32_t device_id;
+			uint32_t driver_version;
+			uint8_t pipeline_cache_uuid[VK_UUID_SIZE];
+		};
+
+		Header createHeader(uint32_t data_size);
+
+		VkPipelineCache m_pipeline_cache = VK_NULL_HANDLE;
+		bool m_warm = false;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,295 @@
+#include "upload_manager.h"
+#include "vulkan_rhi.h"
+
+#include <algorithm>
+
+namespace Bamboo
+{
+
+	void UploadManager::init()
+	{
+		VkDevice device = VulkanRHI::get().getDevice();
+
+		// command buffers are reset when they are recorded again
+		VkCommandPoolCreateInfo command_pool_ci{};
+		command_pool_ci.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+		command_pool_ci.queueFamilyIndex = VulkanRHI::get().getTransferQueueFamily();
+		command_pool_ci.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+		VkResult result = vkCreateCommandPool(device, &command_pool_ci, nullptr, &m_command_pool);
+		CHECK_VULKAN_RESULT(result, "create upload command pool");
+
+		// timeline semaphore
+		VkSemaphoreTypeCreateInfo semaphore_type_ci{};
+		semaphore_type_ci.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+		semaphore_type_ci.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+		semaphore_type_ci.initialValue = 0;
+
+		VkSemaphoreCreateInfo semaphore_ci{};
+		semaphore_ci.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+		semaphore_ci.pNext = &semaphore_type_ci;
+		result = vkCreateSemaphore(device, &semaphore_ci, nullptr, &m_semaphore);
+		CHECK_VULKAN_RESULT(result, "create upload timeline semaphore");
+
+		// staging ring buffer
+		const VkDeviceSize k_staging_size = 64 * 1024 * 1024;
+		VulkanUtil::createBuffer(k_staging_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_AUTO_PREFER_HOST, m_staging_buffer);
+
+		VmaAllocationInfo allocation_info;
+		vmaGetAllocationInfo(VulkanRHI::get().getAllocator(), m_staging_buffer.allocation, &allocation_info);
+		m_staging_data = static_cast<uint8_t*>(allocation_info.pMappedData);
+		ASSERT(m_staging_data != nullptr, "failed to map upload staging buffer");
+
+		// 16 bytes covers the texel size of all uncompressed formats and the block size of compressed formats
+		m_staging_alignment = std::max<VkDeviceSize>(16, VulkanRHI::get().getPhysicalDeviceProperties().limits.optimalBufferCopyOffsetAlignment);
+	}
+
+	void UploadManager::destroy()
+	{
+		std::lock_guard<std::recursive_mutex> lock(m_mutex);
+		wait({ submit() });
+		retireBatches();
+
+		vkDestroyCommandPool(VulkanRHI::get().getDevice(), m_command_pool, nullptr);
+		vkDestroySemaphore(VulkanRHI::get().getDevice(), m_semaphore, nullptr);
+		m_staging_buffer.destroy();
+	}
+
+	UploadHandle UploadManager::uploadBuffer(VkBuffer buffer, const void* data, VkDeviceSize size, VkDeviceSize offset)
+	{
+		std::lock_guard<std::recursive_mutex> lock(m_mutex);
+		VkDeviceSize staging_offset;
+		VkBuffer staging_buffer = allocateStaging(data, size, staging_offset);
+
+		VkBufferCopy copy_region{};
+		copy_region.srcOffset = staging_offset;
+		copy_region.dstOffset = offset;
+		copy_region.size = size;
+		vkCmdCopyBuffer(getCommandBuffer(), staging_buffer, buffer, 1, &copy_region);
+
+		return { m_submitted_value + 1 };
+	}
+
+	UploadHandle UploadManager::uploadImage(VkImage image, const void* data, VkDeviceSize size, std::vector<VkBufferImageCopy> regions,
+		uint32_t mip_levels, uint32_t layers, VkImageLayout final_layout)
+	{
+		std::lock_guard<std::recursive_mutex> lock(m_mutex);
+		VkDeviceSize staging_offset;
+		VkBuffer staging_buffer = allocateStaging(data, size, staging_offset);
+		for (VkBufferImageCopy& region : regions)
+		{
+			region.bufferOffset += staging_offset;
+		}
+
+		VkCommandBuffer command_buffer = getCommandBuffer();
+
+		// transition the whole image to transfer dst optimal
+		VkImageMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.image = image;
+		barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, mip_levels, 0, layers };
+		barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		barrier.srcAccessMask = 0;
+		barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+			0, nullptr, 0, nullptr, 1, &barrier);
+
+		vkCmdCopyBufferToImage(command_buffer, staging_buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			static_cast<uint32_t>(regions.size()), regions.data());
+
+		// the timeline semaphore makes the copies visible to the queues waiting for it
+		if (final_layout != VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL)
+		{
+			barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+			barrier.newLayout = final_layout;
+			barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			barrier.dstAccessMask = 0;
+			vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0,
+				0, nullptr, 0, nullptr, 1, &barrier);
+		}
+
+		return { m_submitted_value + 1 };
+	}
+
+	uint64_t UploadManager::submit()
+	{
+		std::lock_guard<std::recursive_mutex> lock(m_mutex);
+		retireBatches();
+		if (m_batch.command_buffer == VK_NULL_HANDLE)
+		{
+			return m_submitted_value;
+		}
+
+		vkEndCommandBuffer(m_batch.command_buffer);
+		m_batch.value = ++m_submitted_value;
+		m_batch.staging_end = m_staging_head;
+
+		VkTimelineSemaphoreSubmitInfo timeline_semaphore_si{};
+		timeline_semaphore_si.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+		timeline_semaphore_si.signalSemaphoreValueCount = 1;
+		timeline_semaphore_si.pSignalSemaphoreValues = &m_batch.value;
+
+		VkSubmitInfo submit_info{};
+		submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submit_info.pNext = &timeline_semaphore_si;
+		submit_info.commandBufferCount = 1;
+		submit_info.pCommandBuffers = &m_batch.command_buffer;
+		submit_info.signalSemaphoreCount = 1;
+		submit_info.pSignalSemaphores = &m_semaphore;
+
+		VkResult result;
+		{
+			std::lock_guard<std::mutex> queue_lock(VulkanRHI::get().getQueueMutex());
+			result = vkQueueSubmit(VulkanRHI::get().getTransferQueue(), 1, &submit_info, VK_NULL_HANDLE);
+		}
+		CHECK_VULKAN_RESULT(result, "submit upload batch");
+
+		m_pending_batches.push_back(std::move(m_batch));
+		m_batch = Batch{};
+
+		return m_submitted_value;
+	}
+
+	bool UploadManager::isComplete(const UploadHandle& handle)
+	{
+		std::lock_guard<std::recursive_mutex> lock(m_mutex);
+		if (handle.value <= m_completed_value)
+		{
+			return true;
+		}
+		if (handle.value > m_submitted_value)
+		{
+			return false;
+		}
+
+		vkGetSemaphoreCounterValue(VulkanRHI::get().getDevice(), m_semaphore, &m_completed_value);
+		return m_completed_value >= handle.value;
+	}
+
+	void UploadManager::wait(const UploadHandle& handle)
+	{
+		std::lock_guard<std::recursive_mutex> lock(m_mutex);
+		if (isComplete(handle))
+		{
+			return;
+		}
+
+		if (handle.value > m_submitted_value)
+		{
+			submit();
+		}
+
+		VkSemaphoreWaitInfo semaphore_wi{};
+		semaphore_wi.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+		semaphore_wi.semaphoreCount = 1;
+		semaphore_wi.pSemaphores = &m_semaphore;
+		semaphore_wi.pValues = &handle.value;
+		vkWaitSemaphores(VulkanRHI::get().getDevice(), &semaphore_wi, UINT64_MAX);
+		m_completed_value = std::max(m_completed_value, handle.value);
+	}
+
+	VkBuffer UploadManager::allocateStaging(const void* data, VkDeviceSize size, VkDeviceSize& offset)
+	{
+		// uploads larger than the ring get a dedicated staging buffer, which is destroyed with its batch
+		const VkDeviceSize ring_size = m_staging_buffer.size;
+		if (size > ring_size)
+		{
+			VmaBuffer staging_buffer;
+			VulkanUtil::createBuffer(size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_AUTO_PREFER_HOST, staging_buffer);
+			VulkanUtil::updateBuffer(staging_buffer, const_cast<void*>(data), size);
+			m_batch.dedicated_staging_buffers.push_back(staging_buffer);
+
+			offset = 0;
+			return staging_buffer.buffer;
+		}
+
+		// allocations don't wrap around the end of the ring
+		uint64_t position = (m_staging_head + m_staging_alignment - 1) / m_staging_alignment * m_staging_alignment;
+		if (position % ring_size + size > ring_size)
+		{
+			position = (position / ring_size + 1) * ring_size;
+		}
+
+		// wait for the oldest batches until the allocation doesn't overlap staging data in use
+		while (position + size > m_staging_tail + ring_size)
+		{
+			// submit the current batch if it's the only one using the ring
+			if (m_pending_batches.empty())
+			{
+				submit();
+			}
+
+			// no staging data is in use
+			if (m_pending_batches.empty())
+			{
+				m_staging_tail = position;
+				break;
+			}
+
+			wait({ m_pending_batches.front().value });
+			retireBatches();
+		}
+
+		offset = position % ring_size;
+		m_staging_head = position + size;
+		memcpy(m_staging_data + offset, data, size);
+		vmaFlushAllocation(VulkanRHI::get().getAllocator(), m_staging_buffer.allocation, offset, size);
+
+		return m_staging_buffer.buffer;
+	}
+
+	VkCommandBuffer UploadManager::getCommandBuffer()
+	{
+		if (m_batch.command_buffer != VK_NULL_HANDLE)
+		{
+			return m_batch.command_buffer;
+		}
+
+		// reuse command buffers of completed batches
+		if (!m_free_command_buffers.empty())
+		{
+			m_batch.command_buffer = m_free_command_buffers.back();
+			m_free_command_buffers.pop_back();
+		}
+		else
+		{
+			VkCommandBufferAllocateInfo command_buffer_ai{};
+			command_buffer_ai.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+			command_buffer_ai.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+			command_buffer_ai.commandPool = m_command_pool;
+			command_buffer_ai.commandBufferCount = 1;
+			vkAllocateCommandBuffers(VulkanRHI::get().getDevice(), &command_buffer_ai, &m_batch.command_buffer);
+		}
+
+		VkCommandBufferBeginInfo command_buffer_bi{};
+		command_buffer_bi.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		command_buffer_bi.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+		vkBeginCommandBuffer(m_batch.command_buffer, &command_buffer_bi);
+
+		return m_batch.command_buffer;
+	}
+
+	void UploadManager::retireBatches()
+	{
+		if (m_pending_batches.empty())
+		{
+			return;
+		}
+
+		vkGetSemaphoreCounterValue(VulkanRHI::get().getDevice(), m_semaphore, &m_completed_value);
+		while (!m_pending_batches.empty() && m_pending_batches.front().value <= m_completed_value)
+		{
+			Batch& batch = m_pending_batches.front();
+			m_staging_tail = batch.staging_end;
+			for (VmaBuffer& staging_buffer : batch.dedicated_staging_buffers)
+			{
+				staging_buffer.destroy();
+			}
+			m_free_command_buffers.push_back(batch.command_buffer);
+			m_pending_batches.pop_front();
+		}
+	}
+
+}
\ No newline at end of file
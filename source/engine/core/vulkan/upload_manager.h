@@ -0,0 +1,67 @@
+#pragma once
+
+#include "vulkan_util.h"
+
+#include <deque>
+#include <mutex>
+
+namespace Bamboo
+{
+	// batches buffer and image uploads into one transfer command buffer, which is submitted to the transfer queue once per frame
+	// and signals the upload timeline semaphore. staging data is sub allocated from a persistently mapped ring buffer,
+	// whose space is reclaimed when the batches reading it have completed. uploads can be recorded from any thread
+	class UploadManager
+	{
+	public:
+		void init();
+		void destroy();
+
+		// record a copy into the current batch, the destination must be shared with the transfer queue family
+		UploadHandle uploadBuffer(VkBuffer buffer, const void* data, VkDeviceSize size, VkDeviceSize offset = 0);
+
+		// record copies into the current batch, buffer offsets of regions are relative to data,
+		// all mip levels and layers of the image are transitioned from undefined to final_layout
+		UploadHandle uploadImage(VkImage image, const void* data, VkDeviceSize size, std::vector<VkBufferImageCopy> regions,
+			uint32_t mip_levels, uint32_t layers, VkImageLayout final_layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+
+		// submit the current batch if it has recorded copies, return the timeline value of the last submitted batch
+		uint64_t submit();
+
+		bool isComplete(const UploadHandle& handle);
+		void wait(const UploadHandle& handle);
+
+		VkSemaphore getSemaphore() { return m_semaphore; }
+
+	private:
+		struct Batch
+		{
+			VkCommandBuffer command_buffer = VK_NULL_HANDLE;
+			uint64_t value = 0;
+			uint64_t staging_end = 0;
+			std::vector<VmaBuffer> dedicated_staging_buffers;
+		};
+
+		VkBuffer allocateStaging(const void* data, VkDeviceSize size, VkDeviceSize& offset);
+		VkCommandBuffer getCommandBuffer();
+		void retireBatches();
+
+		// recursive, since waiting and allocating staging space may submit the current batch
+		std::recursive_mutex m_mutex;
+
+		VkCommandPool m_command_pool = VK_NULL_HANDLE;
+		std::vector<VkCommandBuffer> m_free_command_buffers;
+		VkSemaphore m_semaphore = VK_NULL_HANDLE;
+		uint64_t m_submitted_value = 0;
+		uint64_t m_completed_value = 0;
+
+		Batch m_batch;
+		std::deque<Batch> m_pending_batches;
+
+		// staging ring, whose positions increase monotonically and wrap around its size
+		VmaBuffer m_staging_buffer;
+		uint8_t* m_staging_data = nullptr;
+		VkDeviceSize m_staging_alignment = 0;
+		uint64_t m_staging_head = 0;
+		uint64_t m_staging_tail = 0;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,150 @@
+#include "upload_ring.h"
+#include "vulkan_rhi.h"
+
+#include <algorithm>
+
+namespace Bamboo
+{
+	void UploadRing::init(VkDeviceSize frame_size)
+	{
+		// every sub allocation could be bound as a uniform or storage buffer
+		const VkPhysicalDeviceLimits& limits = VulkanRHI::get().getPhysicalDeviceProperties().limits;
+		m_alignment = std::max(limits.minUniformBufferOffsetAlignment, limits.minStorageBufferOffsetAlignment);
+		m_frame_size = (frame_size + m_alignment - 1) / m_alignment * m_alignment;
+		m_frame_count = VulkanRHI::get().getFramesInFlight() + 1;
+		m_overflow_blocks.resize(m_frame_count);
+
+		createBuffer(m_frame_size * m_frame_count, m_buffer, m_mapped_data);
+	}
+
+	void UploadRing::destroy()
+	{
+		for (uint32_t i = 0; i < m_frame_count; ++i)
+		{
+			releaseOverflowBlocks(i);
+		}
+		for (auto& retired_buffer : m_retired_buffers)
+		{
+			retired_buffer.first.destroy();
+		}
+		m_retired_buffers.clear();
+
+		m_buffer.destroy();
+		m_mapped_data = nullptr;
+	}
+
+	VmaBufferRange UploadRing::allocate(const void* data, VkDeviceSize size)
+	{
+		VkDeviceSize offset = (m_head + m_alignment - 1) / m_alignment * m_alignment;
+		if (offset + size > m_frame_size)
+		{
+			return allocateOverflow(data, size);
+		}
+		m_head = offset + size;
+
+		VmaBufferRange buffer_range;
+		buffer_range.buffer = m_buffer.buffer;
+		buffer_range.offset = m_frame_index * m_frame_size + offset;
+		buffer_range.size = size;
+		memcpy(m_mapped_data + buffer_range.offset, data, size);
+
+		return buffer_range;
+	}
+
+	void UploadRing::endFrame()
+	{
+		VmaAllocator allocator = VulkanRHI::get().getAllocator();
+		if (m_head > 0)
+		{
+			vmaFlushAllocation(allocator, m_buffer.allocation, m_frame_index * m_frame_size, m_head);
+		}
+		for (const Block& block : m_overflow_blocks[m_frame_index])
+		{
+			vmaFlushAllocation(allocator, block.buffer.allocation, 0, block.head);
+		}
+
+		// destroy the buffers of a grown ring once the frames using them have completed
+		for (auto iter = m_retired_buffers.begin(); iter != m_retired_buffers.end();)
+		{
+			if (--iter->second == 0)
+			{
+				iter->first.destroy();
+				iter = m_retired_buffers.erase(iter);
+			}
+			else
+			{
+				++iter;
+			}
+		}
+
+		// grow the partitions to the peak of an overflowing frame, the old buffer is still read by the frames in flight
+		if (m_overflow_size > 0)
+		{
+			VkDeviceSize peak_size = m_frame_size + m_overflow_size;
+			m_retired_buffers.emplace_back(m_buffer, m_frame_count);
+			m_frame_size = (peak_size + peak_size / 2 + m_alignment - 1) / m_alignment * m_alignment;
+			createBuffer(m_frame_size * m_frame_count, m_buffer, m_mapped_data);
+			LOG_WARNING("upload ring frame partition grows to {} bytes", m_frame_size);
+		}
+
+		m_frame_index = (m_frame_index + 1) % m_frame_count;
+		m_head = 0;
+		m_overflow_size = 0;
+
+		// the partition's last frame has completed before it's written again
+		releaseOverflowBlocks(m_frame_index);
+	}
+
+	void UploadRing::discardFrame()
+	{
+		m_head = 0;
+		m_overflow_size = 0;
+		releaseOverflowBlocks(m_frame_index);
+	}
+
+	void UploadRing::createBuffer(VkDeviceSize size, VmaBuffer& buffer, uint8_t*& mapped_data)
+	{
+		VulkanUtil::createBuffer(size, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+			VMA_MEMORY_USAGE_AUTO_PREFER_HOST, buffer);
+
+		VmaAllocationInfo allocation_info;
+		vmaGetAllocationInfo(VulkanRHI::get().getAllocator(), buffer.allocation, &allocation_info);
+		mapped_data = static_cast<uint8_t*>(allocation_info.pMappedData);
+		ASSERT(mapped_data != nullptr, "failed to map upload ring buffer");
+	}
+
+	VmaBufferRange UploadRing::allocateOverflow(const void* data, VkDeviceSize size)
+	{
+		// chain another block when the last one is full, a block holds at least a whole partition
+		std::vector<Block>& blocks = m_overflow_blocks[m_frame_index];
+		VkDeviceSize offset = blocks.empty() ? 0 : (blocks.back().head + m_alignment - 1) / m_alignment * m_alignment;
+		if (blocks.empty() || offset + size > blocks.back().buffer.size)
+		{
+			Block block;
+			createBuffer(std::max(m_frame_size, (size + m_alignment - 1) / m_alignment * m_alignment), block.buffer, block.mapped_data);
+			blocks.push_back(block);
+			offset = 0;
+		}
+
+		Block& block = blocks.back();
+		m_overflow_size += offset + size - block.head;
+		block.head = offset + size;
+
+		VmaBufferRange buffer_range;
+		buffer_range.buffer = block.buffer.buffer;
+		buffer_range.offset = offset;
+		buffer_range.size = size;
+		memcpy(block.mapped_data + offset, data, size);
+
+		return buffer_range;
+	}
+
+	void UploadRing::releaseOverflowBlocks(uint32_t frame_index)
+	{
+		for (Block& block : m_overflow_blocks[frame_index])
+		{
+			block.buffer.destroy();
+		}
+		m_overflow_blocks[frame_index].clear();
+	}
+}
\ No newline at end of file
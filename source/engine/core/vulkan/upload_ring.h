@@ -0,0 +1,56 @@
+#pragma once
+
+#include "vulkan_util.h"
+
+#include <vector>
+
+namespace Bamboo
+{
+	// persistently mapped host buffer partitioned by frame, which sub allocates per frame uniform and storage data,
+	// and stages copies into device local buffers.
+	// render datas are collected before the frame's fence is waited, so there is one more partition than frames in flight.
+	// a full partition chains dedicated overflow blocks, and the ring grows to the overflowing frame's peak afterwards
+	class UploadRing
+	{
+	public:
+		void init(VkDeviceSize frame_size);
+		void destroy();
+
+		// copy data into the current frame's partition, the returned range is valid until the frame has been rendered
+		VmaBufferRange allocate(const void* data, VkDeviceSize size);
+
+		// flush the current frame's partition before submitting the frame and move to the next one
+		void endFrame();
+
+		// drop the current frame's sub allocations of a frame which isn't submitted
+		void discardFrame();
+
+	private:
+		struct Block
+		{
+			VmaBuffer buffer;
+			uint8_t* mapped_data = nullptr;
+			VkDeviceSize head = 0;
+		};
+
+		void createBuffer(VkDeviceSize size, VmaBuffer& buffer, uint8_t*& mapped_data);
+		VmaBufferRange allocateOverflow(const void* data, VkDeviceSize size);
+		void releaseOverflowBlocks(uint32_t frame_index);
+
+		VmaBuffer m_buffer;
+		uint8_t* m_mapped_data = nullptr;
+
+		// overflow blocks of each partition, released when the partition is reused
+		std::vector<std::vector<Block>> m_overflow_blocks;
+		VkDeviceSize m_overflow_size = 0;
+
+		// buffers of the ring before it grew and the number of frames until their last use has completed
+		std::vector<std::pair<VmaBuffer, uint32_t>> m_retired_buffers;
+
+		VkDeviceSize m_frame_size = 0;
+		uint32_t m_frame_count = 0;
+		VkDeviceSize m_alignment = 0;
+		uint32_t m_frame_index = 0;
+		VkDeviceSize m_head = 0;
+	};
+}
\ No newline at end of file
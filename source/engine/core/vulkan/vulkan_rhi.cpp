@@ -1,6 +1,8 @@
 #include "vulkan_rhi.h"
 #include "engine/core/event/event_system.h"
 #include "engine/function/render/window_system.h"
+#include "engine/core/profile/cpu_profiler.h"
+#include "engine/core/config/config_manager.h"
 
 #include <array>
 #include <algorithm>
@@ -9,8 +11,31 @@
 
 namespace Bamboo
 {
+	static VkPresentModeKHR parsePresentMode(const std::string& name)
+	{
+		const std::map<std::string, VkPresentModeKHR> k_present_modes = {
+			{ "fifo", VK_PRESENT_MODE_FIFO_KHR },
+			{ "mailbox", VK_PRESENT_MODE_MAILBOX_KHR },
+			{ "immediate", VK_PRESENT_MODE_IMMEDIATE_KHR }
+		};
+
+		auto iter = k_present_modes.find(name);
+		if (iter == k_present_modes.end())
+		{
+			LOG_WARNING("unknown present mode {}, use fifo instead", name);
+			return VK_PRESENT_MODE_FIFO_KHR;
+		}
+		return iter->second;
+	}
+
 	void VulkanRHI::init()
 	{
+		m_headless = g_engine.isHeadless();
+		m_main_thread_id = std::this_thread::get_id();
+
+		// every per frame resource is sized by the frames in flight, so they can only be configured at startup
+		m_frames_in_flight = static_cast<uint32_t>(std::max(g_engine.configManager()->getFramesInFlight(), 1));
+		m_requested_present_mode = parsePresentMode(g_engine.configManager()->getPresentMode());
 		createInstance();
 #if ENABLE_VALIDATION_LAYER
 		createDebugging();
@@ -23,6 +48,11 @@ namespace Bamboo
 		getDeviceQueues();
 		createVmaAllocator();
 
+		const VkDeviceSize k_upload_ring_frame_size = 4 * 1024 * 1024;
+		m_upload_ring.init(k_upload_ring_frame_size);
+		m_upload_manager.init();
+		m_pipeline_cache.init();
+
 		createSwapchain();
 		createSwapchainObjects();
 		createCommandPools();
@@ -32,12 +62,29 @@ namespace Bamboo
 
 	void VulkanRHI::render()
 	{
-		waitFrame();
+		// the swapchain can't be recreated while the window is minimized, the frame's uploads are dropped
+		if (!waitFrame())
+		{
+			m_upload_ring.discardFrame();
+			return;
+		}
 		recordFrame();
 		submitFrame();
 		presentFrame();
 	}
 
+	void VulkanRHI::waitDeviceIdle()
+	{
+		std::lock_guard<std::mutex> lock(m_queue_mutex);
+		vkDeviceWaitIdle(m_device);
+	}
+
+	void VulkanRHI::waitFrameFence()
+	{
+		PROFILE_SCOPE("VulkanRHI::waitFrameFence");
+		vkWaitForFences(m_device, 1, &m_flight_fences[m_flight_index], VK_TRUE, UINT64_MAX);
+	}
+
 	void VulkanRHI::destroy()
 	{
 		for (VkSemaphore image_avaliable_semaphore : m_image_avaliable_semaphores)
@@ -54,16 +101,26 @@ namespace Bamboo
 		}
 
 		destroySwapchainObjects();
+		m_upload_ring.destroy();
+		m_upload_manager.destroy();
+		m_pipeline_cache.destroy();
 		vkDestroyCommandPool(m_device, m_instant_command_pool, nullptr);
 		vkDestroyCommandPool(m_device, m_command_pool, nullptr);
 
-		vkDestroySwapchainKHR(m_device, m_swapchain, nullptr);
+		// headless runs didn't enable the swapchain and surface extensions
+		if (!m_headless)
+		{
+			vkDestroySwapchainKHR(m_device, m_swapchain, nullptr);
+		}
 
 #if ENABLE_VALIDATION_LAYER
 		destroyDebugging();
 #endif
 		vmaDestroyAllocator(m_allocator);
-		vkDestroySurfaceKHR(m_instance, m_surface, nullptr);
+		if (!m_headless)
+		{
+			vkDestroySurfaceKHR(m_instance, m_surface, nullptr);
+		}
 		vkDestroyDevice(m_device, nullptr);
 		vkDestroyInstance(m_instance, nullptr);
 	}
@@ -118,6 +175,12 @@ namespace Bamboo
 
 	void VulkanRHI::createSurface()
 	{
+		if (m_headless)
+		{
+			m_surface = VK_NULL_HANDLE;
+			return;
+		}
+
 		GLFWwindow* window = g_engine.windowSystem()->getWindow();
 		VkResult result = glfwCreateWindowSurface(m_instance, window, nullptr, &m_surface);
 		CHECK_VULKAN_RESULT(result, "create window surface");
@@ -134,6 +197,7 @@ namespace Bamboo
 
 		std::vector<VkPhysicalDevice> discrete_physical_devices;
 		std::vector<VkPhysicalDeviceProperties> discrete_physical_device_propertiess;
+		std::vector<VkPhysicalDeviceProperties> physical_device_propertiess(gpu_count);
 		for (uint32_t i = 0; i < gpu_count; ++i)
 		{
 			VkPhysicalDeviceProperties physical_device_properties;
@@ -144,6 +208,7 @@ namespace Bamboo
 				physical_device_properties.apiVersion >> 22,
 				(physical_device_properties.apiVersion >> 12) & 0x3ff,
 				physical_device_properties.apiVersion & 0xfff);
+			physical_device_propertiess[i] = physical_device_properties;
 
 			// only use discrete gpu, for best performance
 			if (physical_device_properties.deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU)
@@ -153,6 +218,14 @@ namespace Bamboo
 			}
 		}
 
+		// software rasterizers like lavapipe in ci aren't discrete gpus, use any device if there is no discrete one
+		if (discrete_physical_devices.empty())
+		{
+			LOG_WARNING("no discrete gpu found, fall back to other device types");
+			discrete_physical_devices = physical_devices;
+			discrete_physical_device_propertiess = physical_device_propertiess;
+		}
+
 		// set the selected device index
 		uint32_t selected_device_index = 0;
 		if (selected_device_index >= discrete_physical_devices.size())
@@ -175,9 +248,29 @@ namespace Bamboo
 		ASSERT(m_physical_device_properties.limits.maxPushConstantsSize >= k_max_push_constant_size, 
 			"push constants size must be greater than {}", k_max_push_constant_size);
 
-		vkGetPhysicalDeviceFeatures(m_physical_device, &m_physical_device_features);
+		m_physical_device_vulkan12_features = {};
+		m_physical_device_vulkan12_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+		VkPhysicalDeviceFeatures2 physical_device_features2{};
+		physical_device_features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+		physical_device_features2.pNext = &m_physical_device_vulkan12_features;
+		vkGetPhysicalDeviceFeatures2(m_physical_device, &physical_device_features2);
+		m_physical_device_features = physical_device_features2.features;
+		m_physical_device_vulkan12_features.pNext = nullptr;
+
 		ASSERT(m_physical_device_features.textureCompressionBC, "doesn't support bc block texture compression");
 		ASSERT(isFormatSupported(VK_FORMAT_BC7_UNORM_BLOCK) && isFormatSupported(VK_FORMAT_BC7_SRGB_BLOCK), "doesn't support bc block formats");
+		ASSERT(m_physical_device_features.shaderSampledImageArrayDynamicIndexing &&
+			m_physical_device_vulkan12_features.runtimeDescriptorArray && m_physical_device_vulkan12_features.descriptorBindingPartiallyBound,
+			"doesn't support descriptor indexing for bindless textures");
+		ASSERT(m_physical_device_vulkan12_features.timelineSemaphore, "doesn't support timeline semaphores for async uploads");
+
+		// gpu driven rendering compacts visible instances into indirect draws whose count is read from a buffer
+		m_gpu_driven_supported = m_physical_device_features.multiDrawIndirect && m_physical_device_features.drawIndirectFirstInstance &&
+			m_physical_device_vulkan12_features.drawIndirectCount;
+		if (!m_gpu_driven_supported)
+		{
+			LOG_WARNING("doesn't support indirect draw count, fall back to cpu driven rendering");
+		}
 	}
 
 	void VulkanRHI::createLogicDevice()
@@ -187,8 +280,16 @@ namespace Bamboo
 		std::vector<VkDeviceQueueCreateInfo> queue_cis;
 		m_queue_family_indices = getQueueFamilyIndices(queue_cis);
 
+		VkPhysicalDeviceVulkan12Features required_vulkan12_features{};
+		required_vulkan12_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+		required_vulkan12_features.drawIndirectCount = m_gpu_driven_supported;
+		required_vulkan12_features.runtimeDescriptorArray = VK_TRUE;
+		required_vulkan12_features.descriptorBindingPartiallyBound = VK_TRUE;
+		required_vulkan12_features.timelineSemaphore = VK_TRUE;
+
 		VkDeviceCreateInfo device_ci{};
 		device_ci.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+		device_ci.pNext = &required_vulkan12_features;
 		device_ci.queueCreateInfoCount = static_cast<uint32_t>(queue_cis.size());
 		device_ci.pQueueCreateInfos = queue_cis.data();
 		device_ci.pEnabledFeatures = &m_required_device_features;
@@ -225,15 +326,27 @@ namespace Bamboo
 
 	void VulkanRHI::createSwapchain()
 	{
+		std::vector<VkFormat> depth_format_candidates = { VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT };
+		m_depth_format = getProperImageFormat(depth_format_candidates, VK_IMAGE_TILING_OPTIMAL, VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT);
+
+		// headless runs have no swapchain, the render system renders into its offscreen images of the window size
+		if (m_headless)
+		{
+			int width, height;
+			g_engine.windowSystem()->getWindowSize(width, height);
+			m_surface_format = { VK_FORMAT_B8G8R8A8_SRGB, VK_COLOR_SPACE_SRGB_NONLINEAR_KHR };
+			m_present_mode = VK_PRESENT_MODE_IMMEDIATE_KHR;
+			m_extent = { static_cast<uint32_t>(width), static_cast<uint32_t>(height) };
+			return;
+		}
+
 		SwapchainSupportDetails swapchain_support_details = getSwapchainSupportDetails();
 		m_surface_format = getProperSwapchainSurfaceFormat(swapchain_support_details);
-		m_present_mode = getProperSwapchainSurfacePresentMode(swapchain_support_details);
+		m_swapchain_requested_present_mode = m_requested_present_mode;
+		m_present_mode = getProperSwapchainSurfacePresentMode(swapchain_support_details, m_swapchain_requested_present_mode);
 		m_extent = getProperSwapchainSurfaceExtent(swapchain_support_details);
 		VkImageUsageFlags image_usage = getProperSwapchainSurfaceImageUsage(swapchain_support_details);
 
-		std::vector<VkFormat> depth_format_candidates = { VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT };
-		m_depth_format = getProperImageFormat(depth_format_candidates, VK_IMAGE_TILING_OPTIMAL, VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT);
-
 		uint32_t image_count = std::min(swapchain_support_details.capabilities.minImageCount + 1, 
 			swapchain_support_details.capabilities.maxImageCount);
 
@@ -259,6 +372,13 @@ namespace Bamboo
 
 	void VulkanRHI::createSwapchainObjects()
 	{
+		if (m_headless)
+		{
+			m_swapchain_image_count = 0;
+			g_engine.eventSystem()->syncDispatch(std::make_shared<RenderCreateSwapchainObjectsEvent>(m_extent.width, m_extent.height));
+			return;
+		}
+
 		// 1.get swapchain images
 		uint32_t last_swapchain_image_count = m_swapchain_image_count;
 		vkGetSwapchainImagesKHR(m_device, m_swapchain, &m_swapchain_image_count, nullptr);
@@ -291,21 +411,24 @@ namespace Bamboo
 		g_engine.eventSystem()->syncDispatch(std::make_shared<RenderDestroySwapchainObjectsEvent>());
 	}
 
-	void VulkanRHI::recreateSwapchain()
+	bool VulkanRHI::recreateSwapchain()
 	{
-		// handle the window minimization corner case
+		// handle the window minimization corner case, a render thread skips frames until the window is restored
 		int width = 0;
 		int height = 0;
-		GLFWwindow* window = g_engine.windowSystem()->getWindow();
-		glfwGetFramebufferSize(window, &width, &height);
+		g_engine.windowSystem()->getFramebufferSize(width, height);
 		while (width == 0 || height == 0)
 		{
-			glfwGetFramebufferSize(window, &width, &height);
+			if (std::this_thread::get_id() != m_main_thread_id)
+			{
+				return false;
+			}
 			glfwWaitEvents();
+			g_engine.windowSystem()->getFramebufferSize(width, height);
 		}
 
 		// ensure all device operations have done
-		vkDeviceWaitIdle(m_device);
+		waitDeviceIdle();
 
 		VkSwapchainKHR oldSwapchain = m_swapchain;
 		createSwapchain();
@@ -313,6 +436,7 @@ namespace Bamboo
 
 		destroySwapchainObjects();
 		createSwapchainObjects();
+		return true;
 	}
 
 	void VulkanRHI::createCommandPools()
@@ -330,7 +454,7 @@ namespace Bamboo
 
 	void VulkanRHI::createCommandBuffers()
 	{
-		m_command_buffers.resize(MAX_FRAMES_IN_FLIGHT);
+		m_command_buffers.resize(m_frames_in_flight);
 
 		VkCommandBufferAllocateInfo command_buffer_ai{};
 		command_buffer_ai.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
@@ -338,11 +462,8 @@ namespace Bamboo
 		command_buffer_ai.commandPool = m_command_pool;
 		command_buffer_ai.commandBufferCount = static_cast<uint32_t>(m_command_buffers.size());
 
-		for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i)
-		{
-			VkCommandBuffer command_buffer;
-			vkAllocateCommandBuffers(m_device, &command_buffer_ai, m_command_buffers.data());
-		}
+		VkResult result = vkAllocateCommandBuffers(m_device, &command_buffer_ai, m_command_buffers.data());
+		CHECK_VULKAN_RESULT(result, "allocate command buffers");
 	}
 
 	void VulkanRHI::createSynchronizationPrimitives()
@@ -350,11 +471,11 @@ namespace Bamboo
 		m_flight_index = 0;
 
 		// semaphore: GPU-GPU
-		m_image_avaliable_semaphores.resize(MAX_FRAMES_IN_FLIGHT);
-		m_render_finished_semaphores.resize(MAX_FRAMES_IN_FLIGHT);
+		m_image_avaliable_semaphores.resize(m_frames_in_flight);
+		m_render_finished_semaphores.resize(m_frames_in_flight);
 
 		// fence: CPU-GPU
-		m_flight_fences.resize(MAX_FRAMES_IN_FLIGHT);
+		m_flight_fences.resize(m_frames_in_flight);
 
 		VkSemaphoreCreateInfo semaphore_ci{};
 		semaphore_ci.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
@@ -363,7 +484,7 @@ namespace Bamboo
 		fence_ci.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
 		fence_ci.flags = VK_FENCE_CREATE_SIGNALED_BIT;
 
-		for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i)
+		for (uint32_t i = 0; i < m_frames_in_flight; ++i)
 		{
 			vkCreateSemaphore(m_device, &semaphore_ci, nullptr, &m_image_avaliable_semaphores[i]);
 			vkCreateSemaphore(m_device, &semaphore_ci, nullptr, &m_render_finished_semaphores[i]);
@@ -371,19 +492,34 @@ namespace Bamboo
 		}
 	}
 
-	void VulkanRHI::waitFrame()
+	bool VulkanRHI::waitFrame()
 	{
+		PROFILE_SCOPE("VulkanRHI::waitFrame");
 		// wait sumbitted command buffer finished
-		vkWaitForFences(m_device, 1, &m_flight_fences[m_flight_index], VK_TRUE, UINT64_MAX);
+		waitFrameFence();
+		if (m_headless)
+		{
+			return true;
+		}
+
+		// a changed present mode needs a new swapchain
+		if (m_requested_present_mode != m_swapchain_requested_present_mode && !recreateSwapchain())
+		{
+			return false;
+		}
 
-		// get free swapchain image
+		// get free swapchain image, an out of date swapchain is recreated and acquired from again
 		VkResult result = vkAcquireNextImageKHR(m_device, m_swapchain, UINT64_MAX, m_image_avaliable_semaphores[m_flight_index], VK_NULL_HANDLE, &m_image_index);
 		if (result == VK_ERROR_OUT_OF_DATE_KHR)
 		{
-			recreateSwapchain();
-			return;
+			if (!recreateSwapchain())
+			{
+				return false;
+			}
+			result = vkAcquireNextImageKHR(m_device, m_swapchain, UINT64_MAX, m_image_avaliable_semaphores[m_flight_index], VK_NULL_HANDLE, &m_image_index);
 		}
 		ASSERT(result == VK_SUCCESS || result == VK_SUBOPTIMAL_KHR, "failed to acquire swapchain image!");
+		return true;
 	}
 
 	void VulkanRHI::recordFrame()
@@ -403,17 +539,34 @@ namespace Bamboo
 
 	void VulkanRHI::submitFrame()
 	{
+		// submit this frame's uploads, which the frame waits for on the device
+		std::array<uint64_t, 2> wait_values = { 0, m_upload_manager.submit() };
+		std::array<VkSemaphore, 2> wait_semaphores = { m_image_avaliable_semaphores[m_flight_index], m_upload_manager.getSemaphore() };
+		std::array<VkPipelineStageFlags, 2> wait_stages = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT };
+
+		// headless frames neither wait for an acquired image nor signal a present
+		uint32_t wait_offset = m_headless ? 1 : 0;
+
+		VkTimelineSemaphoreSubmitInfo timeline_semaphore_si{};
+		timeline_semaphore_si.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+		timeline_semaphore_si.waitSemaphoreValueCount = static_cast<uint32_t>(wait_values.size()) - wait_offset;
+		timeline_semaphore_si.pWaitSemaphoreValues = wait_values.data() + wait_offset;
+
 		VkSubmitInfo submit_info{};
 		submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-		submit_info.waitSemaphoreCount = 1;
-		submit_info.pWaitSemaphores = &m_image_avaliable_semaphores[m_flight_index];
-		VkPipelineStageFlags wait_stages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
-		submit_info.pWaitDstStageMask = wait_stages;
+		submit_info.pNext = &timeline_semaphore_si;
+		submit_info.waitSemaphoreCount = static_cast<uint32_t>(wait_semaphores.size()) - wait_offset;
+		submit_info.pWaitSemaphores = wait_semaphores.data() + wait_offset;
+		submit_info.pWaitDstStageMask = wait_stages.data() + wait_offset;
 		submit_info.commandBufferCount = 1;
 		submit_info.pCommandBuffers = &m_command_buffers[m_flight_index];
-		submit_info.signalSemaphoreCount = 1;
+		submit_info.signalSemaphoreCount = m_headless ? 0 : 1;
 		submit_info.pSignalSemaphores = &m_render_finished_semaphores[m_flight_index];
 
+		// make this frame's uploads visible to the device
+		m_upload_ring.endFrame();
+
+		std::lock_guard<std::mutex> lock(m_queue_mutex);
 		vkResetFences(m_device, 1, &m_flight_fences[m_flight_index]);
 		VkResult result = vkQueueSubmit(m_graphics_queue, 1, &submit_info, m_flight_fences[m_flight_index]);
 		CHECK_VULKAN_RESULT(result, "submit queue");
@@ -421,6 +574,12 @@ namespace Bamboo
 
 	void VulkanRHI::presentFrame()
 	{
+		if (m_headless)
+		{
+			m_flight_index = (m_flight_index + 1) % m_frames_in_flight;
+			return;
+		}
+
 		VkPresentInfoKHR present_info{};
 		present_info.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
 		present_info.waitSemaphoreCount = 1;
@@ -429,7 +588,11 @@ namespace Bamboo
 		present_info.pSwapchains = &m_swapchain;
 		present_info.pImageIndices = &m_image_index;
 
-		VkResult result = vkQueuePresentKHR(m_graphics_queue, &present_info);
+		VkResult result;
+		{
+			std::lock_guard<std::mutex> lock(m_queue_mutex);
+			result = vkQueuePresentKHR(m_graphics_queue, &present_info);
+		}
 		if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR)
 		{
 			recreateSwapchain();
@@ -439,7 +602,7 @@ namespace Bamboo
 			CHECK_VULKAN_RESULT(result, "present swapchain image");
 		}
 
-		m_flight_index = (m_flight_index + 1) % MAX_FRAMES_IN_FLIGHT;
+		m_flight_index = (m_flight_index + 1) % m_frames_in_flight;
 	}
 
 	std::vector<const char*> VulkanRHI::getRequiredInstanceExtensions()
@@ -455,10 +618,14 @@ namespace Bamboo
 			supported_instance_extensions.push_back(extension_properties.extensionName);
 		}
 
-		// find glfw instance extensions
-		uint32_t glfw_instance_extension_count = 0;
-		const char** glfw_instance_extensions = glfwGetRequiredInstanceExtensions(&glfw_instance_extension_count);
-		std::vector<const char*> required_instance_extensions(glfw_instance_extensions, glfw_instance_extensions + glfw_instance_extension_count);
+		// find glfw instance extensions, headless runs don't need surface extensions
+		std::vector<const char*> required_instance_extensions;
+		if (!m_headless)
+		{
+			uint32_t glfw_instance_extension_count = 0;
+			const char** glfw_instance_extensions = glfwGetRequiredInstanceExtensions(&glfw_instance_extension_count);
+			required_instance_extensions.assign(glfw_instance_extensions, glfw_instance_extensions + glfw_instance_extension_count);
+		}
 
 		// if enable validation layer, add some extra debug extension
 #if ENABLE_VALIDATION_LAYER
@@ -527,8 +694,12 @@ namespace Bamboo
 
 		// set required device extensions
 		std::vector<const char*> required_device_extensions = {
-			VK_KHR_SWAPCHAIN_EXTENSION_NAME, VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME
+			VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME
 		};
+		if (!m_headless)
+		{
+			required_device_extensions.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+		}
 
 		// check if each required device extension is supported
 		for (const char* required_device_extension : required_device_extensions)
@@ -567,6 +738,20 @@ namespace Bamboo
 			required_device_features.fillModeNonSolid = VK_TRUE;
 		}
 
+		required_device_features.shaderSampledImageArrayDynamicIndexing = VK_TRUE;
+
+		// the gpu profiler optionally collects shader invocations of render passes
+		if (m_physical_device_features.pipelineStatisticsQuery)
+		{
+			required_device_features.pipelineStatisticsQuery = VK_TRUE;
+		}
+
+		if (m_gpu_driven_supported)
+		{
+			required_device_features.multiDrawIndirect = VK_TRUE;
+			required_device_features.drawIndirectFirstInstance = VK_TRUE;
+		}
+
 		return required_device_features;
 	}
 
@@ -581,7 +766,7 @@ namespace Bamboo
 
 		// create device queue create infos
 		VulkanRHI::QueueFamilyIndices queue_family_indices{};
-		VkQueueFlags required_queue_types = VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT;
+		VkQueueFlags required_queue_types = VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT | VK_QUEUE_TRANSFER_BIT;
 		const float k_default_queue_priority = 0.0f;
 		queue_cis.clear();
 
@@ -597,9 +782,12 @@ namespace Bamboo
 			queue_cis.push_back(queue_ci);
 
 			// ensure the graphic queue family must support presentation
-			VkBool32 is_present_support = false;
-			vkGetPhysicalDeviceSurfaceSupportKHR(m_physical_device, queue_family_indices.graphics, m_surface, &is_present_support);
-			ASSERT(is_present_support, "graphic queue family doesn't support presentation");
+			if (!m_headless)
+			{
+				VkBool32 is_present_support = false;
+				vkGetPhysicalDeviceSurfaceSupportKHR(m_physical_device, queue_family_indices.graphics, m_surface, &is_present_support);
+				ASSERT(is_present_support, "graphic queue family doesn't support presentation");
+			}
 		}
 		else
 		{
@@ -731,17 +919,19 @@ namespace Bamboo
 		return details.formats.front();
 	}
 
-	VkPresentModeKHR VulkanRHI::getProperSwapchainSurfacePresentMode(const SwapchainSupportDetails& details)
+	VkPresentModeKHR VulkanRHI::getProperSwapchainSurfacePresentMode(const SwapchainSupportDetails& details, VkPresentModeKHR requested_present_mode)
 	{
 		for (VkPresentModeKHR present_mode : details.present_modes)
 		{
-			if (present_mode == VK_PRESENT_MODE_MAILBOX_KHR)
+			if (present_mode == requested_present_mode)
 			{
 				return present_mode;
 			}
 		}
-		LOG_FATAL("no supported swapchain surface present mode: VK_PRESENT_MODE_MAILBOX_KHR");
-		return details.present_modes.front();
+
+		// fifo is the only present mode every surface has to support
+		LOG_WARNING("swapchain surface present mode {} isn't supported, use fifo instead", static_cast<int>(requested_present_mode));
+		return VK_PRESENT_MODE_FIFO_KHR;
 	}
 
 	VkExtent2D VulkanRHI::getProperSwapchainSurfaceExtent(const SwapchainSupportDetails& details)
@@ -752,8 +942,7 @@ namespace Bamboo
 		}
 
 		int width, height;
-		GLFWwindow* window = g_engine.windowSystem()->getWindow();
-		glfwGetFramebufferSize(window, &width, &height);
+		g_engine.windowSystem()->getFramebufferSize(width, height);
 
 		VkExtent2D actual_extent = { static_cast<uint32_t>(width), static_cast<uint32_t>(height) };
 		actual_extent.width = std::clamp(actual_extent.width, details.capabilities.minImageExtent.width, details.capabilities.maxImageExtent.width);
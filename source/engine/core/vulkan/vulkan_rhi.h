@@ -1,11 +1,17 @@
 #pragma once
 
 #include "vulkan_util.h"
+#include "upload_ring.h"
+#include "upload_manager.h"
+#include "pipeline_cache.h"
 
+#include <atomic>
 #include <functional>
 #include <string>
 #include <vector>
 #include <map>
+#include <mutex>
+#include <thread>
 
 namespace Bamboo
 {
@@ -16,7 +22,17 @@ namespace Bamboo
 		void render();
 		void destroy();
 
-		void waitDeviceIdle() { vkDeviceWaitIdle(m_device); }
+		void waitDeviceIdle();
+
+		// blocks until the gpu has finished the last frame of the current flight index, so the next frame can be recorded
+		void waitFrameFence();
+
+		// the swapchain is recreated with a changed present mode before the next frame, unsupported modes fall back to fifo
+		void setPresentMode(VkPresentModeKHR present_mode) { m_requested_present_mode = present_mode; }
+		VkPresentModeKHR getPresentMode() { return m_requested_present_mode; }
+
+		// queue submissions, presents and device idle waits of all threads are serialized by the queue mutex
+		std::mutex& getQueueMutex() { return m_queue_mutex; }
 
 		VkInstance getInstance() { return m_instance; }
 		VkPhysicalDevice getPhysicalDevice() { return m_physical_device; }
@@ -25,6 +41,7 @@ namespace Bamboo
 		VkFormat getDepthFormat() { return m_depth_format; }
 		VkDevice getDevice() { return m_device; }
 		uint32_t getGraphicsQueueFamily() { return m_queue_family_indices.graphics; }
+		uint32_t getTransferQueueFamily() { return m_queue_family_indices.transfer; }
 		VkQueue getGraphicsQueue() { return m_graphics_queue; }
 		VkQueue getTransferQueue() { return m_transfer_queue; }
 		VmaAllocator getAllocator() { return m_allocator; }
@@ -33,9 +50,17 @@ namespace Bamboo
 		const VkExtent2D& getSwapchainImageSize() { return m_extent; }
 		uint32_t getImageIndex() { return m_image_index; }
 		uint32_t getFlightIndex() { return m_flight_index; }
+		uint32_t getFramesInFlight() { return m_frames_in_flight; }
 		VkCommandPool getInstantCommandPool() { return m_instant_command_pool; }
 		VkCommandBuffer getCommandBuffer() { return m_command_buffers[m_flight_index]; }
 		PFN_vkCmdPushDescriptorSetKHR getVkCmdPushDescriptorSetKHR() { return m_vk_cmd_push_desc_set_func; }
+		UploadRing& getUploadRing() { return m_upload_ring; }
+		UploadManager& getUploadManager() { return m_upload_manager; }
+		PipelineCache& getPipelineCache() { return m_pipeline_cache; }
+		bool isGPUDrivenSupported() { return m_gpu_driven_supported; }
+		bool isHeadless() { return m_headless; }
+		uint32_t getTimestampValidBits() { return m_queue_family_propertiess[m_queue_family_indices.graphics].timestampValidBits; }
+		bool isPipelineStatisticsQuerySupported() { return m_required_device_features.pipelineStatisticsQuery; }
 
 		static VulkanRHI& get()
 		{
@@ -71,12 +96,12 @@ namespace Bamboo
 		void createSwapchain();
 		void createSwapchainObjects();
 		void destroySwapchainObjects();
-		void recreateSwapchain();
+		bool recreateSwapchain();
 		void createCommandPools();
 		void createCommandBuffers();
 		void createSynchronizationPrimitives();
 
-		void waitFrame();
+		bool waitFrame();
 		void recordFrame();
 		void submitFrame();
 		void presentFrame();
@@ -91,7 +116,7 @@ namespace Bamboo
 
 		SwapchainSupportDetails getSwapchainSupportDetails();
 		VkSurfaceFormatKHR getProperSwapchainSurfaceFormat(const SwapchainSupportDetails& details);
-		VkPresentModeKHR getProperSwapchainSurfacePresentMode(const SwapchainSupportDetails& details);
+		VkPresentModeKHR getProperSwapchainSurfacePresentMode(const SwapchainSupportDetails& details, VkPresentModeKHR requested_present_mode);
 		VkExtent2D getProperSwapchainSurfaceExtent(const SwapchainSupportDetails& details);
 		VkImageUsageFlags getProperSwapchainSurfaceImageUsage(const SwapchainSupportDetails& details);
 		VkFormat getProperImageFormat(const std::vector<VkFormat>& candidates, VkImageTiling tiling, VkFormatFeatureFlags features);
@@ -108,6 +133,7 @@ namespace Bamboo
 		VkPhysicalDevice m_physical_device;
 		VkPhysicalDeviceProperties m_physical_device_properties;
 		VkPhysicalDeviceFeatures m_physical_device_features;
+		VkPhysicalDeviceVulkan12Features m_physical_device_vulkan12_features;
 		VkDevice m_device;
 		VkQueue m_graphics_queue;
 		VkQueue m_transfer_queue;
@@ -127,6 +153,12 @@ namespace Bamboo
 		std::vector<const char*> m_required_instance_layers;
 		std::vector<const char*> m_required_device_extensions;
 		VkPhysicalDeviceFeatures m_required_device_features;
+		bool m_gpu_driven_supported = false;
+		bool m_headless = false;
+
+		// the window events can only be waited for on the thread which created the window
+		std::thread::id m_main_thread_id;
+		std::mutex m_queue_mutex;
 
 		// queue families
 		QueueFamilyIndices m_queue_family_indices;
@@ -135,6 +167,8 @@ namespace Bamboo
 		// swapchain objects
 		VkSurfaceFormatKHR m_surface_format;
 		VkPresentModeKHR m_present_mode;
+		VkPresentModeKHR m_swapchain_requested_present_mode;
+		std::atomic<VkPresentModeKHR> m_requested_present_mode = VK_PRESENT_MODE_MAILBOX_KHR;
 		VkExtent2D m_extent;
 		VkFormat m_depth_format;
 
@@ -142,6 +176,7 @@ namespace Bamboo
 		std::vector<VkImageView> m_swapchain_image_views;
 
 		// synchronization primitives
+		uint32_t m_frames_in_flight = 2;
 		uint32_t m_flight_index;
 		uint32_t m_image_index;
 		std::vector<VkSemaphore> m_image_avaliable_semaphores;
@@ -151,5 +186,14 @@ namespace Bamboo
 
 		// additional device extension functions
 		PFN_vkCmdPushDescriptorSetKHR m_vk_cmd_push_desc_set_func;
+
+		// per frame uniform and storage data
+		UploadRing m_upload_ring;
+
+		// asynchronous buffer and image uploads on the transfer queue
+		UploadManager m_upload_manager;
+
+		// persistent pipeline cache of all render passes
+		PipelineCache m_pipeline_cache;
 	};
 }
\ No newline at end of file
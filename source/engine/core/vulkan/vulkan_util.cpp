@@ -4,6 +4,8 @@
 
 #include <tinygltf/stb_image.h>
 #include <fstream>
+#include <array>
+#include <mutex>
 
 namespace Bamboo
 {
@@ -96,8 +98,12 @@ namespace Bamboo
 		vma_image.destroy();
 	}
 
+	// the instant command pool is shared by all threads, it's locked from begin to end of the instant commands
+	static std::recursive_mutex s_instant_command_mutex;
+
 	VkCommandBuffer VulkanUtil::beginInstantCommands()
 	{
+		s_instant_command_mutex.lock();
 		VkCommandBufferAllocateInfo command_buffer_ai{};
 		command_buffer_ai.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
 		command_buffer_ai.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
@@ -125,6 +131,20 @@ namespace Bamboo
 		submit_info.commandBufferCount = 1;
 		submit_info.pCommandBuffers = &command_buffer;
 
+		// wait for all recorded uploads on the device
+		uint64_t upload_value = VulkanRHI::get().getUploadManager().submit();
+		VkSemaphore upload_semaphore = VulkanRHI::get().getUploadManager().getSemaphore();
+		VkPipelineStageFlags upload_wait_stage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+
+		VkTimelineSemaphoreSubmitInfo timeline_semaphore_si{};
+		timeline_semaphore_si.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+		timeline_semaphore_si.waitSemaphoreValueCount = 1;
+		timeline_semaphore_si.pWaitSemaphoreValues = &upload_value;
+		submit_info.pNext = &timeline_semaphore_si;
+		submit_info.waitSemaphoreCount = 1;
+		submit_info.pWaitSemaphores = &upload_semaphore;
+		submit_info.pWaitDstStageMask = &upload_wait_stage;
+
 		VkFenceCreateInfo fence_ci{};
 		fence_ci.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
 		fence_ci.flags = 0;
@@ -133,12 +153,16 @@ namespace Bamboo
 		vkCreateFence(VulkanRHI::get().getDevice(), &fence_ci, nullptr, &fence);
 
 		VkQueue queue = VulkanRHI::get().getGraphicsQueue();
-		vkQueueSubmit(queue, 1, &submit_info, fence);
+		{
+			std::lock_guard<std::mutex> queue_lock(VulkanRHI::get().getQueueMutex());
+			vkQueueSubmit(queue, 1, &submit_info, fence);
+		}
 
 		vkWaitForFences(VulkanRHI::get().getDevice(), 1, &fence, VK_TRUE, UINT64_MAX);
 		vkDestroyFence(VulkanRHI::get().getDevice(), fence, nullptr);
 
 		vkFreeCommandBuffers(VulkanRHI::get().getDevice(), VulkanRHI::get().getInstantCommandPool(), 1, &command_buffer);
+		s_instant_command_mutex.unlock();
 	}
 
 	void VulkanUtil::createBuffer(VkDeviceSize size, VkBufferUsageFlags buffer_usage, VmaMemoryUsage memory_usage, VmaBuffer& buffer)
@@ -150,6 +174,15 @@ namespace Bamboo
 		buffer_ci.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 		buffer_ci.flags = 0;
 
+		// transfer destinations are shared with the transfer queue, which the upload manager submits to
+		std::array<uint32_t, 2> queue_families = { VulkanRHI::get().getGraphicsQueueFamily(), VulkanRHI::get().getTransferQueueFamily() };
+		if ((buffer_usage & VK_BUFFER_USAGE_TRANSFER_DST_BIT) && queue_families[0] != queue_families[1])
+		{
+			buffer_ci.sharingMode = VK_SHARING_MODE_CONCURRENT;
+			buffer_ci.queueFamilyIndexCount = static_cast<uint32_t>(queue_families.size());
+			buffer_ci.pQueueFamilyIndices = queue_families.data();
+		}
+
 		VmaAllocationCreateInfo vma_alloc_ci{};
 		vma_alloc_ci.usage = memory_usage;
 		if (memory_usage == VMA_MEMORY_USAGE_AUTO_PREFER_HOST)
@@ -174,10 +207,39 @@ namespace Bamboo
 
 	void VulkanUtil::updateBuffer(VmaBuffer& buffer, void* data, size_t size)
 	{
-		void* mapped_data;
-		vmaMapMemory(VulkanRHI::get().getAllocator(), buffer.allocation, &mapped_data);
-		memcpy(mapped_data, data, size);
-		vmaUnmapMemory(VulkanRHI::get().getAllocator(), buffer.allocation);
+		// host buffers are persistently mapped when they are created, so only map the others
+		VmaAllocationInfo allocation_info;
+		vmaGetAllocationInfo(VulkanRHI::get().getAllocator(), buffer.allocation, &allocation_info);
+		if (allocation_info.pMappedData)
+		{
+			memcpy(allocation_info.pMappedData, data, size);
+		}
+		else
+		{
+			void* mapped_data;
+			vmaMapMemory(VulkanRHI::get().getAllocator(), buffer.allocation, &mapped_data);
+			memcpy(mapped_data, data, size);
+			vmaUnmapMemory(VulkanRHI::get().getAllocator(), buffer.allocation);
+		}
+		vmaFlushAllocation(VulkanRHI::get().getAllocator(), buffer.allocation, 0, size);
+	}
+
+	void VulkanUtil::reserveBuffer(VmaBuffer& buffer, VkDeviceSize size, VkDeviceSize min_size, VkBufferUsageFlags buffer_usage, VmaMemoryUsage memory_usage)
+	{
+		size = std::max(size, min_size);
+		if (buffer.buffer != VK_NULL_HANDLE && buffer.size >= size)
+		{
+			return;
+		}
+
+		VkDeviceSize capacity = buffer.buffer == VK_NULL_HANDLE ? min_size : buffer.size;
+		while (capacity < size)
+		{
+			capacity *= 2;
+		}
+
+		buffer.destroy();
+		createBuffer(capacity, buffer_usage, memory_usage, buffer);
 	}
 
 	VmaImageViewSampler VulkanUtil::loadImageViewSampler(const std::string& filename,
@@ -236,23 +298,20 @@ namespace Bamboo
 
 		if (image_data)
 		{
-			size_t image_size = width * height * calcFormatSize(format);
-			VmaBuffer staging_buffer;
-			createBuffer(image_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_AUTO_PREFER_HOST, staging_buffer);
-
-			// copy image pixel data to staging buffer
-			updateBuffer(staging_buffer, image_data, image_size);
+			// upload the first mip level and leave the image in DST_OPT state
+			VkBufferImageCopy region{};
+			region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+			region.imageSubresource.mipLevel = 0;
+			region.imageSubresource.baseArrayLayer = 0;
+			region.imageSubresource.layerCount = 1;
+			region.imageExtent = { width, height, 1 };
 
-			// transition image to DST_OPT state for copy into
-			transitionImageLayout(image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, format, mip_levels);
-
-			// copy staging buffer to image
-			copyBufferToImage(staging_buffer.buffer, image, width, height);
-
-			// clear staging buffer
-			vmaDestroyBuffer(VulkanRHI::get().getAllocator(), staging_buffer.buffer, staging_buffer.allocation);
+			size_t image_size = width * height * calcFormatSize(format);
+			VulkanRHI::get().getUploadManager().uploadImage(image, image_data, image_size, { region }, 
+				mip_levels, layers, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
 
-			// generate image mipmaps, and transition image to READ_ONLY_OPT state for shader reading
+			// generate image mipmaps with blits on the graphics queue, which waits for the upload, 
+			// and transition image to READ_ONLY_OPT state for shader reading
 			createImageMipmaps(image, width, height, mip_levels);
 		}
 	}
@@ -293,6 +352,15 @@ namespace Bamboo
 		image_ci.samples = num_samples;
 		image_ci.flags = layers == 6 ? VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT : 0;
 
+		// transfer destinations are shared with the transfer queue, which the upload manager submits to
+		std::array<uint32_t, 2> queue_families = { VulkanRHI::get().getGraphicsQueueFamily(), VulkanRHI::get().getTransferQueueFamily() };
+		if ((image_usage & VK_IMAGE_USAGE_TRANSFER_DST_BIT) && queue_families[0] != queue_families[1])
+		{
+			image_ci.sharingMode = VK_SHARING_MODE_CONCURRENT;
+			image_ci.queueFamilyIndexCount = static_cast<uint32_t>(queue_families.size());
+			image_ci.pQueueFamilyIndices = queue_families.data();
+		}
+
 		VmaAllocationCreateInfo vma_alloc_ci{};
 		vma_alloc_ci.usage = memory_usage;
 		if (memory_usage == VMA_MEMORY_USAGE_AUTO_PREFER_HOST)
@@ -352,48 +420,36 @@ namespace Bamboo
 		return sampler;
 	}
 
-	void VulkanUtil::createVertexBuffer(uint32_t buffer_size, void* vertex_data, VmaBuffer& vertex_buffer)
+	UploadHandle VulkanUtil::createVertexBuffer(uint32_t buffer_size, void* vertex_data, VmaBuffer& vertex_buffer)
 	{
-		VmaBuffer staging_buffer;
-		createBuffer(buffer_size, 
-			VK_BUFFER_USAGE_TRANSFER_SRC_BIT, 
-			VMA_MEMORY_USAGE_AUTO_PREFER_HOST, 
-			staging_buffer);
-
-		// copy vertex staging_buffer_data to staging buffer
-		updateBuffer(staging_buffer, vertex_data, static_cast<size_t>(buffer_size));
-
 		createBuffer(buffer_size,
 			VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
 			VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE,
 			vertex_buffer);
 
-		copyBuffer(staging_buffer.buffer, vertex_buffer.buffer, buffer_size);
-
-		vmaDestroyBuffer(VulkanRHI::get().getAllocator(), staging_buffer.buffer, staging_buffer.allocation);
+		// copy vertex data through the upload manager's staging ring
+		return VulkanRHI::get().getUploadManager().uploadBuffer(vertex_buffer.buffer, vertex_data, buffer_size);
 	}
 
-	void VulkanUtil::createIndexBuffer(const std::vector<uint32_t>& indices, VmaBuffer& index_buffer)
+	UploadHandle VulkanUtil::createIndexBuffer(const std::vector<uint32_t>& indices, VmaBuffer& index_buffer)
 	{
-		VkDeviceSize buffer_size = sizeof(indices[0]) * indices.size();
-
-		VmaBuffer staging_buffer;
-		createBuffer(buffer_size,
-			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-			VMA_MEMORY_USAGE_AUTO_PREFER_HOST,
-			staging_buffer);
+		return createIndexBuffer(indices.data(), sizeof(indices[0]) * indices.size(), index_buffer);
+	}
 
-		// copy index data to staging buffer
-		updateBuffer(staging_buffer, (void*)indices.data(), static_cast<size_t>(buffer_size));
+	UploadHandle VulkanUtil::createIndexBuffer(const std::vector<uint16_t>& indices, VmaBuffer& index_buffer)
+	{
+		return createIndexBuffer(indices.data(), sizeof(indices[0]) * indices.size(), index_buffer);
+	}
 
+	UploadHandle VulkanUtil::createIndexBuffer(const void* index_data, VkDeviceSize buffer_size, VmaBuffer& index_buffer)
+	{
 		createBuffer(buffer_size,
 			VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
 			VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE,
 			index_buffer);
 
-		copyBuffer(staging_buffer.buffer, index_buffer.buffer, buffer_size);
-
-		vmaDestroyBuffer(VulkanRHI::get().getAllocator(), staging_buffer.buffer, staging_buffer.allocation);
+		// copy index data through the upload manager's staging ring
+		return VulkanRHI::get().getUploadManager().uploadBuffer(index_buffer.buffer, index_data, buffer_size);
 	}
 
 	VkAccessFlags accessFlagsForImageLayout(VkImageLayout layout)
@@ -4,8 +4,6 @@
 #include <vulkan/vulkan.h>
 #include <vma/vk_mem_alloc.h>
 
-#define MAX_FRAMES_IN_FLIGHT 2
-
 namespace Bamboo
 {
 	// get VkResult error code string
@@ -21,6 +19,20 @@ namespace Bamboo
         LOG_FATAL("failed to {}, error: {}", msg, vkErrorString(result)); \
     }
 
+	// VMA Buffer range, e.g. a sub allocation of the upload ring
+	struct VmaBufferRange
+	{
+		VkBuffer buffer = VK_NULL_HANDLE;
+		VkDeviceSize offset = 0;
+		VkDeviceSize size = 0;
+	};
+
+	// handle of an upload, which has completed when the upload manager's timeline semaphore reaches its value
+	struct UploadHandle
+	{
+		uint64_t value = 0;
+	};
+
 	// VMA Buffer
 	struct VmaBuffer
 	{
@@ -29,6 +41,7 @@ namespace Bamboo
 		VkDeviceSize size;
 
 		void destroy();
+		VmaBufferRange range() const { return { buffer, 0, size }; }
 	};
 
 	// VMA Image
@@ -75,6 +88,9 @@ namespace Bamboo
 		static void copyBuffer(VkBuffer src_buffer, VkBuffer dst_buffer, VkDeviceSize size);
 		static void updateBuffer(VmaBuffer& buffer, void* data, size_t size);
 
+		// grow a per flight buffer by doubling, its contents are lost and its last use must have completed
+		static void reserveBuffer(VmaBuffer& buffer, VkDeviceSize size, VkDeviceSize min_size, VkBufferUsageFlags buffer_usage, VmaMemoryUsage memory_usage);
+
 		static VmaImageViewSampler loadImageViewSampler(const std::string& filename,
 			uint32_t mip_levels = 1, uint32_t layers = 1, VkFormat format = VK_FORMAT_R8G8B8A8_SRGB, 
 			VkFilter min_filter = VK_FILTER_LINEAR, VkFilter mag_filter = VK_FILTER_LINEAR,
@@ -92,8 +108,10 @@ namespace Bamboo
 		static VkSampler createSampler(VkFilter min_filter, VkFilter mag_filter, uint32_t mip_levels,
 			VkSamplerAddressMode address_mode_u, VkSamplerAddressMode address_mode_v, VkSamplerAddressMode address_mode_w);
 
-		static void createVertexBuffer(uint32_t buffer_size, void* vertex_data, VmaBuffer& vertex_buffer);
-		static void createIndexBuffer(const std::vector<uint32_t>& indices, VmaBuffer& index_buffer);
+		static UploadHandle createVertexBuffer(uint32_t buffer_size, void* vertex_data, VmaBuffer& vertex_buffer);
+		static UploadHandle createIndexBuffer(const std::vector<uint32_t>& indices, VmaBuffer& index_buffer);
+		static UploadHandle createIndexBuffer(const std::vector<uint16_t>& indices, VmaBuffer& index_buffer);
+		static UploadHandle createIndexBuffer(const void* index_data, VkDeviceSize buffer_size, VmaBuffer& index_buffer);
 
 		static void transitionImageLayout(VkImage image, VkImageLayout old_layout, VkImageLayout new_layout, 
 			VkFormat format = VK_FORMAT_B8G8R8A8_SRGB, uint32_t mip_levels = 1, uint32_t layers = 1);
@@ -1,12 +1,15 @@
 #include "engine.h"
 #include "engine/core/base/macro.h"
 #include "engine/core/time/time_manager.h"
+#include "engine/core/time/frame_pacer.h"
 #include "engine/core/service/service_locator.h"
 #include "engine/function/global/engine_context.h"
 #include "engine/function/render/window_system.h"
 #include "engine/function/render/render_system.h"
 #include "engine/function/framework/world/world_manager.h"
 #include "engine/core/event/event_system.h"
+#include "engine/core/config/config_manager.h"
+#include "engine/core/profile/cpu_profiler.h"
 #include "engine/platform/timer/timer.h"
 #include "engine/core/log/log_system.h"
 #include "engine/platform/file/file_system.h"
@@ -18,6 +21,7 @@ namespace Bamboo
         : m_is_running(false)
         , m_is_initialized(false)
         , m_time_manager(nullptr)
+        , m_frame_pacer(nullptr)
     {
     }
 
@@ -66,9 +70,23 @@ namespace Bamboo
             return false;
         }
 
+        // Create frame pacer, configured once the config manager is initialized
+        m_frame_pacer = std::make_shared<FramePacer>();
+        m_frame_pacer->setTargetFrameRate(g_engine.configManager()->getTargetFrameRate());
+        m_frame_pacer->setLowLatency(g_engine.configManager()->isLowLatencyEnabled());
+        Services().registerService<FramePacer>(m_frame_pacer);
+
         m_is_initialized = true;
         m_is_running = true;
 
+        // capture the first frames if configured
+        CPUProfiler::get().setThreadName("main");
+        int profile_capture_frames = g_engine.configManager()->getProfileCaptureFrames();
+        if (profile_capture_frames > 0)
+        {
+            CPUProfiler::get().captureFrames(profile_capture_frames);
+        }
+
         LOG_INFO("Engine initialized successfully");
         return true;
     }
@@ -91,6 +109,7 @@ namespace Bamboo
         Services().clear();
 
         m_time_manager.reset();
+        m_frame_pacer.reset();
         m_is_initialized = false;
 
         LOG_INFO("Engine shutdown complete");
@@ -103,6 +122,8 @@ namespace Bamboo
             return false;
         }
 
+        PROFILE_FRAME();
+
         // Update time and get delta time
         float delta_time = m_time_manager->tick();
 
@@ -113,6 +134,13 @@ namespace Bamboo
         updateLogic(delta_time);
         updateRender(delta_time);
 
+        // Pace the frame rate, in low latency mode the gpu is waited for right before input is sampled
+        m_frame_pacer->wait();
+        if (m_frame_pacer->isLowLatency() && g_engine.renderSystem())
+        {
+            g_engine.renderSystem()->waitForGPU();
+        }
+
         // Update window title with FPS
         if (g_engine.windowSystem())
         {
@@ -199,6 +227,7 @@ namespace Bamboo
 
     void Engine::updateLogic(float delta_time)
     {
+        PROFILE_SCOPE("Engine::updateLogic");
         if (g_engine.eventSystem())
         {
             g_engine.eventSystem()->tick();
@@ -217,6 +246,7 @@ namespace Bamboo
 
     void Engine::updateRender(float delta_time)
     {
+        PROFILE_SCOPE("Engine::updateRender");
         if (g_engine.renderSystem())
         {
             g_engine.renderSystem()->tick(delta_time);
@@ -6,6 +6,7 @@ namespace Bamboo
 {
     // Forward declarations
     class TimeManager;
+    class FramePacer;
     /**
      * @brief Main engine class responsible for the game loop and system coordination
      * Refactored to follow single responsibility principle
@@ -85,5 +86,6 @@ namespace Bamboo
         bool m_is_initialized;
         
         std::shared_ptr<class TimeManager> m_time_manager;
+        std::shared_ptr<class FramePacer> m_frame_pacer;
     };
 }
\ No newline at end of file
@@ -16,23 +16,6 @@ CEREAL_REGISTER_POLYMORPHIC_RELATION(Bamboo::Component, Bamboo::AnimatorComponen
 namespace Bamboo
 {
 
-	AnimatorComponent::AnimatorComponent()
-	{
-		m_bone_ubs.resize(MAX_FRAMES_IN_FLIGHT);
-		for (VmaBuffer& bone_ub : m_bone_ubs)
-		{
-			VulkanUtil::createBuffer(sizeof(BoneUBO), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VMA_MEMORY_USAGE_AUTO_PREFER_HOST, bone_ub);
-		}
-	}
-
-	AnimatorComponent::~AnimatorComponent()
-	{
-		for (VmaBuffer& bone_ub : m_bone_ubs)
-		{
-			bone_ub.destroy();
-		}
-	}
-
 	void AnimatorComponent::setSkeleton(std::shared_ptr<Skeleton>& skeleton)
 	{
 		m_skeleton_inst = *skeleton;
@@ -124,18 +107,12 @@ namespace Bamboo
 			m_time -= animation->m_duration;
 		}
 
-		// update skeleton and bone matrices
+		// update skeleton and bone matrices, which are uploaded by the render system every frame
 		m_skeleton_inst.update();
 		for (size_t i = 0; i < m_skeleton_inst.m_bones.size(); ++i)
 		{
 			m_bone_ubo.bone_matrices[i] = m_skeleton_inst.m_bones[i].matrix();
 		}
-
-		// update uniform buffers
- 		for (VmaBuffer& bone_ub : m_bone_ubs)
- 		{
- 			VulkanUtil::updateBuffer(bone_ub, (void*)&m_bone_ubo, sizeof(BoneUBO));
- 		}
 	}
 
 	void AnimatorComponent::play(bool loop)
@@ -2,7 +2,6 @@
 
 #include "component.h"
 #include "engine/resource/asset/skeleton.h"
-#include "engine/core/vulkan/vulkan_util.h"
 #include "host_device.h"
 
 namespace Bamboo
@@ -10,15 +9,11 @@ namespace Bamboo
 	class AnimatorComponent : public Component, public IAssetRef
 	{
 	public:
-		AnimatorComponent();
-		~AnimatorComponent();
-
 		void setSkeleton(std::shared_ptr<Skeleton>& skeleton);
 		std::shared_ptr<Skeleton> getSkeleton() { return m_skeleton; }
 
 		void play(bool loop = true);
-
-		std::vector<VmaBuffer> m_bone_ubs;
+		const BoneUBO& getBoneUBO() { return m_bone_ubo; }
 
 	protected:
 		virtual void inflate() override;
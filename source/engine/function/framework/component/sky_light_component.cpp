@@ -3,6 +3,7 @@
 #include "engine/function/render/pass/brdf_lut_pass.h"
 #include "engine/function/render/pass/filter_cube_pass.h"
 #include "engine/resource/asset/texture_2d.h"
+#include "engine/function/render/render_system.h"
 
 RTTR_REGISTRATION
 {
@@ -24,6 +25,11 @@ namespace Bamboo
 
 	SkyLightComponent::~SkyLightComponent()
 	{
+		// the render thread may still render a snapshot with the ibl textures
+		if (g_engine.renderSystem())
+		{
+			g_engine.renderSystem()->flush();
+		}
 		m_irradiance_texture_sampler.destroy();
 		m_prefilter_texture_sampler.destroy();
 	}
@@ -63,6 +69,10 @@ namespace Bamboo
 		filter_cube_pass->render();
 		filter_cube_pass->destroy();
 
+		if (g_engine.renderSystem())
+		{
+			g_engine.renderSystem()->flush();
+		}
 		m_irradiance_texture_sampler.destroy();
 		m_prefilter_texture_sampler.destroy();
 
@@ -1,6 +1,7 @@
 #include "world_manager.h"
 #include "engine/core/base/macro.h"
 #include "engine/core/config/config_manager.h"
+#include "engine/core/profile/cpu_profiler.h"
 #include "engine/resource/asset/asset_manager.h"
 #include "engine/resource/asset/skeletal_mesh.h"
 #include "engine/resource/asset/texture_2d.h"
@@ -33,6 +34,7 @@ namespace Bamboo
 
 	void WorldManager::tick(float delta_time)
 	{
+		PROFILE_SCOPE("WorldManager::tick");
 		// open world async
 		if (!m_open_world_url.empty())
 		{
@@ -68,7 +68,8 @@ namespace Bamboo
 
     void EngineContext::destroy()
     {
-		// wait all gpu operations done
+		// wait all ticked frames rendered and all gpu operations done
+        m_render_system->flush();
         VulkanRHI::get().waitDeviceIdle();
 
         // destroy with reverse initialize order
@@ -41,6 +41,10 @@ namespace Bamboo
             bool isPausing();
             bool isSimulating() { return isPlaying() || isPausing(); }
 
+            // headless runs render offscreen without a window, surface or swapchain, set before init
+            void setHeadless(bool headless) { m_headless = headless; }
+            bool isHeadless() { return m_headless; }
+
         private:
             std::shared_ptr<class TimerManager> m_timer_manager;
 			std::shared_ptr<class FileSystem> m_file_system;
@@ -56,6 +60,7 @@ namespace Bamboo
 			std::shared_ptr<class DebugDrawManager> m_debug_draw_system;
 
             float m_delta_time = 0.0f;
+            bool m_headless = false;
     };
 
     extern EngineContext g_engine;
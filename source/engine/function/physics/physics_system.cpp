@@ -1,6 +1,7 @@
 #include "physics_system.h"
 #include "engine/core/base/macro.h"
 #include "engine/platform/timer/timer.h"
+#include "engine/core/profile/cpu_profiler.h"
 #include "engine/core/math/math_util.h"
 #include "engine/function/framework/world/world_manager.h"
 #include "engine/function/framework/component/transform_component.h"
@@ -308,6 +309,7 @@ namespace Bamboo
 
 	void PhysicsSystem::tick()
 	{
+		PROFILE_SCOPE("PhysicsSystem::tick");
 		static StopWatch stop_watch;
 		static bool last_simulating = false;
 		float delta_time = stop_watch.stop();
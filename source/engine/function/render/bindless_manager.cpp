@@ -0,0 +1,333 @@
+#include "bindless_manager.h"
+#include "engine/core/vulkan/vulkan_rhi.h"
+#include <cstring>
+
+namespace Bamboo
+{
+
+	void BindlessManager::init()
+	{
+		// leave room for the other samplers of the main pass's pipeline layouts, low limits mustn't wrap around
+		const uint32_t k_max_texture_count = 4096;
+		const uint32_t k_min_texture_count = 16;
+		const uint32_t k_reserved_sampler_count = 32;
+		auto available = [k_reserved_sampler_count](uint32_t limit) {
+			return limit > k_reserved_sampler_count ? limit - k_reserved_sampler_count : 0;
+		};
+		const VkPhysicalDeviceLimits& limits = VulkanRHI::get().getPhysicalDeviceProperties().limits;
+		m_max_texture_count = std::min({ k_max_texture_count,
+			available(limits.maxPerStageDescriptorSamplers),
+			available(limits.maxPerStageDescriptorSampledImages),
+			available(limits.maxDescriptorSetSamplers),
+			available(limits.maxDescriptorSetSampledImages) });
+		if (m_max_texture_count < k_min_texture_count)
+		{
+			LOG_FATAL("device supports only {} bindless textures, at least {} are required", m_max_texture_count, k_min_texture_count);
+		}
+
+		// create descriptor set layout, the texture array doesn't need to be fully written
+		std::vector<VkDescriptorSetLayoutBinding> desc_set_layout_bindings = {
+			{0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr},
+			{1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, m_max_texture_count, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr}
+		};
+		std::vector<VkDescriptorBindingFlags> desc_binding_flags = { 0, VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT };
+
+		VkDescriptorSetLayoutBindingFlagsCreateInfo desc_set_layout_binding_flags_ci{};
+		desc_set_layout_binding_flags_ci.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+		desc_set_layout_binding_flags_ci.bindingCount = static_cast<uint32_t>(desc_binding_flags.size());
+		desc_set_layout_binding_flags_ci.pBindingFlags = desc_binding_flags.data();
+
+		VkDescriptorSetLayoutCreateInfo desc_set_layout_ci{};
+		desc_set_layout_ci.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+		desc_set_layout_ci.pNext = &desc_set_layout_binding_flags_ci;
+		desc_set_layout_ci.bindingCount = static_cast<uint32_t>(desc_set_layout_bindings.size());
+		desc_set_layout_ci.pBindings = desc_set_layout_bindings.data();
+
+		VkResult result = vkCreateDescriptorSetLayout(VulkanRHI::get().getDevice(), &desc_set_layout_ci, nullptr, &m_desc_set_layout);
+		CHECK_VULKAN_RESULT(result, "create bindless descriptor set layout");
+
+		// create descriptor pool
+		uint32_t frames_in_flight = VulkanRHI::get().getFramesInFlight();
+		std::vector<VkDescriptorPoolSize> pool_sizes = {
+			{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, frames_in_flight },
+			{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, m_max_texture_count * frames_in_flight }
+		};
+
+		VkDescriptorPoolCreateInfo desc_pool_ci{};
+		desc_pool_ci.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+		desc_pool_ci.maxSets = frames_in_flight;
+		desc_pool_ci.poolSizeCount = static_cast<uint32_t>(pool_sizes.size());
+		desc_pool_ci.pPoolSizes = pool_sizes.data();
+
+		result = vkCreateDescriptorPool(VulkanRHI::get().getDevice(), &desc_pool_ci, nullptr, &m_desc_pool);
+		CHECK_VULKAN_RESULT(result, "create bindless descriptor pool");
+
+		// allocate one descriptor set per flight, so it can be rewritten while the other flights are in use
+		std::vector<VkDescriptorSetLayout> desc_set_layouts(frames_in_flight, m_desc_set_layout);
+		VkDescriptorSetAllocateInfo desc_set_ai{};
+		desc_set_ai.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		desc_set_ai.descriptorPool = m_desc_pool;
+		desc_set_ai.descriptorSetCount = static_cast<uint32_t>(desc_set_layouts.size());
+		desc_set_ai.pSetLayouts = desc_set_layouts.data();
+
+		m_desc_sets.resize(frames_in_flight);
+		result = vkAllocateDescriptorSets(VulkanRHI::get().getDevice(), &desc_set_ai, m_desc_sets.data());
+		CHECK_VULKAN_RESULT(result, "allocate bindless descriptor sets");
+
+		m_material_sbs.resize(frames_in_flight);
+		m_written_texture_views.resize(frames_in_flight);
+		m_written_material_buffers.resize(frames_in_flight, VK_NULL_HANDLE);
+	}
+
+	void BindlessManager::destroy()
+	{
+		for (VmaBuffer& material_sb : m_material_sbs)
+		{
+			material_sb.destroy();
+		}
+
+		vkDestroyDescriptorPool(VulkanRHI::get().getDevice(), m_desc_pool, nullptr);
+		vkDestroyDescriptorSetLayout(VulkanRHI::get().getDevice(), m_desc_set_layout, nullptr);
+	}
+
+	static uint64_t hashMaterial(const MaterialData& material)
+	{
+		// fnv-1a hash of the material bytes
+		uint64_t material_hash = 0xcbf29ce484222325ull;
+		const uint8_t* p_material = reinterpret_cast<const uint8_t*>(&material);
+		for (size_t i = 0; i < sizeof(MaterialData); ++i)
+		{
+			material_hash = (material_hash ^ p_material[i]) * 0x100000001b3ull;
+		}
+		return material_hash;
+	}
+
+	void BindlessManager::reset()
+	{
+		// release the references of a frame which wasn't recorded
+		releaseFrameReferences(m_last_frame_texture_indices, m_last_frame_material_indices);
+		m_last_frame_texture_indices.swap(m_frame_texture_indices);
+		m_last_frame_material_indices.swap(m_frame_material_indices);
+	}
+
+	int BindlessManager::addTexture(const VmaImageViewSampler& texture)
+	{
+		int texture_index = acquireTexture(texture);
+		if (texture_index != INVALID_TEXTURE_INDEX)
+		{
+			m_frame_texture_indices.push_back(texture_index);
+		}
+		return texture_index;
+	}
+
+	uint32_t BindlessManager::addMaterial(const MaterialData& material)
+	{
+		uint32_t material_index = acquireMaterial(material);
+		m_frame_material_indices.push_back(material_index);
+		return material_index;
+	}
+
+	int BindlessManager::acquireTexture(const VmaImageViewSampler& texture)
+	{
+		auto iter = m_texture_indices.find(texture.view);
+		if (iter != m_texture_indices.end())
+		{
+			m_texture_ref_counts[iter->second]++;
+			return iter->second;
+		}
+
+		int texture_index = INVALID_TEXTURE_INDEX;
+		if (!m_free_texture_indices.empty())
+		{
+			texture_index = m_free_texture_indices.back();
+			m_free_texture_indices.pop_back();
+		}
+		else if (m_textures.size() < m_max_texture_count)
+		{
+			texture_index = static_cast<int>(m_textures.size());
+			m_textures.emplace_back();
+			m_texture_ref_counts.push_back(0);
+		}
+		else
+		{
+			LOG_WARNING("bindless texture count exceeds {}", m_max_texture_count);
+			return INVALID_TEXTURE_INDEX;
+		}
+
+		m_textures[texture_index] = texture;
+		m_texture_ref_counts[texture_index] = 1;
+		m_texture_indices[texture.view] = texture_index;
+		return texture_index;
+	}
+
+	void BindlessManager::releaseTexture(int texture_index)
+	{
+		if (texture_index == INVALID_TEXTURE_INDEX || --m_texture_ref_counts[texture_index] > 0)
+		{
+			return;
+		}
+
+		// the descriptor is left in the flights' descriptor sets until the slot is reused
+		m_texture_indices.erase(m_textures[texture_index].view);
+		m_free_texture_indices.push_back(texture_index);
+	}
+
+	uint32_t BindlessManager::acquireMaterial(const MaterialData& material)
+	{
+		uint64_t material_hash = hashMaterial(material);
+		auto range = m_material_indices.equal_range(material_hash);
+		for (auto iter = range.first; iter != range.second; ++iter)
+		{
+			if (memcmp(&m_materials[iter->second], &material, sizeof(MaterialData)) == 0)
+			{
+				m_material_ref_counts[iter->second]++;
+				return iter->second;
+			}
+		}
+
+		uint32_t material_index = static_cast<uint32_t>(m_materials.size());
+		if (!m_free_material_indices.empty())
+		{
+			material_index = m_free_material_indices.back();
+			m_free_material_indices.pop_back();
+		}
+		else
+		{
+			m_materials.emplace_back();
+			m_material_ref_counts.push_back(0);
+		}
+
+		m_materials[material_index] = material;
+		m_material_ref_counts[material_index] = 1;
+		m_material_indices.emplace(material_hash, material_index);
+		return material_index;
+	}
+
+	void BindlessManager::releaseMaterial(uint32_t material_index)
+	{
+		if (--m_material_ref_counts[material_index] > 0)
+		{
+			return;
+		}
+
+		auto range = m_material_indices.equal_range(hashMaterial(m_materials[material_index]));
+		for (auto iter = range.first; iter != range.second; ++iter)
+		{
+			if (iter->second == material_index)
+			{
+				m_material_indices.erase(iter);
+				break;
+			}
+		}
+		m_free_material_indices.push_back(material_index);
+	}
+
+	uint32_t BindlessManager::getMaterialFeatures(const MaterialData& material)
+	{
+		uint32_t material_features = 0;
+		material_features |= material.base_color_texture_index != INVALID_TEXTURE_INDEX ? MATERIAL_FEATURE_BASE_COLOR_TEXTURE : 0;
+		material_features |= material.metallic_roughness_occlusion_texture_index != INVALID_TEXTURE_INDEX ? MATERIAL_FEATURE_METALLIC_ROUGHNESS_OCCLUSION_TEXTURE : 0;
+		material_features |= material.normal_texture_index != INVALID_TEXTURE_INDEX ? MATERIAL_FEATURE_NORMAL_TEXTURE : 0;
+		material_features |= material.emissive_texture_index != INVALID_TEXTURE_INDEX ? MATERIAL_FEATURE_EMISSIVE_TEXTURE : 0;
+		return material_features;
+	}
+
+	void BindlessManager::releaseFrameReferences(std::vector<int>& texture_indices, std::vector<uint32_t>& material_indices)
+	{
+		for (int texture_index : texture_indices)
+		{
+			releaseTexture(texture_index);
+		}
+		for (uint32_t material_index : material_indices)
+		{
+			releaseMaterial(material_index);
+		}
+		texture_indices.clear();
+		material_indices.clear();
+	}
+
+	void BindlessManager::update()
+	{
+		m_flight_index = VulkanRHI::get().getFlightIndex();
+
+		// the indices of the last frame which this frame doesn't reference are released
+		releaseFrameReferences(m_last_frame_texture_indices, m_last_frame_material_indices);
+
+		// grow the material buffer of this flight
+		const VkDeviceSize k_min_material_count = 64;
+		VmaBuffer& material_sb = m_material_sbs[m_flight_index];
+		VkDeviceSize material_buffer_size = std::max(static_cast<VkDeviceSize>(m_materials.size()), k_min_material_count) * sizeof(MaterialData);
+		if (material_sb.buffer == VK_NULL_HANDLE || material_sb.size < material_buffer_size)
+		{
+			VkDeviceSize capacity = material_sb.buffer == VK_NULL_HANDLE ? k_min_material_count * sizeof(MaterialData) : material_sb.size;
+			while (capacity < material_buffer_size)
+			{
+				capacity *= 2;
+			}
+
+			material_sb.destroy();
+			VulkanUtil::createBuffer(capacity, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_AUTO_PREFER_HOST, material_sb);
+		}
+
+		if (!m_materials.empty())
+		{
+			VulkanUtil::updateBuffer(material_sb, m_materials.data(), m_materials.size() * sizeof(MaterialData));
+		}
+
+		// only write the descriptors which changed since this flight's descriptor set was last written
+		std::vector<VkWriteDescriptorSet> desc_writes;
+		VkDescriptorBufferInfo desc_buffer_info{};
+		std::vector<VkDescriptorImageInfo> desc_image_infos(m_textures.size());
+
+		if (m_written_material_buffers[m_flight_index] != material_sb.buffer)
+		{
+			desc_buffer_info.buffer = material_sb.buffer;
+			desc_buffer_info.offset = 0;
+			desc_buffer_info.range = VK_WHOLE_SIZE;
+
+			VkWriteDescriptorSet desc_write{};
+			desc_write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			desc_write.dstSet = m_desc_sets[m_flight_index];
+			desc_write.dstBinding = 0;
+			desc_write.dstArrayElement = 0;
+			desc_write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			desc_write.descriptorCount = 1;
+			desc_write.pBufferInfo = &desc_buffer_info;
+			desc_writes.push_back(desc_write);
+
+			m_written_material_buffers[m_flight_index] = material_sb.buffer;
+		}
+
+		std::vector<VkImageView>& written_texture_views = m_written_texture_views[m_flight_index];
+		written_texture_views.resize(std::max(written_texture_views.size(), m_textures.size()), VK_NULL_HANDLE);
+		for (size_t i = 0; i < m_textures.size(); ++i)
+		{
+			if (written_texture_views[i] == m_textures[i].view)
+			{
+				continue;
+			}
+
+			desc_image_infos[i].imageLayout = m_textures[i].image_layout;
+			desc_image_infos[i].imageView = m_textures[i].view;
+			desc_image_infos[i].sampler = m_textures[i].sampler;
+
+			VkWriteDescriptorSet desc_write{};
+			desc_write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			desc_write.dstSet = m_desc_sets[m_flight_index];
+			desc_write.dstBinding = 1;
+			desc_write.dstArrayElement = static_cast<uint32_t>(i);
+			desc_write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+			desc_write.descriptorCount = 1;
+			desc_write.pImageInfo = &desc_image_infos[i];
+			desc_writes.push_back(desc_write);
+
+			written_texture_views[i] = m_textures[i].view;
+		}
+
+		if (!desc_writes.empty())
+		{
+			vkUpdateDescriptorSets(VulkanRHI::get().getDevice(), static_cast<uint32_t>(desc_writes.size()), desc_writes.data(), 0, nullptr);
+		}
+	}
+
+}
\ No newline at end of file
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "engine/core/vulkan/vulkan_util.h"
+#include "host_device.h"
+
+#include <unordered_map>
+
+namespace Bamboo
+{
+	// global descriptor set of the textures and materials referenced by a frame or by the gpu scene,
+	// draws only push MaterialPCO::material_index and materials reference textures by their bindless indices.
+	// indices are ref counted, so they stay stable while they're referenced and are reused once released
+	class BindlessManager
+	{
+	public:
+		void init();
+		void destroy();
+
+		// register textures and materials while collecting render datas, equal materials share the same index.
+		// the frame's references are held until the next frame has registered its own, so unchanged indices are kept
+		void reset();
+		int addTexture(const VmaImageViewSampler& texture);
+		uint32_t addMaterial(const MaterialData& material);
+
+		// persistent references of the gpu scene, every acquire is paired with a release
+		int acquireTexture(const VmaImageViewSampler& texture);
+		void releaseTexture(int texture_index);
+		uint32_t acquireMaterial(const MaterialData& material);
+		void releaseMaterial(uint32_t material_index);
+
+		// upload materials and write changed descriptors of the current flight, its last use has completed
+		void update();
+
+		VkDescriptorSetLayout getDescriptorSetLayout() { return m_desc_set_layout; }
+		VkDescriptorSet getDescriptorSet() { return m_desc_sets[m_flight_index]; }
+
+		// MATERIAL_FEATURE_* bits of the textures a material samples
+		static uint32_t getMaterialFeatures(const MaterialData& material);
+
+	private:
+		void releaseFrameReferences(std::vector<int>& texture_indices, std::vector<uint32_t>& material_indices);
+
+		uint32_t m_max_texture_count = 0;
+
+		VkDescriptorSetLayout m_desc_set_layout = VK_NULL_HANDLE;
+		VkDescriptorPool m_desc_pool = VK_NULL_HANDLE;
+		std::vector<VkDescriptorSet> m_desc_sets;
+		std::vector<VmaBuffer> m_material_sbs;
+		uint32_t m_flight_index = 0;
+
+		// registered textures and materials, released slots are reused
+		std::vector<VmaImageViewSampler> m_textures;
+		std::vector<uint32_t> m_texture_ref_counts;
+		std::vector<int> m_free_texture_indices;
+		std::unordered_map<VkImageView, int> m_texture_indices;
+		std::vector<MaterialData> m_materials;
+		std::vector<uint32_t> m_material_ref_counts;
+		std::vector<uint32_t> m_free_material_indices;
+		std::unordered_multimap<uint64_t, uint32_t> m_material_indices;
+
+		// references of the frame being collected and of the last frame
+		std::vector<int> m_frame_texture_indices, m_last_frame_texture_indices;
+		std::vector<uint32_t> m_frame_material_indices, m_last_frame_material_indices;
+
+		// descriptors written to each flight's descriptor set
+		std::vector<std::vector<VkImageView>> m_written_texture_views;
+		std::vector<VkBuffer> m_written_material_buffers;
+	};
+}
\ No newline at end of file
@@ -1,75 +1,96 @@
 #include "debug_draw_manager.h"
 #include "engine/core/base/macro.h"
-#include "engine/platform/timer/timer.h"
+#include "engine/core/vulkan/vulkan_rhi.h"
 
-#define MAX_VERTEX_COUNT 1024
-#define UPDATE_BUFFER_FPS 30
+#include <algorithm>
+
+#define MIN_VERTEX_COUNT 1024
+#define MAX_IDLE_FRAME_COUNT 300
 
 namespace Bamboo
 {
-	
+	static std::atomic<uint64_t> s_generation = 0;
+
 	void DebugDrawManager::init()
 	{
-		m_vertex_count = 0;
-		m_max_vertex_buffer_size = MAX_VERTEX_COUNT * sizeof(DebugDrawVertex);
-		VulkanUtil::createBuffer(m_max_vertex_buffer_size,
-			VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
-			VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE,
-			m_vertex_buffer);
-
-		VulkanUtil::createBuffer(m_max_vertex_buffer_size,
-			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-			VMA_MEMORY_USAGE_AUTO_PREFER_HOST,
-			m_staging_buffer);
-
-		m_tick_timer_handle = g_engine.timerManager()->addTimer(1.0f / UPDATE_BUFFER_FPS, [this]() { update(); }, true);
+		m_generation = ++s_generation;
+		m_vertex_buffers.resize(VulkanRHI::get().getFramesInFlight());
+		m_vertex_buffer_sizes.assign(VulkanRHI::get().getFramesInFlight(), 0);
 	}
 
 	void DebugDrawManager::clear()
 	{
-		// clear vertices
-		m_vertices.clear();
+		// clear all threads' pending vertices
+		std::lock_guard<std::mutex> lock(m_batches_mutex);
+		for (auto& iter : m_batches)
+		{
+			std::lock_guard<std::mutex> batch_lock(iter.second->mutex);
+			iter.second->depth_vertices.clear();
+			iter.second->overlay_vertices.clear();
+		}
 	}
 
 	void DebugDrawManager::destroy()
 	{
-		m_vertex_buffer.destroy();
-		m_staging_buffer.destroy();
-		g_engine.timerManager()->removeTimer(m_tick_timer_handle);
+		// threads' cached batches of this manager are looked up again, and find them released
+		{
+			std::lock_guard<std::mutex> lock(m_batches_mutex);
+			for (auto& iter : m_batches)
+			{
+				std::lock_guard<std::mutex> batch_lock(iter.second->mutex);
+				iter.second->is_released = true;
+			}
+			m_batches.clear();
+			m_generation = ++s_generation;
+		}
+
+		for (VmaBuffer& vertex_buffer : m_vertex_buffers)
+		{
+			vertex_buffer.destroy();
+		}
+		m_vertex_buffers.clear();
+		m_vertex_buffer_sizes.clear();
 	}
 
-	void DebugDrawManager::drawLine(const glm::vec3& start, const glm::vec3& end, const Color3& color /*= Color3::White*/)
+	void DebugDrawManager::drawLine(const glm::vec3& start, const glm::vec3& end, const Color3& color /*= Color3::White*/, bool depth_test /*= true*/)
 	{
-		m_vertices.push_back({ start, color.toVec3() });
-		m_vertices.push_back({ end, color.toVec3() });
+		std::unique_lock<std::mutex> lock;
+		DebugDrawBatch& batch = *lockThreadBatch(lock);
+		addLine(batch, start, end, color.toVec3(), depth_test);
 	}
 
-	void DebugDrawManager::drawLines(const std::vector<DebugDrawLine>& lines)
+	void DebugDrawManager::drawLines(const std::vector<DebugDrawLine>& lines, bool depth_test /*= true*/)
 	{
+		std::unique_lock<std::mutex> lock;
+		DebugDrawBatch& batch = *lockThreadBatch(lock);
 		for (const auto& line : lines)
 		{
-			drawLine(line.start, line.end, line.color);
+			addLine(batch, line.start, line.end, line.color.toVec3(), depth_test);
 		}
 	}
 
-	void DebugDrawManager::drawBox(const glm::vec3& center, const glm::vec3& extent /*= glm::vec3(1.0f)*/, const glm::vec3& rotation /*= glm::vec3(0.0f)*/, const Color3& color /*= Color3::White*/)
+	void DebugDrawManager::drawBox(const glm::vec3& center, const glm::vec3& extent /*= glm::vec3(1.0f)*/, const glm::vec3& rotation /*= glm::vec3(0.0f)*/, const Color3& color /*= Color3::White*/, bool depth_test /*= true*/)
 	{
+		std::unique_lock<std::mutex> lock;
+		DebugDrawBatch& batch = *lockThreadBatch(lock);
+		const glm::vec3 line_color = color.toVec3();
+
 		if (rotation == k_zero_vector)
 		{
-			drawLine(center + glm::vec3(extent.x, extent.y, extent.z), center + glm::vec3(extent.x, -extent.y, extent.z), color);
-			drawLine(center + glm::vec3(extent.x, -extent.y, extent.z), center + glm::vec3(-extent.x, -extent.y, extent.z), color);
-			drawLine(center + glm::vec3(-extent.x, -extent.y, extent.z), center + glm::vec3(-extent.x, extent.y, extent.z), color);
-			drawLine(center + glm::vec3(-extent.x, extent.y, extent.z), center + glm::vec3(extent.x, extent.y, extent.z), color);
-
-			drawLine(center + glm::vec3(extent.x, extent.y, -extent.z), center + glm::vec3(extent.x, -extent.y, -extent.z), color);
-			drawLine(center + glm::vec3(extent.x, -extent.y, -extent.z), center + glm::vec3(-extent.x, -extent.y, -extent.z), color);
-			drawLine(center + glm::vec3(-extent.x, -extent.y, -extent.z), center + glm::vec3(-extent.x, extent.y, -extent.z), color);
-			drawLine(center + glm::vec3(-extent.x, extent.y, -extent.z), center + glm::vec3(extent.x, extent.y, -extent.z), color);
-
-			drawLine(center + glm::vec3(extent.x, extent.y, extent.z), center + glm::vec3(extent.x, extent.y, -extent.z), color);
-			drawLine(center + glm::vec3(extent.x, -extent.y, extent.z), center + glm::vec3(extent.x, -extent.y, -extent.z), color);
-			drawLine(center + glm::vec3(-extent.x, -extent.y, extent.z), center + glm::vec3(-extent.x, -extent.y, -extent.z), color);
-			drawLine(center + glm::vec3(-extent.x, extent.y, extent.z), center + glm::vec3(-extent.x, extent.y, -extent.z), color);
+			addLine(batch, center + glm::vec3(extent.x, extent.y, extent.z), center + glm::vec3(extent.x, -extent.y, extent.z), line_color, depth_test);
+			addLine(batch, center + glm::vec3(extent.x, -extent.y, extent.z), center + glm::vec3(-extent.x, -extent.y, extent.z), line_color, depth_test);
+			addLine(batch, center + glm::vec3(-extent.x, -extent.y, extent.z), center + glm::vec3(-extent.x, extent.y, extent.z), line_color, depth_test);
+			addLine(batch, center + glm::vec3(-extent.x, extent.y, extent.z), center + glm::vec3(extent.x, extent.y, extent.z), line_color, depth_test);
+
+			addLine(batch, center + glm::vec3(extent.x, extent.y, -extent.z), center + glm::vec3(extent.x, -extent.y, -extent.z), line_color, depth_test);
+			addLine(batch, center + glm::vec3(extent.x, -extent.y, -extent.z), center + glm::vec3(-extent.x, -extent.y, -extent.z), line_color, depth_test);
+			addLine(batch, center + glm::vec3(-extent.x, -extent.y, -extent.z), center + glm::vec3(-extent.x, extent.y, -extent.z), line_color, depth_test);
+			addLine(batch, center + glm::vec3(-extent.x, extent.y, -extent.z), center + glm::vec3(extent.x, extent.y, -extent.z), line_color, depth_test);
+
+			addLine(batch, center + glm::vec3(extent.x, extent.y, extent.z), center + glm::vec3(extent.x, extent.y, -extent.z), line_color, depth_test);
+			addLine(batch, center + glm::vec3(extent.x, -extent.y, extent.z), center + glm::vec3(extent.x, -extent.y, -extent.z), line_color, depth_test);
+			addLine(batch, center + glm::vec3(-extent.x, -extent.y, extent.z), center + glm::vec3(-extent.x, -extent.y, -extent.z), line_color, depth_test);
+			addLine(batch, center + glm::vec3(-extent.x, extent.y, extent.z), center + glm::vec3(-extent.x, extent.y, -extent.z), line_color, depth_test);
 		}
 		else
 		{
@@ -77,85 +98,187 @@ namespace Bamboo
 			transform.m_rotation = rotation;
 			glm::vec3 start = transform.transformPosition(glm::vec3(extent.x, extent.y, extent.z));
 			glm::vec3 end = transform.transformPosition(glm::vec3(extent.x, -extent.y, extent.z));
-			drawLine(center + start, center + end, color);
+			addLine(batch, center + start, center + end, line_color, depth_test);
 
 			start = transform.transformPosition(glm::vec3(extent.x, -extent.y, extent.z));
 			end = transform.transformPosition(glm::vec3(-extent.x, -extent.y, extent.z));
-			drawLine(center + start, center + end, color);
+			addLine(batch, center + start, center + end, line_color, depth_test);
 
 			start = transform.transformPosition(glm::vec3(-extent.x, -extent.y, extent.z));
 			end = transform.transformPosition(glm::vec3(-extent.x, extent.y, extent.z));
-			drawLine(center + start, center + end, color);
+			addLine(batch, center + start, center + end, line_color, depth_test);
 
 			start = transform.transformPosition(glm::vec3(-extent.x, extent.y, extent.z));
 			end = transform.transformPosition(glm::vec3(extent.x, extent.y, extent.z));
-			drawLine(center + start, center + end, color);
+			addLine(batch, center + start, center + end, line_color, depth_test);
 
 			start = transform.transformPosition(glm::vec3(extent.x, extent.y, -extent.z));
 			end = transform.transformPosition(glm::vec3(extent.x, -extent.y, -extent.z));
-			drawLine(center + start, center + end, color);
+			addLine(batch, center + start, center + end, line_color, depth_test);
 
 			start = transform.transformPosition(glm::vec3(extent.x, -extent.y, -extent.z));
 			end = transform.transformPosition(glm::vec3(-extent.x, -extent.y, -extent.z));
-			drawLine(center + start, center + end, color);
+			addLine(batch, center + start, center + end, line_color, depth_test);
 
 			start = transform.transformPosition(glm::vec3(-extent.x, -extent.y, -extent.z));
 			end = transform.transformPosition(glm::vec3(-extent.x, extent.y, -extent.z));
-			drawLine(center + start, center + end, color);
+			addLine(batch, center + start, center + end, line_color, depth_test);
 
 			start = transform.transformPosition(glm::vec3(-extent.x, extent.y, -extent.z));
 			end = transform.transformPosition(glm::vec3(extent.x, extent.y, -extent.z));
-			drawLine(center + start, center + end, color);
+			addLine(batch, center + start, center + end, line_color, depth_test);
 
 			start = transform.transformPosition(glm::vec3(extent.x, extent.y, extent.z));
 			end = transform.transformPosition(glm::vec3(extent.x, extent.y, -extent.z));
-			drawLine(center + start, center + end, color);
+			addLine(batch, center + start, center + end, line_color, depth_test);
 
 			start = transform.transformPosition(glm::vec3(extent.x, -extent.y, extent.z));
 			end = transform.transformPosition(glm::vec3(extent.x, -extent.y, -extent.z));
-			drawLine(center + start, center + end, color);
+			addLine(batch, center + start, center + end, line_color, depth_test);
 
 			start = transform.transformPosition(glm::vec3(-extent.x, -extent.y, extent.z));
 			end = transform.transformPosition(glm::vec3(-extent.x, -extent.y, -extent.z));
-			drawLine(center + start, center + end, color);
+			addLine(batch, center + start, center + end, line_color, depth_test);
 
 			start = transform.transformPosition(glm::vec3(-extent.x, extent.y, extent.z));
 			end = transform.transformPosition(glm::vec3(-extent.x, extent.y, -extent.z));
-			drawLine(center + start, center + end, color);
+			addLine(batch, center + start, center + end, line_color, depth_test);
 		}
 	}
 
-	void DebugDrawManager::drawSphere(const glm::vec3& center, float radius /*= 1.0f*/, uint32_t segment /*= 12*/, const Color3& color /*= Color3::White*/)
+	void DebugDrawManager::drawSphere(const glm::vec3& center, float radius /*= 1.0f*/, uint32_t segment /*= 12*/, const Color3& color /*= Color3::White*/, bool depth_test /*= true*/)
 	{
 
 	}
 
-	void DebugDrawManager::drawCylinder(const glm::vec3& start, const glm::vec3& end, float radius /*= 1.0f*/, uint32_t segment /*= 12*/, const Color3& color /*= Color3::White*/)
+	void DebugDrawManager::drawCylinder(const glm::vec3& start, const glm::vec3& end, float radius /*= 1.0f*/, uint32_t segment /*= 12*/, const Color3& color /*= Color3::White*/, bool depth_test /*= true*/)
 	{
 
 	}
 
-	void DebugDrawManager::drawCapsule(const glm::vec3& center, float half_height /*= 2.0f*/, float radius /*= 1.0f*/, const Color3& color /*= Color3::White*/)
+	void DebugDrawManager::drawCapsule(const glm::vec3& center, float half_height /*= 2.0f*/, float radius /*= 1.0f*/, const Color3& color /*= Color3::White*/, bool depth_test /*= true*/)
 	{
 
 	}
 
-	void DebugDrawManager::drawFrustum(const glm::mat4& view, const glm::mat4& proj, const Color3& color /*= Color3::White*/)
+	void DebugDrawManager::drawFrustum(const glm::mat4& view, const glm::mat4& proj, const Color3& color /*= Color3::White*/, bool depth_test /*= true*/)
 	{
 
 	}
 
-	void DebugDrawManager::update()
+	void DebugDrawManager::takeLines(DebugDrawLines& lines)
+	{
+		// move the lines of all thread batches into the frame
+		std::lock_guard<std::mutex> lock(m_batches_mutex);
+		bool has_released_batch = false;
+		for (auto iter = m_batches.begin(); iter != m_batches.end();)
+		{
+			DebugDrawBatch* batch = iter->second.get();
+			std::lock_guard<std::mutex> batch_lock(batch->mutex);
+			lines.depth_vertices.insert(lines.depth_vertices.end(), batch->depth_vertices.begin(), batch->depth_vertices.end());
+			lines.overlay_vertices.insert(lines.overlay_vertices.end(), batch->overlay_vertices.begin(), batch->overlay_vertices.end());
+
+			// debug lines only live for one frame, the batches keep their capacity unless their thread stopped drawing
+			bool is_idle = batch->depth_vertices.empty() && batch->overlay_vertices.empty();
+			batch->idle_frame_count = is_idle ? batch->idle_frame_count + 1 : 0;
+			batch->depth_vertices.clear();
+			batch->overlay_vertices.clear();
+			batch->is_released = batch->idle_frame_count > MAX_IDLE_FRAME_COUNT;
+
+			if (batch->is_released)
+			{
+				has_released_batch = true;
+				iter = m_batches.erase(iter);
+			}
+			else
+			{
+				++iter;
+			}
+		}
+		if (has_released_batch)
+		{
+			m_generation = ++s_generation;
+		}
+	}
+
+	void DebugDrawManager::endFrame(const DebugDrawLines& lines)
 	{
-		// update vertex buffer
-		m_vertex_count = static_cast<uint32_t>(m_vertices.size());
-		if (m_vertex_count > 0)
+		// the flight's fence has been waited, so its vertex buffer is no longer read by the device
+		m_flight_index = VulkanRHI::get().getFlightIndex();
+		m_depth_vertex_count = static_cast<uint32_t>(lines.depth_vertices.size());
+		m_overlay_vertex_count = static_cast<uint32_t>(lines.overlay_vertices.size());
+
+		// grow the flight's vertex buffer to the next power of two if it's too small
+		VkDeviceSize vertex_buffer_size = getVertexCount() * sizeof(DebugDrawVertex);
+		VmaBuffer& vertex_buffer = m_vertex_buffers[m_flight_index];
+		VkDeviceSize& capacity = m_vertex_buffer_sizes[m_flight_index];
+		if (vertex_buffer_size > capacity)
 		{
-			VkDeviceSize vertex_buffer_size = m_vertex_count * sizeof(DebugDrawVertex);
-			ASSERT(vertex_buffer_size < m_max_vertex_buffer_size, "debug draw vertex overflow");
-			VulkanUtil::updateBuffer(m_staging_buffer, m_vertices.data(), vertex_buffer_size);
-			VulkanUtil::copyBuffer(m_staging_buffer.buffer, m_vertex_buffer.buffer, vertex_buffer_size);
+			VkDeviceSize new_capacity = std::max(capacity, static_cast<VkDeviceSize>(MIN_VERTEX_COUNT * sizeof(DebugDrawVertex)));
+			while (new_capacity < vertex_buffer_size)
+			{
+				new_capacity *= 2;
+			}
+
+			vertex_buffer.destroy();
+			VulkanUtil::createBuffer(new_capacity, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VMA_MEMORY_USAGE_AUTO_PREFER_HOST, vertex_buffer);
+			capacity = new_capacity;
 		}
+
+		// write depth tested vertices first and overlay vertices after them straight into the mapped memory
+		if (vertex_buffer_size > 0)
+		{
+			VmaAllocationInfo allocation_info;
+			vmaGetAllocationInfo(VulkanRHI::get().getAllocator(), vertex_buffer.allocation, &allocation_info);
+			DebugDrawVertex* vertices = static_cast<DebugDrawVertex*>(allocation_info.pMappedData);
+			std::copy(lines.depth_vertices.begin(), lines.depth_vertices.end(), vertices);
+			std::copy(lines.overlay_vertices.begin(), lines.overlay_vertices.end(), vertices + m_depth_vertex_count);
+			vmaFlushAllocation(VulkanRHI::get().getAllocator(), vertex_buffer.allocation, 0, vertex_buffer_size);
+		}
+	}
+
+	std::shared_ptr<DebugDrawBatch> DebugDrawManager::lockThreadBatch(std::unique_lock<std::mutex>& lock)
+	{
+		// a batch released between looking it up and locking it is looked up again
+		bool refresh = false;
+		while (true)
+		{
+			std::shared_ptr<DebugDrawBatch> batch = getThreadBatch(refresh);
+			lock = std::unique_lock<std::mutex>(batch->mutex);
+			if (!batch->is_released)
+			{
+				return batch;
+			}
+			lock.unlock();
+			refresh = true;
+		}
+	}
+
+	std::shared_ptr<DebugDrawBatch> DebugDrawManager::getThreadBatch(bool refresh)
+	{
+		// the batch is cached by the manager's generation, so a destroyed or recreated manager's batch isn't reused
+		thread_local uint64_t t_generation = 0;
+		thread_local std::shared_ptr<DebugDrawBatch> t_batch;
+		if (refresh || !t_batch || t_generation != m_generation)
+		{
+			// register a new batch the first time a thread draws
+			std::lock_guard<std::mutex> lock(m_batches_mutex);
+			std::shared_ptr<DebugDrawBatch>& batch = m_batches[std::this_thread::get_id()];
+			if (!batch)
+			{
+				batch = std::make_shared<DebugDrawBatch>();
+			}
+			t_batch = batch;
+			t_generation = m_generation;
+		}
+		return t_batch;
+	}
+
+	void DebugDrawManager::addLine(DebugDrawBatch& batch, const glm::vec3& start, const glm::vec3& end, const glm::vec3& color, bool depth_test)
+	{
+		std::vector<DebugDrawVertex>& vertices = depth_test ? batch.depth_vertices : batch.overlay_vertices;
+		vertices.push_back({ start, color });
+		vertices.push_back({ end, color });
 	}
 
 }
\ No newline at end of file
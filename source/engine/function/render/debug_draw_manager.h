@@ -1,6 +1,11 @@
 #pragma once
 
 #include <vector>
+#include <mutex>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <unordered_map>
 #include "engine/core/color/color.h"
 #include "engine/core/math/transform.h"
 #include "engine/core/vulkan/vulkan_util.h"
@@ -20,6 +25,25 @@ namespace Bamboo
 		Color3 color;
 	};
 
+	// lines of one frame, taken out of the thread batches on the game thread and uploaded by the render thread
+	struct DebugDrawLines
+	{
+		std::vector<DebugDrawVertex> depth_vertices;
+		std::vector<DebugDrawVertex> overlay_vertices;
+	};
+
+	// lines drawn by one thread since the last frame, depth tested and overlay lines are kept apart
+	struct DebugDrawBatch
+	{
+		std::mutex mutex;
+		std::vector<DebugDrawVertex> depth_vertices;
+		std::vector<DebugDrawVertex> overlay_vertices;
+
+		// batches of threads which stopped drawing are released, a thread still holding one draws into a new batch
+		uint32_t idle_frame_count = 0;
+		bool is_released = false;
+	};
+
 	class DebugDrawManager
 	{
 	public:
@@ -27,27 +51,48 @@ namespace Bamboo
 		void clear();
 		void destroy();
 
-		void drawLine(const glm::vec3& start, const glm::vec3& end, const Color3& color = Color3::White);
-		void drawLines(const std::vector<DebugDrawLine>& lines);
-		void drawBox(const glm::vec3& center, const glm::vec3& extent = k_one_vector, const glm::vec3& rotation = k_zero_vector, const Color3& color = Color3::White);
-		void drawSphere(const glm::vec3& center, float radius = 1.0f, uint32_t segment = 12, const Color3& color = Color3::White);
-		void drawCylinder(const glm::vec3& start, const glm::vec3& end, float radius = 1.0f, uint32_t segment = 12, const Color3& color = Color3::White);
-		void drawCapsule(const glm::vec3& center, float half_height = 2.0f, float radius = 1.0f, const Color3& color = Color3::White);
-		void drawFrustum(const glm::mat4& view, const glm::mat4& proj, const Color3& color = Color3::White);
+		// lines can be drawn from any thread, each thread appends to its own batch and all batches are merged by takeLines,
+		// depth tested lines are hidden behind scene geometry, the others are drawn on top of it
+		void drawLine(const glm::vec3& start, const glm::vec3& end, const Color3& color = Color3::White, bool depth_test = true);
+		void drawLines(const std::vector<DebugDrawLine>& lines, bool depth_test = true);
+		void drawBox(const glm::vec3& center, const glm::vec3& extent = k_one_vector, const glm::vec3& rotation = k_zero_vector, const Color3& color = Color3::White, bool depth_test = true);
+		void drawSphere(const glm::vec3& center, float radius = 1.0f, uint32_t segment = 12, const Color3& color = Color3::White, bool depth_test = true);
+		void drawCylinder(const glm::vec3& start, const glm::vec3& end, float radius = 1.0f, uint32_t segment = 12, const Color3& color = Color3::White, bool depth_test = true);
+		void drawCapsule(const glm::vec3& center, float half_height = 2.0f, float radius = 1.0f, const Color3& color = Color3::White, bool depth_test = true);
+		void drawFrustum(const glm::mat4& view, const glm::mat4& proj, const Color3& color = Color3::White, bool depth_test = true);
+
+		// merge all thread batches into the frame's lines and start collecting the next frame's lines
+		void takeLines(DebugDrawLines& lines);
+
+		// upload a frame's lines into the current flight's vertex buffer, must be called after the flight's fence has been waited
+		void endFrame(const DebugDrawLines& lines);
 
-		bool empty() { return m_vertex_count == 0; }
-		VkBuffer getVertexBuffer() { return m_vertex_buffer.buffer; }
-		uint32_t getVertexCount() { return m_vertex_count; }
+		bool empty() { return getVertexCount() == 0; }
+		VkBuffer getVertexBuffer() { return m_vertex_buffers[m_flight_index].buffer; }
+		uint32_t getVertexCount() { return m_depth_vertex_count + m_overlay_vertex_count; }
+
+		// depth tested vertices come first in the vertex buffer, followed by the overlay vertices
+		uint32_t getDepthVertexCount() { return m_depth_vertex_count; }
+		uint32_t getOverlayVertexCount() { return m_overlay_vertex_count; }
 
 	private:
-		void update();
+		// returns the calling thread's batch locked by the given lock
+		std::shared_ptr<DebugDrawBatch> lockThreadBatch(std::unique_lock<std::mutex>& lock);
+		std::shared_ptr<DebugDrawBatch> getThreadBatch(bool refresh);
+		void addLine(DebugDrawBatch& batch, const glm::vec3& start, const glm::vec3& end, const glm::vec3& color, bool depth_test);
+
+		std::mutex m_batches_mutex;
+		std::unordered_map<std::thread::id, std::shared_ptr<DebugDrawBatch>> m_batches;
+
+		// threads cache their batch per generation, which is unique across managers and changes when batches are released
+		std::atomic<uint64_t> m_generation = 0;
 
-		VmaBuffer m_vertex_buffer;
-		VmaBuffer m_staging_buffer;
-		VkDeviceSize m_max_vertex_buffer_size;
+		// persistently mapped host visible vertex buffers, one per frame in flight, which grow on demand
+		std::vector<VmaBuffer> m_vertex_buffers;
+		std::vector<VkDeviceSize> m_vertex_buffer_sizes;
+		uint32_t m_flight_index = 0;
 
-		std::vector<DebugDrawVertex> m_vertices;
-		uint32_t m_vertex_count;
-		uint32_t m_tick_timer_handle;
+		uint32_t m_depth_vertex_count = 0;
+		uint32_t m_overlay_vertex_count = 0;
 	};
 }
\ No newline at end of file
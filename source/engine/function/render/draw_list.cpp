@@ -0,0 +1,329 @@
+#include "draw_list.h"
+#include "gpu_scene.h"
+#include "engine/core/vulkan/vulkan_rhi.h"
+#include <map>
+#include <algorithm>
+#include <cstring>
+
+#define SORT_KEY_PASS_BITS 4
+#define SORT_KEY_PIPELINE_BITS 4
+#define SORT_KEY_MATERIAL_BITS 16
+#define SORT_KEY_MESH_BITS 16
+#define SORT_KEY_DEPTH_BITS 24
+
+namespace Bamboo
+{
+	DrawStats& DrawStats::operator+=(const DrawStats& other)
+	{
+		draw_count += other.draw_count;
+		instance_count += other.instance_count;
+		bind_count += other.bind_count;
+		saved_bind_count += other.saved_bind_count;
+		return *this;
+	}
+
+	uint64_t DrawList::makeSortKey(EDrawPass pass, uint32_t pipeline_id, uint32_t material_id, uint32_t mesh_id, float depth,
+		bool back_to_front)
+	{
+		// positive floats keep their order when reinterpreted as unsigned integers
+		uint32_t depth_bits = 0;
+		depth = std::max(depth, 0.0f);
+		memcpy(&depth_bits, &depth, sizeof(float));
+		depth_bits >>= (32 - SORT_KEY_DEPTH_BITS);
+		if (back_to_front)
+		{
+			depth_bits ^= (1u << SORT_KEY_DEPTH_BITS) - 1;
+		}
+
+		uint64_t sort_key = static_cast<uint64_t>(pass) & ((1ull << SORT_KEY_PASS_BITS) - 1);
+		if (back_to_front)
+		{
+			sort_key = (sort_key << SORT_KEY_DEPTH_BITS) | (depth_bits & ((1ull << SORT_KEY_DEPTH_BITS) - 1));
+		}
+		sort_key = (sort_key << SORT_KEY_PIPELINE_BITS) | (pipeline_id & ((1ull << SORT_KEY_PIPELINE_BITS) - 1));
+		sort_key = (sort_key << SORT_KEY_MATERIAL_BITS) | (material_id & ((1ull << SORT_KEY_MATERIAL_BITS) - 1));
+		sort_key = (sort_key << SORT_KEY_MESH_BITS) | (mesh_id & ((1ull << SORT_KEY_MESH_BITS) - 1));
+		if (!back_to_front)
+		{
+			sort_key = (sort_key << SORT_KEY_DEPTH_BITS) | (depth_bits & ((1ull << SORT_KEY_DEPTH_BITS) - 1));
+		}
+		return sort_key;
+	}
+
+	void DrawList::build(const std::vector<std::shared_ptr<RenderData>>& render_datas, EDrawPass pass, bool back_to_front,
+		const std::vector<glm::vec4>& instance_colors)
+	{
+		m_items.clear();
+
+		// assign dense mesh ids in this frame, so they fit in the sort key without collisions,
+		// the sub meshes of a mesh get consecutive mesh ids and stay adjacent after sorting, different lods get different ids,
+		// material indices are already dense since the bindless manager collects them every frame
+		std::map<std::pair<VkBuffer, uint32_t>, uint32_t> mesh_ids;
+		bool is_shadow_pass = pass == EDrawPass::DirectionalLightShadow || pass == EDrawPass::PointLightShadow || pass == EDrawPass::SpotLightShadow;
+
+		for (size_t r = 0; r < render_datas.size(); ++r)
+		{
+			StaticMeshRenderData* static_mesh_render_data = static_cast<StaticMeshRenderData*>(render_datas[r].get());
+			uint32_t pipeline_id = static_mesh_render_data->type == ERenderDataType::SkeletalMesh ? 1 : 0;
+
+			// clip space depth of the mesh origin
+			float depth = static_mesh_render_data->transform_pco.mvp[3].z;
+
+			const std::vector<uint32_t>& index_counts = is_shadow_pass ? static_mesh_render_data->shadow_index_counts : static_mesh_render_data->index_counts;
+			const std::vector<uint32_t>& index_offsets = is_shadow_pass ? static_mesh_render_data->shadow_index_offsets : static_mesh_render_data->index_offsets;
+			for (size_t i = 0; i < index_counts.size(); ++i)
+			{
+				auto mesh_key = std::make_pair(static_mesh_render_data->vertex_buffer.buffer, index_offsets[i]);
+				uint32_t mesh_id = mesh_ids.emplace(mesh_key, static_cast<uint32_t>(mesh_ids.size())).first->second;
+
+				uint32_t material_id = static_mesh_render_data->material_indices[i];
+
+				DrawItem draw_item;
+				draw_item.sort_key = makeSortKey(pass, pipeline_id, material_id, mesh_id, depth, back_to_front);
+				draw_item.render_data = static_mesh_render_data;
+				draw_item.render_data_index = static_cast<uint32_t>(r);
+				draw_item.sub_mesh_index = static_cast<uint32_t>(i);
+				draw_item.first_index = index_offsets[i];
+				draw_item.index_count = index_counts[i];
+				m_items.push_back(draw_item);
+			}
+		}
+
+		sort();
+		batchInstances(instance_colors, back_to_front);
+		updateInstanceBuffer();
+	}
+
+	void DrawList::destroy()
+	{
+		for (VmaBuffer& instance_sb : m_instance_sbs)
+		{
+			instance_sb.destroy();
+		}
+		m_instance_sbs.clear();
+	}
+
+	TransformPCO DrawList::makeInstanceTransformPCO(const glm::mat4& view_proj)
+	{
+		TransformPCO transform_pco;
+		transform_pco.m = glm::mat4(1.0f);
+		transform_pco.nm = glm::mat4(1.0f);
+		transform_pco.mvp = view_proj;
+		return transform_pco;
+	}
+
+	void DrawList::cullRenderDatas(const std::vector<std::shared_ptr<RenderData>>& render_datas, const glm::mat4& view_proj,
+		std::vector<std::shared_ptr<RenderData>>& visible_render_datas)
+	{
+		visible_render_datas.clear();
+		for (const auto& render_data : render_datas)
+		{
+			// a box is outside if all of its clip space corners are outside of the same frustum plane
+			const BoundingBox& bounding_box = static_cast<MeshRenderData*>(render_data.get())->bounding_box;
+			uint32_t outside_mask = 0x3f;
+			for (uint32_t i = 0; i < 8 && outside_mask != 0; ++i)
+			{
+				glm::vec3 corner = glm::vec3(i & 1 ? bounding_box.m_max.x : bounding_box.m_min.x,
+					i & 2 ? bounding_box.m_max.y : bounding_box.m_min.y, i & 4 ? bounding_box.m_max.z : bounding_box.m_min.z);
+				glm::vec4 clip = view_proj * glm::vec4(corner, 1.0f);
+				uint32_t corner_outside_mask = (clip.x < -clip.w) | (clip.x > clip.w) << 1 | (clip.y < -clip.w) << 2 |
+					(clip.y > clip.w) << 3 | (clip.z < 0.0f) << 4 | (clip.z > clip.w) << 5;
+				outside_mask &= corner_outside_mask;
+			}
+
+			if (outside_mask == 0)
+			{
+				visible_render_datas.push_back(render_data);
+			}
+		}
+	}
+
+	void DrawList::sort()
+	{
+		// lsd radix sort with 8-bit digits, skipping digits that are equal for all items
+		const uint32_t k_radix_bits = 8;
+		const uint32_t k_radix_size = 1 << k_radix_bits;
+		if (m_items.empty())
+		{
+			return;
+		}
+
+		m_sort_items.resize(m_items.size());
+		for (uint32_t shift = 0; shift < 64; shift += k_radix_bits)
+		{
+			std::array<uint32_t, k_radix_size> counts{};
+			for (const DrawItem& draw_item : m_items)
+			{
+				counts[(draw_item.sort_key >> shift) & (k_radix_size - 1)]++;
+			}
+			if (counts[(m_items.front().sort_key >> shift) & (k_radix_size - 1)] == m_items.size())
+			{
+				continue;
+			}
+
+			uint32_t offset = 0;
+			for (uint32_t& count : counts)
+			{
+				uint32_t next_offset = offset + count;
+				count = offset;
+				offset = next_offset;
+			}
+
+			for (const DrawItem& draw_item : m_items)
+			{
+				m_sort_items[counts[(draw_item.sort_key >> shift) & (k_radix_size - 1)]++] = draw_item;
+			}
+			m_items.swap(m_sort_items);
+		}
+	}
+
+	static bool isInstanceCompatible(const DrawItem& a, const DrawItem& b)
+	{
+		if (a.render_data->type != ERenderDataType::StaticMesh || b.render_data->type != ERenderDataType::StaticMesh ||
+			a.render_data->vertex_buffer.buffer != b.render_data->vertex_buffer.buffer || a.sub_mesh_index != b.sub_mesh_index ||
+			a.first_index != b.first_index)
+		{
+			return false;
+		}
+
+		// equal material indices imply equal material factors and textures
+		return a.render_data->material_indices[a.sub_mesh_index] == b.render_data->material_indices[b.sub_mesh_index];
+	}
+
+	void DrawList::batchInstances(const std::vector<glm::vec4>& instance_colors, bool back_to_front)
+	{
+		// sorted items sharing mesh, sub mesh and material are adjacent, merge them into one instanced draw.
+		// back to front items stay single instance draws, an instanced draw would blend its instances out of depth order
+		m_instances.clear();
+		size_t batch_count = 0;
+		for (size_t i = 0; i < m_items.size(); ++i)
+		{
+			DrawItem draw_item = m_items[i];
+			if (draw_item.render_data->type != ERenderDataType::StaticMesh)
+			{
+				m_items[batch_count++] = draw_item;
+				continue;
+			}
+
+			ObjectData instance{};
+			instance.m = draw_item.render_data->transform_pco.m;
+			instance.nm = draw_item.render_data->transform_pco.nm;
+			instance.color = instance_colors.empty() ? glm::vec4(0.0f) : instance_colors[draw_item.render_data_index];
+			m_instances.push_back(instance);
+
+			bool is_batched = !back_to_front && batch_count > 0 && isInstanceCompatible(m_items[batch_count - 1], draw_item);
+			if (!is_batched)
+			{
+				draw_item.first_instance = static_cast<uint32_t>(m_instances.size() - 1);
+				draw_item.instance_count = 0;
+				m_items[batch_count++] = draw_item;
+			}
+			m_items[batch_count - 1].instance_count++;
+		}
+		m_items.resize(batch_count);
+	}
+
+	void DrawList::updateInstanceBuffer()
+	{
+		m_flight_index = VulkanRHI::get().getFlightIndex();
+		if (m_instance_sbs.empty())
+		{
+			m_instance_sbs.resize(VulkanRHI::get().getFramesInFlight());
+		}
+
+		const VkDeviceSize k_min_instance_count = 64;
+		VmaBuffer& instance_sb = m_instance_sbs[m_flight_index];
+		VulkanUtil::reserveBuffer(instance_sb, m_instances.size() * sizeof(ObjectData), k_min_instance_count * sizeof(ObjectData),
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_AUTO_PREFER_HOST);
+		if (!m_instances.empty())
+		{
+			VulkanUtil::updateBuffer(instance_sb, m_instances.data(), m_instances.size() * sizeof(ObjectData));
+		}
+	}
+
+	DrawStateCache::DrawStateCache(VkCommandBuffer command_buffer, DrawStats& draw_stats) :
+		m_command_buffer(command_buffer), m_draw_stats(draw_stats)
+	{
+
+	}
+
+	void DrawStateCache::bindPipeline(VkPipeline pipeline)
+	{
+		if (pipeline == m_pipeline)
+		{
+			m_draw_stats.saved_bind_count++;
+			return;
+		}
+
+		vkCmdBindPipeline(m_command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+		m_pipeline = pipeline;
+		m_draw_stats.bind_count++;
+	}
+
+	void DrawStateCache::bindVertexBuffer(VkBuffer vertex_buffer)
+	{
+		if (vertex_buffer == m_vertex_buffer)
+		{
+			m_draw_stats.saved_bind_count++;
+			return;
+		}
+
+		VkDeviceSize offset = 0;
+		vkCmdBindVertexBuffers(m_command_buffer, 0, 1, &vertex_buffer, &offset);
+		m_vertex_buffer = vertex_buffer;
+		m_draw_stats.bind_count++;
+	}
+
+	void DrawStateCache::bindIndexBuffer(VkBuffer index_buffer, VkIndexType index_type)
+	{
+		if (index_buffer == m_index_buffer)
+		{
+			m_draw_stats.saved_bind_count++;
+			return;
+		}
+
+		vkCmdBindIndexBuffer(m_command_buffer, index_buffer, 0, index_type);
+		m_index_buffer = index_buffer;
+		m_draw_stats.bind_count++;
+	}
+
+	bool DrawStateCache::needPushDescriptors(VkPipelineLayout pipeline_layout, const PBRTexture& pbr_texture, const VmaBufferRange& mesh_buffer)
+	{
+		std::array<VkImageView, 4> pbr_texture_views = {
+			pbr_texture.base_color_texure.view, pbr_texture.metallic_roughness_occlusion_texure.view,
+			pbr_texture.normal_texure.view, pbr_texture.emissive_texure.view
+		};
+
+		if (pipeline_layout == m_pipeline_layout && pbr_texture_views == m_pbr_texture_views && 
+			mesh_buffer.buffer == m_mesh_buffer.buffer && mesh_buffer.offset == m_mesh_buffer.offset)
+		{
+			m_draw_stats.saved_bind_count++;
+			return false;
+		}
+
+		m_pipeline_layout = pipeline_layout;
+		m_pbr_texture_views = pbr_texture_views;
+		m_mesh_buffer = mesh_buffer;
+		m_draw_stats.bind_count++;
+		return true;
+	}
+
+	void DrawStateCache::drawIndexed(const DrawItem& draw_item)
+	{
+		vkCmdDrawIndexed(m_command_buffer, draw_item.index_count, draw_item.instance_count, draw_item.first_index, 0, draw_item.first_instance);
+
+		m_draw_stats.draw_count++;
+		m_draw_stats.instance_count += draw_item.instance_count;
+	}
+
+	void DrawStateCache::drawIndexedIndirectCount(const GPUSceneView& gpu_scene_view, const GPUSceneBatch& batch, uint32_t batch_index)
+	{
+		vkCmdDrawIndexedIndirectCount(m_command_buffer, gpu_scene_view.getDrawCommandBuffer().buffer, batch.command_offset * sizeof(DrawCommand),
+			gpu_scene_view.getDrawCountBuffer().buffer, batch_index * sizeof(uint32_t), batch.command_capacity, sizeof(DrawCommand));
+
+		// the visible instance count is only known on the gpu, so the batch's objects are counted before culling
+		m_draw_stats.draw_count++;
+		m_draw_stats.instance_count += batch.object_count;
+	}
+
+}
\ No newline at end of file
@@ -0,0 +1,111 @@
+#pragma once
+
+#include "engine/function/render/render_data.h"
+#include <array>
+
+namespace Bamboo
+{
+	// 64-bit draw sort key layout, from the most significant bit:
+	// | pass: 4 | pipeline: 4 | material: 16 | mesh: 16 | depth: 24 |
+	enum class EDrawPass
+	{
+		DirectionalLightShadow, PointLightShadow, SpotLightShadow, Pick, MainDeferred, MainForward
+	};
+
+	struct DrawItem
+	{
+		uint64_t sort_key;
+		StaticMeshRenderData* render_data;
+		uint32_t render_data_index;
+		uint32_t sub_mesh_index;
+
+		// index range of the sub mesh's lod selected for the pass
+		uint32_t first_index;
+		uint32_t index_count;
+
+		// static meshes are drawn as instances, whose ObjectData lives in the draw list's instance buffer
+		uint32_t first_instance = 0;
+		uint32_t instance_count = 1;
+	};
+
+	struct DrawStats
+	{
+		uint32_t draw_count = 0;
+		uint32_t instance_count = 0;
+		uint32_t bind_count = 0;
+		uint32_t saved_bind_count = 0;
+
+		void reset() { draw_count = instance_count = bind_count = saved_bind_count = 0; }
+		DrawStats& operator+=(const DrawStats& other);
+	};
+
+	class DrawList
+	{
+	public:
+		// opaque keys group by pipeline, material and mesh before depth, back to front keys order by inverted depth first
+		static uint64_t makeSortKey(EDrawPass pass, uint32_t pipeline_id, uint32_t material_id, uint32_t mesh_id, float depth,
+			bool back_to_front = false);
+
+		// collect one draw item per sub mesh, radix sort them by sort key and merge identical static meshes into instanced draws,
+		// instance_colors are indexed by render data and written to ObjectData::color if not empty
+		void build(const std::vector<std::shared_ptr<RenderData>>& render_datas, EDrawPass pass, bool back_to_front = false,
+			const std::vector<glm::vec4>& instance_colors = {});
+		void clear() { m_items.clear(); }
+		void destroy();
+
+		bool empty() const { return m_items.empty(); }
+		const std::vector<DrawItem>& getItems() const { return m_items; }
+		const VmaBuffer& getInstanceBuffer() const { return m_instance_sbs[m_flight_index]; }
+
+		// push constant of instanced draws, the model matrices come from the instance buffer
+		static TransformPCO makeInstanceTransformPCO(const glm::mat4& view_proj);
+
+		// collect the render datas whose bounding boxes intersect the view frustum, so views sharing render datas get their own draw lists
+		static void cullRenderDatas(const std::vector<std::shared_ptr<RenderData>>& render_datas, const glm::mat4& view_proj,
+			std::vector<std::shared_ptr<RenderData>>& visible_render_datas);
+
+	private:
+		void sort();
+		void batchInstances(const std::vector<glm::vec4>& instance_colors, bool back_to_front);
+		void updateInstanceBuffer();
+
+		std::vector<DrawItem> m_items;
+		std::vector<DrawItem> m_sort_items;
+
+		std::vector<ObjectData> m_instances;
+		std::vector<VmaBuffer> m_instance_sbs;
+		uint32_t m_flight_index = 0;
+	};
+
+	// tracks the currently bound command buffer state and skips unchanged binds
+	class DrawStateCache
+	{
+	public:
+		DrawStateCache(VkCommandBuffer command_buffer, DrawStats& draw_stats);
+
+		void bindPipeline(VkPipeline pipeline);
+		void bindVertexBuffer(VkBuffer vertex_buffer);
+		void bindIndexBuffer(VkBuffer index_buffer, VkIndexType index_type);
+
+		// return true if the pushed descriptors differ from the last pushed ones,
+		// mesh_buffer is the bone uniform buffer range of skeletal meshes, or the instance or object buffer of static meshes
+		bool needPushDescriptors(VkPipelineLayout pipeline_layout, const PBRTexture& pbr_texture, const VmaBufferRange& mesh_buffer);
+
+		void drawIndexed(const DrawItem& draw_item);
+
+		// draw a gpu scene batch's objects, which the culling pass has compacted into the view's indirect commands
+		void drawIndexedIndirectCount(const class GPUSceneView& gpu_scene_view, const struct GPUSceneBatch& batch, uint32_t batch_index);
+
+	private:
+		VkCommandBuffer m_command_buffer;
+		DrawStats& m_draw_stats;
+
+		VkPipeline m_pipeline = VK_NULL_HANDLE;
+		VkBuffer m_vertex_buffer = VK_NULL_HANDLE;
+		VkBuffer m_index_buffer = VK_NULL_HANDLE;
+
+		VkPipelineLayout m_pipeline_layout = VK_NULL_HANDLE;
+		std::array<VkImageView, 4> m_pbr_texture_views{};
+		VmaBufferRange m_mesh_buffer;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,199 @@
+#include "gpu_profiler.h"
+#include "engine/core/vulkan/vulkan_rhi.h"
+
+namespace Bamboo
+{
+	const VkQueryPipelineStatisticFlags k_pipeline_statistics = VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT |
+		VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT | VK_QUERY_PIPELINE_STATISTIC_COMPUTE_SHADER_INVOCATIONS_BIT;
+	const uint32_t k_pipeline_statistic_count = 3;
+
+	void GPUProfiler::init()
+	{
+		m_max_scope_count = 32;
+		m_timestamp_period = VulkanRHI::get().getPhysicalDeviceProperties().limits.timestampPeriod;
+		uint32_t timestamp_valid_bits = VulkanRHI::get().getTimestampValidBits();
+		m_timestamp_mask = timestamp_valid_bits >= 64 ? UINT64_MAX : (1ull << timestamp_valid_bits) - 1;
+		if (m_timestamp_mask == 0)
+		{
+			LOG_WARNING("graphics queue doesn't support timestamps, disable gpu profiling");
+			m_enabled = false;
+			return;
+		}
+
+		m_frames.resize(VulkanRHI::get().getFramesInFlight());
+		for (Frame& frame : m_frames)
+		{
+			VkQueryPoolCreateInfo query_pool_ci{};
+			query_pool_ci.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+			query_pool_ci.queryType = VK_QUERY_TYPE_TIMESTAMP;
+			query_pool_ci.queryCount = m_max_scope_count * 2;
+			VkResult result = vkCreateQueryPool(VulkanRHI::get().getDevice(), &query_pool_ci, nullptr, &frame.timestamp_query_pool);
+			CHECK_VULKAN_RESULT(result, "create timestamp query pool");
+
+			if (VulkanRHI::get().isPipelineStatisticsQuerySupported())
+			{
+				query_pool_ci.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+				query_pool_ci.queryCount = m_max_scope_count;
+				query_pool_ci.pipelineStatistics = k_pipeline_statistics;
+				result = vkCreateQueryPool(VulkanRHI::get().getDevice(), &query_pool_ci, nullptr, &frame.statistics_query_pool);
+				CHECK_VULKAN_RESULT(result, "create pipeline statistics query pool");
+			}
+		}
+	}
+
+	void GPUProfiler::destroy()
+	{
+		for (Frame& frame : m_frames)
+		{
+			vkDestroyQueryPool(VulkanRHI::get().getDevice(), frame.timestamp_query_pool, nullptr);
+			if (frame.statistics_query_pool)
+			{
+				vkDestroyQueryPool(VulkanRHI::get().getDevice(), frame.statistics_query_pool, nullptr);
+			}
+		}
+		m_frames.clear();
+	}
+
+	void GPUProfiler::beginFrame(VkCommandBuffer command_buffer)
+	{
+		if (m_frames.empty())
+		{
+			return;
+		}
+
+		// the flight fence has been waited, so the queries of the frame previously recorded with this index are done
+		m_frame_index = VulkanRHI::get().getFlightIndex();
+		Frame& frame = m_frames[m_frame_index];
+		if (!frame.scope_names.empty())
+		{
+			readResults(frame);
+		}
+
+		// the options are latched per frame, as they may be changed while the frame is recorded
+		frame.scope_names.clear();
+		frame.enabled = m_enabled;
+		frame.has_statistics = frame.enabled && m_pipeline_statistics_enabled && frame.statistics_query_pool;
+		if (!frame.enabled)
+		{
+			return;
+		}
+
+		vkCmdResetQueryPool(command_buffer, frame.timestamp_query_pool, 0, m_max_scope_count * 2);
+		if (frame.has_statistics)
+		{
+			vkCmdResetQueryPool(command_buffer, frame.statistics_query_pool, 0, m_max_scope_count);
+		}
+	}
+
+	void GPUProfiler::beginScope(VkCommandBuffer command_buffer, const std::string& name)
+	{
+		if (m_frames.empty() || !m_frames[m_frame_index].enabled)
+		{
+			return;
+		}
+
+		Frame& frame = m_frames[m_frame_index];
+		uint32_t scope_index = static_cast<uint32_t>(frame.scope_names.size());
+		if (scope_index == m_max_scope_count)
+		{
+			return;
+		}
+
+		m_is_scope_open = true;
+		frame.scope_names.push_back(name);
+		vkCmdWriteTimestamp(command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, frame.timestamp_query_pool, scope_index * 2);
+		if (frame.has_statistics)
+		{
+			vkCmdBeginQuery(command_buffer, frame.statistics_query_pool, scope_index, 0);
+		}
+	}
+
+	void GPUProfiler::endScope(VkCommandBuffer command_buffer)
+	{
+		if (!m_is_scope_open)
+		{
+			return;
+		}
+
+		m_is_scope_open = false;
+		Frame& frame = m_frames[m_frame_index];
+		uint32_t scope_index = static_cast<uint32_t>(frame.scope_names.size()) - 1;
+		if (frame.has_statistics)
+		{
+			vkCmdEndQuery(command_buffer, frame.statistics_query_pool, scope_index);
+		}
+		vkCmdWriteTimestamp(command_buffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, frame.timestamp_query_pool, scope_index * 2 + 1);
+	}
+
+	void GPUProfiler::readResults(Frame& frame)
+	{
+		// every query is followed by its availability, frames which were recorded but never submitted stay unavailable
+		uint32_t scope_count = static_cast<uint32_t>(frame.scope_names.size());
+		std::vector<uint64_t> timestamps(scope_count * 2 * 2);
+		VkResult result = vkGetQueryPoolResults(VulkanRHI::get().getDevice(), frame.timestamp_query_pool, 0, scope_count * 2,
+			timestamps.size() * sizeof(uint64_t), timestamps.data(), sizeof(uint64_t) * 2,
+			VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+		if (result != VK_SUCCESS && result != VK_NOT_READY)
+		{
+			return;
+		}
+
+		const uint32_t k_statistics_stride = k_pipeline_statistic_count + 1;
+		std::vector<uint64_t> statistics;
+		if (frame.has_statistics)
+		{
+			statistics.resize(scope_count * k_statistics_stride);
+			result = vkGetQueryPoolResults(VulkanRHI::get().getDevice(), frame.statistics_query_pool, 0, scope_count,
+				statistics.size() * sizeof(uint64_t), statistics.data(), sizeof(uint64_t) * k_statistics_stride,
+				VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+			if (result != VK_SUCCESS && result != VK_NOT_READY)
+			{
+				statistics.clear();
+			}
+		}
+
+		std::vector<GPUProfileScope> scopes;
+		uint64_t frame_begin = 0, frame_end = 0;
+		for (uint32_t i = 0; i < scope_count; ++i)
+		{
+			const uint64_t* p_timestamps = &timestamps[i * 4];
+			if (!p_timestamps[1] || !p_timestamps[3])
+			{
+				continue;
+			}
+
+			GPUProfileScope scope;
+			scope.name = frame.scope_names[i];
+			scope.time_ms = ((p_timestamps[2] - p_timestamps[0]) & m_timestamp_mask) * m_timestamp_period * 1e-6f;
+			if (!statistics.empty() && statistics[i * k_statistics_stride + k_pipeline_statistic_count])
+			{
+				// statistics are written in the bit order of their flags
+				scope.vertex_invocations = statistics[i * k_statistics_stride];
+				scope.fragment_invocations = statistics[i * k_statistics_stride + 1];
+				scope.compute_invocations = statistics[i * k_statistics_stride + 2];
+			}
+			if (scopes.empty())
+			{
+				frame_begin = p_timestamps[0];
+			}
+			frame_end = p_timestamps[2];
+			scopes.push_back(scope);
+		}
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_scopes = std::move(scopes);
+		m_frame_time_ms = ((frame_end - frame_begin) & m_timestamp_mask) * m_timestamp_period * 1e-6f;
+	}
+
+	std::vector<GPUProfileScope> GPUProfiler::getScopes()
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_scopes;
+	}
+
+	float GPUProfiler::getFrameTimeMs()
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_frame_time_ms;
+	}
+}
\ No newline at end of file
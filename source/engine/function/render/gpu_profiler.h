@@ -0,0 +1,71 @@
+#pragma once
+
+#include "engine/core/vulkan/vulkan_util.h"
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace Bamboo
+{
+	// gpu time and pipeline statistics of a profiled scope, statistics are zero if they weren't collected
+	struct GPUProfileScope
+	{
+		std::string name;
+		float time_ms = 0.0f;
+		uint64_t vertex_invocations = 0;
+		uint64_t fragment_invocations = 0;
+		uint64_t compute_invocations = 0;
+	};
+
+	// timestamp and pipeline statistics queries around the render passes of a frame. every frame in flight has its own
+	// query pools, which are read back when the frame's fence has been waited, so results lag the frames in flight.
+	// frames are recorded on the render thread, the options and results can be accessed from any thread
+	class GPUProfiler
+	{
+	public:
+		void init();
+		void destroy();
+
+		// reads back the results of the last frame recorded with the current flight index, and resets its queries
+		void beginFrame(VkCommandBuffer command_buffer);
+
+		// scopes must not be nested, and are recorded outside of render pass instances
+		void beginScope(VkCommandBuffer command_buffer, const std::string& name);
+		void endScope(VkCommandBuffer command_buffer);
+
+		void setEnabled(bool enabled) { m_enabled = enabled && m_timestamp_mask != 0; }
+		bool isEnabled() { return m_enabled; }
+		void setPipelineStatisticsEnabled(bool enabled) { m_pipeline_statistics_enabled = enabled; }
+		bool isPipelineStatisticsEnabled() { return m_pipeline_statistics_enabled; }
+		bool isPipelineStatisticsSupported() { return !m_frames.empty() && m_frames[0].statistics_query_pool != VK_NULL_HANDLE; }
+
+		std::vector<GPUProfileScope> getScopes();
+		float getFrameTimeMs();
+
+	private:
+		struct Frame
+		{
+			VkQueryPool timestamp_query_pool = VK_NULL_HANDLE;
+			VkQueryPool statistics_query_pool = VK_NULL_HANDLE;
+			std::vector<std::string> scope_names;
+			bool enabled = false;
+			bool has_statistics = false;
+		};
+
+		void readResults(Frame& frame);
+
+		std::vector<Frame> m_frames;
+		uint32_t m_frame_index = 0;
+		bool m_is_scope_open = false;
+		uint32_t m_max_scope_count = 0;
+		uint64_t m_timestamp_mask = 0;
+		float m_timestamp_period = 0.0f;
+		std::atomic<bool> m_enabled = true;
+		std::atomic<bool> m_pipeline_statistics_enabled = false;
+
+		std::mutex m_mutex;
+		std::vector<GPUProfileScope> m_scopes;
+		float m_frame_time_ms = 0.0f;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,444 @@
+#include "gpu_scene.h"
+#include "engine/core/vulkan/vulkan_rhi.h"
+#include "engine/function/render/bindless_manager.h"
+#include "engine/function/render/render_snapshot.h"
+#include "engine/resource/asset/asset_manager.h"
+#include "engine/resource/asset/base/mesh.h"
+#include "engine/resource/asset/texture_2d.h"
+
+#include <algorithm>
+
+namespace Bamboo
+{
+	static_assert(sizeof(DrawCommand) == sizeof(VkDrawIndexedIndirectCommand), "draw command must match the indirect command layout");
+
+	const VkDeviceSize k_min_object_count = 64;
+	const VkDeviceSize k_min_batch_count = 64;
+
+	void GPUScene::init(const std::shared_ptr<BindlessManager>& bindless_manager)
+	{
+		m_bindless_manager = bindless_manager;
+	}
+
+	void GPUScene::destroy()
+	{
+		for (auto& iter : m_entity_object_indices)
+		{
+			for (uint32_t object_index : iter.second)
+			{
+				releaseObject(object_index);
+			}
+		}
+		m_entity_object_indices.clear();
+
+		for (auto& retired_buffer : m_retired_buffers)
+		{
+			retired_buffer.first.destroy();
+		}
+		m_retired_buffers.clear();
+		m_object_sb.destroy();
+		m_batch_sb.destroy();
+	}
+
+	void GPUScene::updateEntity(const MeshSnapshot& mesh_snapshot)
+	{
+		const std::shared_ptr<Mesh>& mesh = mesh_snapshot.mesh;
+		std::vector<uint32_t>& object_indices = m_entity_object_indices[mesh_snapshot.entity_id];
+
+		// existing sub meshes keep their object slots
+		while (object_indices.size() > mesh->m_sub_meshes.size())
+		{
+			freeObject(object_indices.back());
+			object_indices.pop_back();
+		}
+		while (object_indices.size() < mesh->m_sub_meshes.size())
+		{
+			object_indices.push_back(allocateObject());
+		}
+
+		// packed positions are dequantized by the model matrix, as in the cpu instanced draw lists
+		const glm::mat4& model_matrix = mesh_snapshot.model_matrix;
+		glm::mat4 m = model_matrix * mesh->getDequantizeMatrix();
+		glm::mat4 nm = glm::transpose(glm::inverse(glm::mat3(model_matrix)));
+		BoundingBox bounding_box = mesh->m_bounding_box.transform(model_matrix);
+		m_changed_bounding_boxes.push_back(bounding_box);
+
+		const VmaImageViewSampler& default_texture_2d = g_engine.assetManager()->getDefaultTexture2D();
+		for (size_t i = 0; i < mesh->m_sub_meshes.size(); ++i)
+		{
+			const SubMesh& sub_mesh = mesh->m_sub_meshes[i];
+			const MaterialSnapshot& material = mesh_snapshot.materials[i];
+			uint32_t object_index = object_indices[i];
+
+			// acquire the new material and batch before releasing the old ones, so unchanged ones keep their indices
+			auto acquireTexture = [this](const std::shared_ptr<Texture2D>& texture) {
+				return texture ? m_bindless_manager->acquireTexture(texture->m_image_view_sampler) : INVALID_TEXTURE_INDEX;
+			};
+			std::array<int, 4> texture_indices = {
+				acquireTexture(material.base_color_texture),
+				acquireTexture(material.metallic_roughness_occlusion_texture),
+				acquireTexture(material.normal_texture),
+				acquireTexture(material.emissive_texture)
+			};
+
+			MaterialData material_data{};
+			material_data.base_color_factor = material.base_color_factor;
+			material_data.emissive_factor = material.emissive_factor;
+			material_data.metallic_factor = material.metallic_factor;
+			material_data.roughness_factor = material.roughness_factor;
+			material_data.contains_occlusion_channel = material.contains_occlusion_channel;
+			material_data.base_color_texture_index = texture_indices[0];
+			material_data.metallic_roughness_occlusion_texture_index = texture_indices[1];
+			material_data.normal_texture_index = texture_indices[2];
+			material_data.emissive_texture_index = texture_indices[3];
+			uint32_t material_index = m_bindless_manager->acquireMaterial(material_data);
+			uint32_t batch_index = acquireBatch(*mesh, material_index, BindlessManager::getMaterialFeatures(material_data),
+				material.base_color_texture ? material.base_color_texture->m_image_view_sampler : default_texture_2d);
+
+			ObjectData& object = m_objects[object_index];
+			if (object.batch_index != INVALID_BATCH_INDEX)
+			{
+				m_changed_bounding_boxes.push_back({ glm::vec3(object.bounds_min), glm::vec3(object.bounds_max) });
+			}
+			releaseObject(object_index);
+			m_object_texture_indices[object_index] = texture_indices;
+
+			object.m = m;
+			object.nm = nm;
+			object.color = glm::vec4(0.0f);
+			object.bounds_min = glm::vec4(bounding_box.m_min, 1.0f);
+			object.bounds_max = glm::vec4(bounding_box.m_max, 1.0f);
+			object.lod_count = std::min(sub_mesh.getLODCount(), static_cast<uint32_t>(MESH_LOD_NUM));
+			for (uint32_t lod = 0; lod < MESH_LOD_NUM; ++lod)
+			{
+				sub_mesh.getLODIndexRange(std::min(lod, object.lod_count - 1), object.lod_first_indices[lod], object.lod_index_counts[lod]);
+			}
+			object.material_index = material_index;
+			object.batch_index = batch_index;
+			markObjectDirty(object_index);
+		}
+	}
+
+	void GPUScene::removeEntity(uint32_t entity_id)
+	{
+		auto iter = m_entity_object_indices.find(entity_id);
+		if (iter == m_entity_object_indices.end())
+		{
+			return;
+		}
+
+		for (uint32_t object_index : iter->second)
+		{
+			freeObject(object_index);
+		}
+		m_entity_object_indices.erase(iter);
+	}
+
+	void GPUScene::upload(VkCommandBuffer command_buffer)
+	{
+		// destroy the grown out buffers once the frames using them have completed
+		for (auto iter = m_retired_buffers.begin(); iter != m_retired_buffers.end();)
+		{
+			if (--iter->second == 0)
+			{
+				iter->first.destroy();
+				iter = m_retired_buffers.erase(iter);
+			}
+			else
+			{
+				++iter;
+			}
+		}
+
+		if (m_is_layout_dirty)
+		{
+			layoutBatches();
+		}
+
+		// a grown buffer is written from scratch, the old one may still be read by the frames in flight
+		if (growBuffer(m_object_sb, m_objects.size() * sizeof(ObjectData), k_min_object_count * sizeof(ObjectData)))
+		{
+			for (uint32_t i = 0; i < m_objects.size(); ++i)
+			{
+				markObjectDirty(i);
+			}
+		}
+		if (growBuffer(m_batch_sb, m_batch_command_offsets.size() * sizeof(uint32_t), k_min_batch_count * sizeof(uint32_t)))
+		{
+			m_is_batch_buffer_dirty = true;
+		}
+
+		if (m_dirty_object_indices.empty() && !m_is_batch_buffer_dirty)
+		{
+			return;
+		}
+
+		// the last frame's culling and vertex shaders must have read the buffers before they're overwritten
+		vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT,
+			VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 0, nullptr);
+
+		// gather the changed objects into one staging range, and copy runs of adjacent slots with one region each
+		UploadRing& upload_ring = VulkanRHI::get().getUploadRing();
+		if (!m_dirty_object_indices.empty())
+		{
+			std::sort(m_dirty_object_indices.begin(), m_dirty_object_indices.end());
+			std::vector<ObjectData> dirty_objects;
+			dirty_objects.reserve(m_dirty_object_indices.size());
+			for (uint32_t object_index : m_dirty_object_indices)
+			{
+				dirty_objects.push_back(m_objects[object_index]);
+				m_is_object_dirty[object_index] = false;
+			}
+			VmaBufferRange staging_range = upload_ring.allocate(dirty_objects.data(), dirty_objects.size() * sizeof(ObjectData));
+
+			std::vector<VkBufferCopy> copy_regions;
+			for (size_t i = 0; i < m_dirty_object_indices.size(); ++i)
+			{
+				uint32_t object_index = m_dirty_object_indices[i];
+				if (i > 0 && object_index == m_dirty_object_indices[i - 1] + 1)
+				{
+					copy_regions.back().size += sizeof(ObjectData);
+					continue;
+				}
+
+				VkBufferCopy copy_region{};
+				copy_region.srcOffset = staging_range.offset + i * sizeof(ObjectData);
+				copy_region.dstOffset = object_index * sizeof(ObjectData);
+				copy_region.size = sizeof(ObjectData);
+				copy_regions.push_back(copy_region);
+			}
+			vkCmdCopyBuffer(command_buffer, staging_range.buffer, m_object_sb.buffer, static_cast<uint32_t>(copy_regions.size()), copy_regions.data());
+			m_dirty_object_indices.clear();
+		}
+
+		if (m_is_batch_buffer_dirty && !m_batch_command_offsets.empty())
+		{
+			VkDeviceSize size = m_batch_command_offsets.size() * sizeof(uint32_t);
+			VmaBufferRange staging_range = upload_ring.allocate(m_batch_command_offsets.data(), size);
+
+			VkBufferCopy copy_region{};
+			copy_region.srcOffset = staging_range.offset;
+			copy_region.dstOffset = 0;
+			copy_region.size = size;
+			vkCmdCopyBuffer(command_buffer, staging_range.buffer, m_batch_sb.buffer, 1, &copy_region);
+		}
+		m_is_batch_buffer_dirty = false;
+
+		VkMemoryBarrier memory_barrier{};
+		memory_barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		memory_barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		memory_barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT,
+			0, 1, &memory_barrier, 0, nullptr, 0, nullptr);
+	}
+
+	bool GPUScene::isChangedInRange(const glm::vec3& center, float radius) const
+	{
+		for (const BoundingBox& bounding_box : m_changed_bounding_boxes)
+		{
+			glm::vec3 d = glm::clamp(center, bounding_box.m_min, bounding_box.m_max) - center;
+			if (glm::dot(d, d) <= radius * radius)
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	uint32_t GPUScene::allocateObject()
+	{
+		if (!m_free_object_indices.empty())
+		{
+			uint32_t object_index = m_free_object_indices.back();
+			m_free_object_indices.pop_back();
+			return object_index;
+		}
+
+		ObjectData object{};
+		object.batch_index = INVALID_BATCH_INDEX;
+		m_objects.push_back(object);
+		m_object_texture_indices.push_back({ INVALID_TEXTURE_INDEX, INVALID_TEXTURE_INDEX, INVALID_TEXTURE_INDEX, INVALID_TEXTURE_INDEX });
+		m_is_object_dirty.push_back(false);
+		return static_cast<uint32_t>(m_objects.size() - 1);
+	}
+
+	void GPUScene::freeObject(uint32_t object_index)
+	{
+		// a free slot is skipped by the culling shader until it's reused
+		ObjectData& object = m_objects[object_index];
+		if (object.batch_index != INVALID_BATCH_INDEX)
+		{
+			m_changed_bounding_boxes.push_back({ glm::vec3(object.bounds_min), glm::vec3(object.bounds_max) });
+		}
+		releaseObject(object_index);
+		object.batch_index = INVALID_BATCH_INDEX;
+		markObjectDirty(object_index);
+		m_free_object_indices.push_back(object_index);
+	}
+
+	void GPUScene::releaseObject(uint32_t object_index)
+	{
+		// release the batch, material and textures the object references
+		ObjectData& object = m_objects[object_index];
+		if (object.batch_index == INVALID_BATCH_INDEX)
+		{
+			return;
+		}
+
+		releaseBatch(object.batch_index);
+		m_bindless_manager->releaseMaterial(object.material_index);
+		for (int texture_index : m_object_texture_indices[object_index])
+		{
+			m_bindless_manager->releaseTexture(texture_index);
+		}
+		m_object_texture_indices[object_index].fill(INVALID_TEXTURE_INDEX);
+	}
+
+	void GPUScene::markObjectDirty(uint32_t object_index)
+	{
+		if (!m_is_object_dirty[object_index])
+		{
+			m_is_object_dirty[object_index] = true;
+			m_dirty_object_indices.push_back(object_index);
+		}
+	}
+
+	uint32_t GPUScene::acquireBatch(const Mesh& mesh, uint32_t material_index, uint32_t material_features,
+		const VmaImageViewSampler& base_color_texture)
+	{
+		auto key = std::make_tuple(mesh.m_vertex_buffer.buffer, mesh.m_index_buffer.buffer, material_index);
+		auto iter = m_batch_indices.find(key);
+		if (iter != m_batch_indices.end())
+		{
+			GPUSceneBatch& batch = m_batches[iter->second];
+			if (++batch.object_count > batch.command_capacity)
+			{
+				m_is_layout_dirty = true;
+			}
+			return iter->second;
+		}
+
+		uint32_t batch_index = static_cast<uint32_t>(m_batches.size());
+		if (!m_free_batch_indices.empty())
+		{
+			batch_index = m_free_batch_indices.back();
+			m_free_batch_indices.pop_back();
+		}
+		else
+		{
+			m_batches.emplace_back();
+		}
+
+		GPUSceneBatch& batch = m_batches[batch_index];
+		batch = GPUSceneBatch{};
+		batch.vertex_buffer = mesh.m_vertex_buffer.buffer;
+		batch.index_buffer = mesh.m_index_buffer.buffer;
+		batch.index_type = mesh.m_index_type;
+		batch.material_index = material_index;
+		batch.material_features = material_features;
+		batch.base_color_texture = base_color_texture;
+		batch.object_count = 1;
+		m_batch_indices[key] = batch_index;
+		m_is_layout_dirty = true;
+		return batch_index;
+	}
+
+	void GPUScene::releaseBatch(uint32_t batch_index)
+	{
+		GPUSceneBatch& batch = m_batches[batch_index];
+		if (--batch.object_count > 0)
+		{
+			return;
+		}
+
+		m_batch_indices.erase(std::make_tuple(batch.vertex_buffer, batch.index_buffer, batch.material_index));
+		m_free_batch_indices.push_back(batch_index);
+		m_is_layout_dirty = true;
+	}
+
+	void GPUScene::layoutBatches()
+	{
+		// every batch gets room for twice its objects, so batches can grow before they're laid out again
+		const uint32_t k_min_command_capacity = 16;
+		m_command_count = 0;
+		m_batch_command_offsets.assign(m_batches.size(), 0);
+		m_draw_batch_indices.clear();
+		for (uint32_t b = 0; b < m_batches.size(); ++b)
+		{
+			GPUSceneBatch& batch = m_batches[b];
+			batch.command_offset = m_command_count;
+			batch.command_capacity = batch.object_count > 0 ? std::max(batch.object_count * 2, k_min_command_capacity) : 0;
+			m_batch_command_offsets[b] = batch.command_offset;
+			m_command_count += batch.command_capacity;
+			if (batch.object_count > 0)
+			{
+				m_draw_batch_indices.push_back(b);
+			}
+		}
+
+		std::sort(m_draw_batch_indices.begin(), m_draw_batch_indices.end(), [this](uint32_t a, uint32_t b) {
+			const GPUSceneBatch& batch_a = m_batches[a];
+			const GPUSceneBatch& batch_b = m_batches[b];
+			return std::make_tuple(batch_a.material_features, batch_a.vertex_buffer, batch_a.material_index) <
+				std::make_tuple(batch_b.material_features, batch_b.vertex_buffer, batch_b.material_index);
+		});
+
+		m_is_layout_dirty = false;
+		m_is_batch_buffer_dirty = true;
+	}
+
+	bool GPUScene::growBuffer(VmaBuffer& buffer, VkDeviceSize size, VkDeviceSize min_size)
+	{
+		size = std::max(size, min_size);
+		if (buffer.buffer != VK_NULL_HANDLE && buffer.size >= size)
+		{
+			return false;
+		}
+
+		VkDeviceSize capacity = buffer.buffer == VK_NULL_HANDLE ? min_size : buffer.size;
+		while (capacity < size)
+		{
+			capacity *= 2;
+		}
+
+		if (buffer.buffer != VK_NULL_HANDLE)
+		{
+			m_retired_buffers.emplace_back(buffer, VulkanRHI::get().getFramesInFlight());
+		}
+		VulkanUtil::createBuffer(capacity, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE, buffer);
+		return true;
+	}
+
+	void GPUSceneView::update(const GPUScene& gpu_scene)
+	{
+		m_flight_index = VulkanRHI::get().getFlightIndex();
+		if (m_draw_command_sbs.empty())
+		{
+			m_draw_command_sbs.resize(VulkanRHI::get().getFramesInFlight());
+			m_draw_count_sbs.resize(VulkanRHI::get().getFramesInFlight());
+		}
+
+		// the draw commands and counts are written by the culling compute shader
+		VulkanUtil::reserveBuffer(m_draw_command_sbs[m_flight_index], gpu_scene.getCommandCount() * sizeof(DrawCommand),
+			k_min_object_count * sizeof(DrawCommand), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+			VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE);
+		VulkanUtil::reserveBuffer(m_draw_count_sbs[m_flight_index], gpu_scene.getBatchCount() * sizeof(uint32_t),
+			k_min_batch_count * sizeof(uint32_t), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE);
+	}
+
+	void GPUSceneView::destroy()
+	{
+		for (VmaBuffer& draw_command_sb : m_draw_command_sbs)
+		{
+			draw_command_sb.destroy();
+		}
+		for (VmaBuffer& draw_count_sb : m_draw_count_sbs)
+		{
+			draw_count_sb.destroy();
+		}
+		m_draw_command_sbs.clear();
+		m_draw_count_sbs.clear();
+	}
+}
@@ -0,0 +1,124 @@
+#pragma once
+
+#include "engine/core/vulkan/vulkan_util.h"
+#include "engine/core/math/bounding_box.h"
+#include "host_device.h"
+
+#include <array>
+#include <map>
+#include <memory>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+namespace Bamboo
+{
+	// static sub meshes sharing mesh buffers and material, drawn with one indirect draw count per view
+	struct GPUSceneBatch
+	{
+		VkBuffer vertex_buffer = VK_NULL_HANDLE;
+		VkBuffer index_buffer = VK_NULL_HANDLE;
+		VkIndexType index_type = VK_INDEX_TYPE_UINT32;
+		uint32_t material_index = 0;
+		uint32_t material_features = 0;
+
+		// sampled by the shadow passes for alpha testing, the default texture if the material has none
+		VmaImageViewSampler base_color_texture;
+
+		// range of the batch's indirect commands in a view's command buffer, and the objects referencing the batch
+		uint32_t command_offset = 0;
+		uint32_t command_capacity = 0;
+		uint32_t object_count = 0;
+	};
+
+	// device resident objects of the static meshes, which keep their object slots while their entities exist.
+	// the render thread writes the changed objects' slots, and views cull all objects into their batches' indirect commands
+	class GPUScene
+	{
+	public:
+		void init(const std::shared_ptr<class BindlessManager>& bindless_manager);
+		void destroy();
+
+		// add or replace the objects of an entity's sub meshes, or remove all of them
+		void updateEntity(const struct MeshSnapshot& mesh_snapshot);
+		void removeEntity(uint32_t entity_id);
+
+		// copy the changed objects and the batch layout to the device, must be recorded before any view is culled
+		void upload(VkCommandBuffer command_buffer);
+
+		// world space boxes of the objects changed since the last clearChanges, which invalidate cached shadows
+		bool isChangedInRange(const glm::vec3& center, float radius) const;
+		void clearChanges() { m_changed_bounding_boxes.clear(); }
+
+		bool empty() const { return m_entity_object_indices.empty(); }
+
+		// object slots including free ones, batch slots including free ones, and the indirect commands of all batches
+		uint32_t getObjectCount() const { return static_cast<uint32_t>(m_objects.size()); }
+		uint32_t getBatchCount() const { return static_cast<uint32_t>(m_batches.size()); }
+		uint32_t getCommandCount() const { return m_command_count; }
+
+		// indices of the non-empty batches, sorted by material features, mesh buffers and material to save binds
+		const std::vector<GPUSceneBatch>& getBatches() const { return m_batches; }
+		const std::vector<uint32_t>& getDrawBatchIndices() const { return m_draw_batch_indices; }
+
+		const VmaBuffer& getObjectBuffer() const { return m_object_sb; }
+		const VmaBuffer& getBatchBuffer() const { return m_batch_sb; }
+
+	private:
+		uint32_t allocateObject();
+		void freeObject(uint32_t object_index);
+		void releaseObject(uint32_t object_index);
+		void markObjectDirty(uint32_t object_index);
+		uint32_t acquireBatch(const class Mesh& mesh, uint32_t material_index, uint32_t material_features,
+			const VmaImageViewSampler& base_color_texture);
+		void releaseBatch(uint32_t batch_index);
+		void layoutBatches();
+		bool growBuffer(VmaBuffer& buffer, VkDeviceSize size, VkDeviceSize min_size);
+
+		std::shared_ptr<class BindlessManager> m_bindless_manager;
+
+		// cpu copy of the object buffer and the bindless textures referenced by every object's material
+		std::vector<ObjectData> m_objects;
+		std::vector<std::array<int, 4>> m_object_texture_indices;
+		std::vector<uint32_t> m_free_object_indices;
+		std::vector<uint32_t> m_dirty_object_indices;
+		std::vector<bool> m_is_object_dirty;
+		std::unordered_map<uint32_t, std::vector<uint32_t>> m_entity_object_indices;
+
+		// batches keyed by vertex buffer, index buffer and material index
+		std::vector<GPUSceneBatch> m_batches;
+		std::vector<uint32_t> m_free_batch_indices;
+		std::map<std::tuple<VkBuffer, VkBuffer, uint32_t>, uint32_t> m_batch_indices;
+
+		// the batches' command ranges are laid out again when batches are added, removed or outgrow their capacity
+		bool m_is_layout_dirty = false;
+		bool m_is_batch_buffer_dirty = false;
+		uint32_t m_command_count = 0;
+		std::vector<uint32_t> m_batch_command_offsets;
+		std::vector<uint32_t> m_draw_batch_indices;
+
+		std::vector<BoundingBox> m_changed_bounding_boxes;
+
+		// device buffers, and the grown out ones with the number of frames until their last use has completed
+		VmaBuffer m_object_sb;
+		VmaBuffer m_batch_sb;
+		std::vector<std::pair<VmaBuffer, uint32_t>> m_retired_buffers;
+	};
+
+	// per flight indirect commands and draw counts of a view, written by the culling pass
+	class GPUSceneView
+	{
+	public:
+		// size the current flight's buffers for the scene's batch layout
+		void update(const GPUScene& gpu_scene);
+		void destroy();
+
+		const VmaBuffer& getDrawCommandBuffer() const { return m_draw_command_sbs[m_flight_index]; }
+		const VmaBuffer& getDrawCountBuffer() const { return m_draw_count_sbs[m_flight_index]; }
+
+	private:
+		std::vector<VmaBuffer> m_draw_command_sbs;
+		std::vector<VmaBuffer> m_draw_count_sbs;
+		uint32_t m_flight_index = 0;
+	};
+}
@@ -0,0 +1,209 @@
+#include "light_grid.h"
+#include <algorithm>
+#include <cmath>
+
+namespace Bamboo
+{
+	const uint32_t k_cluster_num = LIGHT_CLUSTER_X_NUM * LIGHT_CLUSTER_Y_NUM * LIGHT_CLUSTER_Z_NUM;
+
+	static uint32_t getClusterIndex(uint32_t x, uint32_t y, uint32_t z)
+	{
+		return (z * LIGHT_CLUSTER_Y_NUM + y) * LIGHT_CLUSTER_X_NUM + x;
+	}
+
+	void LightGrid::build(const std::vector<PointLight>& point_lights, const std::vector<SpotLight>& spot_lights,
+		const glm::mat4& view, const glm::mat4& proj, float near, float far)
+	{
+		if (proj != m_proj || near != m_near || far != m_far)
+		{
+			updateClusterBounds(proj, near, far);
+		}
+
+		m_cluster_point_lights.resize(k_cluster_num);
+		m_cluster_spot_lights.resize(k_cluster_num);
+		for (uint32_t c = 0; c < k_cluster_num; ++c)
+		{
+			m_cluster_point_lights[c].clear();
+			m_cluster_spot_lights[c].clear();
+		}
+
+		for (size_t i = 0; i < point_lights.size(); ++i)
+		{
+			const PointLight& point_light = point_lights[i];
+			glm::vec3 view_center = view * glm::vec4(point_light.position, 1.0f);
+			cullLight(view_center, point_light.radius, static_cast<uint32_t>(i), m_cluster_point_lights);
+		}
+
+		for (size_t i = 0; i < spot_lights.size(); ++i)
+		{
+			// bounding sphere of the spot light's cone, the outer cutoff is stored as the cosine of the cone angle
+			const SpotLight& spot_light = spot_lights[i];
+			float radius = spot_light._pl.radius;
+			float cos_angle = spot_light._pl.padding1;
+			glm::vec3 center;
+			if (cos_angle < std::cos(glm::radians(45.0f)))
+			{
+				center = spot_light._pl.position + spot_light.direction * (radius * cos_angle);
+				radius = radius * std::sqrt(std::max(1.0f - cos_angle * cos_angle, 0.0f));
+			}
+			else
+			{
+				radius = radius / (2.0f * cos_angle);
+				center = spot_light._pl.position + spot_light.direction * radius;
+			}
+
+			glm::vec3 view_center = view * glm::vec4(center, 1.0f);
+			cullLight(view_center, radius, static_cast<uint32_t>(i), m_cluster_spot_lights);
+		}
+
+		// flatten the cluster lists into one index buffer, point lights first in every cluster
+		m_clusters.resize(k_cluster_num);
+		m_light_indices.clear();
+		for (uint32_t c = 0; c < k_cluster_num; ++c)
+		{
+			const auto& cluster_point_lights = m_cluster_point_lights[c];
+			const auto& cluster_spot_lights = m_cluster_spot_lights[c];
+			uint32_t point_light_num = std::min(static_cast<uint32_t>(cluster_point_lights.size()), static_cast<uint32_t>(MAX_CLUSTER_LIGHT_NUM));
+			uint32_t spot_light_num = std::min(static_cast<uint32_t>(cluster_spot_lights.size()), MAX_CLUSTER_LIGHT_NUM - point_light_num);
+
+			LightCluster& cluster = m_clusters[c];
+			cluster.offset = static_cast<uint32_t>(m_light_indices.size());
+			cluster.point_light_num = point_light_num;
+			cluster.spot_light_num = spot_light_num;
+			cluster.padding0 = 0;
+
+			m_light_indices.insert(m_light_indices.end(), cluster_point_lights.begin(), cluster_point_lights.begin() + point_light_num);
+			m_light_indices.insert(m_light_indices.end(), cluster_spot_lights.begin(), cluster_spot_lights.begin() + spot_light_num);
+		}
+	}
+
+	void LightGrid::updateClusterBounds(const glm::mat4& proj, float near, float far)
+	{
+		m_proj = proj;
+		m_near = near;
+		m_far = far;
+
+		// exponential depth slices, so clusters stay roughly cubic along the view direction
+		float log_depth_ratio = std::log(far / near);
+		m_z_scale = LIGHT_CLUSTER_Z_NUM / log_depth_ratio;
+		m_z_bias = LIGHT_CLUSTER_Z_NUM * std::log(near) / log_depth_ratio;
+
+		std::vector<float> slice_depths(LIGHT_CLUSTER_Z_NUM + 1);
+		for (uint32_t z = 0; z <= LIGHT_CLUSTER_Z_NUM; ++z)
+		{
+			slice_depths[z] = near * std::pow(far / near, static_cast<float>(z) / LIGHT_CLUSTER_Z_NUM);
+		}
+
+		// every tile corner is a view space line from the near to the far plane, sliced at the depths above
+		glm::mat4 inv_proj = glm::inverse(proj);
+		auto unproject = [&inv_proj](float x, float y, float z) {
+			glm::vec4 p = inv_proj * glm::vec4(x, y, z, 1.0f);
+			return glm::vec3(p) / p.w;
+		};
+
+		m_near_plane_depth = -unproject(0.0f, 0.0f, 0.0f).z;
+
+		m_cluster_bounds.resize(k_cluster_num);
+		for (uint32_t y = 0; y < LIGHT_CLUSTER_Y_NUM; ++y)
+		{
+			for (uint32_t x = 0; x < LIGHT_CLUSTER_X_NUM; ++x)
+			{
+				glm::vec3 near_corners[4], far_corners[4];
+				for (uint32_t i = 0; i < 4; ++i)
+				{
+					float ndc_x = (x + (i & 1)) * 2.0f / LIGHT_CLUSTER_X_NUM - 1.0f;
+					float ndc_y = (y + (i >> 1)) * 2.0f / LIGHT_CLUSTER_Y_NUM - 1.0f;
+					near_corners[i] = unproject(ndc_x, ndc_y, 0.0f);
+					far_corners[i] = unproject(ndc_x, ndc_y, 1.0f);
+				}
+
+				for (uint32_t z = 0; z < LIGHT_CLUSTER_Z_NUM; ++z)
+				{
+					BoundingBox& bounds = m_cluster_bounds[getClusterIndex(x, y, z)];
+					bounds.m_min = glm::vec3(std::numeric_limits<float>::max());
+					bounds.m_max = glm::vec3(-std::numeric_limits<float>::max());
+					for (uint32_t i = 0; i < 4; ++i)
+					{
+						float near_depth = -near_corners[i].z;
+						float far_depth = -far_corners[i].z;
+						for (uint32_t s = z; s <= z + 1; ++s)
+						{
+							// the first and last slices extend to the projection's near and far planes
+							float t = (slice_depths[s] - near_depth) / (far_depth - near_depth);
+							t = s == 0 ? 0.0f : (s == LIGHT_CLUSTER_Z_NUM ? 1.0f : t);
+							bounds.combine(glm::mix(near_corners[i], far_corners[i], t));
+						}
+					}
+				}
+			}
+		}
+	}
+
+	void LightGrid::cullLight(const glm::vec3& view_center, float radius, uint32_t light_index, std::vector<std::vector<uint32_t>>& cluster_lights)
+	{
+		// view space looks down -z
+		float min_depth = -view_center.z - radius;
+		float max_depth = -view_center.z + radius;
+		if (max_depth < m_near_plane_depth || min_depth > m_far)
+		{
+			return;
+		}
+
+		uint32_t min_z = calcSlice(min_depth);
+		uint32_t max_z = calcSlice(max_depth);
+
+		// project the sphere's bounds to a tile range if it's in front of the near plane, otherwise test every tile
+		uint32_t min_x = 0, max_x = LIGHT_CLUSTER_X_NUM - 1;
+		uint32_t min_y = 0, max_y = LIGHT_CLUSTER_Y_NUM - 1;
+		if (min_depth > m_near)
+		{
+			glm::vec2 min_ndc(std::numeric_limits<float>::max()), max_ndc(-std::numeric_limits<float>::max());
+			for (uint32_t i = 0; i < 8; ++i)
+			{
+				glm::vec3 corner = view_center + glm::vec3(i & 1 ? radius : -radius, i & 2 ? radius : -radius, i & 4 ? radius : -radius);
+				glm::vec4 clip = m_proj * glm::vec4(corner, 1.0f);
+				glm::vec2 ndc = glm::vec2(clip) / clip.w;
+				min_ndc = glm::min(min_ndc, ndc);
+				max_ndc = glm::max(max_ndc, ndc);
+			}
+
+			auto toTile = [](float ndc, uint32_t tile_num) {
+				float tile = std::floor((ndc * 0.5f + 0.5f) * tile_num);
+				return static_cast<uint32_t>(std::clamp(tile, 0.0f, static_cast<float>(tile_num - 1)));
+			};
+
+			if (max_ndc.x < -1.0f || min_ndc.x > 1.0f || max_ndc.y < -1.0f || min_ndc.y > 1.0f)
+			{
+				return;
+			}
+			min_x = toTile(min_ndc.x, LIGHT_CLUSTER_X_NUM);
+			max_x = toTile(max_ndc.x, LIGHT_CLUSTER_X_NUM);
+			min_y = toTile(min_ndc.y, LIGHT_CLUSTER_Y_NUM);
+			max_y = toTile(max_ndc.y, LIGHT_CLUSTER_Y_NUM);
+		}
+
+		float radius_sqr = radius * radius;
+		for (uint32_t z = min_z; z <= max_z; ++z)
+		{
+			for (uint32_t y = min_y; y <= max_y; ++y)
+			{
+				for (uint32_t x = min_x; x <= max_x; ++x)
+				{
+					uint32_t cluster_index = getClusterIndex(x, y, z);
+					const BoundingBox& bounds = m_cluster_bounds[cluster_index];
+					glm::vec3 d = glm::clamp(view_center, bounds.m_min, bounds.m_max) - view_center;
+					if (glm::dot(d, d) <= radius_sqr)
+					{
+						cluster_lights[cluster_index].push_back(light_index);
+					}
+				}
+			}
+		}
+	}
+
+	uint32_t LightGrid::calcSlice(float depth) const
+	{
+		float slice = std::floor(std::log(std::max(depth, m_near)) * m_z_scale - m_z_bias);
+		return static_cast<uint32_t>(std::clamp(slice, 0.0f, static_cast<float>(LIGHT_CLUSTER_Z_NUM - 1)));
+	}
+}
\ No newline at end of file
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "engine/core/math/bounding_box.h"
+#include "host_device.h"
+#include <vector>
+
+namespace Bamboo
+{
+	// cpu light culling into a froxel grid over the camera frustum, every cluster lists the point and spot lights
+	// whose bounding spheres overlap its view space bounds, so lighting shaders only iterate the lights of their cluster
+	class LightGrid
+	{
+	public:
+		void build(const std::vector<PointLight>& point_lights, const std::vector<SpotLight>& spot_lights,
+			const glm::mat4& view, const glm::mat4& proj, float near, float far);
+
+		const std::vector<LightCluster>& getClusters() const { return m_clusters; }
+		const std::vector<uint32_t>& getLightIndices() const { return m_light_indices; }
+		float getZScale() const { return m_z_scale; }
+		float getZBias() const { return m_z_bias; }
+
+	private:
+		void updateClusterBounds(const glm::mat4& proj, float near, float far);
+		void cullLight(const glm::vec3& view_center, float radius, uint32_t light_index, std::vector<std::vector<uint32_t>>& cluster_lights);
+		uint32_t calcSlice(float depth) const;
+
+		std::vector<LightCluster> m_clusters;
+		std::vector<uint32_t> m_light_indices;
+
+		// per cluster light lists, kept to reuse their capacity
+		std::vector<std::vector<uint32_t>> m_cluster_point_lights;
+		std::vector<std::vector<uint32_t>> m_cluster_spot_lights;
+
+		// view space cluster bounds only change with the projection
+		std::vector<BoundingBox> m_cluster_bounds;
+		glm::mat4 m_proj = glm::mat4(0.0f);
+		float m_near = 0.0f, m_far = 0.0f;
+		float m_near_plane_depth = 0.0f;
+		float m_z_scale = 0.0f, m_z_bias = 0.0f;
+	};
+}
\ No newline at end of file
@@ -17,6 +17,8 @@ namespace Bamboo
 	void BRDFLUTPass::init()
 	{
 		RenderPass::init();
+		buildPipelines();
+		commitPipelines();
 
 		createResizableObjects(m_size, m_size);
 	}
@@ -167,8 +169,8 @@ namespace Bamboo
 		m_pipeline_ci.renderPass = m_render_pass;
 		m_pipeline_ci.subpass = 0;
 
-		m_pipelines.resize(1);
-		VkResult result = vkCreateGraphicsPipelines(VulkanRHI::get().getDevice(), m_pipeline_cache, 1, &m_pipeline_ci, nullptr, &m_pipelines[0]);
+		m_pending_pipelines.resize(1);
+		VkResult result = vkCreateGraphicsPipelines(VulkanRHI::get().getDevice(), m_pipeline_cache, 1, &m_pipeline_ci, nullptr, &m_pending_pipelines[0]);
 		CHECK_VULKAN_RESULT(result, "create brdf lut graphics pipeline");
 	}
 
@@ -0,0 +1,323 @@
+#include "culling_pass.h"
+#include "engine/core/vulkan/vulkan_rhi.h"
+#include "engine/resource/shader/shader_manager.h"
+
+namespace Bamboo
+{
+
+	CullingPass::CullingPass()
+	{
+		m_format = VK_FORMAT_R32_SFLOAT;
+	}
+
+	void CullingPass::init()
+	{
+		RenderPass::init();
+
+		// create a placeholder hi-z pyramid, so the culling shader always has a texture to bind
+		createResizableObjects(1, 1);
+	}
+
+	void CullingPass::render()
+	{
+		VkCommandBuffer command_buffer = VulkanRHI::get().getCommandBuffer();
+		VkImageAspectFlags depth_aspect_flags = VulkanUtil::calcImageAspectFlags(VulkanRHI::get().getDepthFormat());
+
+		// wait for the main pass's depth writes and this frame's hi-z reads
+		std::array<VkImageMemoryBarrier, 2> image_barriers{};
+		for (VkImageMemoryBarrier& image_barrier : image_barriers)
+		{
+			image_barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+			image_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			image_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			image_barrier.subresourceRange.baseArrayLayer = 0;
+			image_barrier.subresourceRange.layerCount = 1;
+			image_barrier.subresourceRange.baseMipLevel = 0;
+		}
+
+		image_barriers[0].image = m_depth_texture->vma_image.image;
+		image_barriers[0].oldLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+		image_barriers[0].newLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+		image_barriers[0].srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+		image_barriers[0].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		image_barriers[0].subresourceRange.aspectMask = depth_aspect_flags;
+		image_barriers[0].subresourceRange.levelCount = 1;
+
+		image_barriers[1].image = m_hiz_image_view.image();
+		image_barriers[1].oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+		image_barriers[1].newLayout = VK_IMAGE_LAYOUT_GENERAL;
+		image_barriers[1].srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		image_barriers[1].dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		image_barriers[1].subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		image_barriers[1].subresourceRange.levelCount = m_mip_levels;
+
+		vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0, nullptr, static_cast<uint32_t>(image_barriers.size()), image_barriers.data());
+
+		// build the hi-z pyramid, each mip stores the max depth of its footprint in the previous mip
+		vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipelines[1]);
+
+		VmaImageViewSampler src_texture{};
+		src_texture.sampler = m_hiz_sampler;
+		src_texture.descriptor_type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+
+		VmaImageViewSampler dst_texture{};
+		dst_texture.image_layout = VK_IMAGE_LAYOUT_GENERAL;
+		dst_texture.descriptor_type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+
+		VkMemoryBarrier memory_barrier{};
+		memory_barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		memory_barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		memory_barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+		HiZPCO hiz_pco;
+		hiz_pco.src_width = m_width;
+		hiz_pco.src_height = m_height;
+		for (uint32_t i = 0; i < m_mip_levels; ++i)
+		{
+			src_texture.view = i == 0 ? m_depth_view : m_hiz_mip_views[i - 1];
+			src_texture.image_layout = i == 0 ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_GENERAL;
+			dst_texture.view = m_hiz_mip_views[i];
+
+			std::vector<VkWriteDescriptorSet> desc_writes;
+			std::array<VkDescriptorImageInfo, 2> desc_image_infos{};
+			addImageDescriptorSet(desc_writes, desc_image_infos[0], src_texture, 0);
+			addImageDescriptorSet(desc_writes, desc_image_infos[1], dst_texture, 1);
+			VulkanRHI::get().getVkCmdPushDescriptorSetKHR()(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+				m_pipeline_layouts[1], 0, static_cast<uint32_t>(desc_writes.size()), desc_writes.data());
+
+			hiz_pco.dst_width = std::max(m_width >> i, 1u);
+			hiz_pco.dst_height = std::max(m_height >> i, 1u);
+			vkCmdPushConstants(command_buffer, m_pipeline_layouts[1], VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(HiZPCO), &hiz_pco);
+			vkCmdDispatch(command_buffer, (hiz_pco.dst_width + HIZ_GROUP_SIZE - 1) / HIZ_GROUP_SIZE,
+				(hiz_pco.dst_height + HIZ_GROUP_SIZE - 1) / HIZ_GROUP_SIZE, 1);
+
+			vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+				0, 1, &memory_barrier, 0, nullptr, 0, nullptr);
+
+			hiz_pco.src_width = hiz_pco.dst_width;
+			hiz_pco.src_height = hiz_pco.dst_height;
+		}
+
+		// give the depth texture back to the next frame's main pass
+		image_barriers[0].oldLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+		image_barriers[0].newLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+		image_barriers[0].srcAccessMask = 0;
+		image_barriers[0].dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+		vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT, 
+			0, 0, nullptr, 0, nullptr, 1, &image_barriers[0]);
+
+		m_hiz_valid = true;
+	}
+
+	void CullingPass::setLODCamera(const glm::vec3& position, float fovy, float lod_bias, float shadow_lod_bias)
+	{
+		m_lod_camera_position = position;
+		m_lod_scale = 1.0f / std::tan(glm::radians(fovy) * 0.5f);
+		m_lod_bias = lod_bias;
+		m_shadow_lod_bias = shadow_lod_bias;
+	}
+
+	void CullingPass::cull(VkCommandBuffer command_buffer, const GPUScene& gpu_scene, GPUSceneView& gpu_scene_view,
+		const glm::mat4& view_proj, uint32_t cull_flags, bool is_shadow_view)
+	{
+		gpu_scene_view.update(gpu_scene);
+		uint32_t object_count = gpu_scene.getObjectCount();
+		uint32_t batch_count = gpu_scene.getBatchCount();
+		if (object_count == 0 || batch_count == 0)
+		{
+			return;
+		}
+
+		// reset draw counts
+		vkCmdFillBuffer(command_buffer, gpu_scene_view.getDrawCountBuffer().buffer, 0, batch_count * sizeof(uint32_t), 0);
+
+		VkMemoryBarrier memory_barrier{};
+		memory_barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		memory_barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		memory_barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+		vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			0, 1, &memory_barrier, 0, nullptr, 0, nullptr);
+
+		// cull and compact
+		vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipelines[0]);
+
+		VmaImageViewSampler hiz_texture{};
+		hiz_texture.view = m_hiz_image_view.view;
+		hiz_texture.sampler = m_hiz_sampler;
+		hiz_texture.image_layout = VK_IMAGE_LAYOUT_GENERAL;
+		hiz_texture.descriptor_type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+
+		std::vector<VkWriteDescriptorSet> desc_writes;
+		std::array<VkDescriptorBufferInfo, 4> desc_buffer_infos{};
+		VkDescriptorImageInfo desc_image_info{};
+		addBufferDescriptorSet(desc_writes, desc_buffer_infos[0], gpu_scene.getObjectBuffer(), 0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER);
+		addBufferDescriptorSet(desc_writes, desc_buffer_infos[1], gpu_scene.getBatchBuffer(), 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER);
+		addBufferDescriptorSet(desc_writes, desc_buffer_infos[2], gpu_scene_view.getDrawCommandBuffer(), 2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER);
+		addBufferDescriptorSet(desc_writes, desc_buffer_infos[3], gpu_scene_view.getDrawCountBuffer(), 3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER);
+		addImageDescriptorSet(desc_writes, desc_image_info, hiz_texture, 4);
+		VulkanRHI::get().getVkCmdPushDescriptorSetKHR()(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+			m_pipeline_layouts[0], 0, static_cast<uint32_t>(desc_writes.size()), desc_writes.data());
+
+		CullPCO cull_pco;
+		cull_pco.view_proj = view_proj;
+		cull_pco.lod_camera = glm::vec4(m_lod_camera_position, is_shadow_view ? m_shadow_lod_bias : m_lod_bias);
+		cull_pco.hiz_size = glm::vec2(m_width, m_height);
+		cull_pco.lod_scale = m_lod_scale;
+		cull_pco.object_count = object_count;
+		cull_pco.cull_flags = m_hiz_valid ? cull_flags : cull_flags & ~CULL_FLAG_OCCLUSION;
+		vkCmdPushConstants(command_buffer, m_pipeline_layouts[0], VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(CullPCO), &cull_pco);
+		vkCmdDispatch(command_buffer, (object_count + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE, 1, 1);
+
+		// make the indirect commands and draw counts visible to indirect draws
+		memory_barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		memory_barrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+		vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,
+			0, 1, &memory_barrier, 0, nullptr, 0, nullptr);
+	}
+
+	void CullingPass::createDescriptorSetLayouts()
+	{
+		std::vector<VkDescriptorSetLayoutBinding> desc_set_layout_bindings = {
+			{0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr},
+			{1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr},
+			{2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr},
+			{3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr},
+			{4, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr}
+		};
+
+		VkDescriptorSetLayoutCreateInfo desc_set_layout_ci{};
+		desc_set_layout_ci.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+		desc_set_layout_ci.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_PUSH_DESCRIPTOR_BIT_KHR;
+		desc_set_layout_ci.pBindings = desc_set_layout_bindings.data();
+		desc_set_layout_ci.bindingCount = static_cast<uint32_t>(desc_set_layout_bindings.size());
+
+		m_desc_set_layouts.resize(2);
+		VkResult result = vkCreateDescriptorSetLayout(VulkanRHI::get().getDevice(), &desc_set_layout_ci, nullptr, &m_desc_set_layouts[0]);
+		CHECK_VULKAN_RESULT(result, "create culling descriptor set layout");
+
+		desc_set_layout_bindings = {
+			{0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr},
+			{1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr}
+		};
+		desc_set_layout_ci.pBindings = desc_set_layout_bindings.data();
+		desc_set_layout_ci.bindingCount = static_cast<uint32_t>(desc_set_layout_bindings.size());
+
+		result = vkCreateDescriptorSetLayout(VulkanRHI::get().getDevice(), &desc_set_layout_ci, nullptr, &m_desc_set_layouts[1]);
+		CHECK_VULKAN_RESULT(result, "create hi-z building descriptor set layout");
+	}
+
+	void CullingPass::createPipelineLayouts()
+	{
+		VkPushConstantRange push_constant_range = { VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(CullPCO) };
+
+		VkPipelineLayoutCreateInfo pipeline_layout_ci{};
+		pipeline_layout_ci.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+		pipeline_layout_ci.setLayoutCount = 1;
+		pipeline_layout_ci.pSetLayouts = &m_desc_set_layouts[0];
+		pipeline_layout_ci.pushConstantRangeCount = 1;
+		pipeline_layout_ci.pPushConstantRanges = &push_constant_range;
+
+		m_pipeline_layouts.resize(2);
+		VkResult result = vkCreatePipelineLayout(VulkanRHI::get().getDevice(), &pipeline_layout_ci, nullptr, &m_pipeline_layouts[0]);
+		CHECK_VULKAN_RESULT(result, "create culling pipeline layout");
+
+		push_constant_range.size = sizeof(HiZPCO);
+		pipeline_layout_ci.pSetLayouts = &m_desc_set_layouts[1];
+		result = vkCreatePipelineLayout(VulkanRHI::get().getDevice(), &pipeline_layout_ci, nullptr, &m_pipeline_layouts[1]);
+		CHECK_VULKAN_RESULT(result, "create hi-z building pipeline layout");
+	}
+
+	void CullingPass::createPipelines()
+	{
+		const auto& shader_manager = g_engine.shaderManager();
+
+		VkComputePipelineCreateInfo compute_pipeline_ci{};
+		compute_pipeline_ci.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+		compute_pipeline_ci.stage = shader_manager->getShaderStageCI("cull.comp", VK_SHADER_STAGE_COMPUTE_BIT);
+		compute_pipeline_ci.layout = m_pipeline_layouts[0];
+
+		m_pending_pipelines.resize(2);
+		VkResult result = vkCreateComputePipelines(VulkanRHI::get().getDevice(), m_pipeline_cache, 1, &compute_pipeline_ci, nullptr, &m_pending_pipelines[0]);
+		CHECK_VULKAN_RESULT(result, "create culling compute pipeline");
+
+		compute_pipeline_ci.stage = shader_manager->getShaderStageCI("hiz_build.comp", VK_SHADER_STAGE_COMPUTE_BIT);
+		compute_pipeline_ci.layout = m_pipeline_layouts[1];
+		result = vkCreateComputePipelines(VulkanRHI::get().getDevice(), m_pipeline_cache, 1, &compute_pipeline_ci, nullptr, &m_pending_pipelines[1]);
+		CHECK_VULKAN_RESULT(result, "create hi-z building compute pipeline");
+	}
+
+	void CullingPass::createResizableObjects(uint32_t width, uint32_t height)
+	{
+		RenderPass::createResizableObjects(width, height);
+
+		// create hi-z pyramid, mip 0 has the same size as the depth texture
+		m_mip_levels = VulkanUtil::calcMipLevel(width, height);
+		VulkanUtil::createImageAndView(width, height, m_mip_levels, 1, VK_SAMPLE_COUNT_1_BIT, m_format,
+			VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE,
+			VK_IMAGE_ASPECT_COLOR_BIT, m_hiz_image_view);
+		VulkanUtil::transitionImageLayout(m_hiz_image_view.image(), VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL, m_format, m_mip_levels);
+
+		// create one storage view per mip
+		m_hiz_mip_views.resize(m_mip_levels);
+		for (uint32_t i = 0; i < m_mip_levels; ++i)
+		{
+			VkImageViewCreateInfo image_view_ci{};
+			image_view_ci.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+			image_view_ci.image = m_hiz_image_view.image();
+			image_view_ci.viewType = VK_IMAGE_VIEW_TYPE_2D;
+			image_view_ci.format = m_format;
+			image_view_ci.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+			image_view_ci.subresourceRange.baseMipLevel = i;
+			image_view_ci.subresourceRange.levelCount = 1;
+			image_view_ci.subresourceRange.baseArrayLayer = 0;
+			image_view_ci.subresourceRange.layerCount = 1;
+			vkCreateImageView(VulkanRHI::get().getDevice(), &image_view_ci, nullptr, &m_hiz_mip_views[i]);
+		}
+
+		// depth values must not be filtered across texels
+		m_hiz_sampler = VulkanUtil::createSampler(VK_FILTER_NEAREST, VK_FILTER_NEAREST, m_mip_levels, 
+			VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE, VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE, VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE);
+
+		// create a depth only view, stencil aspect can't be sampled together with depth
+		if (m_depth_texture && m_depth_texture->view != VK_NULL_HANDLE)
+		{
+			m_depth_view = VulkanUtil::createImageView(m_depth_texture->vma_image.image, VulkanRHI::get().getDepthFormat(), 
+				VK_IMAGE_ASPECT_DEPTH_BIT, 1, 1);
+		}
+
+		// the new pyramid has no depth until the next main pass is rendered
+		m_hiz_valid = false;
+	}
+
+	void CullingPass::destroyResizableObjects()
+	{
+		for (VkImageView hiz_mip_view : m_hiz_mip_views)
+		{
+			vkDestroyImageView(VulkanRHI::get().getDevice(), hiz_mip_view, nullptr);
+		}
+		m_hiz_mip_views.clear();
+		m_hiz_image_view.destroy();
+
+		if (m_hiz_sampler)
+		{
+			vkDestroySampler(VulkanRHI::get().getDevice(), m_hiz_sampler, nullptr);
+			m_hiz_sampler = VK_NULL_HANDLE;
+		}
+
+		if (m_depth_view)
+		{
+			vkDestroyImageView(VulkanRHI::get().getDevice(), m_depth_view, nullptr);
+			m_depth_view = VK_NULL_HANDLE;
+		}
+
+		RenderPass::destroyResizableObjects();
+	}
+
+	bool CullingPass::isEnabled()
+	{
+		return RenderPass::isEnabled() && m_depth_view != VK_NULL_HANDLE;
+	}
+
+}
\ No newline at end of file
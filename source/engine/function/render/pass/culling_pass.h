@@ -0,0 +1,53 @@
+#pragma once
+
+#include "render_pass.h"
+#include "engine/function/render/gpu_scene.h"
+
+namespace Bamboo
+{
+	class CullingPass : public RenderPass
+	{
+	public:
+		CullingPass();
+
+		virtual void init() override;
+		virtual void render() override;
+
+		virtual void createRenderPass() override {}
+		virtual void createDescriptorSetLayouts() override;
+		virtual void createPipelineLayouts() override;
+		virtual void createPipelines() override;
+		virtual void createFramebuffer() override {}
+		virtual void createResizableObjects(uint32_t width, uint32_t height) override;
+		virtual void destroyResizableObjects() override;
+
+		virtual bool isEnabled() override;
+
+		void setDepthTexture(const VmaImageViewSampler* depth_texture) { m_depth_texture = depth_texture; }
+
+		// lods of all views are selected by their screen size from the main camera, shadow views have their own bias
+		void setLODCamera(const glm::vec3& position, float fovy, float lod_bias, float shadow_lod_bias);
+
+		// cull the gpu scene's objects against the view frustum and the last frame's hi-z pyramid, select their lods,
+		// then compact the visible ones into the view's indirect commands, must be recorded outside of render passes
+		void cull(VkCommandBuffer command_buffer, const GPUScene& gpu_scene, GPUSceneView& gpu_scene_view,
+			const glm::mat4& view_proj, uint32_t cull_flags, bool is_shadow_view = false);
+
+	private:
+		VkFormat m_format;
+		VmaImageView m_hiz_image_view;
+		std::vector<VkImageView> m_hiz_mip_views;
+		VkSampler m_hiz_sampler = VK_NULL_HANDLE;
+		uint32_t m_mip_levels = 0;
+		bool m_hiz_valid = false;
+
+		// depth only view of the main pass's depth stencil texture
+		const VmaImageViewSampler* m_depth_texture = nullptr;
+		VkImageView m_depth_view = VK_NULL_HANDLE;
+
+		glm::vec3 m_lod_camera_position = glm::vec3(0.0f);
+		float m_lod_scale = 1.0f;
+		float m_lod_bias = 0.0f;
+		float m_shadow_lod_bias = 0.0f;
+	};
+}
\ No newline at end of file
@@ -1,4 +1,5 @@
 #include "directional_light_shadow_pass.h"
+#include "culling_pass.h"
 #include "engine/core/vulkan/vulkan_rhi.h"
 #include "engine/resource/shader/shader_manager.h"
 #include "engine/resource/asset/base/mesh.h"
@@ -6,130 +7,165 @@
 
 namespace Bamboo
 {
+	// far cascades are rendered every few frames at staggered phases, so at most two cascades are rendered per frame
+	const uint32_t k_cascade_update_intervals[SHADOW_CASCADE_NUM] = { 1, 2, 4, 8 };
+
+	// throttled cascades cover a slightly larger sphere, so the camera can move before they have to be rendered early
+	const float k_throttled_cascade_padding = 1.1f;
 
 	DirectionalLightShadowPass::DirectionalLightShadowPass()
 	{
 		m_format = VulkanRHI::get().getDepthFormat();
 		m_size = 2048;
-		m_cascade_split_lambda = 0.95f;
 	}
 
 	void DirectionalLightShadowPass::init()
 	{
 		RenderPass::init();
-
-		// create shadow cascade uniform buffers
-		m_shadow_cascade_ubs.resize(MAX_FRAMES_IN_FLIGHT);
-		for (VmaBuffer& uniform_buffer : m_shadow_cascade_ubs)
-		{
-			VulkanUtil::createBuffer(sizeof(ShadowCascadeUBO), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VMA_MEMORY_USAGE_AUTO_PREFER_HOST, uniform_buffer);
-		}
-
 		createResizableObjects(m_size, m_size);
 	}
 
 	void DirectionalLightShadowPass::render()
 	{
-		VkRenderPassBeginInfo render_pass_bi{};
-		render_pass_bi.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-		render_pass_bi.renderPass = m_render_pass;
-		render_pass_bi.framebuffer = m_framebuffer;
-		render_pass_bi.renderArea.offset = { 0, 0 };
-		render_pass_bi.renderArea.extent = { m_size, m_size };
-
-		VkClearValue clear_value{};
-		clear_value.depthStencil = { 1.0f, 0 };
-		render_pass_bi.clearValueCount = 1;
-		render_pass_bi.pClearValues = &clear_value;
-
- 		VkCommandBuffer command_buffer = VulkanRHI::get().getCommandBuffer();
- 		uint32_t flight_index = VulkanRHI::get().getFlightIndex();
-
-		vkCmdBeginRenderPass(command_buffer, &render_pass_bi, VK_SUBPASS_CONTENTS_INLINE);
-
-		VkViewport viewport{};
-		viewport.x = 0.0f;
-		viewport.y = 0.0f;
-		viewport.width = static_cast<float>(m_size);
-		viewport.height = static_cast<float>(m_size);
-		viewport.minDepth = 0.0f;
-		viewport.maxDepth = 1.0f;
-		vkCmdSetViewport(command_buffer, 0, 1, &viewport);
-
-		VkRect2D scissor{};
-		scissor.offset = { 0, 0 };
-		scissor.extent = { m_size, m_size };
-		vkCmdSetScissor(command_buffer, 0, 1, &scissor);
-
-		for (const auto& render_data : m_render_datas)
+		VkCommandBuffer command_buffer = VulkanRHI::get().getCommandBuffer();
+
+		// build a draw list per updated cascade from the casters intersecting its frustum and cull the gpu scene into its view,
+		// culling has to be recorded before any cascade's render pass begins
+		m_draw_stats.reset();
+		std::vector<std::shared_ptr<RenderData>> cascade_render_datas;
+		for (uint32_t c = 0; c < SHADOW_CASCADE_NUM; ++c)
 		{
-			std::shared_ptr<SkeletalMeshRenderData> skeletal_mesh_render_data = nullptr;
-			std::shared_ptr<StaticMeshRenderData> static_mesh_render_data = std::static_pointer_cast<StaticMeshRenderData>(render_data);
-			bool is_skeletal_mesh = render_data->type == ERenderDataType::SkeletalMesh;
-			if (is_skeletal_mesh)
+			if (!m_cascades[c].dirty)
 			{
-				skeletal_mesh_render_data = std::static_pointer_cast<SkeletalMeshRenderData>(render_data);
+				continue;
 			}
 
-			uint32_t pipeline_index = (uint32_t)is_skeletal_mesh;
-			VkPipeline pipeline = m_pipelines[pipeline_index];
-			VkPipelineLayout pipeline_layout = m_pipeline_layouts[pipeline_index];
-
-			// bind pipeline
-			vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+			const glm::mat4& cascade_view_proj = m_cascade_view_projs[c];
+			DrawList::cullRenderDatas(m_render_datas, cascade_view_proj, cascade_render_datas);
+			m_draw_lists[c].build(cascade_render_datas, EDrawPass::DirectionalLightShadow);
 
-			// bind vertex and index buffer
-			VkBuffer vertexBuffers[] = { static_mesh_render_data->vertex_buffer.buffer };
-			VkDeviceSize offsets[] = { 0 };
-			vkCmdBindVertexBuffers(command_buffer, 0, 1, vertexBuffers, offsets);
-			vkCmdBindIndexBuffer(command_buffer, static_mesh_render_data->index_buffer.buffer, 0, VK_INDEX_TYPE_UINT32);
-
-			// render all sub meshes
-			std::vector<uint32_t>& index_counts = static_mesh_render_data->index_counts;
-			std::vector<uint32_t>& index_offsets = static_mesh_render_data->index_offsets;
-			size_t sub_mesh_count = index_counts.size();
-			for (size_t i = 0; i < sub_mesh_count; ++i)
+			if (m_culling_pass && m_gpu_scene)
 			{
-				// push constants
-				updatePushConstants(command_buffer, pipeline_layout, { &static_mesh_render_data->transform_pco });
+				m_culling_pass->cull(command_buffer, *m_gpu_scene, m_scene_views[c], cascade_view_proj, CULL_FLAG_FRUSTUM, true);
+			}
+		}
 
-				// update(push) sub mesh descriptors
-				std::vector<VkWriteDescriptorSet> desc_writes;
-				std::array<VkDescriptorBufferInfo, 2> desc_buffer_infos{};
-				std::array<VkDescriptorImageInfo, 1> desc_image_infos{};
+		// the layers of the other cascades keep their depth
+		for (uint32_t c = 0; c < SHADOW_CASCADE_NUM; ++c)
+		{
+			if (!m_cascades[c].dirty)
+			{
+				continue;
+			}
 
-				// bone matrix ubo
+			VkRenderPassBeginInfo render_pass_bi{};
+			render_pass_bi.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+			render_pass_bi.renderPass = m_render_pass;
+			render_pass_bi.framebuffer = m_cascade_framebuffers[c];
+			render_pass_bi.renderArea.offset = { 0, 0 };
+			render_pass_bi.renderArea.extent = { m_size, m_size };
+
+			VkClearValue clear_value{};
+			clear_value.depthStencil = { 1.0f, 0 };
+			render_pass_bi.clearValueCount = 1;
+			render_pass_bi.pClearValues = &clear_value;
+
+			vkCmdBeginRenderPass(command_buffer, &render_pass_bi, VK_SUBPASS_CONTENTS_INLINE);
+
+			VkViewport viewport{};
+			viewport.x = 0.0f;
+			viewport.y = 0.0f;
+			viewport.width = static_cast<float>(m_size);
+			viewport.height = static_cast<float>(m_size);
+			viewport.minDepth = 0.0f;
+			viewport.maxDepth = 1.0f;
+			vkCmdSetViewport(command_buffer, 0, 1, &viewport);
+
+			VkRect2D scissor{};
+			scissor.offset = { 0, 0 };
+			scissor.extent = { m_size, m_size };
+			vkCmdSetScissor(command_buffer, 0, 1, &scissor);
+
+			// the bound state is tracked per render pass instance
+			DrawStateCache draw_state_cache(command_buffer, m_draw_stats);
+			const DrawList& draw_list = m_draw_lists[c];
+			const glm::mat4& cascade_view_proj = m_cascade_view_projs[c];
+
+			for (const DrawItem& draw_item : draw_list.getItems())
+			{
+				StaticMeshRenderData* static_mesh_render_data = draw_item.render_data;
+				SkeletalMeshRenderData* skeletal_mesh_render_data = nullptr;
+				bool is_skeletal_mesh = static_mesh_render_data->type == ERenderDataType::SkeletalMesh;
 				if (is_skeletal_mesh)
 				{
-					addBufferDescriptorSet(desc_writes, desc_buffer_infos[0], skeletal_mesh_render_data->bone_ubs[flight_index], 0);
+					skeletal_mesh_render_data = static_cast<SkeletalMeshRenderData*>(static_mesh_render_data);
 				}
 
-				// shadow cascade ubo
-				addBufferDescriptorSet(desc_writes, desc_buffer_infos[1], m_shadow_cascade_ubs[flight_index], 1);
-	
-				// base color texture image sampler
-				addImageDescriptorSet(desc_writes, desc_image_infos[0], static_mesh_render_data->pbr_textures[i].base_color_texure, 2);
+				uint32_t pipeline_index = (uint32_t)is_skeletal_mesh;
+				VkPipeline pipeline = m_pipelines[pipeline_index];
+				VkPipelineLayout pipeline_layout = m_pipeline_layouts[pipeline_index];
+
+				// bind pipeline, vertex and index buffer if changed
+				draw_state_cache.bindPipeline(pipeline);
+				draw_state_cache.bindVertexBuffer(static_mesh_render_data->vertex_buffer.buffer);
+				draw_state_cache.bindIndexBuffer(static_mesh_render_data->index_buffer.buffer, static_mesh_render_data->index_type);
+
+				// push constants
+				uint32_t i = draw_item.sub_mesh_index;
+				TransformPCO transform_pco = is_skeletal_mesh ? static_mesh_render_data->transform_pco : DrawList::makeInstanceTransformPCO(cascade_view_proj);
+				transform_pco.mvp = cascade_view_proj * transform_pco.m;
+				updatePushConstants(command_buffer, pipeline_layout, { &transform_pco });
+
+				// update(push) sub mesh descriptors if changed
+				VmaBufferRange mesh_buffer = is_skeletal_mesh ? skeletal_mesh_render_data->bone_ub : draw_list.getInstanceBuffer().range();
+				if (draw_state_cache.needPushDescriptors(pipeline_layout, static_mesh_render_data->pbr_textures[i], mesh_buffer))
+				{
+					std::vector<VkWriteDescriptorSet> desc_writes;
+					std::array<VkDescriptorBufferInfo, 1> desc_buffer_infos{};
+					std::array<VkDescriptorImageInfo, 1> desc_image_infos{};
 
-				VulkanRHI::get().getVkCmdPushDescriptorSetKHR()(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
-					pipeline_layout, 0, static_cast<uint32_t>(desc_writes.size()), desc_writes.data());
+					// bone matrix ubo or instance ssbo
+					addBufferDescriptorSet(desc_writes, desc_buffer_infos[0], mesh_buffer, 0,
+						is_skeletal_mesh ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER);
 
-				// render sub mesh
-				vkCmdDrawIndexed(command_buffer, index_counts[i], 1, index_offsets[i], 0, 0);
+					// base color texture image sampler
+					addImageDescriptorSet(desc_writes, desc_image_infos[0], static_mesh_render_data->pbr_textures[i].base_color_texure, 1);
+
+					VulkanRHI::get().getVkCmdPushDescriptorSetKHR()(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+						pipeline_layout, 0, static_cast<uint32_t>(desc_writes.size()), desc_writes.data());
+				}
+
+				// render sub mesh instances
+				draw_state_cache.drawIndexed(draw_item);
+			}
+
+			if (m_gpu_scene)
+			{
+				renderGPUSceneDepth(draw_state_cache, m_scene_views[c], cascade_view_proj);
 			}
+
+			vkCmdEndRenderPass(command_buffer);
 		}
 
-		vkCmdEndRenderPass(command_buffer);
 		m_render_datas.clear();
+		m_gpu_scene.reset();
+		for (uint32_t c = 0; c < SHADOW_CASCADE_NUM; ++c)
+		{
+			m_draw_lists[c].clear();
+			m_cascades[c].dirty = false;
+		}
 	}
 
 	void DirectionalLightShadowPass::destroy()
 	{
 		RenderPass::destroy();
-
-		// destroy shadow cascade uniform buffers
-		for (VmaBuffer& uniform_buffer : m_shadow_cascade_ubs)
+		for (DrawList& draw_list : m_draw_lists)
+		{
+			draw_list.destroy();
+		}
+		for (GPUSceneView& scene_view : m_scene_views)
 		{
-			uniform_buffer.destroy();
+			scene_view.destroy();
 		}
 	}
 
@@ -187,8 +223,8 @@ namespace Bamboo
 	void DirectionalLightShadowPass::createDescriptorSetLayouts()
 	{
 		std::vector<VkDescriptorSetLayoutBinding> desc_set_layout_bindings = {
-			{1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_GEOMETRY_BIT, nullptr},
-			{2, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr}
+			{0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT, nullptr},
+			{1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr}
 		};
 
 		VkDescriptorSetLayoutCreateInfo desc_set_layout_ci{};
@@ -201,9 +237,7 @@ namespace Bamboo
 		VkResult result = vkCreateDescriptorSetLayout(VulkanRHI::get().getDevice(), &desc_set_layout_ci, nullptr, &m_desc_set_layouts[0]);
 		CHECK_VULKAN_RESULT(result, "create static mesh descriptor set layout");
 
-		desc_set_layout_bindings.insert(desc_set_layout_bindings.begin(), { 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT, nullptr });
-		desc_set_layout_ci.bindingCount = static_cast<uint32_t>(desc_set_layout_bindings.size());
-		desc_set_layout_ci.pBindings = desc_set_layout_bindings.data(); 
+		desc_set_layout_bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
 		result = vkCreateDescriptorSetLayout(VulkanRHI::get().getDevice(), &desc_set_layout_ci, nullptr, &m_desc_set_layouts[1]);
 		CHECK_VULKAN_RESULT(result, "create skeletal mesh descriptor set layout");
 	}
@@ -238,27 +272,11 @@ namespace Bamboo
 		std::vector<VkVertexInputBindingDescription> vertex_input_binding_descriptions;
 		vertex_input_binding_descriptions.resize(1, VkVertexInputBindingDescription{});
 		vertex_input_binding_descriptions[0].binding = 0;
-		vertex_input_binding_descriptions[0].stride = sizeof(StaticVertex);
+		vertex_input_binding_descriptions[0].stride = Mesh::getVertexStride(false);
 		vertex_input_binding_descriptions[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
 
 		// static mesh vertex attributes
-		std::vector<VkVertexInputAttributeDescription> vertex_input_attribute_descriptions;
-		vertex_input_attribute_descriptions.resize(3, VkVertexInputAttributeDescription{});
-
-		vertex_input_attribute_descriptions[0].binding = 0;
-		vertex_input_attribute_descriptions[0].location = 0;
-		vertex_input_attribute_descriptions[0].format = VK_FORMAT_R32G32B32_SFLOAT;
-		vertex_input_attribute_descriptions[0].offset = offsetof(StaticVertex, m_position);
-
-		vertex_input_attribute_descriptions[1].binding = 0;
-		vertex_input_attribute_descriptions[1].location = 1;
-		vertex_input_attribute_descriptions[1].format = VK_FORMAT_R32G32_SFLOAT;
-		vertex_input_attribute_descriptions[1].offset = offsetof(StaticVertex, m_tex_coord);
-
-		vertex_input_attribute_descriptions[2].binding = 0;
-		vertex_input_attribute_descriptions[2].location = 2;
-		vertex_input_attribute_descriptions[2].format = VK_FORMAT_R32G32B32_SFLOAT;
-		vertex_input_attribute_descriptions[2].offset = offsetof(StaticVertex, m_normal);
+		std::vector<VkVertexInputAttributeDescription> vertex_input_attribute_descriptions = Mesh::getVertexInputAttributeDescriptions(false);
 
 		VkPipelineVertexInputStateCreateInfo vertex_input_ci{};
 		vertex_input_ci.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
@@ -270,8 +288,7 @@ namespace Bamboo
 		// shader stages
 		const auto& shader_manager = g_engine.shaderManager();
 		std::vector<VkPipelineShaderStageCreateInfo> shader_stage_cis = {
-			shader_manager->getShaderStageCI("static_mesh.vert", VK_SHADER_STAGE_VERTEX_BIT),
-			shader_manager->getShaderStageCI("directional_light_shadow.geom", VK_SHADER_STAGE_GEOMETRY_BIT),
+			shader_manager->getShaderStageCI("static_mesh_instance.vert", VK_SHADER_STAGE_VERTEX_BIT),
 			shader_manager->getShaderStageCI("directional_light_shadow.frag", VK_SHADER_STAGE_FRAGMENT_BIT)
 		};
 
@@ -283,30 +300,20 @@ namespace Bamboo
 		m_pipeline_ci.renderPass = m_render_pass;
 		m_pipeline_ci.subpass = 0;
 
-		m_pipelines.resize(2);
-		VkResult result = vkCreateGraphicsPipelines(VulkanRHI::get().getDevice(), m_pipeline_cache, 1, &m_pipeline_ci, nullptr, &m_pipelines[0]);
+		m_pending_pipelines.resize(2);
+		VkResult result = vkCreateGraphicsPipelines(VulkanRHI::get().getDevice(), m_pipeline_cache, 1, &m_pipeline_ci, nullptr, &m_pending_pipelines[0]);
 		CHECK_VULKAN_RESULT(result, "create directional light shadow pass's static mesh graphics pipeline");
 
 		// skeletal mesh vertex attributes
-		vertex_input_binding_descriptions[0].stride = sizeof(SkeletalVertex);
-
-		vertex_input_attribute_descriptions.resize(5);
-		vertex_input_attribute_descriptions[3].binding = 0;
-		vertex_input_attribute_descriptions[3].location = 3;
-		vertex_input_attribute_descriptions[3].format = VK_FORMAT_R32G32B32A32_SINT;
-		vertex_input_attribute_descriptions[3].offset = offsetof(SkeletalVertex, m_bones);
-
-		vertex_input_attribute_descriptions[4].binding = 0;
-		vertex_input_attribute_descriptions[4].location = 4;
-		vertex_input_attribute_descriptions[4].format = VK_FORMAT_R32G32B32A32_SFLOAT;
-		vertex_input_attribute_descriptions[4].offset = offsetof(SkeletalVertex, m_weights);
+		vertex_input_binding_descriptions[0].stride = Mesh::getVertexStride(true);
+		vertex_input_attribute_descriptions = Mesh::getVertexInputAttributeDescriptions(true);
 
 		vertex_input_ci.vertexAttributeDescriptionCount = static_cast<uint32_t>(vertex_input_attribute_descriptions.size());
 		vertex_input_ci.pVertexAttributeDescriptions = vertex_input_attribute_descriptions.data();
 
 		m_pipeline_ci.layout = m_pipeline_layouts[1];
 		shader_stage_cis[0] = shader_manager->getShaderStageCI("skeletal_mesh.vert", VK_SHADER_STAGE_VERTEX_BIT);
-		result = vkCreateGraphicsPipelines(VulkanRHI::get().getDevice(), m_pipeline_cache, 1, &m_pipeline_ci, nullptr, &m_pipelines[1]);
+		result = vkCreateGraphicsPipelines(VulkanRHI::get().getDevice(), m_pipeline_cache, 1, &m_pipeline_ci, nullptr, &m_pending_pipelines[1]);
 		CHECK_VULKAN_RESULT(result, "create directional light shadow pass's static mesh graphics pipeline");
 	}
 
@@ -317,22 +324,44 @@ namespace Bamboo
 			VK_FILTER_LINEAR, VK_FILTER_LINEAR, VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE, m_shadow_image_view_sampler,
 			VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT);
 
-		// create framebuffer
-		VkFramebufferCreateInfo framebuffer_ci{};
-		framebuffer_ci.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-		framebuffer_ci.renderPass = m_render_pass;
-		framebuffer_ci.attachmentCount = 1;
-		framebuffer_ci.pAttachments = &m_shadow_image_view_sampler.view;
-		framebuffer_ci.width = m_size;
-		framebuffer_ci.height = m_size;
-		framebuffer_ci.layers = SHADOW_CASCADE_NUM;
-
-		VkResult result = vkCreateFramebuffer(VulkanRHI::get().getDevice(), &framebuffer_ci, nullptr, &m_framebuffer);
-		CHECK_VULKAN_RESULT(result, "create directional light shadow framebuffer");
+		for (uint32_t c = 0; c < SHADOW_CASCADE_NUM; ++c)
+		{
+			// create a depth view of the cascade's layer
+			VkImageViewCreateInfo image_view_ci{};
+			image_view_ci.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+			image_view_ci.image = m_shadow_image_view_sampler.image();
+			image_view_ci.viewType = VK_IMAGE_VIEW_TYPE_2D;
+			image_view_ci.format = m_format;
+			image_view_ci.subresourceRange.aspectMask = VulkanUtil::calcImageAspectFlags(m_format);
+			image_view_ci.subresourceRange.baseMipLevel = 0;
+			image_view_ci.subresourceRange.levelCount = 1;
+			image_view_ci.subresourceRange.baseArrayLayer = c;
+			image_view_ci.subresourceRange.layerCount = 1;
+			VkResult result = vkCreateImageView(VulkanRHI::get().getDevice(), &image_view_ci, nullptr, &m_cascade_views[c]);
+			CHECK_VULKAN_RESULT(result, "create directional light shadow cascade image view");
+
+			// create framebuffer
+			VkFramebufferCreateInfo framebuffer_ci{};
+			framebuffer_ci.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+			framebuffer_ci.renderPass = m_render_pass;
+			framebuffer_ci.attachmentCount = 1;
+			framebuffer_ci.pAttachments = &m_cascade_views[c];
+			framebuffer_ci.width = m_size;
+			framebuffer_ci.height = m_size;
+			framebuffer_ci.layers = 1;
+
+			result = vkCreateFramebuffer(VulkanRHI::get().getDevice(), &framebuffer_ci, nullptr, &m_cascade_framebuffers[c]);
+			CHECK_VULKAN_RESULT(result, "create directional light shadow framebuffer");
+		}
 	}
 
 	void DirectionalLightShadowPass::destroyResizableObjects()
 	{
+		for (uint32_t c = 0; c < SHADOW_CASCADE_NUM; ++c)
+		{
+			vkDestroyFramebuffer(VulkanRHI::get().getDevice(), m_cascade_framebuffers[c], nullptr);
+			vkDestroyImageView(VulkanRHI::get().getDevice(), m_cascade_views[c], nullptr);
+		}
 		m_shadow_image_view_sampler.destroy();
 
 		RenderPass::destroyResizableObjects();
@@ -340,26 +369,30 @@ namespace Bamboo
 
 	void DirectionalLightShadowPass::updateCascades(const ShadowCascadeCreateInfo& shadow_cascade_ci)
 	{
-		float cascade_splits[SHADOW_CASCADE_NUM];
-
 		float near = shadow_cascade_ci.camera_near;
 		float far = shadow_cascade_ci.camera_far;
-		float cascade_frustum_near = shadow_cascade_ci.light_cascade_frustum_near;
 		float range = far - near;
-
-		float min_z = near;
-		float max_z = near + range;
-
-		float range_z = max_z - min_z;
-		float ratio = max_z / min_z;
+		float ratio = far / near;
+
+		// all cascades are rendered again if anything but the camera transform changed
+		bool invalidated = m_frame_index == 0 || shadow_cascade_ci.light_dir != m_light_dir || shadow_cascade_ci.light_cast_shadow != m_light_cast_shadow ||
+			shadow_cascade_ci.light_cascade_frustum_near != m_cascade_frustum_near || shadow_cascade_ci.cascade_split_lambda != m_cascade_split_lambda ||
+			near != m_camera_near || far != m_camera_far;
+		m_light_dir = shadow_cascade_ci.light_dir;
+		m_light_cast_shadow = shadow_cascade_ci.light_cast_shadow;
+		m_cascade_frustum_near = shadow_cascade_ci.light_cascade_frustum_near;
+		m_cascade_split_lambda = shadow_cascade_ci.cascade_split_lambda;
+		m_camera_near = near;
+		m_camera_far = far;
 
 		// Calculate split depths based on view camera frustum
 		// Based on method presented in https://developer.nvidia.com/gpugems/GPUGems3/gpugems3_ch10.html
+		float cascade_splits[SHADOW_CASCADE_NUM];
 		for (uint32_t i = 0; i < SHADOW_CASCADE_NUM; ++i) 
 		{
 			float p = (i + 1) / static_cast<float>(SHADOW_CASCADE_NUM);
-			float log = min_z * std::pow(ratio, p);
-			float uniform = min_z + range_z * p;
+			float log = near * std::pow(ratio, p);
+			float uniform = near + range * p;
 			float d = m_cascade_split_lambda * (log - uniform) + uniform;
 			cascade_splits[i] = (d - near) / range;
 		}
@@ -394,6 +427,8 @@ namespace Bamboo
 				frustum_corners[i + 4] = frustum_corners[i] + (dist * cascade_split);
 				frustum_corners[i] = frustum_corners[i] + (dist * last_cascade_split);
 			}
+			m_cascade_splits[c] = -(near + cascade_split * range);
+			last_cascade_split = cascade_split;
 
 			// Get frustum center
 			glm::vec3 frustum_center = glm::vec3(0.0f);
@@ -403,6 +438,7 @@ namespace Bamboo
 			}
 			frustum_center /= 8.0f;
 
+			// the bounding sphere keeps the cascade's size independent of the camera rotation
 			float radius = 0.0f;
 			for (uint32_t i = 0; i < 8; ++i) 
 			{
@@ -410,20 +446,37 @@ namespace Bamboo
 				radius = std::max(radius, distance);
 			}
 
+			// render the cascade on its scheduled frames, or earlier if its slice left the sphere it was rendered for
+			Cascade& cascade = m_cascades[c];
+			uint32_t update_interval = k_cascade_update_intervals[c];
+			bool scheduled = m_frame_index % update_interval == update_interval / 2;
+			bool uncovered = glm::distance(frustum_center, cascade.center) + radius > cascade.radius;
+			if (!invalidated && !scheduled && !uncovered)
+			{
+				continue;
+			}
+
+			// quantize the radius, so the texel size doesn't change with floating point noise
+			radius = std::ceil(radius * (update_interval > 1 ? k_throttled_cascade_padding : 1.0f) * 16.0f) / 16.0f;
+			cascade.center = frustum_center;
+			cascade.radius = radius;
+			cascade.dirty = true;
+
 			glm::mat4 light_view = glm::lookAtRH(frustum_center - shadow_cascade_ci.light_dir * radius, frustum_center, k_up_vector);
-			glm::mat4 light_proj = glm::orthoRH_ZO(-radius, radius, -radius, radius, cascade_frustum_near, radius * 2.0f);
+			glm::mat4 light_proj = glm::orthoRH_ZO(-radius, radius, -radius, radius, m_cascade_frustum_near, radius * 2.0f);
 			light_proj[1][1] *= -1.0f;
 
-			// Store split distance and matrix in cascade
-			m_shadow_cascade_ubo.cascade_view_projs[c] = light_proj * light_view;
-			m_cascade_splits[c] = -(near + cascade_split * range);
+			// snap the projection to whole shadow map texels, so static shadows don't shimmer when the camera moves
+			glm::vec4 shadow_origin = light_proj * light_view * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+			shadow_origin *= m_size * 0.5f;
+			glm::vec2 texel_offset = (glm::round(glm::vec2(shadow_origin)) - glm::vec2(shadow_origin)) * (2.0f / m_size);
+			light_proj[3][0] += texel_offset.x;
+			light_proj[3][1] += texel_offset.y;
 
-			last_cascade_split = cascade_split;
+			m_cascade_view_projs[c] = light_proj * light_view;
 		}
 
-		// update uniform buffers
-		VmaBuffer uniform_buffer = m_shadow_cascade_ubs[VulkanRHI::get().getFlightIndex()];
-		VulkanUtil::updateBuffer(uniform_buffer, (void*)&m_shadow_cascade_ubo, sizeof(ShadowCascadeUBO));
+		m_frame_index++;
 	}
 
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "render_pass.h"
+#include "engine/function/render/gpu_scene.h"
 
 namespace Bamboo
 {
@@ -23,15 +24,39 @@ namespace Bamboo
 		void updateCascades(const ShadowCascadeCreateInfo& shadow_cascade_ci);
 		VmaImageViewSampler getShadowImageViewSampler() { return m_shadow_image_view_sampler; }
 
-		ShadowCascadeUBO m_shadow_cascade_ubo;
+		glm::mat4 m_cascade_view_projs[SHADOW_CASCADE_NUM];
 		float m_cascade_splits[SHADOW_CASCADE_NUM];
 
 	private:
+		struct Cascade
+		{
+			// world space sphere the cascade was last rendered for
+			glm::vec3 center = glm::vec3(0.0f);
+			float radius = 0.0f;
+
+			// the cascade is rendered this frame
+			bool dirty = false;
+		};
+
 		VkFormat m_format;
 		uint32_t m_size;
-		float m_cascade_split_lambda;
 
+		std::array<Cascade, SHADOW_CASCADE_NUM> m_cascades;
+		uint32_t m_frame_index = 0;
+
+		// cascade inputs of the last update, the cascades are invalidated if they change
+		glm::vec3 m_light_dir = glm::vec3(0.0f);
+		bool m_light_cast_shadow = false;
+		float m_cascade_frustum_near = 0.0f;
+		float m_cascade_split_lambda = 0.0f;
+		float m_camera_near = 0.0f;
+		float m_camera_far = 0.0f;
+
+		// every cascade renders to its own layer with its own frustum culled draw list
 		VmaImageViewSampler m_shadow_image_view_sampler;
-		std::vector<VmaBuffer> m_shadow_cascade_ubs;
+		std::array<VkImageView, SHADOW_CASCADE_NUM> m_cascade_views{};
+		std::array<VkFramebuffer, SHADOW_CASCADE_NUM> m_cascade_framebuffers{};
+		std::array<DrawList, SHADOW_CASCADE_NUM> m_draw_lists;
+		std::array<GPUSceneView, SHADOW_CASCADE_NUM> m_scene_views;
 	};
 }
\ No newline at end of file
@@ -14,11 +14,15 @@
 namespace Bamboo
 {
 
+	// position_offset and position_scale dequantize the packed skybox cube positions in the vertex shader
 	struct IrradiancePCO
 	{
 		glm::mat4 mvp;
 		float delta_phi;
 		float delta_theta;
+		float padding[2];
+		glm::vec4 position_offset;
+		glm::vec4 position_scale;
 	};
 
 	struct PrefilterPCO
@@ -26,6 +30,9 @@ namespace Bamboo
 		glm::mat4 mvp;
 		float roughness;
 		uint32_t samples;
+		float padding[2];
+		glm::vec4 position_offset;
+		glm::vec4 position_scale;
 	};
 
 	FilterCubePass::FilterCubePass(std::shared_ptr<class TextureCube>& skybox_texture_cube)
@@ -47,6 +54,8 @@ namespace Bamboo
 	void FilterCubePass::init()
 	{
 		RenderPass::init();
+		buildPipelines();
+		commitPipelines();
 
 		createFramebuffer();
 	}
@@ -124,6 +133,8 @@ namespace Bamboo
 						irradiance_pco.mvp = mvp;
 						irradiance_pco.delta_phi = PI / 90.0f;
 						irradiance_pco.delta_theta = PI / 128.0f;
+						irradiance_pco.position_offset = glm::vec4(m_skybox_mesh->m_position_offset, 0.0f);
+						irradiance_pco.position_scale = glm::vec4(m_skybox_mesh->m_position_scale, 0.0f);
 						vkCmdPushConstants(command_buffer, m_pipeline_layouts[i], 
 							VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 
 							0, sizeof(IrradiancePCO), &irradiance_pco);
@@ -135,6 +146,8 @@ namespace Bamboo
 						prefilter_pco.mvp = mvp;
 						prefilter_pco.roughness = (float)m / (float)(m_mip_levels[i] - 1);
 						prefilter_pco.samples = 32;
+						prefilter_pco.position_offset = glm::vec4(m_skybox_mesh->m_position_offset, 0.0f);
+						prefilter_pco.position_scale = glm::vec4(m_skybox_mesh->m_position_scale, 0.0f);
 						vkCmdPushConstants(command_buffer, m_pipeline_layouts[i], 
 							VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 
 							0, sizeof(PrefilterPCO), &prefilter_pco);
@@ -159,7 +172,7 @@ namespace Bamboo
 					VkBuffer vertexBuffers[] = { m_skybox_mesh->m_vertex_buffer.buffer};
 					VkDeviceSize offsets[] = { 0 };
 					vkCmdBindVertexBuffers(command_buffer, 0, 1, vertexBuffers, offsets);
-					vkCmdBindIndexBuffer(command_buffer, m_skybox_mesh->m_index_buffer.buffer, 0, VK_INDEX_TYPE_UINT32);
+					vkCmdBindIndexBuffer(command_buffer, m_skybox_mesh->m_index_buffer.buffer, 0, m_skybox_mesh->m_index_type);
 
 					// draw indexed mesh
 					vkCmdDrawIndexed(command_buffer, m_skybox_mesh->m_sub_meshes[0].m_index_count, 1, m_skybox_mesh->m_sub_meshes[0].m_index_offset, 0, 0);
@@ -334,7 +347,7 @@ namespace Bamboo
 
 	void FilterCubePass::createPipelines()
 	{
-		m_pipelines.resize(2);
+		m_pending_pipelines.resize(2);
 
 		for (uint32_t i = 0; i < 2; ++i)
 		{
@@ -350,17 +363,12 @@ namespace Bamboo
 			std::vector<VkVertexInputBindingDescription> vertex_input_binding_descriptions;
 			vertex_input_binding_descriptions.resize(1, VkVertexInputBindingDescription{});
 			vertex_input_binding_descriptions[0].binding = 0;
-			vertex_input_binding_descriptions[0].stride = sizeof(StaticVertex);
+			vertex_input_binding_descriptions[0].stride = Mesh::getVertexStride(false);
 			vertex_input_binding_descriptions[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
 
-			// vertex attributes
-			std::vector<VkVertexInputAttributeDescription> vertex_input_attribute_descriptions;
-			vertex_input_attribute_descriptions.resize(1, VkVertexInputAttributeDescription{});
-
-			vertex_input_attribute_descriptions[0].binding = 0;
-			vertex_input_attribute_descriptions[0].location = 0;
-			vertex_input_attribute_descriptions[0].format = VK_FORMAT_R32G32B32_SFLOAT;
-			vertex_input_attribute_descriptions[0].offset = offsetof(StaticVertex, m_position);
+			// vertex attributes, only positions are read
+			std::vector<VkVertexInputAttributeDescription> vertex_input_attribute_descriptions = Mesh::getVertexInputAttributeDescriptions(false);
+			vertex_input_attribute_descriptions.resize(1);
 
 			VkPipelineVertexInputStateCreateInfo vertex_input_ci{};
 			vertex_input_ci.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
@@ -386,7 +394,7 @@ namespace Bamboo
 			m_pipeline_ci.renderPass = m_render_passes[i];
 			m_pipeline_ci.subpass = 0;
 
-			VkResult result = vkCreateGraphicsPipelines(VulkanRHI::get().getDevice(), m_pipeline_cache, 1, &m_pipeline_ci, nullptr, &m_pipelines[i]);
+			VkResult result = vkCreateGraphicsPipelines(VulkanRHI::get().getDevice(), m_pipeline_cache, 1, &m_pipeline_ci, nullptr, &m_pending_pipelines[i]);
 			CHECK_VULKAN_RESULT(result, "create brdf lut graphics pipeline");
 		}
 	}
@@ -1,4 +1,7 @@
 #include "main_pass.h"
+#include "culling_pass.h"
+#include "engine/function/render/bindless_manager.h"
+#include "engine/function/render/render_graph.h"
 #include "engine/core/vulkan/vulkan_rhi.h"
 #include "engine/resource/shader/shader_manager.h"
 #include "engine/resource/asset/asset_manager.h"
@@ -22,6 +25,22 @@ namespace Bamboo
 		};
 	}
 
+	void MainPass::destroy()
+	{
+		RenderPass::destroy();
+
+		// destroy material pipeline variants
+		for (const auto& iter : m_material_pipelines)
+		{
+			vkDestroyPipeline(VulkanRHI::get().getDevice(), iter.second, nullptr);
+		}
+
+		// destroy draw list instance buffers and the scene view's indirect buffers
+		m_deferred_draw_list.destroy();
+		m_forward_draw_list.destroy();
+		m_scene_view.destroy();
+	}
+
 	void MainPass::render()
 	{
 		VkRenderPassBeginInfo render_pass_bi{};
@@ -42,7 +61,19 @@ namespace Bamboo
 		render_pass_bi.pClearValues = clear_values.data();
 
 		VkCommandBuffer command_buffer = VulkanRHI::get().getCommandBuffer();
-		uint32_t flight_index = VulkanRHI::get().getFlightIndex();
+
+		// sort draw items and skip redundant state binds
+		m_draw_stats.reset();
+		m_deferred_draw_list.build(m_render_datas, EDrawPass::MainDeferred);
+		m_forward_draw_list.build(m_transparency_render_datas, EDrawPass::MainForward, true);
+
+		// cull the gpu scene's static meshes before the render pass begins
+		if (m_culling_pass && m_gpu_scene)
+		{
+			m_culling_pass->cull(command_buffer, *m_gpu_scene, m_scene_view, m_lighting_render_data->camera_view_proj,
+				CULL_FLAG_FRUSTUM | CULL_FLAG_OCCLUSION);
+		}
+
 		vkCmdBeginRenderPass(command_buffer, &render_pass_bi, VK_SUBPASS_CONTENTS_INLINE);
 
 		VkViewport viewport{};
@@ -60,45 +91,44 @@ namespace Bamboo
 		vkCmdSetScissor(command_buffer, 0, 1, &scissor);
 
 		// 1.deferred subpass
-		for (const auto& render_data : m_render_datas)
+		DrawStateCache deferred_draw_state_cache(command_buffer, m_draw_stats);
+		render_draw_list(m_deferred_draw_list, ERendererType::Deferred, deferred_draw_state_cache);
+		if (m_gpu_scene)
 		{
-			render_mesh(render_data, ERendererType::Deferred);
+			render_gpu_scene(deferred_draw_state_cache);
 		}
 
 		// 2.composition subpass
 		vkCmdNextSubpass(command_buffer, VK_SUBPASS_CONTENTS_INLINE);
 
-		if (!m_render_datas.empty())
+		if (!m_render_datas.empty() || (m_gpu_scene && !m_gpu_scene->empty()))
 		{
 			vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipelines[2]);
 
 			std::vector<VkWriteDescriptorSet> desc_writes;
-			std::array<VkDescriptorBufferInfo, 1> desc_buffer_infos{};
+			std::array<VkDescriptorBufferInfo, 6> desc_buffer_infos{};
 
-			// lighting uniform buffer
-			addBufferDescriptorSet(desc_writes, desc_buffer_infos[0], m_lighting_render_data->lighting_ubs[flight_index], 11);
+			// lighting uniform buffer, clustered light and shadow view storage buffers
+			addLightingDescriptorSets(desc_writes, desc_buffer_infos.data());
 
 			// input attachments and ibl textures
 			std::vector<VmaImageViewSampler> textures = {
-				m_normal_texture_sampler,
-				m_base_color_texture_sampler,
-				m_emissive_texture_sampler,
-				m_metallic_roughness_occlusion_texture_sampler,
+				m_render_graph->getImage(m_gbuffer_images[0]),
+				m_render_graph->getImage(m_gbuffer_images[1]),
+				m_render_graph->getImage(m_gbuffer_images[2]),
+				m_render_graph->getImage(m_gbuffer_images[3]),
 				m_depth_stencil_texture_sampler,
 				m_lighting_render_data->irradiance_texture,
 				m_lighting_render_data->prefilter_texture,
 				m_lighting_render_data->brdf_lut_texture,
-				m_lighting_render_data->directional_light_shadow_texture
+				m_lighting_render_data->directional_light_shadow_texture,
+				m_lighting_render_data->shadow_atlas_texture
 			};
-			std::vector<VmaImageViewSampler> point_light_shadow_textures = m_lighting_render_data->point_light_shadow_textures;
-			std::vector<VmaImageViewSampler> spot_light_shadow_textures = m_lighting_render_data->spot_light_shadow_textures;
-			std::vector<VkDescriptorImageInfo> desc_image_infos(textures.size() + point_light_shadow_textures.size() + spot_light_shadow_textures.size(), VkDescriptorImageInfo{});
+			std::vector<VkDescriptorImageInfo> desc_image_infos(textures.size(), VkDescriptorImageInfo{});
 			for (size_t i = 0; i < textures.size(); ++i)
 			{
 				addImageDescriptorSet(desc_writes, desc_image_infos[i], textures[i], i);
 			}
-			addImagesDescriptorSet(desc_writes, &desc_image_infos[textures.size()], point_light_shadow_textures, textures.size());
-			addImagesDescriptorSet(desc_writes, &desc_image_infos[textures.size() + point_light_shadow_textures.size()], spot_light_shadow_textures, textures.size() + 1);
 
 			VulkanRHI::get().getVkCmdPushDescriptorSetKHR()(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
 				m_pipeline_layouts[2], 0, static_cast<uint32_t>(desc_writes.size()), desc_writes.data());
@@ -108,20 +138,28 @@ namespace Bamboo
 		// 3.forward subpass
 		vkCmdNextSubpass(command_buffer, VK_SUBPASS_CONTENTS_INLINE);
 
-		// 3.1 debug draw
+		// 3.1 debug draw, depth tested lines first and overlay lines on top
 		const auto& ddm = g_engine.debugDrawSystem();
 		if (!ddm->empty())
 		{
-			vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipelines[6]);
-
-			// bind vertex and index buffer
+			// bind vertex buffer
 			VkBuffer vertexBuffers[] = { ddm->getVertexBuffer() };
 			VkDeviceSize offsets[] = { 0 };
 			vkCmdBindVertexBuffers(command_buffer, 0, 1, vertexBuffers, offsets);
 
-			// push constants
-			vkCmdPushConstants(command_buffer, m_pipeline_layouts[6], VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(glm::mat4), &m_lighting_render_data->camera_view_proj);
-			vkCmdDraw(command_buffer, ddm->getVertexCount(), 1, 0, 0);
+			if (ddm->getDepthVertexCount() > 0)
+			{
+				vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipelines[6]);
+				vkCmdPushConstants(command_buffer, m_pipeline_layouts[6], VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(glm::mat4), &m_lighting_render_data->camera_view_proj);
+				vkCmdDraw(command_buffer, ddm->getDepthVertexCount(), 1, 0, 0);
+			}
+
+			if (ddm->getOverlayVertexCount() > 0)
+			{
+				vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipelines[8]);
+				vkCmdPushConstants(command_buffer, m_pipeline_layouts[6], VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(glm::mat4), &m_lighting_render_data->camera_view_proj);
+				vkCmdDraw(command_buffer, ddm->getOverlayVertexCount(), 1, ddm->getDepthVertexCount(), 0);
+			}
 		}
 
 		// 3.2 render skybox
@@ -134,7 +172,7 @@ namespace Bamboo
 			VkBuffer vertexBuffers[] = { m_skybox_render_data->vertex_buffer.buffer };
 			VkDeviceSize offsets[] = { 0 };
 			vkCmdBindVertexBuffers(command_buffer, 0, 1, vertexBuffers, offsets);
-			vkCmdBindIndexBuffer(command_buffer, m_skybox_render_data->index_buffer.buffer, 0, VK_INDEX_TYPE_UINT32);
+			vkCmdBindIndexBuffer(command_buffer, m_skybox_render_data->index_buffer.buffer, 0, m_skybox_render_data->index_type);
 
 			// push constants
 			vkCmdPushConstants(command_buffer, m_pipeline_layouts[5], VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(TransformPCO), &m_skybox_render_data->transform_pco);
@@ -149,11 +187,9 @@ namespace Bamboo
 			vkCmdDrawIndexed(command_buffer, m_skybox_render_data->index_count, 1, 0, 0, 0);
 		}
 
-		// 3.3 render transparency meshes
-		for (const auto& render_data : m_transparency_render_datas)
-		{
-			render_mesh(render_data, ERendererType::Forward);
-		}
+		// 3.3 render transparency meshes, the debug draw and skybox pipelines above have changed the bound state
+		DrawStateCache forward_draw_state_cache(command_buffer, m_draw_stats);
+		render_draw_list(m_forward_draw_list, ERendererType::Forward, forward_draw_state_cache);
 
 		// 3.4 render billboards
 		vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipelines[7]);
@@ -276,13 +312,9 @@ namespace Bamboo
 
 	void MainPass::createDescriptorSetLayouts()
 	{
-		// gbuffer descriptor set layouts
+		// gbuffer descriptor set layouts, material textures are in the bindless descriptor set
 		std::vector<VkDescriptorSetLayoutBinding> desc_set_layout_bindings = {
-			{1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr},
-			{2, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr},
-			{3, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr},
-			{4, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr},
-			{5, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr},
+			{0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT, nullptr}
 		};
 
 		VkDescriptorSetLayoutCreateInfo desc_set_layout_ci{};
@@ -295,9 +327,7 @@ namespace Bamboo
 		VkResult result = vkCreateDescriptorSetLayout(VulkanRHI::get().getDevice(), &desc_set_layout_ci, nullptr, &m_desc_set_layouts[0]);
 		CHECK_VULKAN_RESULT(result, "create gbuffer static mesh descriptor set layout");
 
-		desc_set_layout_bindings.insert(desc_set_layout_bindings.begin(), { 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT, nullptr });
-		desc_set_layout_ci.bindingCount = static_cast<uint32_t>(desc_set_layout_bindings.size());
-		desc_set_layout_ci.pBindings = desc_set_layout_bindings.data();
+		desc_set_layout_bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
 		result = vkCreateDescriptorSetLayout(VulkanRHI::get().getDevice(), &desc_set_layout_ci, nullptr, &m_desc_set_layouts[1]);
 		CHECK_VULKAN_RESULT(result, "create gbuffer skeletal mesh descriptor set layout");
 
@@ -312,9 +342,13 @@ namespace Bamboo
 			{6, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr},
 			{7, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr},
 			{8, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr},
-			{9, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, MAX_POINT_LIGHT_NUM, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr},
-			{10, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, MAX_SPOT_LIGHT_NUM, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr},
+			{9, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr},
+			{10, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr},
 			{11, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr},
+			{12, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr},
+			{13, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr},
+			{14, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr},
+			{15, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr},
 		};
 
 		desc_set_layout_ci.bindingCount = static_cast<uint32_t>(desc_set_layout_bindings.size());
@@ -324,17 +358,18 @@ namespace Bamboo
 
 		// transparency descriptor set layouts
 		desc_set_layout_bindings = {
-			{1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr},
-			{2, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr},
-			{3, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr},
-			{4, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr},
+			{0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT, nullptr},
 			{5, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr},
 			{6, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr},
 			{7, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr},
 			{8, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr},
-			{9, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, MAX_POINT_LIGHT_NUM, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr},
-			{10, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, MAX_SPOT_LIGHT_NUM, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr},
+			{9, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr},
+			{10, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr},
 			{11, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr},
+			{12, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr},
+			{13, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr},
+			{14, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr},
+			{15, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr},
 		};
 
 		desc_set_layout_ci.bindingCount = static_cast<uint32_t>(desc_set_layout_bindings.size());
@@ -342,9 +377,7 @@ namespace Bamboo
 		result = vkCreateDescriptorSetLayout(VulkanRHI::get().getDevice(), &desc_set_layout_ci, nullptr, &m_desc_set_layouts[3]);
 		CHECK_VULKAN_RESULT(result, "create transparency static mesh descriptor set layout");
 
-		desc_set_layout_bindings.insert(desc_set_layout_bindings.begin(), { 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT, nullptr });
-		desc_set_layout_ci.bindingCount = static_cast<uint32_t>(desc_set_layout_bindings.size());
-		desc_set_layout_ci.pBindings = desc_set_layout_bindings.data();
+		desc_set_layout_bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
 		result = vkCreateDescriptorSetLayout(VulkanRHI::get().getDevice(), &desc_set_layout_ci, nullptr, &m_desc_set_layouts[4]);
 		CHECK_VULKAN_RESULT(result, "create transparency skeletal mesh descriptor set layout");
 
@@ -371,11 +404,13 @@ namespace Bamboo
 
 	void MainPass::createPipelineLayouts()
 	{
-		// gbuffer pipeline layouts
+		// gbuffer pipeline layouts, set 1 is the bindless material and texture set
+		std::array<VkDescriptorSetLayout, 2> mesh_desc_set_layouts = { m_desc_set_layouts[0], m_bindless_manager->getDescriptorSetLayout() };
+
 		VkPipelineLayoutCreateInfo pipeline_layout_ci{};
 		pipeline_layout_ci.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-		pipeline_layout_ci.setLayoutCount = 1;
-		pipeline_layout_ci.pSetLayouts = &m_desc_set_layouts[0];
+		pipeline_layout_ci.setLayoutCount = static_cast<uint32_t>(mesh_desc_set_layouts.size());
+		pipeline_layout_ci.pSetLayouts = mesh_desc_set_layouts.data();
 
 		m_push_constant_ranges =
 		{
@@ -390,11 +425,12 @@ namespace Bamboo
 		VkResult result = vkCreatePipelineLayout(VulkanRHI::get().getDevice(), &pipeline_layout_ci, nullptr, &m_pipeline_layouts[0]);
 		CHECK_VULKAN_RESULT(result, "create gbuffer static mesh pipeline layout");
 
-		pipeline_layout_ci.pSetLayouts = &m_desc_set_layouts[1];
+		mesh_desc_set_layouts[0] = m_desc_set_layouts[1];
 		result = vkCreatePipelineLayout(VulkanRHI::get().getDevice(), &pipeline_layout_ci, nullptr, &m_pipeline_layouts[1]);
 		CHECK_VULKAN_RESULT(result, "create gbuffer skeletal mesh pipeline layout");
 
 		// composition pipeline layouts
+		pipeline_layout_ci.setLayoutCount = 1;
 		pipeline_layout_ci.pSetLayouts = &m_desc_set_layouts[2];
 		pipeline_layout_ci.pushConstantRangeCount = 0;
 		pipeline_layout_ci.pPushConstantRanges = nullptr;
@@ -402,17 +438,20 @@ namespace Bamboo
 		CHECK_VULKAN_RESULT(result, "create composition pipeline layout");
 
 		// transparency pipeline layouts
-		pipeline_layout_ci.pSetLayouts = &m_desc_set_layouts[3];
+		mesh_desc_set_layouts[0] = m_desc_set_layouts[3];
+		pipeline_layout_ci.setLayoutCount = static_cast<uint32_t>(mesh_desc_set_layouts.size());
+		pipeline_layout_ci.pSetLayouts = mesh_desc_set_layouts.data();
 		pipeline_layout_ci.pushConstantRangeCount = static_cast<uint32_t>(m_push_constant_ranges.size());
 		pipeline_layout_ci.pPushConstantRanges = m_push_constant_ranges.data();
 		result = vkCreatePipelineLayout(VulkanRHI::get().getDevice(), &pipeline_layout_ci, nullptr, &m_pipeline_layouts[3]);
 		CHECK_VULKAN_RESULT(result, "create transparency static mesh pipeline layout");
 
-		pipeline_layout_ci.pSetLayouts = &m_desc_set_layouts[4];
+		mesh_desc_set_layouts[0] = m_desc_set_layouts[4];
 		result = vkCreatePipelineLayout(VulkanRHI::get().getDevice(), &pipeline_layout_ci, nullptr, &m_pipeline_layouts[4]);
 		CHECK_VULKAN_RESULT(result, "create transparency skeletal mesh pipeline layout");
 
 		// skybox pipeline layouts
+		pipeline_layout_ci.setLayoutCount = 1;
 		pipeline_layout_ci.pSetLayouts = &m_desc_set_layouts[5];
 		pipeline_layout_ci.pushConstantRangeCount = 1;
 		result = vkCreatePipelineLayout(VulkanRHI::get().getDevice(), &pipeline_layout_ci, nullptr, &m_pipeline_layouts[5]);
@@ -448,27 +487,11 @@ namespace Bamboo
 		std::vector<VkVertexInputBindingDescription> vertex_input_binding_descriptions;
 		vertex_input_binding_descriptions.resize(1, VkVertexInputBindingDescription{});
 		vertex_input_binding_descriptions[0].binding = 0;
-		vertex_input_binding_descriptions[0].stride = sizeof(StaticVertex);
+		vertex_input_binding_descriptions[0].stride = Mesh::getVertexStride(false);
 		vertex_input_binding_descriptions[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
 
 		// vertex attributes
-		std::vector<VkVertexInputAttributeDescription> vertex_input_attribute_descriptions;
-		vertex_input_attribute_descriptions.resize(3, VkVertexInputAttributeDescription{});
-
-		vertex_input_attribute_descriptions[0].binding = 0;
-		vertex_input_attribute_descriptions[0].location = 0;
-		vertex_input_attribute_descriptions[0].format = VK_FORMAT_R32G32B32_SFLOAT;
-		vertex_input_attribute_descriptions[0].offset = offsetof(StaticVertex, m_position);
-
-		vertex_input_attribute_descriptions[1].binding = 0;
-		vertex_input_attribute_descriptions[1].location = 1;
-		vertex_input_attribute_descriptions[1].format = VK_FORMAT_R32G32_SFLOAT;
-		vertex_input_attribute_descriptions[1].offset = offsetof(StaticVertex, m_tex_coord);
-
-		vertex_input_attribute_descriptions[2].binding = 0;
-		vertex_input_attribute_descriptions[2].location = 2;
-		vertex_input_attribute_descriptions[2].format = VK_FORMAT_R32G32B32_SFLOAT;
-		vertex_input_attribute_descriptions[2].offset = offsetof(StaticVertex, m_normal);
+		std::vector<VkVertexInputAttributeDescription> vertex_input_attribute_descriptions = Mesh::getVertexInputAttributeDescriptions(false);
 
 		VkPipelineVertexInputStateCreateInfo vertex_input_ci{};
 		vertex_input_ci.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
@@ -480,7 +503,7 @@ namespace Bamboo
 		// shader stages
 		const auto& shader_manager = g_engine.shaderManager();
 		std::vector<VkPipelineShaderStageCreateInfo> shader_stage_cis = {
-			shader_manager->getShaderStageCI("static_mesh.vert", VK_SHADER_STAGE_VERTEX_BIT),
+			shader_manager->getShaderStageCI("static_mesh_instance.vert", VK_SHADER_STAGE_VERTEX_BIT),
 			shader_manager->getShaderStageCI("gbuffer.frag", VK_SHADER_STAGE_FRAGMENT_BIT)
 		};
 
@@ -492,20 +515,19 @@ namespace Bamboo
 		m_pipeline_ci.renderPass = m_render_pass;
 		m_pipeline_ci.subpass = 0;
 
-		m_pipelines.resize(8);
+		m_pending_pipelines.resize(9);
 
-		// create gbuffer static mesh pipeline
-		VkResult result = vkCreateGraphicsPipelines(VulkanRHI::get().getDevice(), m_pipeline_cache, 1, &m_pipeline_ci, nullptr, &m_pipelines[0]);
-		CHECK_VULKAN_RESULT(result, "create gbuffer static mesh graphics pipeline");
+		// gbuffer static mesh pipeline, mesh pipelines are only created per material feature mask on first use
+		m_pending_material_pipeline_states.clear();
+		addMaterialPipelineState(0, vertex_input_ci, shader_stage_cis);
 
-		// create transparency static mesh pipeline
+		// transparency static mesh pipeline
 		m_color_blend_ci.attachmentCount = 1;
 		m_color_blend_attachments[0].blendEnable = VK_TRUE;
 		shader_stage_cis[1] = shader_manager->getShaderStageCI("forward_lighting.frag", VK_SHADER_STAGE_FRAGMENT_BIT);
 		m_pipeline_ci.layout = m_pipeline_layouts[3];
 		m_pipeline_ci.subpass = 2;
-		result = vkCreateGraphicsPipelines(VulkanRHI::get().getDevice(), m_pipeline_cache, 1, &m_pipeline_ci, nullptr, &m_pipelines[3]);
-		CHECK_VULKAN_RESULT(result, "create transparency static mesh graphics pipeline");
+		addMaterialPipelineState(3, vertex_input_ci, shader_stage_cis);
 
 		// skybox pipeline
 		shader_stage_cis = {
@@ -517,26 +539,16 @@ namespace Bamboo
 		m_rasterize_state_ci.cullMode = VK_CULL_MODE_NONE;
 		m_pipeline_ci.layout = m_pipeline_layouts[5];
 		m_pipeline_ci.subpass = 2;
-		result = vkCreateGraphicsPipelines(VulkanRHI::get().getDevice(), m_pipeline_cache, 1, &m_pipeline_ci, nullptr, &m_pipelines[5]);
+		VkResult result = vkCreateGraphicsPipelines(VulkanRHI::get().getDevice(), m_pipeline_cache, 1, &m_pipeline_ci, nullptr, &m_pending_pipelines[5]);
 		m_rasterize_state_ci.cullMode = VK_CULL_MODE_BACK_BIT;
 		m_color_blend_ci.attachmentCount = static_cast<uint32_t>(m_color_blend_attachments.size());
 		shader_stage_cis[1] = shader_manager->getShaderStageCI("gbuffer.frag", VK_SHADER_STAGE_FRAGMENT_BIT);
 		CHECK_VULKAN_RESULT(result, "create skybox graphics pipeline");
 		m_depth_stencil_ci.depthCompareOp = VK_COMPARE_OP_LESS;
 
-		// create gbuffer skeletal mesh pipeline
-		vertex_input_binding_descriptions[0].stride = sizeof(SkeletalVertex);
-
-		vertex_input_attribute_descriptions.resize(5);
-		vertex_input_attribute_descriptions[3].binding = 0;
-		vertex_input_attribute_descriptions[3].location = 3;
-		vertex_input_attribute_descriptions[3].format = VK_FORMAT_R32G32B32A32_SINT;
-		vertex_input_attribute_descriptions[3].offset = offsetof(SkeletalVertex, m_bones);
-
-		vertex_input_attribute_descriptions[4].binding = 0;
-		vertex_input_attribute_descriptions[4].location = 4;
-		vertex_input_attribute_descriptions[4].format = VK_FORMAT_R32G32B32A32_SFLOAT;
-		vertex_input_attribute_descriptions[4].offset = offsetof(SkeletalVertex, m_weights);
+		// gbuffer skeletal mesh pipeline
+		vertex_input_binding_descriptions[0].stride = Mesh::getVertexStride(true);
+		vertex_input_attribute_descriptions = Mesh::getVertexInputAttributeDescriptions(true);
 
 		vertex_input_ci.vertexAttributeDescriptionCount = static_cast<uint32_t>(vertex_input_attribute_descriptions.size());
 		vertex_input_ci.pVertexAttributeDescriptions = vertex_input_attribute_descriptions.data();
@@ -544,17 +556,15 @@ namespace Bamboo
 		m_pipeline_ci.layout = m_pipeline_layouts[1];
 		m_pipeline_ci.subpass = 0;
 		shader_stage_cis[0] = shader_manager->getShaderStageCI("skeletal_mesh.vert", VK_SHADER_STAGE_VERTEX_BIT);
-		result = vkCreateGraphicsPipelines(VulkanRHI::get().getDevice(), m_pipeline_cache, 1, &m_pipeline_ci, nullptr, &m_pipelines[1]);
-		CHECK_VULKAN_RESULT(result, "create gbuffer skeletal mesh graphics pipeline");
+		addMaterialPipelineState(1, vertex_input_ci, shader_stage_cis);
 
-		// create transparency skeletal mesh pipeline
+		// transparency skeletal mesh pipeline
 		m_color_blend_ci.attachmentCount = 1;
 		m_color_blend_attachments[0].blendEnable = VK_TRUE;
 		shader_stage_cis[1] = shader_manager->getShaderStageCI("forward_lighting.frag", VK_SHADER_STAGE_FRAGMENT_BIT);
 		m_pipeline_ci.layout = m_pipeline_layouts[4];
 		m_pipeline_ci.subpass = 2;
-		result = vkCreateGraphicsPipelines(VulkanRHI::get().getDevice(), m_pipeline_cache, 1, &m_pipeline_ci, nullptr, &m_pipelines[4]);
-		CHECK_VULKAN_RESULT(result, "create transparency skeletal mesh graphics pipeline");
+		addMaterialPipelineState(4, vertex_input_ci, shader_stage_cis);
 
 		// composition pipelines
 		// disable culling and depth testing
@@ -576,7 +586,7 @@ namespace Bamboo
 		m_pipeline_ci.pVertexInputState = &composition_vertex_input_ci;
 		m_pipeline_ci.layout = m_pipeline_layouts[2];
 		m_pipeline_ci.subpass = 1;
-		result = vkCreateGraphicsPipelines(VulkanRHI::get().getDevice(), m_pipeline_cache, 1, &m_pipeline_ci, nullptr, &m_pipelines[2]);
+		result = vkCreateGraphicsPipelines(VulkanRHI::get().getDevice(), m_pipeline_cache, 1, &m_pipeline_ci, nullptr, &m_pending_pipelines[2]);
 		CHECK_VULKAN_RESULT(result, "create composition graphics pipeline");
 
 		// billboard pipeline
@@ -596,17 +606,24 @@ namespace Bamboo
 		m_pipeline_ci.pStages = shader_stage_cis.data();
 		m_pipeline_ci.layout = m_pipeline_layouts[7];
 		m_pipeline_ci.subpass = 2;
-		result = vkCreateGraphicsPipelines(VulkanRHI::get().getDevice(), m_pipeline_cache, 1, &m_pipeline_ci, nullptr, &m_pipelines[7]);
+		result = vkCreateGraphicsPipelines(VulkanRHI::get().getDevice(), m_pipeline_cache, 1, &m_pipeline_ci, nullptr, &m_pending_pipelines[7]);
 		CHECK_VULKAN_RESULT(result, "create billboard graphics pipeline");
 
-		// debug draw pipeline
+		// debug draw pipeline, depth tested lines don't write depth
 		m_input_assembly_state_ci.topology = VK_PRIMITIVE_TOPOLOGY_LINE_LIST;
+		m_depth_stencil_ci.depthTestEnable = VK_TRUE;
+		m_depth_stencil_ci.depthWriteEnable = VK_FALSE;
 		m_color_blend_attachments[0].blendEnable = VK_FALSE;
 
 		// vertex input
 		vertex_input_binding_descriptions[0].stride = sizeof(DebugDrawVertex);
+		vertex_input_attribute_descriptions.resize(2);
+		vertex_input_attribute_descriptions[0].format = VK_FORMAT_R32G32B32_SFLOAT;
+		vertex_input_attribute_descriptions[0].offset = offsetof(DebugDrawVertex, position);
 		vertex_input_attribute_descriptions[1].format = VK_FORMAT_R32G32B32_SFLOAT;
-		vertex_input_ci.vertexAttributeDescriptionCount = 2;
+		vertex_input_attribute_descriptions[1].offset = offsetof(DebugDrawVertex, color);
+		vertex_input_ci.vertexAttributeDescriptionCount = static_cast<uint32_t>(vertex_input_attribute_descriptions.size());
+		vertex_input_ci.pVertexAttributeDescriptions = vertex_input_attribute_descriptions.data();
 
 		// shader stages
 		shader_stage_cis = {
@@ -619,8 +636,13 @@ namespace Bamboo
 		m_pipeline_ci.pStages = shader_stage_cis.data();
 		m_pipeline_ci.layout = m_pipeline_layouts[6];
 		m_pipeline_ci.subpass = 2;
-		result = vkCreateGraphicsPipelines(VulkanRHI::get().getDevice(), m_pipeline_cache, 1, &m_pipeline_ci, nullptr, &m_pipelines[6]);
+		result = vkCreateGraphicsPipelines(VulkanRHI::get().getDevice(), m_pipeline_cache, 1, &m_pipeline_ci, nullptr, &m_pending_pipelines[6]);
 		CHECK_VULKAN_RESULT(result, "create debug draw graphics pipeline");
+
+		// debug draw overlay pipeline
+		m_depth_stencil_ci.depthTestEnable = VK_FALSE;
+		result = vkCreateGraphicsPipelines(VulkanRHI::get().getDevice(), m_pipeline_cache, 1, &m_pipeline_ci, nullptr, &m_pending_pipelines[8]);
+		CHECK_VULKAN_RESULT(result, "create debug draw overlay graphics pipeline");
 	}
 
 	void MainPass::createFramebuffer()
@@ -628,18 +650,6 @@ namespace Bamboo
 		VulkanUtil::createImageViewSampler(m_width, m_height, nullptr, 1, 1, m_formats[0],
 			VK_FILTER_LINEAR, VK_FILTER_LINEAR, VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE, m_color_texture_sampler,
 			VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT);
-		VulkanUtil::createImageViewSampler(m_width, m_height, nullptr, 1, 1, m_formats[1], 
-			VK_FILTER_NEAREST, VK_FILTER_NEAREST, VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE, m_normal_texture_sampler, 
-			VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT);
-		VulkanUtil::createImageViewSampler(m_width, m_height, nullptr, 1, 1, m_formats[2], 
-			VK_FILTER_NEAREST, VK_FILTER_NEAREST, VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE, m_base_color_texture_sampler, 
-			VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT);
-		VulkanUtil::createImageViewSampler(m_width, m_height, nullptr, 1, 1, m_formats[3],
-			VK_FILTER_NEAREST, VK_FILTER_NEAREST, VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE, m_emissive_texture_sampler, 
-			VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT);
-		VulkanUtil::createImageViewSampler(m_width, m_height, nullptr, 1, 1, m_formats[4], 
-			VK_FILTER_NEAREST, VK_FILTER_NEAREST, VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE, m_metallic_roughness_occlusion_texture_sampler, 
-			VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT);
 		VulkanUtil::createImageViewSampler(m_width, m_height, nullptr, 1, 1, m_formats[5], 
 			VK_FILTER_NEAREST, VK_FILTER_NEAREST, VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE, m_depth_stencil_texture_sampler,
 			VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT);
@@ -647,10 +657,10 @@ namespace Bamboo
 		// 2.create framebuffer
 		std::vector<VkImageView> attachments = {
 			m_color_texture_sampler.view,
-			m_normal_texture_sampler.view,
-			m_base_color_texture_sampler.view,
-			m_emissive_texture_sampler.view,
-			m_metallic_roughness_occlusion_texture_sampler.view,
+			m_render_graph->getImage(m_gbuffer_images[0]).view,
+			m_render_graph->getImage(m_gbuffer_images[1]).view,
+			m_render_graph->getImage(m_gbuffer_images[2]).view,
+			m_render_graph->getImage(m_gbuffer_images[3]).view,
 			m_depth_stencil_texture_sampler.view
 		};
 
@@ -670,103 +680,232 @@ namespace Bamboo
 	void MainPass::destroyResizableObjects()
 	{
 		m_color_texture_sampler.destroy();
-		m_normal_texture_sampler.destroy();
-		m_base_color_texture_sampler.destroy();
-		m_emissive_texture_sampler.destroy();
-		m_metallic_roughness_occlusion_texture_sampler.destroy();
 		m_depth_stencil_texture_sampler.destroy();
 
 		RenderPass::destroyResizableObjects();
 	}
 
-	void MainPass::render_mesh(const std::shared_ptr<RenderData>& render_data, ERendererType renderer_type)
+	void MainPass::setRenderGraph(const std::shared_ptr<RenderGraph>& render_graph)
 	{
-		VkCommandBuffer command_buffer = VulkanRHI::get().getCommandBuffer();
-		uint32_t flight_index = VulkanRHI::get().getFlightIndex();
+		// gbuffers only live in the deferred subpasses, so they are transient render graph images
+		m_render_graph = render_graph;
+		const std::array<std::string, 4> names = { "gbuffer_normal", "gbuffer_base_color", "gbuffer_emissive", "gbuffer_metallic_roughness_occlusion" };
+		for (size_t i = 0; i < m_gbuffer_images.size(); ++i)
+		{
+			m_gbuffer_images[i] = m_render_graph->createImage(names[i], m_formats[i + 1],
+				VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT, VK_FILTER_NEAREST);
+		}
+	}
 
-		std::shared_ptr<SkeletalMeshRenderData> skeletal_mesh_render_data = nullptr;
-		std::shared_ptr<StaticMeshRenderData> static_mesh_render_data = std::static_pointer_cast<StaticMeshRenderData>(render_data);
-		bool is_skeletal_mesh = render_data->type == ERenderDataType::SkeletalMesh;;
-		if (is_skeletal_mesh)
+	std::vector<VkPipeline> MainPass::commitPipelines()
+	{
+		// material variants reference the old shader modules, they're recreated from the new states on demand
+		std::vector<VkPipeline> pipelines = RenderPass::commitPipelines();
+		for (const auto& iter : m_material_pipelines)
 		{
-			skeletal_mesh_render_data = std::static_pointer_cast<SkeletalMeshRenderData>(render_data);
+			pipelines.push_back(iter.second);
 		}
+		m_material_pipelines.clear();
 
-		uint32_t pipeline_index = (uint32_t)is_skeletal_mesh + (renderer_type == ERendererType::Deferred ? 0 : 3);
-		VkPipeline pipeline = m_pipelines[pipeline_index];
-		VkPipelineLayout pipeline_layout = m_pipeline_layouts[pipeline_index];
+		m_material_pipeline_states = std::move(m_pending_material_pipeline_states);
+		m_pending_material_pipeline_states.clear();
+		return pipelines;
+	}
 
-		// bind pipeline
-		vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+	void MainPass::addMaterialPipelineState(uint32_t pipeline_index, const VkPipelineVertexInputStateCreateInfo& vertex_input_ci,
+		const std::vector<VkPipelineShaderStageCreateInfo>& shader_stage_cis)
+	{
+		MaterialPipelineState& state = m_pending_material_pipeline_states[pipeline_index];
+		state.pipeline_ci = m_pipeline_ci;
+		state.input_assembly_state_ci = m_input_assembly_state_ci;
+		state.rasterize_state_ci = m_rasterize_state_ci;
+		state.multisampling_ci = m_multisampling_ci;
+		state.depth_stencil_ci = m_depth_stencil_ci;
+		state.color_blend_attachments = m_color_blend_attachments;
+		state.color_blend_ci = m_color_blend_ci;
+		state.viewport_ci = m_viewport_ci;
+		state.dynamic_states = m_dynamic_states;
+		state.dynamic_state_ci = m_dynamic_state_ci;
+		state.vertex_input_binding_descriptions.assign(vertex_input_ci.pVertexBindingDescriptions,
+			vertex_input_ci.pVertexBindingDescriptions + vertex_input_ci.vertexBindingDescriptionCount);
+		state.vertex_input_attribute_descriptions.assign(vertex_input_ci.pVertexAttributeDescriptions,
+			vertex_input_ci.pVertexAttributeDescriptions + vertex_input_ci.vertexAttributeDescriptionCount);
+		state.vertex_input_ci = vertex_input_ci;
+		state.shader_stage_cis = shader_stage_cis;
+	}
 
-		// bind vertex and index buffer
-		VkBuffer vertexBuffers[] = { static_mesh_render_data->vertex_buffer.buffer };
-		VkDeviceSize offsets[] = { 0 };
-		vkCmdBindVertexBuffers(command_buffer, 0, 1, vertexBuffers, offsets);
-		vkCmdBindIndexBuffer(command_buffer, static_mesh_render_data->index_buffer.buffer, 0, VK_INDEX_TYPE_UINT32);
+	VkPipeline MainPass::getMaterialPipeline(uint32_t pipeline_index, uint32_t material_features)
+	{
+		auto key = std::make_pair(pipeline_index, material_features);
+		auto iter = m_material_pipelines.find(key);
+		if (iter != m_material_pipelines.end())
+		{
+			return iter->second;
+		}
 
-		// render all sub meshes
-		std::vector<uint32_t>& index_counts = static_mesh_render_data->index_counts;
-		std::vector<uint32_t>& index_offsets = static_mesh_render_data->index_offsets;
-		size_t sub_mesh_count = index_counts.size();
-		for (size_t i = 0; i < sub_mesh_count; ++i)
+		// point the copied create info at the state's own structures
+		MaterialPipelineState state = m_material_pipeline_states.at(pipeline_index);
+		state.color_blend_ci.pAttachments = state.color_blend_attachments.data();
+		state.dynamic_state_ci.pDynamicStates = state.dynamic_states.data();
+		state.vertex_input_ci.pVertexBindingDescriptions = state.vertex_input_binding_descriptions.data();
+		state.vertex_input_ci.pVertexAttributeDescriptions = state.vertex_input_attribute_descriptions.data();
+
+		// specialize the fragment shader's MATERIAL_FEATURES constant
+		VkSpecializationMapEntry specialization_map_entry = { 0, 0, sizeof(uint32_t) };
+		VkSpecializationInfo specialization_info{};
+		specialization_info.mapEntryCount = 1;
+		specialization_info.pMapEntries = &specialization_map_entry;
+		specialization_info.dataSize = sizeof(uint32_t);
+		specialization_info.pData = &material_features;
+		for (VkPipelineShaderStageCreateInfo& shader_stage_ci : state.shader_stage_cis)
 		{
-			// push constants
-			updatePushConstants(command_buffer, pipeline_layout, { &static_mesh_render_data->transform_pco, &static_mesh_render_data->material_pcos[i] });
+			if (shader_stage_ci.stage == VK_SHADER_STAGE_FRAGMENT_BIT)
+			{
+				shader_stage_ci.pSpecializationInfo = &specialization_info;
+			}
+		}
 
-			// update(push) sub mesh descriptors
-			std::vector<VkWriteDescriptorSet> desc_writes;
-			std::array<VkDescriptorBufferInfo, 2> desc_buffer_infos{};
-			std::array<VkDescriptorImageInfo, 24> desc_image_infos{};
+		VkGraphicsPipelineCreateInfo& pipeline_ci = state.pipeline_ci;
+		pipeline_ci.pInputAssemblyState = &state.input_assembly_state_ci;
+		pipeline_ci.pViewportState = &state.viewport_ci;
+		pipeline_ci.pRasterizationState = &state.rasterize_state_ci;
+		pipeline_ci.pMultisampleState = &state.multisampling_ci;
+		pipeline_ci.pDepthStencilState = &state.depth_stencil_ci;
+		pipeline_ci.pColorBlendState = &state.color_blend_ci;
+		pipeline_ci.pDynamicState = &state.dynamic_state_ci;
+		pipeline_ci.pVertexInputState = &state.vertex_input_ci;
+		pipeline_ci.stageCount = static_cast<uint32_t>(state.shader_stage_cis.size());
+		pipeline_ci.pStages = state.shader_stage_cis.data();
+
+		// variants are created through the shared pipeline cache, so they're only compiled once across runs
+		VkPipeline pipeline;
+		VkResult result = vkCreateGraphicsPipelines(VulkanRHI::get().getDevice(), m_pipeline_cache, 1, &pipeline_ci, nullptr, &pipeline);
+		CHECK_VULKAN_RESULT(result, "create material graphics pipeline");
+
+		m_material_pipelines[key] = pipeline;
+		return pipeline;
+	}
 
-			// bone matrix ubo
+	void MainPass::render_draw_list(const DrawList& draw_list, ERendererType renderer_type, DrawStateCache& draw_state_cache)
+	{
+		VkCommandBuffer command_buffer = VulkanRHI::get().getCommandBuffer();
+		TransformPCO instance_transform_pco = DrawList::makeInstanceTransformPCO(m_lighting_render_data->camera_view_proj);
+
+		// render all sub meshes in sort key order
+		for (const DrawItem& draw_item : draw_list.getItems())
+		{
+			StaticMeshRenderData* static_mesh_render_data = draw_item.render_data;
+			SkeletalMeshRenderData* skeletal_mesh_render_data = nullptr;
+			bool is_skeletal_mesh = static_mesh_render_data->type == ERenderDataType::SkeletalMesh;
 			if (is_skeletal_mesh)
 			{
-				addBufferDescriptorSet(desc_writes, desc_buffer_infos[0], skeletal_mesh_render_data->bone_ubs[flight_index], 0);
+				skeletal_mesh_render_data = static_cast<SkeletalMeshRenderData*>(static_mesh_render_data);
 			}
 
-			// forward rendering
-			if (renderer_type == ERendererType::Forward)
+			uint32_t pipeline_index = (uint32_t)is_skeletal_mesh + (renderer_type == ERendererType::Deferred ? 0 : 3);
+			VkPipeline pipeline = getMaterialPipeline(pipeline_index, static_mesh_render_data->material_features[draw_item.sub_mesh_index]);
+			VkPipelineLayout pipeline_layout = m_pipeline_layouts[pipeline_index];
+
+			// bind pipeline, vertex and index buffer if changed
+			draw_state_cache.bindPipeline(pipeline);
+			draw_state_cache.bindVertexBuffer(static_mesh_render_data->vertex_buffer.buffer);
+			draw_state_cache.bindIndexBuffer(static_mesh_render_data->index_buffer.buffer, static_mesh_render_data->index_type);
+
+			// push constants, static meshes are instanced and read their model matrices from the instance buffer,
+			// materials are only referenced by their index into the bindless material buffer
+			const TransformPCO& transform_pco = is_skeletal_mesh ? static_mesh_render_data->transform_pco : instance_transform_pco;
+			MaterialPCO material_pco = { static_mesh_render_data->material_indices[draw_item.sub_mesh_index] };
+			updatePushConstants(command_buffer, pipeline_layout, { &transform_pco, &material_pco });
+
+			// update(push) mesh descriptors if changed, the bindless set is rebound since set 0 layouts differ between pipeline layouts
+			VmaBufferRange mesh_buffer = is_skeletal_mesh ? skeletal_mesh_render_data->bone_ub : draw_list.getInstanceBuffer().range();
+			if (draw_state_cache.needPushDescriptors(pipeline_layout, PBRTexture{}, mesh_buffer))
 			{
-				// lighting ubo
-				addBufferDescriptorSet(desc_writes, desc_buffer_infos[1], m_lighting_render_data->lighting_ubs[flight_index], 11);
-
-				// ibl textures
-				std::vector<VmaImageViewSampler> ibl_textures = {
-					m_lighting_render_data->irradiance_texture,
-					m_lighting_render_data->prefilter_texture,
-					m_lighting_render_data->brdf_lut_texture,
-					m_lighting_render_data->directional_light_shadow_texture,
-				};
-				const uint32_t k_binding_offset = 5;
-				for (size_t t = 0; t < ibl_textures.size(); ++t)
+				std::vector<VkWriteDescriptorSet> desc_writes;
+				std::array<VkDescriptorBufferInfo, 7> desc_buffer_infos{};
+				std::array<VkDescriptorImageInfo, 5> desc_image_infos{};
+
+				// bone matrix ubo or instance ssbo
+				addBufferDescriptorSet(desc_writes, desc_buffer_infos[0], mesh_buffer, 0, 
+					is_skeletal_mesh ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER);
+
+				// forward rendering
+				if (renderer_type == ERendererType::Forward)
 				{
-					addImageDescriptorSet(desc_writes, desc_image_infos[t], ibl_textures[t], static_cast<uint32_t>(t + k_binding_offset));
+					// lighting ubo, clustered light and shadow view ssbos
+					addLightingDescriptorSets(desc_writes, &desc_buffer_infos[1]);
+
+					// ibl and shadow textures
+					std::vector<VmaImageViewSampler> ibl_textures = {
+						m_lighting_render_data->irradiance_texture,
+						m_lighting_render_data->prefilter_texture,
+						m_lighting_render_data->brdf_lut_texture,
+						m_lighting_render_data->directional_light_shadow_texture,
+						m_lighting_render_data->shadow_atlas_texture
+					};
+					const uint32_t k_binding_offset = 5;
+					for (size_t t = 0; t < ibl_textures.size(); ++t)
+					{
+						addImageDescriptorSet(desc_writes, desc_image_infos[t], ibl_textures[t], static_cast<uint32_t>(t + k_binding_offset));
+					}
 				}
 
-				addImagesDescriptorSet(desc_writes, &desc_image_infos[ibl_textures.size()], m_lighting_render_data->point_light_shadow_textures, ibl_textures.size() + k_binding_offset);
-				addImagesDescriptorSet(desc_writes, &desc_image_infos[ibl_textures.size() + m_lighting_render_data->point_light_shadow_textures.size()], 
-					m_lighting_render_data->spot_light_shadow_textures, ibl_textures.size() + k_binding_offset + 1);
+				VulkanRHI::get().getVkCmdPushDescriptorSetKHR()(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+					pipeline_layout, 0, static_cast<uint32_t>(desc_writes.size()), desc_writes.data());
+
+				VkDescriptorSet bindless_desc_set = m_bindless_manager->getDescriptorSet();
+				vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_layout, 1, 1, &bindless_desc_set, 0, nullptr);
 			}
-			
-			// image sampler
-			std::vector<VmaImageViewSampler> pbr_textures = {
-				static_mesh_render_data->pbr_textures[i].base_color_texure,
-				static_mesh_render_data->pbr_textures[i].metallic_roughness_occlusion_texure,
-				static_mesh_render_data->pbr_textures[i].normal_texure,
-				static_mesh_render_data->pbr_textures[i].emissive_texure,
-			};
-			for (size_t t = 0; t < pbr_textures.size(); ++t)
+
+			// render sub mesh instances
+			draw_state_cache.drawIndexed(draw_item);
+		}
+	}
+
+	void MainPass::render_gpu_scene(DrawStateCache& draw_state_cache)
+	{
+		VkCommandBuffer command_buffer = VulkanRHI::get().getCommandBuffer();
+		TransformPCO instance_transform_pco = DrawList::makeInstanceTransformPCO(m_lighting_render_data->camera_view_proj);
+		VkPipelineLayout pipeline_layout = m_pipeline_layouts[0];
+		VmaBufferRange object_buffer = m_gpu_scene->getObjectBuffer().range();
+
+		// every batch draws the visible objects the culling pass has compacted into its indirect commands,
+		// whose instance index is the object index
+		const std::vector<GPUSceneBatch>& batches = m_gpu_scene->getBatches();
+		for (uint32_t batch_index : m_gpu_scene->getDrawBatchIndices())
+		{
+			const GPUSceneBatch& batch = batches[batch_index];
+			draw_state_cache.bindPipeline(getMaterialPipeline(0, batch.material_features));
+			draw_state_cache.bindVertexBuffer(batch.vertex_buffer);
+			draw_state_cache.bindIndexBuffer(batch.index_buffer, batch.index_type);
+
+			MaterialPCO material_pco = { batch.material_index };
+			updatePushConstants(command_buffer, pipeline_layout, { &instance_transform_pco, &material_pco });
+
+			if (draw_state_cache.needPushDescriptors(pipeline_layout, PBRTexture{}, object_buffer))
 			{
-				addImageDescriptorSet(desc_writes, desc_image_infos[t + 20], pbr_textures[t], static_cast<uint32_t>(t + 1));
+				std::vector<VkWriteDescriptorSet> desc_writes;
+				VkDescriptorBufferInfo desc_buffer_info{};
+				addBufferDescriptorSet(desc_writes, desc_buffer_info, object_buffer, 0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER);
+				VulkanRHI::get().getVkCmdPushDescriptorSetKHR()(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+					pipeline_layout, 0, static_cast<uint32_t>(desc_writes.size()), desc_writes.data());
+
+				VkDescriptorSet bindless_desc_set = m_bindless_manager->getDescriptorSet();
+				vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_layout, 1, 1, &bindless_desc_set, 0, nullptr);
 			}
 
-			VulkanRHI::get().getVkCmdPushDescriptorSetKHR()(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
-				pipeline_layout, 0, static_cast<uint32_t>(desc_writes.size()), desc_writes.data());
-
-			// render sub mesh
-			vkCmdDrawIndexed(command_buffer, index_counts[i], 1, index_offsets[i], 0, 0);
+			draw_state_cache.drawIndexedIndirectCount(m_scene_view, batch, batch_index);
 		}
 	}
 
+	void MainPass::addLightingDescriptorSets(std::vector<VkWriteDescriptorSet>& desc_writes, VkDescriptorBufferInfo* p_desc_buffer_infos)
+	{
+		addBufferDescriptorSet(desc_writes, p_desc_buffer_infos[0], m_lighting_render_data->lighting_ub, 11);
+		addBufferDescriptorSet(desc_writes, p_desc_buffer_infos[1], m_lighting_render_data->point_light_sb, 12, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER);
+		addBufferDescriptorSet(desc_writes, p_desc_buffer_infos[2], m_lighting_render_data->spot_light_sb, 13, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER);
+		addBufferDescriptorSet(desc_writes, p_desc_buffer_infos[3], m_lighting_render_data->light_cluster_sb, 14, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER);
+		addBufferDescriptorSet(desc_writes, p_desc_buffer_infos[4], m_lighting_render_data->light_index_sb, 15, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER);
+		addBufferDescriptorSet(desc_writes, p_desc_buffer_infos[5], m_lighting_render_data->shadow_view_sb, 10, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER);
+	}
+
 }
\ No newline at end of file
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "render_pass.h"
+#include "engine/function/render/gpu_scene.h"
+#include <map>
 
 namespace Bamboo
 {
@@ -10,6 +12,7 @@ namespace Bamboo
 		MainPass();
 
 		virtual void render() override;
+		virtual void destroy() override;
 
 		virtual void createRenderPass() override;
 		virtual void createDescriptorSetLayouts() override;
@@ -17,7 +20,9 @@ namespace Bamboo
 		virtual void createPipelines() override;
 		virtual void createFramebuffer() override;
 		virtual void destroyResizableObjects() override;
+		virtual std::vector<VkPipeline> commitPipelines() override;
 
+		void setBindlessManager(const std::shared_ptr<class BindlessManager>& bindless_manager) { m_bindless_manager = bindless_manager; }
 		void setLightingRenderData(const std::shared_ptr<LightingRenderData>& lighting_render_data) { m_lighting_render_data = lighting_render_data; }
 		void setSkyboxRenderData(const std::shared_ptr<SkyboxRenderData>& skybox_render_data) { m_skybox_render_data = skybox_render_data; }
 		void setBillboardRenderDatas(const std::vector<std::shared_ptr<BillboardRenderData>>& billboard_render_datas) {
@@ -27,7 +32,12 @@ namespace Bamboo
 			m_transparency_render_datas = transparency_render_datas;
 		}
 
+		// the gbuffers are transient render graph images
+		void setRenderGraph(const std::shared_ptr<class RenderGraph>& render_graph);
+		const std::array<RenderGraphImage, 4>& getGBufferImages() { return m_gbuffer_images; }
+
 		const VmaImageViewSampler* getColorTexture() { return &m_color_texture_sampler; }
+		const VmaImageViewSampler* getDepthTexture() { return &m_depth_stencil_texture_sampler; }
 
 	private:
 		enum class ERendererType
@@ -35,18 +45,41 @@ namespace Bamboo
 			Deferred, Forward
 		};
 
-		void render_mesh(const std::shared_ptr<RenderData>& render_data, ERendererType renderer_type);
+		// graphics pipeline state of a mesh pipeline, its material variants are created from it on first use
+		struct MaterialPipelineState
+		{
+			VkGraphicsPipelineCreateInfo pipeline_ci;
+			VkPipelineInputAssemblyStateCreateInfo input_assembly_state_ci;
+			VkPipelineRasterizationStateCreateInfo rasterize_state_ci;
+			VkPipelineMultisampleStateCreateInfo multisampling_ci;
+			VkPipelineDepthStencilStateCreateInfo depth_stencil_ci;
+			std::vector<VkPipelineColorBlendAttachmentState> color_blend_attachments;
+			VkPipelineColorBlendStateCreateInfo color_blend_ci;
+			VkPipelineViewportStateCreateInfo viewport_ci;
+			std::vector<VkDynamicState> dynamic_states;
+			VkPipelineDynamicStateCreateInfo dynamic_state_ci;
+			std::vector<VkVertexInputBindingDescription> vertex_input_binding_descriptions;
+			std::vector<VkVertexInputAttributeDescription> vertex_input_attribute_descriptions;
+			VkPipelineVertexInputStateCreateInfo vertex_input_ci;
+			std::vector<VkPipelineShaderStageCreateInfo> shader_stage_cis;
+		};
+
+		void addMaterialPipelineState(uint32_t pipeline_index, const VkPipelineVertexInputStateCreateInfo& vertex_input_ci,
+			const std::vector<VkPipelineShaderStageCreateInfo>& shader_stage_cis);
+		VkPipeline getMaterialPipeline(uint32_t pipeline_index, uint32_t material_features);
+
+		void render_draw_list(const DrawList& draw_list, ERendererType renderer_type, DrawStateCache& draw_state_cache);
+		void render_gpu_scene(DrawStateCache& draw_state_cache);
+		void addLightingDescriptorSets(std::vector<VkWriteDescriptorSet>& desc_writes, VkDescriptorBufferInfo* p_desc_buffer_infos);
 
 		std::vector<VkFormat> m_formats;
 
 		// color attachment
 		VmaImageViewSampler m_color_texture_sampler;
 
-		// gbuffer attachment
-		VmaImageViewSampler m_normal_texture_sampler;
-		VmaImageViewSampler m_base_color_texture_sampler;
-		VmaImageViewSampler m_emissive_texture_sampler;
-		VmaImageViewSampler m_metallic_roughness_occlusion_texture_sampler;
+		// gbuffer attachments, normal, base color, emissive and metallic roughness occlusion
+		std::shared_ptr<class RenderGraph> m_render_graph;
+		std::array<RenderGraphImage, 4> m_gbuffer_images;
 
 		// depth stencil attachment
 		VmaImageViewSampler m_depth_stencil_texture_sampler;
@@ -56,5 +89,18 @@ namespace Bamboo
 		std::shared_ptr<LightingRenderData> m_lighting_render_data;
 		std::shared_ptr<SkyboxRenderData> m_skybox_render_data;
 		std::vector<std::shared_ptr<BillboardRenderData>> m_billboard_render_datas;
+		std::shared_ptr<class BindlessManager> m_bindless_manager;
+
+		// mesh pipeline states by pipeline index, and their variants specialized on MATERIAL_FEATURE_* masks
+		std::map<uint32_t, MaterialPipelineState> m_material_pipeline_states;
+		std::map<uint32_t, MaterialPipelineState> m_pending_material_pipeline_states;
+		std::map<std::pair<uint32_t, uint32_t>, VkPipeline> m_material_pipelines;
+
+		// sorted draw lists
+		DrawList m_deferred_draw_list;
+		DrawList m_forward_draw_list;
+
+		// culled indirect commands of the gpu scene's static meshes
+		GPUSceneView m_scene_view;
 	};
 }
\ No newline at end of file
@@ -1,4 +1,5 @@
 #include "outline_pass.h"
+#include "engine/function/render/render_graph.h"
 #include "engine/core/vulkan/vulkan_rhi.h"
 #include "engine/resource/shader/shader_manager.h"
 #include "engine/resource/asset/base/mesh.h"
@@ -14,36 +15,8 @@ namespace Bamboo
 
 	void OutlinePass::render()
 	{
-		// render to framebuffer
-		VkClearValue clear_values[1];
-		clear_values[0].color = { { 0.0f, 0.0f, 0.0f, 0.0f } };
-
-		VkRenderPassBeginInfo render_pass_bi{};
-		render_pass_bi.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-		render_pass_bi.renderPass = m_render_passes[0];
-		render_pass_bi.renderArea.extent.width = m_width;
-		render_pass_bi.renderArea.extent.height = m_height;
-		render_pass_bi.clearValueCount = 1;
-		render_pass_bi.pClearValues = clear_values;
-		render_pass_bi.framebuffer = m_framebuffers[0];
-
 		VkCommandBuffer command_buffer = VulkanRHI::get().getCommandBuffer();
-		uint32_t flight_index = VulkanRHI::get().getFlightIndex();
-
-		VkViewport viewport{};
-		viewport.width = static_cast<float>(m_width);
-		viewport.height = static_cast<float>(m_height);
-		viewport.minDepth = 0.0f;
-		viewport.maxDepth = 1.0f;
-
-		VkRect2D scissor{};
-		scissor.extent.width = m_width;
-		scissor.extent.height = m_height;
-
-		vkCmdSetViewport(command_buffer, 0, 1, &viewport);
-		vkCmdSetScissor(command_buffer, 0, 1, &scissor);
-
-		vkCmdBeginRenderPass(command_buffer, &render_pass_bi, VK_SUBPASS_CONTENTS_INLINE);
+		beginRenderPass(0);
 
 		// render meshes
 		for (const auto& render_data : m_render_datas)
@@ -69,7 +42,7 @@ namespace Bamboo
 				VkBuffer vertexBuffers[] = { static_mesh_render_data->vertex_buffer.buffer };
 				VkDeviceSize offsets[] = { 0 };
 				vkCmdBindVertexBuffers(command_buffer, 0, 1, vertexBuffers, offsets);
-				vkCmdBindIndexBuffer(command_buffer, static_mesh_render_data->index_buffer.buffer, 0, VK_INDEX_TYPE_UINT32);
+				vkCmdBindIndexBuffer(command_buffer, static_mesh_render_data->index_buffer.buffer, 0, static_mesh_render_data->index_type);
 
 				// render all sub meshes
 				std::vector<uint32_t>& index_counts = static_mesh_render_data->index_counts;
@@ -88,7 +61,7 @@ namespace Bamboo
 					// bone matrix ubo
 					if (is_skeletal_mesh)
 					{
-						addBufferDescriptorSet(desc_writes, desc_buffer_infos[0], skeletal_mesh_render_data->bone_ubs[flight_index], 0);
+						addBufferDescriptorSet(desc_writes, desc_buffer_infos[0], skeletal_mesh_render_data->bone_ub, 0);
 					}
 
 					// base color texture image sampler
@@ -121,18 +94,19 @@ namespace Bamboo
 		}
 
 		vkCmdEndRenderPass(command_buffer);
+	}
 
-		// blur pass
-		render_pass_bi.renderPass = m_render_passes[1];
-		render_pass_bi.framebuffer = m_framebuffers[1];
-		vkCmdBeginRenderPass(command_buffer, &render_pass_bi, VK_SUBPASS_CONTENTS_INLINE);
+	void OutlinePass::renderBlur()
+	{
+		VkCommandBuffer command_buffer = VulkanRHI::get().getCommandBuffer();
+		beginRenderPass(1);
 		vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipelines[3]);
 
 		std::vector<VkWriteDescriptorSet> desc_writes;
 		std::array<VkDescriptorImageInfo, 1> desc_image_infos{};
 
-		// base color texture image sampler
-		addImageDescriptorSet(desc_writes, desc_image_infos[0], m_color_texture_samplers[0], 0);
+		// selection mask image sampler
+		addImageDescriptorSet(desc_writes, desc_image_infos[0], m_render_graph->getImage(m_mask_image), 0);
 
 		VulkanRHI::get().getVkCmdPushDescriptorSetKHR()(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
 			m_pipeline_layouts[3], 0, static_cast<uint32_t>(desc_writes.size()), desc_writes.data());
@@ -161,7 +135,7 @@ namespace Bamboo
 		attachments[0].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
 		attachments[0].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
 		attachments[0].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-		attachments[0].finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		attachments[0].finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 		VkAttachmentReference color_reference = { 0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL };
 
 		// subpass
@@ -170,16 +144,6 @@ namespace Bamboo
 		subpass_desc.colorAttachmentCount = 1;
 		subpass_desc.pColorAttachments = &color_reference;
 
-		// subpass dependencies
-		std::array<VkSubpassDependency, 2> dependencies;
-		dependencies[0].srcSubpass = 0;
-		dependencies[0].dstSubpass = VK_SUBPASS_EXTERNAL;
-		dependencies[0].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-		dependencies[0].dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
-		dependencies[0].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-		dependencies[0].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-		dependencies[0].dependencyFlags = 0;
-
 		// create outline render pass
 		VkRenderPassCreateInfo render_pass_ci{};
 		render_pass_ci.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
@@ -187,29 +151,13 @@ namespace Bamboo
 		render_pass_ci.pAttachments = attachments.data();
 		render_pass_ci.subpassCount = 1;
 		render_pass_ci.pSubpasses = &subpass_desc;
-		render_pass_ci.dependencyCount = 1;
-		render_pass_ci.pDependencies = dependencies.data();
+		render_pass_ci.dependencyCount = 0;
+		render_pass_ci.pDependencies = nullptr;
 
 		VkResult result = vkCreateRenderPass(VulkanRHI::get().getDevice(), &render_pass_ci, nullptr, &m_render_passes[0]);
 		CHECK_VULKAN_RESULT(result, "create outline render pass");
 
-		// create blur render pass
-		dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
-		dependencies[0].dstSubpass = 0;
-		dependencies[0].srcStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
-		dependencies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-		dependencies[0].srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
-		dependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-		dependencies[0].dependencyFlags = 0;
-
-		dependencies[1].srcSubpass = 0;
-		dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
-		dependencies[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-		dependencies[1].dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
-		dependencies[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-		dependencies[1].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-		dependencies[1].dependencyFlags = 0;
-
+		// create blur render pass, the render graph transitions the mask and outline textures between the passes
 		result = vkCreateRenderPass(VulkanRHI::get().getDevice(), &render_pass_ci, nullptr, &m_render_passes[1]);
 		CHECK_VULKAN_RESULT(result, "create blur render pass");
 	}
@@ -294,27 +242,11 @@ namespace Bamboo
 		std::vector<VkVertexInputBindingDescription> vertex_input_binding_descriptions;
 		vertex_input_binding_descriptions.resize(1, VkVertexInputBindingDescription{});
 		vertex_input_binding_descriptions[0].binding = 0;
-		vertex_input_binding_descriptions[0].stride = sizeof(StaticVertex);
+		vertex_input_binding_descriptions[0].stride = Mesh::getVertexStride(false);
 		vertex_input_binding_descriptions[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
 
 		// static mesh vertex attributes
-		std::vector<VkVertexInputAttributeDescription> vertex_input_attribute_descriptions;
-		vertex_input_attribute_descriptions.resize(3, VkVertexInputAttributeDescription{});
-
-		vertex_input_attribute_descriptions[0].binding = 0;
-		vertex_input_attribute_descriptions[0].location = 0;
-		vertex_input_attribute_descriptions[0].format = VK_FORMAT_R32G32B32_SFLOAT;
-		vertex_input_attribute_descriptions[0].offset = offsetof(StaticVertex, m_position);
-
-		vertex_input_attribute_descriptions[1].binding = 0;
-		vertex_input_attribute_descriptions[1].location = 1;
-		vertex_input_attribute_descriptions[1].format = VK_FORMAT_R32G32_SFLOAT;
-		vertex_input_attribute_descriptions[1].offset = offsetof(StaticVertex, m_tex_coord);
-
-		vertex_input_attribute_descriptions[2].binding = 0;
-		vertex_input_attribute_descriptions[2].location = 2;
-		vertex_input_attribute_descriptions[2].format = VK_FORMAT_R32G32B32_SFLOAT;
-		vertex_input_attribute_descriptions[2].offset = offsetof(StaticVertex, m_normal);
+		std::vector<VkVertexInputAttributeDescription> vertex_input_attribute_descriptions = Mesh::getVertexInputAttributeDescriptions(false);
 
 		VkPipelineVertexInputStateCreateInfo vertex_input_ci{};
 		vertex_input_ci.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
@@ -338,30 +270,20 @@ namespace Bamboo
 		m_pipeline_ci.renderPass = m_render_passes[0];
 		m_pipeline_ci.subpass = 0;
 
-		m_pipelines.resize(4);
-		VkResult result = vkCreateGraphicsPipelines(VulkanRHI::get().getDevice(), m_pipeline_cache, 1, &m_pipeline_ci, nullptr, &m_pipelines[0]);
+		m_pending_pipelines.resize(4);
+		VkResult result = vkCreateGraphicsPipelines(VulkanRHI::get().getDevice(), m_pipeline_cache, 1, &m_pipeline_ci, nullptr, &m_pending_pipelines[0]);
 		CHECK_VULKAN_RESULT(result, "create outline pass's static mesh graphics pipeline");
 
 		// skeletal mesh vertex attributes
-		vertex_input_binding_descriptions[0].stride = sizeof(SkeletalVertex);
-
-		vertex_input_attribute_descriptions.resize(5);
-		vertex_input_attribute_descriptions[3].binding = 0;
-		vertex_input_attribute_descriptions[3].location = 3;
-		vertex_input_attribute_descriptions[3].format = VK_FORMAT_R32G32B32A32_SINT;
-		vertex_input_attribute_descriptions[3].offset = offsetof(SkeletalVertex, m_bones);
-
-		vertex_input_attribute_descriptions[4].binding = 0;
-		vertex_input_attribute_descriptions[4].location = 4;
-		vertex_input_attribute_descriptions[4].format = VK_FORMAT_R32G32B32A32_SFLOAT;
-		vertex_input_attribute_descriptions[4].offset = offsetof(SkeletalVertex, m_weights);
+		vertex_input_binding_descriptions[0].stride = Mesh::getVertexStride(true);
+		vertex_input_attribute_descriptions = Mesh::getVertexInputAttributeDescriptions(true);
 
 		vertex_input_ci.vertexAttributeDescriptionCount = static_cast<uint32_t>(vertex_input_attribute_descriptions.size());
 		vertex_input_ci.pVertexAttributeDescriptions = vertex_input_attribute_descriptions.data();
 
 		m_pipeline_ci.layout = m_pipeline_layouts[1];
 		shader_stage_cis[0] = shader_manager->getShaderStageCI("skeletal_mesh.vert", VK_SHADER_STAGE_VERTEX_BIT);
-		result = vkCreateGraphicsPipelines(VulkanRHI::get().getDevice(), m_pipeline_cache, 1, &m_pipeline_ci, nullptr, &m_pipelines[1]);
+		result = vkCreateGraphicsPipelines(VulkanRHI::get().getDevice(), m_pipeline_cache, 1, &m_pipeline_ci, nullptr, &m_pending_pipelines[1]);
 		CHECK_VULKAN_RESULT(result, "create outline pass's static mesh graphics pipeline");
 
 		// billboard pipeline
@@ -382,7 +304,7 @@ namespace Bamboo
 		m_pipeline_ci.stageCount = static_cast<uint32_t>(shader_stage_cis.size());
 		m_pipeline_ci.pStages = shader_stage_cis.data();
 		m_pipeline_ci.layout = m_pipeline_layouts[2];
-		result = vkCreateGraphicsPipelines(VulkanRHI::get().getDevice(), m_pipeline_cache, 1, &m_pipeline_ci, nullptr, &m_pipelines[2]);
+		result = vkCreateGraphicsPipelines(VulkanRHI::get().getDevice(), m_pipeline_cache, 1, &m_pipeline_ci, nullptr, &m_pending_pipelines[2]);
 		CHECK_VULKAN_RESULT(result, "create billboard graphics pipeline");
 
 		// blur pipeline
@@ -408,25 +330,21 @@ namespace Bamboo
 		m_pipeline_ci.layout = m_pipeline_layouts[3];
 		m_pipeline_ci.stageCount = static_cast<uint32_t>(shader_stage_cis.size());
 		m_pipeline_ci.pStages = shader_stage_cis.data();
-		result = vkCreateGraphicsPipelines(VulkanRHI::get().getDevice(), m_pipeline_cache, 1, &m_pipeline_ci, nullptr, &m_pipelines[3]);
+		result = vkCreateGraphicsPipelines(VulkanRHI::get().getDevice(), m_pipeline_cache, 1, &m_pipeline_ci, nullptr, &m_pending_pipelines[3]);
 		CHECK_VULKAN_RESULT(result, "create blur graphics pipeline");
 	}
 
 	void OutlinePass::createFramebuffer()
 	{
+		// the render graph has already created the mask and outline images of the render size
+		std::array<VkImageView, 2> views = { m_render_graph->getImage(m_mask_image).view, m_render_graph->getImage(m_color_image).view };
 		for (uint32_t i = 0; i < 2; ++i)
 		{
-			// 1.create color images and view
-			VulkanUtil::createImageViewSampler(m_width, m_height, nullptr, 1, 1, m_format,
-				VK_FILTER_LINEAR, VK_FILTER_LINEAR, VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE, m_color_texture_samplers[i],
-				VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT);
-
-			// 2.create framebuffer
 			VkFramebufferCreateInfo framebuffer_ci{};
 			framebuffer_ci.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
 			framebuffer_ci.renderPass = m_render_passes[i];
 			framebuffer_ci.attachmentCount = 1;
-			framebuffer_ci.pAttachments = &m_color_texture_samplers[i].view;
+			framebuffer_ci.pAttachments = &views[i];
 			framebuffer_ci.width = m_width;
 			framebuffer_ci.height = m_height;
 			framebuffer_ci.layers = 1;
@@ -434,18 +352,16 @@ namespace Bamboo
 			VkResult result = vkCreateFramebuffer(VulkanRHI::get().getDevice(), &framebuffer_ci, nullptr, &m_framebuffers[i]);
 			CHECK_VULKAN_RESULT(result, "create outline pass frame buffer");
 		}
-
-		VulkanUtil::transitionImageLayout(m_color_texture_samplers[1].image(), VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, m_format);
 	}
 
 	void OutlinePass::destroyResizableObjects()
 	{
 		for (uint32_t i = 0; i < 2; ++i)
 		{
-			m_color_texture_samplers[i].destroy();
-			if (m_color_texture_samplers[i].view)
+			if (m_framebuffers[i])
 			{
 				vkDestroyFramebuffer(VulkanRHI::get().getDevice(), m_framebuffers[i], nullptr);
+				m_framebuffers[i] = VK_NULL_HANDLE;
 			}
 		}
 
@@ -457,9 +373,48 @@ namespace Bamboo
 		return RenderPass::isEnabled() && (!m_render_datas.empty() || !m_billboard_render_datas.empty());
 	}
 
+	void OutlinePass::setRenderGraph(const std::shared_ptr<RenderGraph>& render_graph)
+	{
+		m_render_graph = render_graph;
+		m_mask_image = m_render_graph->createImage("outline_mask", m_format, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT);
+		m_color_image = m_render_graph->createImage("outline_color", m_format, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT);
+	}
+
 	const VmaImageViewSampler* OutlinePass::getColorTexture()
 	{
-		return isEnabled() ? &m_color_texture_samplers[1] : nullptr;
+		return isEnabled() ? &m_render_graph->getImage(m_color_image) : nullptr;
+	}
+
+	void OutlinePass::beginRenderPass(uint32_t index)
+	{
+		VkClearValue clear_values[1];
+		clear_values[0].color = { { 0.0f, 0.0f, 0.0f, 0.0f } };
+
+		VkRenderPassBeginInfo render_pass_bi{};
+		render_pass_bi.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+		render_pass_bi.renderPass = m_render_passes[index];
+		render_pass_bi.renderArea.extent.width = m_width;
+		render_pass_bi.renderArea.extent.height = m_height;
+		render_pass_bi.clearValueCount = 1;
+		render_pass_bi.pClearValues = clear_values;
+		render_pass_bi.framebuffer = m_framebuffers[index];
+
+		VkCommandBuffer command_buffer = VulkanRHI::get().getCommandBuffer();
+
+		VkViewport viewport{};
+		viewport.width = static_cast<float>(m_width);
+		viewport.height = static_cast<float>(m_height);
+		viewport.minDepth = 0.0f;
+		viewport.maxDepth = 1.0f;
+
+		VkRect2D scissor{};
+		scissor.extent.width = m_width;
+		scissor.extent.height = m_height;
+
+		vkCmdSetViewport(command_buffer, 0, 1, &viewport);
+		vkCmdSetScissor(command_buffer, 0, 1, &scissor);
+
+		vkCmdBeginRenderPass(command_buffer, &render_pass_bi, VK_SUBPASS_CONTENTS_INLINE);
 	}
 
 }
\ No newline at end of file
@@ -9,7 +9,10 @@ namespace Bamboo
 	public:
 		OutlinePass();
 
+		// render() renders the selection mask, renderBlur() blurs it into the outline texture,
+		// they're separate render graph passes, which transitions the mask in between
 		virtual void render() override;
+		void renderBlur();
 		virtual void destroy() override;
 
 		virtual void createRenderPass() override;
@@ -25,12 +28,20 @@ namespace Bamboo
 			m_billboard_render_datas = billboard_render_datas;
 		}
 
+		// the mask and outline textures are transient render graph images
+		void setRenderGraph(const std::shared_ptr<class RenderGraph>& render_graph);
+		RenderGraphImage getMaskImage() { return m_mask_image; }
+		RenderGraphImage getColorImage() { return m_color_image; }
 		const VmaImageViewSampler* getColorTexture();
 
 	private:
+		void beginRenderPass(uint32_t index);
+
 		VkFormat m_format;
-		VmaImageViewSampler m_color_texture_samplers[2];
-		VkFramebuffer m_framebuffers[2];
+		std::shared_ptr<class RenderGraph> m_render_graph;
+		RenderGraphImage m_mask_image;
+		RenderGraphImage m_color_image;
+		VkFramebuffer m_framebuffers[2] = {};
 		VkRenderPass m_render_passes[2];
 
 		std::vector<VkPushConstantRange> m_billboard_push_constant_ranges;
@@ -1,11 +1,12 @@
 #include "pick_pass.h"
 #include "engine/core/vulkan/vulkan_rhi.h"
 #include "engine/resource/shader/shader_manager.h"
-#include "engine/resource/asset/base/mesh.h"
-#include "engine/platform/timer/timer.h"
+#include "engine/resource/asset/static_mesh.h"
+#include "engine/core/profile/cpu_profiler.h"
 #include "engine/core/event/event_system.h"
 
 #include <limits>
+#include <algorithm>
 
 #define MAX_SIZE 512u
 
@@ -20,10 +21,16 @@ namespace Bamboo
 		m_enabled = false;
 	}
 
+	void PickPass::destroy()
+	{
+		RenderPass::destroy();
+
+		m_draw_list.destroy();
+	}
+
 	void PickPass::render()
 	{
-		StopWatch stop_watch;
-		stop_watch.start();
+		PROFILE_SCOPE("PickPass::render");
 
 		// render to framebuffer
 		VkClearValue clear_values[2];
@@ -40,7 +47,6 @@ namespace Bamboo
 		render_pass_bi.framebuffer = m_framebuffer;
 
 		VkCommandBuffer command_buffer = VulkanUtil::beginInstantCommands();
-		uint32_t flight_index = 0;
 
 		VkViewport viewport{};
 		viewport.width = static_cast<float>(m_width);
@@ -57,58 +63,60 @@ namespace Bamboo
 
 		vkCmdBeginRenderPass(command_buffer, &render_pass_bi, VK_SUBPASS_CONTENTS_INLINE);
 
-		// render meshes
-		uint32_t entity_index = 0;
-		for (const auto& render_data : m_render_datas)
+		// render meshes, static meshes are instanced and read their entity colors from the instance buffer
+		std::vector<glm::vec4> colors(m_render_datas.size());
+		for (size_t i = 0; i < m_render_datas.size(); ++i)
+		{
+			colors[i] = encodeEntityID(m_entity_ids[i]);
+		}
+
+		m_draw_stats.reset();
+		m_draw_list.build(m_render_datas, EDrawPass::Pick, false, colors);
+		DrawStateCache draw_state_cache(command_buffer, m_draw_stats);
+		TransformPCO instance_transform_pco = DrawList::makeInstanceTransformPCO(m_camera_view_proj);
+
+		for (const DrawItem& draw_item : m_draw_list.getItems())
 		{
-			std::shared_ptr<SkeletalMeshRenderData> skeletal_mesh_render_data = nullptr;
-			std::shared_ptr<StaticMeshRenderData> static_mesh_render_data = std::static_pointer_cast<StaticMeshRenderData>(render_data);
-			bool is_skeletal_mesh = render_data->type == ERenderDataType::SkeletalMesh;;
+			StaticMeshRenderData* static_mesh_render_data = draw_item.render_data;
+			SkeletalMeshRenderData* skeletal_mesh_render_data = nullptr;
+			bool is_skeletal_mesh = static_mesh_render_data->type == ERenderDataType::SkeletalMesh;
 			if (is_skeletal_mesh)
 			{
-				skeletal_mesh_render_data = std::static_pointer_cast<SkeletalMeshRenderData>(render_data);
+				skeletal_mesh_render_data = static_cast<SkeletalMeshRenderData*>(static_mesh_render_data);
 			}
 
 			uint32_t pipeline_index = (uint32_t)is_skeletal_mesh;
 			VkPipeline pipeline = m_pipelines[pipeline_index];
 			VkPipelineLayout pipeline_layout = m_pipeline_layouts[pipeline_index];
 
-			// bind pipeline
-			vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+			// bind pipeline, vertex and index buffer if changed
+			draw_state_cache.bindPipeline(pipeline);
+			draw_state_cache.bindVertexBuffer(static_mesh_render_data->vertex_buffer.buffer);
+			draw_state_cache.bindIndexBuffer(static_mesh_render_data->index_buffer.buffer, static_mesh_render_data->index_type);
 
-			// bind vertex and index buffer
-			VkBuffer vertexBuffers[] = { static_mesh_render_data->vertex_buffer.buffer };
-			VkDeviceSize offsets[] = { 0 };
-			vkCmdBindVertexBuffers(command_buffer, 0, 1, vertexBuffers, offsets);
-			vkCmdBindIndexBuffer(command_buffer, static_mesh_render_data->index_buffer.buffer, 0, VK_INDEX_TYPE_UINT32);
+			// push constants
+			const TransformPCO& transform_pco = is_skeletal_mesh ? static_mesh_render_data->transform_pco : instance_transform_pco;
+			const glm::vec4& color = colors[draw_item.render_data_index];
+			updatePushConstants(command_buffer, pipeline_layout, { &transform_pco, &color });
 
-			// render all sub meshes
-			std::vector<uint32_t>& index_counts = static_mesh_render_data->index_counts;
-			std::vector<uint32_t>& index_offsets = static_mesh_render_data->index_offsets;
-			size_t sub_mesh_count = index_counts.size();
-			glm::vec4 color = encodeEntityID(m_entity_ids[entity_index++]);
-			for (size_t i = 0; i < sub_mesh_count; ++i)
+			// update(push) bone matrix ubo or instance ssbo if changed
+			VmaBufferRange mesh_buffer = is_skeletal_mesh ? skeletal_mesh_render_data->bone_ub : m_draw_list.getInstanceBuffer().range();
+			if (draw_state_cache.needPushDescriptors(pipeline_layout, PBRTexture{}, mesh_buffer))
 			{
-				// push constants
-				updatePushConstants(command_buffer, pipeline_layout, { &static_mesh_render_data->transform_pco, &color });
-
-				// bone matrix ubo
-				if (is_skeletal_mesh)
-				{
-					// update(push) sub mesh descriptors
-					std::vector<VkWriteDescriptorSet> desc_writes;
-					std::array<VkDescriptorBufferInfo, 1> desc_buffer_infos{};
+				std::vector<VkWriteDescriptorSet> desc_writes;
+				std::array<VkDescriptorBufferInfo, 1> desc_buffer_infos{};
 
-					addBufferDescriptorSet(desc_writes, desc_buffer_infos[0], skeletal_mesh_render_data->bone_ubs[flight_index], 0);
+				addBufferDescriptorSet(desc_writes, desc_buffer_infos[0], mesh_buffer, 0,
+					is_skeletal_mesh ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER);
 
-					VulkanRHI::get().getVkCmdPushDescriptorSetKHR()(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
-						pipeline_layout, 0, static_cast<uint32_t>(desc_writes.size()), desc_writes.data());
-				}
-
-				// render sub mesh
-				vkCmdDrawIndexed(command_buffer, index_counts[i], 1, index_offsets[i], 0, 0);
+				VulkanRHI::get().getVkCmdPushDescriptorSetKHR()(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+					pipeline_layout, 0, static_cast<uint32_t>(desc_writes.size()), desc_writes.data());
 			}
+
+			// render sub mesh instances
+			draw_state_cache.drawIndexed(draw_item);
 		}
+		uint32_t entity_index = static_cast<uint32_t>(m_render_datas.size());
 
 		// render billboards
 		vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipelines[2]);
@@ -124,6 +132,7 @@ namespace Bamboo
 		vkCmdEndRenderPass(command_buffer);
 
 		VulkanUtil::endInstantCommands(command_buffer);
+		m_draw_list.clear();
 
 		std::vector<uint8_t> image_data;
 		VulkanUtil::extractImage(m_color_image_view.image(), m_width, m_height, m_formats[0], image_data);
@@ -131,7 +140,6 @@ namespace Bamboo
 		uint32_t entity_id = decodeEntityID(&image_data[(m_mouse_y * m_width + m_mouse_x) * 4]);
 		g_engine.eventSystem()->asyncDispatch(std::make_shared<SelectEntityEvent>(entity_id));
 
-		//LOG_INFO("pick entity {} elapsed time : {}ms", entity_id, stop_watch.stopMs());
 		m_enabled = false;
 	}
 
@@ -187,15 +195,19 @@ namespace Bamboo
 		desc_set_layout_ci.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
 		desc_set_layout_ci.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_PUSH_DESCRIPTOR_BIT_KHR;
 
-		m_desc_set_layouts.resize(2);
-		VkResult result = vkCreateDescriptorSetLayout(VulkanRHI::get().getDevice(), &desc_set_layout_ci, nullptr, &m_desc_set_layouts[0]);
-		CHECK_VULKAN_RESULT(result, "create static mesh/billboard descriptor set layout");
+		m_desc_set_layouts.resize(3);
+		VkResult result = vkCreateDescriptorSetLayout(VulkanRHI::get().getDevice(), &desc_set_layout_ci, nullptr, &m_desc_set_layouts[2]);
+		CHECK_VULKAN_RESULT(result, "create billboard descriptor set layout");
 
 		std::vector<VkDescriptorSetLayoutBinding> desc_set_layout_bindings = {
-			{ 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT, nullptr }
+			{ 0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT, nullptr }
 		};
 		desc_set_layout_ci.bindingCount = static_cast<uint32_t>(desc_set_layout_bindings.size());
 		desc_set_layout_ci.pBindings = desc_set_layout_bindings.data();
+		result = vkCreateDescriptorSetLayout(VulkanRHI::get().getDevice(), &desc_set_layout_ci, nullptr, &m_desc_set_layouts[0]);
+		CHECK_VULKAN_RESULT(result, "create static mesh descriptor set layout");
+
+		desc_set_layout_bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
 		result = vkCreateDescriptorSetLayout(VulkanRHI::get().getDevice(), &desc_set_layout_ci, nullptr, &m_desc_set_layouts[1]);
 		CHECK_VULKAN_RESULT(result, "create skeletal mesh descriptor set layout");
 	}
@@ -224,7 +236,7 @@ namespace Bamboo
 		CHECK_VULKAN_RESULT(result, "create skeletal mesh pipeline layout");
 
 		// billboard pipeline layouts
-		pipeline_layout_ci.pSetLayouts = &m_desc_set_layouts[0];
+		pipeline_layout_ci.pSetLayouts = &m_desc_set_layouts[2];
 		m_billboard_push_constant_ranges = {
 			{ VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_GEOMETRY_BIT, 0, sizeof(glm::vec4) + sizeof(glm::vec2) },
 			{ VK_SHADER_STAGE_FRAGMENT_BIT, sizeof(glm::vec4) * 2, sizeof(glm::vec4) }
@@ -243,27 +255,11 @@ namespace Bamboo
 		std::vector<VkVertexInputBindingDescription> vertex_input_binding_descriptions;
 		vertex_input_binding_descriptions.resize(1, VkVertexInputBindingDescription{});
 		vertex_input_binding_descriptions[0].binding = 0;
-		vertex_input_binding_descriptions[0].stride = sizeof(StaticVertex);
+		vertex_input_binding_descriptions[0].stride = Mesh::getVertexStride(false);
 		vertex_input_binding_descriptions[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
 
 		// static mesh vertex attributes
-		std::vector<VkVertexInputAttributeDescription> vertex_input_attribute_descriptions;
-		vertex_input_attribute_descriptions.resize(3, VkVertexInputAttributeDescription{});
-
-		vertex_input_attribute_descriptions[0].binding = 0;
-		vertex_input_attribute_descriptions[0].location = 0;
-		vertex_input_attribute_descriptions[0].format = VK_FORMAT_R32G32B32_SFLOAT;
-		vertex_input_attribute_descriptions[0].offset = offsetof(StaticVertex, m_position);
-
-		vertex_input_attribute_descriptions[1].binding = 0;
-		vertex_input_attribute_descriptions[1].location = 1;
-		vertex_input_attribute_descriptions[1].format = VK_FORMAT_R32G32_SFLOAT;
-		vertex_input_attribute_descriptions[1].offset = offsetof(StaticVertex, m_tex_coord);
-
-		vertex_input_attribute_descriptions[2].binding = 0;
-		vertex_input_attribute_descriptions[2].location = 2;
-		vertex_input_attribute_descriptions[2].format = VK_FORMAT_R32G32B32_SFLOAT;
-		vertex_input_attribute_descriptions[2].offset = offsetof(StaticVertex, m_normal);
+		std::vector<VkVertexInputAttributeDescription> vertex_input_attribute_descriptions = Mesh::getVertexInputAttributeDescriptions(false);
 
 		VkPipelineVertexInputStateCreateInfo vertex_input_ci{};
 		vertex_input_ci.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
@@ -275,8 +271,8 @@ namespace Bamboo
 		// shader stages
 		const auto& shader_manager = g_engine.shaderManager();
 		std::vector<VkPipelineShaderStageCreateInfo> shader_stage_cis = {
-			shader_manager->getShaderStageCI("static_mesh.vert", VK_SHADER_STAGE_VERTEX_BIT),
-			shader_manager->getShaderStageCI("pick_mesh.frag", VK_SHADER_STAGE_FRAGMENT_BIT)
+			shader_manager->getShaderStageCI("static_mesh_instance.vert", VK_SHADER_STAGE_VERTEX_BIT),
+			shader_manager->getShaderStageCI("pick_mesh_instance.frag", VK_SHADER_STAGE_FRAGMENT_BIT)
 		};
 
 		// create graphics pipeline
@@ -287,30 +283,21 @@ namespace Bamboo
 		m_pipeline_ci.renderPass = m_render_pass;
 		m_pipeline_ci.subpass = 0;
 
-		m_pipelines.resize(3);
-		VkResult result = vkCreateGraphicsPipelines(VulkanRHI::get().getDevice(), m_pipeline_cache, 1, &m_pipeline_ci, nullptr, &m_pipelines[0]);
+		m_pending_pipelines.resize(3);
+		VkResult result = vkCreateGraphicsPipelines(VulkanRHI::get().getDevice(), m_pipeline_cache, 1, &m_pipeline_ci, nullptr, &m_pending_pipelines[0]);
 		CHECK_VULKAN_RESULT(result, "create pick pass's static mesh graphics pipeline");
 
 		// skeletal mesh vertex attributes
-		vertex_input_binding_descriptions[0].stride = sizeof(SkeletalVertex);
-
-		vertex_input_attribute_descriptions.resize(5);
-		vertex_input_attribute_descriptions[3].binding = 0;
-		vertex_input_attribute_descriptions[3].location = 3;
-		vertex_input_attribute_descriptions[3].format = VK_FORMAT_R32G32B32A32_SINT;
-		vertex_input_attribute_descriptions[3].offset = offsetof(SkeletalVertex, m_bones);
-
-		vertex_input_attribute_descriptions[4].binding = 0;
-		vertex_input_attribute_descriptions[4].location = 4;
-		vertex_input_attribute_descriptions[4].format = VK_FORMAT_R32G32B32A32_SFLOAT;
-		vertex_input_attribute_descriptions[4].offset = offsetof(SkeletalVertex, m_weights);
+		vertex_input_binding_descriptions[0].stride = Mesh::getVertexStride(true);
+		vertex_input_attribute_descriptions = Mesh::getVertexInputAttributeDescriptions(true);
 
 		vertex_input_ci.vertexAttributeDescriptionCount = static_cast<uint32_t>(vertex_input_attribute_descriptions.size());
 		vertex_input_ci.pVertexAttributeDescriptions = vertex_input_attribute_descriptions.data();
 
 		m_pipeline_ci.layout = m_pipeline_layouts[1];
 		shader_stage_cis[0] = shader_manager->getShaderStageCI("skeletal_mesh.vert", VK_SHADER_STAGE_VERTEX_BIT);
-		result = vkCreateGraphicsPipelines(VulkanRHI::get().getDevice(), m_pipeline_cache, 1, &m_pipeline_ci, nullptr, &m_pipelines[1]);
+		shader_stage_cis[1] = shader_manager->getShaderStageCI("pick_mesh.frag", VK_SHADER_STAGE_FRAGMENT_BIT);
+		result = vkCreateGraphicsPipelines(VulkanRHI::get().getDevice(), m_pipeline_cache, 1, &m_pipeline_ci, nullptr, &m_pending_pipelines[1]);
 		CHECK_VULKAN_RESULT(result, "create pick pass's static mesh graphics pipeline");
 
 		// billboard pipeline
@@ -331,7 +318,7 @@ namespace Bamboo
 		m_pipeline_ci.stageCount = static_cast<uint32_t>(shader_stage_cis.size());
 		m_pipeline_ci.pStages = shader_stage_cis.data();
 		m_pipeline_ci.layout = m_pipeline_layouts[2];
-		result = vkCreateGraphicsPipelines(VulkanRHI::get().getDevice(), m_pipeline_cache, 1, &m_pipeline_ci, nullptr, &m_pipelines[2]);
+		result = vkCreateGraphicsPipelines(VulkanRHI::get().getDevice(), m_pipeline_cache, 1, &m_pipeline_ci, nullptr, &m_pending_pipelines[2]);
 		CHECK_VULKAN_RESULT(result, "create billboard graphics pipeline");
 	}
 
@@ -368,6 +355,8 @@ namespace Bamboo
 
 	void PickPass::createResizableObjects(uint32_t width, uint32_t height)
 	{
+		m_viewport_width = width;
+		m_viewport_height = height;
 		if (width > height)
 		{
 			m_width = std::min(width, MAX_SIZE);
@@ -394,6 +383,20 @@ namespace Bamboo
 
 	void PickPass::pick(uint32_t mouse_x, uint32_t mouse_y)
 	{
+		if (mouse_x >= m_viewport_width || mouse_y >= m_viewport_height)
+		{
+			return;
+		}
+
+		// the id buffer is only rendered and read back if the cpu can't resolve the pick
+		glm::vec2 ndc_pos = glm::vec2((mouse_x + 0.5f) / m_viewport_width, (mouse_y + 0.5f) / m_viewport_height) * 2.0f - 1.0f;
+		uint32_t entity_id;
+		if (pickOnCPU(ndc_pos, entity_id))
+		{
+			g_engine.eventSystem()->asyncDispatch(std::make_shared<SelectEntityEvent>(entity_id));
+			return;
+		}
+
 		m_mouse_x = (uint32_t)(mouse_x * m_scale_ratio);
 		m_mouse_y = (uint32_t)(mouse_y * m_scale_ratio);
 
@@ -403,6 +406,75 @@ namespace Bamboo
 		}
 	}
 
+	bool PickPass::pickOnCPU(const glm::vec2& ndc_pos, uint32_t& entity_id)
+	{
+		PROFILE_SCOPE("PickPass::pickOnCPU");
+
+		// the camera's projection is y inverted, so normalized device y points down like the mouse position
+		Ray ray = Ray::unproject(ndc_pos, glm::inverse(m_camera_view_proj));
+
+		// top level pass over the entities' world bounding boxes, then the closest hit of each static mesh's bvh
+		float closest_t = 1.0f;
+		entity_id = UINT32_MAX;
+		std::vector<std::pair<float, const PickMeshData*>> hit_pick_mesh_datas;
+		for (const PickMeshData& pick_mesh_data : m_pick_mesh_datas)
+		{
+			float t;
+			if (ray.intersect(pick_mesh_data.bounding_box, closest_t, t))
+			{
+				hit_pick_mesh_datas.emplace_back(t, &pick_mesh_data);
+			}
+		}
+		std::sort(hit_pick_mesh_datas.begin(), hit_pick_mesh_datas.end(), [](const auto& a, const auto& b) {
+			return a.first < b.first;
+		});
+
+		for (const auto& hit_pick_mesh_data : hit_pick_mesh_datas)
+		{
+			if (hit_pick_mesh_data.first > closest_t)
+			{
+				break;
+			}
+
+			const PickMeshData* pick_mesh_data = hit_pick_mesh_data.second;
+			if (!pick_mesh_data->static_mesh)
+			{
+				return false;
+			}
+
+			float t;
+			Ray mesh_ray = ray.transform(glm::inverse(pick_mesh_data->model_matrix));
+			if (pick_mesh_data->static_mesh->m_bvh.intersect(mesh_ray, closest_t, t))
+			{
+				closest_t = t;
+				entity_id = pick_mesh_data->entity_id;
+			}
+		}
+
+		// billboards are depth tested quads around their projected positions
+		float closest_depth = 1.0f;
+		if (entity_id != UINT32_MAX)
+		{
+			glm::vec4 hit_pos = m_camera_view_proj * glm::vec4(ray.at(closest_t), 1.0f);
+			closest_depth = hit_pos.z / hit_pos.w;
+		}
+
+		uint32_t entity_index = static_cast<uint32_t>(m_render_datas.size());
+		for (const auto& render_data : m_billboard_render_datas)
+		{
+			glm::vec2 offset = glm::abs(ndc_pos - glm::vec2(render_data->position));
+			if (offset.x <= render_data->size.x * 0.5f && offset.y <= render_data->size.y * 0.5f && 
+				render_data->position.z >= 0.0f && render_data->position.z < closest_depth)
+			{
+				closest_depth = render_data->position.z;
+				entity_id = m_entity_ids[entity_index];
+			}
+			entity_index++;
+		}
+
+		return true;
+	}
+
 	bool PickPass::isEnabled()
 	{
 		return RenderPass::isEnabled() && m_enabled;
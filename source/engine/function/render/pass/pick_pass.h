@@ -10,6 +10,7 @@ namespace Bamboo
 		PickPass();
 
 		virtual void render() override;
+		virtual void destroy() override;
 
 		virtual void createRenderPass() override;
 		virtual void createDescriptorSetLayouts() override;
@@ -26,11 +27,16 @@ namespace Bamboo
 			m_billboard_render_datas = billboard_render_datas;
 		}
 		void setEntityIDs(const std::vector<uint32_t>& entity_ids) { m_entity_ids = entity_ids; }
+		void setPickMeshDatas(const std::vector<PickMeshData>& pick_mesh_datas) { m_pick_mesh_datas = pick_mesh_datas; }
+		void setCameraViewProj(const glm::mat4& camera_view_proj) { m_camera_view_proj = camera_view_proj; }
 
 	private:
 		glm::vec4 encodeEntityID(uint32_t id);
 		uint32_t decodeEntityID(const uint8_t* color);
 
+		// ray casts static meshes and billboards, returns false if a skeletal mesh may be hit first
+		bool pickOnCPU(const glm::vec2& ndc_pos, uint32_t& entity_id);
+
 		VkFormat m_formats[2];
 		VmaImageView m_color_image_view;
 		VmaImageView m_depth_image_view;
@@ -38,10 +44,15 @@ namespace Bamboo
 
 		std::vector<std::shared_ptr<BillboardRenderData>> m_billboard_render_datas;
 		std::vector<uint32_t> m_entity_ids;
+		std::vector<PickMeshData> m_pick_mesh_datas;
+		glm::mat4 m_camera_view_proj;
+		DrawList m_draw_list;
 
 		bool m_enabled;
 		uint32_t m_mouse_x;
 		uint32_t m_mouse_y;
 		float m_scale_ratio;
+		uint32_t m_viewport_width;
+		uint32_t m_viewport_height;
 	};
 }
\ No newline at end of file
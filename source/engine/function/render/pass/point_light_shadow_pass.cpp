@@ -1,4 +1,6 @@
 #include "point_light_shadow_pass.h"
+#include "culling_pass.h"
+#include "engine/function/render/shadow_atlas.h"
 #include "engine/core/vulkan/vulkan_rhi.h"
 #include "engine/resource/shader/shader_manager.h"
 #include "engine/resource/asset/base/mesh.h"
@@ -9,185 +11,203 @@ namespace Bamboo
 
 	PointLightShadowPass::PointLightShadowPass()
 	{
-		m_formats = { VK_FORMAT_R32_SFLOAT, VulkanRHI::get().getDepthFormat() };
-		m_size = 1024;
+
 	}
 
 	void PointLightShadowPass::init()
 	{
 		RenderPass::init();
 
-		createResizableObjects(m_size, m_size);
+		createResizableObjects(m_shadow_atlas->getSize(), m_shadow_atlas->getSize());
 	}
 
 	void PointLightShadowPass::render()
 	{
-		for (size_t p = 0; p < m_framebuffers.size(); ++p)
+		// cached cube faces keep their atlas tiles, so only the dirty ones are rendered
+		m_draw_stats.reset();
+		if (m_dirty_views.empty())
+		{
+			m_render_datas.clear();
+			m_gpu_scene.reset();
+			return;
+		}
+
+		// build a draw list per dirty view from the casters intersecting its frustum and cull the gpu scene into its view,
+		// culling has to be recorded before the render pass begins
+		VkCommandBuffer command_buffer = VulkanRHI::get().getCommandBuffer();
+		if (m_draw_lists.size() < m_dirty_views.size())
+		{
+			m_draw_lists.resize(m_dirty_views.size());
+			m_scene_views.resize(m_dirty_views.size());
+		}
+
+		std::vector<std::shared_ptr<RenderData>> view_render_datas;
+		for (size_t v = 0; v < m_dirty_views.size(); ++v)
+		{
+			const glm::mat4& view_proj = m_shadow_views[m_dirty_views[v].first].view_proj;
+			DrawList::cullRenderDatas(m_render_datas, view_proj, view_render_datas);
+			m_draw_lists[v].build(view_render_datas, EDrawPass::PointLightShadow);
+
+			if (m_culling_pass && m_gpu_scene)
+			{
+				m_culling_pass->cull(command_buffer, *m_gpu_scene, m_scene_views[v], view_proj, CULL_FLAG_FRUSTUM, true);
+			}
+		}
+
+		VkRenderPassBeginInfo render_pass_bi{};
+		render_pass_bi.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+		render_pass_bi.renderPass = m_render_pass;
+		render_pass_bi.framebuffer = m_framebuffer;
+		render_pass_bi.renderArea.offset = { 0, 0 };
+		render_pass_bi.renderArea.extent = { m_width, m_height };
+
+		vkCmdBeginRenderPass(command_buffer, &render_pass_bi, VK_SUBPASS_CONTENTS_INLINE);
+
+		// pipelines and mesh buffers are shared by all faces, instance buffers differ per draw list
+		DrawStateCache draw_state_cache(command_buffer, m_draw_stats);
+		for (size_t v = 0; v < m_dirty_views.size(); ++v)
 		{
-			VkRenderPassBeginInfo render_pass_bi{};
-			render_pass_bi.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-			render_pass_bi.renderPass = m_render_pass;
-			render_pass_bi.framebuffer = m_framebuffers[p];
-			render_pass_bi.renderArea.offset = { 0, 0 };
-			render_pass_bi.renderArea.extent = { m_size, m_size };
-
-			std::array<VkClearValue, 2> clear_values{};
-			clear_values[0].color = { { 0.0f, 0.0f, 0.0f, 1.0f } };
-			clear_values[1].depthStencil = { 1.0f, 0 };
-			render_pass_bi.clearValueCount = static_cast<uint32_t>(clear_values.size());
-			render_pass_bi.pClearValues = clear_values.data();
-
-			VkCommandBuffer command_buffer = VulkanRHI::get().getCommandBuffer();
-			uint32_t flight_index = VulkanRHI::get().getFlightIndex();
-			vkCmdBeginRenderPass(command_buffer, &render_pass_bi, VK_SUBPASS_CONTENTS_INLINE);
+			const glm::mat4& view_proj = m_shadow_views[m_dirty_views[v].first].view_proj;
+			const VkRect2D& tile = m_dirty_views[v].second;
+			const DrawList& draw_list = m_draw_lists[v];
 
 			VkViewport viewport{};
-			viewport.x = 0.0f;
-			viewport.y = 0.0f;
-			viewport.width = static_cast<float>(m_size);
-			viewport.height = static_cast<float>(m_size);
+			viewport.x = static_cast<float>(tile.offset.x);
+			viewport.y = static_cast<float>(tile.offset.y);
+			viewport.width = static_cast<float>(tile.extent.width);
+			viewport.height = static_cast<float>(tile.extent.height);
 			viewport.minDepth = 0.0f;
 			viewport.maxDepth = 1.0f;
 			vkCmdSetViewport(command_buffer, 0, 1, &viewport);
+			vkCmdSetScissor(command_buffer, 0, 1, &tile);
 
-			VkRect2D scissor{};
-			scissor.offset = { 0, 0 };
-			scissor.extent = { m_size, m_size };
-			vkCmdSetScissor(command_buffer, 0, 1, &scissor);
+			// clear the tile's outdated depth, the rest of the atlas is loaded
+			VkClearAttachment clear_attachment{};
+			clear_attachment.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+			clear_attachment.clearValue.depthStencil = { 1.0f, 0 };
+			VkClearRect clear_rect = { tile, 0, 1 };
+			vkCmdClearAttachments(command_buffer, 1, &clear_attachment, 1, &clear_rect);
 
-			for (const auto& render_data : m_render_datas)
+			for (const DrawItem& draw_item : draw_list.getItems())
 			{
-				std::shared_ptr<SkeletalMeshRenderData> skeletal_mesh_render_data = nullptr;
-				std::shared_ptr<StaticMeshRenderData> static_mesh_render_data = std::static_pointer_cast<StaticMeshRenderData>(render_data);
-				bool is_skeletal_mesh = render_data->type == ERenderDataType::SkeletalMesh;;
+				StaticMeshRenderData* static_mesh_render_data = draw_item.render_data;
+				SkeletalMeshRenderData* skeletal_mesh_render_data = nullptr;
+				bool is_skeletal_mesh = static_mesh_render_data->type == ERenderDataType::SkeletalMesh;
 				if (is_skeletal_mesh)
 				{
-					skeletal_mesh_render_data = std::static_pointer_cast<SkeletalMeshRenderData>(render_data);
+					skeletal_mesh_render_data = static_cast<SkeletalMeshRenderData*>(static_mesh_render_data);
 				}
 
 				uint32_t pipeline_index = (uint32_t)is_skeletal_mesh;
 				VkPipeline pipeline = m_pipelines[pipeline_index];
 				VkPipelineLayout pipeline_layout = m_pipeline_layouts[pipeline_index];
 
-				// bind pipeline
-				vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+				// bind pipeline, vertex and index buffer if changed
+				draw_state_cache.bindPipeline(pipeline);
+				draw_state_cache.bindVertexBuffer(static_mesh_render_data->vertex_buffer.buffer);
+				draw_state_cache.bindIndexBuffer(static_mesh_render_data->index_buffer.buffer, static_mesh_render_data->index_type);
 
-				// bind vertex and index buffer
-				VkBuffer vertexBuffers[] = { static_mesh_render_data->vertex_buffer.buffer };
-				VkDeviceSize offsets[] = { 0 };
-				vkCmdBindVertexBuffers(command_buffer, 0, 1, vertexBuffers, offsets);
-				vkCmdBindIndexBuffer(command_buffer, static_mesh_render_data->index_buffer.buffer, 0, VK_INDEX_TYPE_UINT32);
+				// push constants
+				uint32_t i = draw_item.sub_mesh_index;
+				TransformPCO transform_pco = is_skeletal_mesh ? static_mesh_render_data->transform_pco : DrawList::makeInstanceTransformPCO(view_proj);
+				transform_pco.mvp = view_proj * transform_pco.m;
+				updatePushConstants(command_buffer, pipeline_layout, { &transform_pco });
 
-				// render all sub meshes
-				std::vector<uint32_t>& index_counts = static_mesh_render_data->index_counts;
-				std::vector<uint32_t>& index_offsets = static_mesh_render_data->index_offsets;
-				size_t sub_mesh_count = index_counts.size();
-				for (size_t i = 0; i < sub_mesh_count; ++i)
+				// update(push) sub mesh descriptors if changed
+				VmaBufferRange mesh_buffer = is_skeletal_mesh ? skeletal_mesh_render_data->bone_ub : draw_list.getInstanceBuffer().range();
+				if (draw_state_cache.needPushDescriptors(pipeline_layout, static_mesh_render_data->pbr_textures[i], mesh_buffer))
 				{
-					// push constants
-					glm::vec4 light_pos = glm::vec4(m_light_poss[p], 1.0f);
-					updatePushConstants(command_buffer, pipeline_layout, { &static_mesh_render_data->transform_pco, glm::value_ptr(light_pos) });
-
-					// update(push) sub mesh descriptors
 					std::vector<VkWriteDescriptorSet> desc_writes;
-					std::array<VkDescriptorBufferInfo, 2> desc_buffer_infos{};
+					std::array<VkDescriptorBufferInfo, 1> desc_buffer_infos{};
 					std::array<VkDescriptorImageInfo, 1> desc_image_infos{};
 
-					// bone matrix ubo
-					if (is_skeletal_mesh)
-					{
-						addBufferDescriptorSet(desc_writes, desc_buffer_infos[0], skeletal_mesh_render_data->bone_ubs[flight_index], 0);
-					}
-
-					// shadow face ubo
-					addBufferDescriptorSet(desc_writes, desc_buffer_infos[1], m_shadow_cube_ubss[p][flight_index], 1);
+					// bone matrix ubo or instance ssbo
+					addBufferDescriptorSet(desc_writes, desc_buffer_infos[0], mesh_buffer, 0,
+						is_skeletal_mesh ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER);
 
 					// base color texture image sampler
-					addImageDescriptorSet(desc_writes, desc_image_infos[0], static_mesh_render_data->pbr_textures[i].base_color_texure, 2);
+					addImageDescriptorSet(desc_writes, desc_image_infos[0], static_mesh_render_data->pbr_textures[i].base_color_texure, 1);
 
 					VulkanRHI::get().getVkCmdPushDescriptorSetKHR()(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
 						pipeline_layout, 0, static_cast<uint32_t>(desc_writes.size()), desc_writes.data());
-
-					// render sub mesh
-					vkCmdDrawIndexed(command_buffer, index_counts[i], 1, index_offsets[i], 0, 0);
 				}
+
+				// render sub mesh instances
+				draw_state_cache.drawIndexed(draw_item);
 			}
 
-			vkCmdEndRenderPass(command_buffer);
+			if (m_gpu_scene)
+			{
+				renderGPUSceneDepth(draw_state_cache, m_scene_views[v], view_proj);
+			}
 		}
+
+		vkCmdEndRenderPass(command_buffer);
 		
 		m_render_datas.clear();
+		m_gpu_scene.reset();
+		for (DrawList& draw_list : m_draw_lists)
+		{
+			draw_list.clear();
+		}
+		m_dirty_views.clear();
 	}
 
 	void PointLightShadowPass::destroy()
 	{
 		RenderPass::destroy();
-
-		// destroy shadow face uniform buffers
-		for (auto& shadow_cube_ubs : m_shadow_cube_ubss)
+		for (DrawList& draw_list : m_draw_lists)
 		{
-			for (VmaBuffer& uniform_buffer : shadow_cube_ubs)
-			{
-				uniform_buffer.destroy();
-			}
+			draw_list.destroy();
+		}
+		for (GPUSceneView& scene_view : m_scene_views)
+		{
+			scene_view.destroy();
 		}
 	}
 
 	void PointLightShadowPass::createRenderPass()
 	{
-		// color attachment
-		std::array<VkAttachmentDescription, 2> attachments{};
-		attachments[0].format = m_formats[0];
-		attachments[0].samples = VK_SAMPLE_COUNT_1_BIT;
-		attachments[0].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-		attachments[0].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-		attachments[0].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-		attachments[0].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-		attachments[0].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-		attachments[0].finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-		VkAttachmentReference color_reference = { 0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL };
-
-		// depth attachment
-		attachments[1].format = m_formats[1];
-		attachments[1].samples = VK_SAMPLE_COUNT_1_BIT;
-		attachments[1].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-		attachments[1].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-		attachments[1].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-		attachments[1].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-		attachments[1].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-		attachments[1].finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
-		VkAttachmentReference depth_reference = { 1, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL };
+		// depth attachment of the shadow atlas, cached tiles of other lights are loaded
+		VkAttachmentDescription depth_attachment{};
+		depth_attachment.format = m_shadow_atlas->getFormat();
+		depth_attachment.samples = VK_SAMPLE_COUNT_1_BIT;
+		depth_attachment.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+		depth_attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+		depth_attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+		depth_attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+		depth_attachment.initialLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+		depth_attachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+		VkAttachmentReference depth_reference = { 0, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL };
 
 		// subpass
 		VkSubpassDescription subpass_desc{};
 		subpass_desc.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-		subpass_desc.colorAttachmentCount = 1;
-		subpass_desc.pColorAttachments = &color_reference;
 		subpass_desc.pDepthStencilAttachment = &depth_reference;
 
-		// subpass dependencies
+		// subpass dependencies, the atlas is read by lighting and written by the other shadow pass
 		std::array<VkSubpassDependency, 2> dependencies{};
 		dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
 		dependencies[0].dstSubpass = 0;
-		dependencies[0].srcStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
-		dependencies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-		dependencies[0].srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
-		dependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+		dependencies[0].srcStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+		dependencies[0].dstStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+		dependencies[0].srcAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+		dependencies[0].dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
 		dependencies[0].dependencyFlags = 0;
 
 		dependencies[1].srcSubpass = 0;
 		dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
-		dependencies[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+		dependencies[1].srcStageMask = VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
 		dependencies[1].dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
-		dependencies[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+		dependencies[1].srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
 		dependencies[1].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
 		dependencies[1].dependencyFlags = 0;
 
 		// create render pass
 		VkRenderPassCreateInfo render_pass_ci{};
 		render_pass_ci.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-		render_pass_ci.attachmentCount = static_cast<uint32_t>(attachments.size());
-		render_pass_ci.pAttachments = attachments.data();
+		render_pass_ci.attachmentCount = 1;
+		render_pass_ci.pAttachments = &depth_attachment;
 		render_pass_ci.subpassCount = 1;
 		render_pass_ci.pSubpasses = &subpass_desc;
 		render_pass_ci.dependencyCount = static_cast<uint32_t>(dependencies.size());
@@ -200,8 +220,8 @@ namespace Bamboo
 	void PointLightShadowPass::createDescriptorSetLayouts()
 	{
 		std::vector<VkDescriptorSetLayoutBinding> desc_set_layout_bindings = {
-			{1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_GEOMETRY_BIT, nullptr},
-			{2, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr}
+			{0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT, nullptr},
+			{1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr}
 		};
 
 		VkDescriptorSetLayoutCreateInfo desc_set_layout_ci{};
@@ -214,9 +234,7 @@ namespace Bamboo
 		VkResult result = vkCreateDescriptorSetLayout(VulkanRHI::get().getDevice(), &desc_set_layout_ci, nullptr, &m_desc_set_layouts[0]);
 		CHECK_VULKAN_RESULT(result, "create static mesh descriptor set layout");
 
-		desc_set_layout_bindings.insert(desc_set_layout_bindings.begin(), { 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT, nullptr });
-		desc_set_layout_ci.bindingCount = static_cast<uint32_t>(desc_set_layout_bindings.size());
-		desc_set_layout_ci.pBindings = desc_set_layout_bindings.data(); 
+		desc_set_layout_bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
 		result = vkCreateDescriptorSetLayout(VulkanRHI::get().getDevice(), &desc_set_layout_ci, nullptr, &m_desc_set_layouts[1]);
 		CHECK_VULKAN_RESULT(result, "create skeletal mesh descriptor set layout");
 	}
@@ -226,7 +244,6 @@ namespace Bamboo
 		m_push_constant_ranges =
 		{
 			{ VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(TransformPCO) },
-			{ VK_SHADER_STAGE_FRAGMENT_BIT, sizeof(TransformPCO), sizeof(vec4) }
 		};
 
 		VkPipelineLayoutCreateInfo pipeline_layout_ci{};
@@ -252,27 +269,11 @@ namespace Bamboo
 		std::vector<VkVertexInputBindingDescription> vertex_input_binding_descriptions;
 		vertex_input_binding_descriptions.resize(1, VkVertexInputBindingDescription{});
 		vertex_input_binding_descriptions[0].binding = 0;
-		vertex_input_binding_descriptions[0].stride = sizeof(StaticVertex);
+		vertex_input_binding_descriptions[0].stride = Mesh::getVertexStride(false);
 		vertex_input_binding_descriptions[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
 
 		// static mesh vertex attributes
-		std::vector<VkVertexInputAttributeDescription> vertex_input_attribute_descriptions;
-		vertex_input_attribute_descriptions.resize(3, VkVertexInputAttributeDescription{});
-
-		vertex_input_attribute_descriptions[0].binding = 0;
-		vertex_input_attribute_descriptions[0].location = 0;
-		vertex_input_attribute_descriptions[0].format = VK_FORMAT_R32G32B32_SFLOAT;
-		vertex_input_attribute_descriptions[0].offset = offsetof(StaticVertex, m_position);
-
-		vertex_input_attribute_descriptions[1].binding = 0;
-		vertex_input_attribute_descriptions[1].location = 1;
-		vertex_input_attribute_descriptions[1].format = VK_FORMAT_R32G32_SFLOAT;
-		vertex_input_attribute_descriptions[1].offset = offsetof(StaticVertex, m_tex_coord);
-
-		vertex_input_attribute_descriptions[2].binding = 0;
-		vertex_input_attribute_descriptions[2].location = 2;
-		vertex_input_attribute_descriptions[2].format = VK_FORMAT_R32G32B32_SFLOAT;
-		vertex_input_attribute_descriptions[2].offset = offsetof(StaticVertex, m_normal);
+		std::vector<VkVertexInputAttributeDescription> vertex_input_attribute_descriptions = Mesh::getVertexInputAttributeDescriptions(false);
 
 		VkPipelineVertexInputStateCreateInfo vertex_input_ci{};
 		vertex_input_ci.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
@@ -284,8 +285,7 @@ namespace Bamboo
 		// shader stages
 		const auto& shader_manager = g_engine.shaderManager();
 		std::vector<VkPipelineShaderStageCreateInfo> shader_stage_cis = {
-			shader_manager->getShaderStageCI("static_mesh.vert", VK_SHADER_STAGE_VERTEX_BIT),
-			shader_manager->getShaderStageCI("point_light_shadow.geom", VK_SHADER_STAGE_GEOMETRY_BIT),
+			shader_manager->getShaderStageCI("static_mesh_instance.vert", VK_SHADER_STAGE_VERTEX_BIT),
 			shader_manager->getShaderStageCI("point_light_shadow.frag", VK_SHADER_STAGE_FRAGMENT_BIT)
 		};
 
@@ -297,67 +297,49 @@ namespace Bamboo
 		m_pipeline_ci.renderPass = m_render_pass;
 		m_pipeline_ci.subpass = 0;
 
-		m_pipelines.resize(2);
-		VkResult result = vkCreateGraphicsPipelines(VulkanRHI::get().getDevice(), m_pipeline_cache, 1, &m_pipeline_ci, nullptr, &m_pipelines[0]);
+		m_pending_pipelines.resize(2);
+		VkResult result = vkCreateGraphicsPipelines(VulkanRHI::get().getDevice(), m_pipeline_cache, 1, &m_pipeline_ci, nullptr, &m_pending_pipelines[0]);
 		CHECK_VULKAN_RESULT(result, "create point light shadow pass's static mesh graphics pipeline");
 
 		// skeletal mesh vertex attributes
-		vertex_input_binding_descriptions[0].stride = sizeof(SkeletalVertex);
-
-		vertex_input_attribute_descriptions.resize(5);
-		vertex_input_attribute_descriptions[3].binding = 0;
-		vertex_input_attribute_descriptions[3].location = 3;
-		vertex_input_attribute_descriptions[3].format = VK_FORMAT_R32G32B32A32_SINT;
-		vertex_input_attribute_descriptions[3].offset = offsetof(SkeletalVertex, m_bones);
-
-		vertex_input_attribute_descriptions[4].binding = 0;
-		vertex_input_attribute_descriptions[4].location = 4;
-		vertex_input_attribute_descriptions[4].format = VK_FORMAT_R32G32B32A32_SFLOAT;
-		vertex_input_attribute_descriptions[4].offset = offsetof(SkeletalVertex, m_weights);
+		vertex_input_binding_descriptions[0].stride = Mesh::getVertexStride(true);
+		vertex_input_attribute_descriptions = Mesh::getVertexInputAttributeDescriptions(true);
 
 		vertex_input_ci.vertexAttributeDescriptionCount = static_cast<uint32_t>(vertex_input_attribute_descriptions.size());
 		vertex_input_ci.pVertexAttributeDescriptions = vertex_input_attribute_descriptions.data();
 
 		m_pipeline_ci.layout = m_pipeline_layouts[1];
 		shader_stage_cis[0] = shader_manager->getShaderStageCI("skeletal_mesh.vert", VK_SHADER_STAGE_VERTEX_BIT);
-		result = vkCreateGraphicsPipelines(VulkanRHI::get().getDevice(), m_pipeline_cache, 1, &m_pipeline_ci, nullptr, &m_pipelines[1]);
+		result = vkCreateGraphicsPipelines(VulkanRHI::get().getDevice(), m_pipeline_cache, 1, &m_pipeline_ci, nullptr, &m_pending_pipelines[1]);
 		CHECK_VULKAN_RESULT(result, "create point light shadow pass's static mesh graphics pipeline");
 	}
 
 	void PointLightShadowPass::createFramebuffer()
 	{
-		// create depth image view sampler
-		VulkanUtil::createImageViewSampler(m_size, m_size, nullptr, 1, SHADOW_FACE_NUM, m_formats[1],
-			VK_FILTER_LINEAR, VK_FILTER_LINEAR, VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE, m_depth_image_view_sampler,
-			VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT);
-	}
-
-	void PointLightShadowPass::destroyResizableObjects()
-	{
-		m_depth_image_view_sampler.destroy();
-		for (auto& shadow_image_view_sampler : m_shadow_image_view_samplers)
-		{
-			shadow_image_view_sampler.destroy();
-		}
-		for (auto& framebuffer : m_framebuffers)
-		{
-			vkDestroyFramebuffer(VulkanRHI::get().getDevice(), framebuffer, nullptr);
-		}
-
-		RenderPass::destroyResizableObjects();
+		// create the shadow atlas framebuffer
+		VkFramebufferCreateInfo framebuffer_ci{};
+		framebuffer_ci.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+		framebuffer_ci.renderPass = m_render_pass;
+		framebuffer_ci.attachmentCount = 1;
+		framebuffer_ci.pAttachments = &m_shadow_atlas->getImageViewSampler().view;
+		framebuffer_ci.width = m_width;
+		framebuffer_ci.height = m_height;
+		framebuffer_ci.layers = 1;
+
+		VkResult result = vkCreateFramebuffer(VulkanRHI::get().getDevice(), &framebuffer_ci, nullptr, &m_framebuffer);
+		CHECK_VULKAN_RESULT(result, "create point light shadow framebuffer");
 	}
 
 	void PointLightShadowPass::updateCubes(const std::vector<ShadowCubeCreateInfo>& shadow_cube_cis)
 	{
-		createDynamicBuffers(shadow_cube_cis.size());
+		m_shadow_views.resize(shadow_cube_cis.size() * SHADOW_FACE_NUM);
+		m_dirty_views.clear();
 
 		for (size_t p = 0; p < shadow_cube_cis.size(); ++p)
 		{
 			const ShadowCubeCreateInfo& shadow_cube_ci = shadow_cube_cis[p];
-			m_light_poss[p] = shadow_cube_ci.light_pos;
-
-			ShadowCubeUBO shadow_cube_ubo;
 			glm::mat4 proj = glm::perspectiveRH_ZO(glm::radians(90.0f), 1.0f, shadow_cube_ci.light_near, shadow_cube_ci.light_far);
+			proj[1][1] *= -1.0f;
 			for (uint32_t i = 0; i < SHADOW_FACE_NUM; ++i)
 			{
 				glm::mat4 view = glm::mat4(1.0f);
@@ -385,58 +367,17 @@ namespace Bamboo
 					break;
 				}
 
-				shadow_cube_ubo.face_view_projs[i] = proj * view * glm::translate(glm::mat4(1.0f), -m_light_poss[p]);
-			}
-
-			// update uniform buffers
-			VmaBuffer uniform_buffer = m_shadow_cube_ubss[p][VulkanRHI::get().getFlightIndex()];
-			VulkanUtil::updateBuffer(uniform_buffer, (void*)&shadow_cube_ubo, sizeof(ShadowCubeUBO));
-		}
-	}
-
-	const std::vector<VmaImageViewSampler>& PointLightShadowPass::getShadowImageViewSamplers()
-	{
-		return m_shadow_image_view_samplers;
-	}
-
-	void PointLightShadowPass::createDynamicBuffers(size_t size)
-	{
-		size_t last_size = m_framebuffers.size();
-		m_shadow_image_view_samplers.resize(size);
-		m_shadow_cube_ubss.resize(size);
-		m_framebuffers.resize(size);
-		m_light_poss.resize(size);
+				uint32_t view_index = static_cast<uint32_t>(p * SHADOW_FACE_NUM + i);
+				const glm::uvec2& tile_offset = shadow_cube_ci.tile_offsets[i];
+				ShadowView& shadow_view = m_shadow_views[view_index];
+				shadow_view.view_proj = proj * view * glm::translate(glm::mat4(1.0f), -shadow_cube_ci.light_pos);
+				shadow_view.atlas_rect = m_shadow_atlas->calcTileRect(tile_offset, shadow_cube_ci.tile_size);
 
-		for (uint32_t i = last_size; i < size; ++i)
-		{
-			// create shadow image view sampler
-			VulkanUtil::createImageViewSampler(m_size, m_size, nullptr, 1, SHADOW_FACE_NUM, m_formats[0],
-				VK_FILTER_LINEAR, VK_FILTER_LINEAR, VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE, m_shadow_image_view_samplers[i],
-				VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT);
-
-			std::vector<VkImageView> attachments = {
-				m_shadow_image_view_samplers[i].view,
-				m_depth_image_view_sampler.view
-			};
-
-			// create framebuffers
-			VkFramebufferCreateInfo framebuffer_ci{};
-			framebuffer_ci.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-			framebuffer_ci.renderPass = m_render_pass;
-			framebuffer_ci.attachmentCount = static_cast<uint32_t>(attachments.size());
-			framebuffer_ci.pAttachments = attachments.data();
-			framebuffer_ci.width = m_size;
-			framebuffer_ci.height = m_size;
-			framebuffer_ci.layers = SHADOW_FACE_NUM;
-
-			VkResult result = vkCreateFramebuffer(VulkanRHI::get().getDevice(), &framebuffer_ci, nullptr, &m_framebuffers[i]);
-			CHECK_VULKAN_RESULT(result, "create point light shadow framebuffer");
-
-			// create shadow face uniform buffers
-			m_shadow_cube_ubss[i].resize(MAX_FRAMES_IN_FLIGHT);
-			for (VmaBuffer& uniform_buffer : m_shadow_cube_ubss[i])
-			{
-				VulkanUtil::createBuffer(sizeof(ShadowCubeUBO), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VMA_MEMORY_USAGE_AUTO_PREFER_HOST, uniform_buffer);
+				if (shadow_cube_ci.dirty)
+				{
+					VkRect2D tile = { { static_cast<int32_t>(tile_offset.x), static_cast<int32_t>(tile_offset.y) }, { shadow_cube_ci.tile_size, shadow_cube_ci.tile_size } };
+					m_dirty_views.push_back({ view_index, tile });
+				}
 			}
 		}
 	}
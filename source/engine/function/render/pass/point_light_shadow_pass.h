@@ -1,6 +1,7 @@
 #pragma once
 
 #include "render_pass.h"
+#include "engine/function/render/gpu_scene.h"
 
 namespace Bamboo
 {
@@ -18,23 +19,24 @@ namespace Bamboo
 		virtual void createPipelineLayouts() override;
 		virtual void createPipelines() override;
 		virtual void createFramebuffer() override;
-		virtual void destroyResizableObjects() override;
 
+		void setShadowAtlas(const std::shared_ptr<class ShadowAtlas>& shadow_atlas) { m_shadow_atlas = shadow_atlas; }
 		void updateCubes(const std::vector<ShadowCubeCreateInfo>& shadow_cube_cis);
-		const std::vector<VmaImageViewSampler>& getShadowImageViewSamplers();
 
-	private:
-		void createDynamicBuffers(size_t size);
+		// six views per cube in face order, and whether any of them has to be rendered this frame
+		const std::vector<ShadowView>& getShadowViews() { return m_shadow_views; }
+		bool hasDirtyViews() { return !m_dirty_views.empty(); }
 
-		std::vector<VkFormat> m_formats;
-		uint32_t m_size;
+	private:
+		std::shared_ptr<class ShadowAtlas> m_shadow_atlas;
 
-		VmaImageViewSampler m_depth_image_view_sampler;
+		std::vector<ShadowView> m_shadow_views;
 
-		std::vector<VmaImageViewSampler> m_shadow_image_view_samplers;
-		std::vector<VkFramebuffer> m_framebuffers;
-		std::vector<std::vector<VmaBuffer>> m_shadow_cube_ubss;
+		// atlas tiles of the shadow views rendered this frame
+		std::vector<std::pair<uint32_t, VkRect2D>> m_dirty_views;
 
-		std::vector<glm::vec3> m_light_poss;
+		// frustum culled draw lists and gpu scene views of the dirty views, kept to reuse their buffers
+		std::vector<DrawList> m_draw_lists;
+		std::vector<GPUSceneView> m_scene_views;
 	};
 }
\ No newline at end of file
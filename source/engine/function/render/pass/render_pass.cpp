@@ -1,5 +1,7 @@
 #include "render_pass.h"
 #include "engine/core/vulkan/vulkan_rhi.h"
+#include "engine/function/render/gpu_scene.h"
+#include "engine/resource/shader/shader_manager.h"
 
 namespace Bamboo
 {
@@ -10,7 +12,6 @@ namespace Bamboo
 		createDescriptorSetLayouts();
 		createPipelineLayouts();
 		createPipelineCache();
-		createPipelines();
 	}
 
 	void RenderPass::destroy()
@@ -33,23 +34,33 @@ namespace Bamboo
 		{
 			vkDestroyPipelineLayout(VulkanRHI::get().getDevice(), pipeline_layout, nullptr);
 		}
-		vkDestroyPipelineCache(VulkanRHI::get().getDevice(), m_pipeline_cache, nullptr);
 		for (VkPipeline pipeline : m_pipelines)
 		{
 			vkDestroyPipeline(VulkanRHI::get().getDevice(), pipeline, nullptr);
 		}
+		for (VkPipeline pipeline : m_pending_pipelines)
+		{
+			vkDestroyPipeline(VulkanRHI::get().getDevice(), pipeline, nullptr);
+		}
 
 		destroyResizableObjects();
 	}
 
 	void RenderPass::createPipelineCache()
 	{
-		// create pipeline cache
-		VkPipelineCacheCreateInfo pipeline_cache_ci{};
-		pipeline_cache_ci.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
-		vkCreatePipelineCache(VulkanRHI::get().getDevice(), &pipeline_cache_ci, nullptr, &m_pipeline_cache);
+		// all render passes share the persistent pipeline cache
+		m_pipeline_cache = VulkanRHI::get().getPipelineCache().get();
+
+		// create pipeline create info, it's reset before pipelines are rebuilt, as passes modify it while creating their pipelines
+		m_pipeline_ci = {};
+		m_input_assembly_state_ci = {};
+		m_rasterize_state_ci = {};
+		m_multisampling_ci = {};
+		m_depth_stencil_ci = {};
+		m_color_blend_ci = {};
+		m_viewport_ci = {};
+		m_dynamic_state_ci = {};
 
-		// create pipeline create info
 		// input assembly
 		m_input_assembly_state_ci.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
 		m_input_assembly_state_ci.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
@@ -91,7 +102,7 @@ namespace Bamboo
 		color_blend_attachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
 		color_blend_attachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
 		color_blend_attachment.alphaBlendOp = VK_BLEND_OP_ADD;
-		m_color_blend_attachments.push_back(color_blend_attachment);
+		m_color_blend_attachments = { color_blend_attachment };
 
 		m_color_blend_ci.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
 		m_color_blend_ci.attachmentCount = static_cast<uint32_t>(m_color_blend_attachments.size());
@@ -125,6 +136,37 @@ namespace Bamboo
 		m_pipeline_ci.pDynamicState = &m_dynamic_state_ci;
 	}
 
+	void RenderPass::buildPipelines()
+	{
+		// pipelines are created from the default pipeline create info, and their shaders are recorded,
+		// so the pipelines are only rebuilt if one of their shaders changes
+		createPipelineCache();
+		m_shader_names.clear();
+		ShaderManager::setShaderNameRecorder(&m_shader_names);
+		createPipelines();
+		ShaderManager::setShaderNameRecorder(nullptr);
+	}
+
+	std::vector<VkPipeline> RenderPass::commitPipelines()
+	{
+		std::vector<VkPipeline> pipelines = std::move(m_pipelines);
+		m_pipelines = std::move(m_pending_pipelines);
+		m_pending_pipelines.clear();
+		return pipelines;
+	}
+
+	bool RenderPass::usesAnyShader(const std::vector<std::string>& shader_names)
+	{
+		for (const std::string& shader_name : shader_names)
+		{
+			if (m_shader_names.find(shader_name) != m_shader_names.end())
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
 	void RenderPass::createResizableObjects(uint32_t width, uint32_t height)
 	{
 		m_width = width;
@@ -167,18 +209,25 @@ namespace Bamboo
 	}
 
 	void RenderPass::addBufferDescriptorSet(std::vector<VkWriteDescriptorSet>& desc_writes,
-		VkDescriptorBufferInfo& desc_buffer_info, VmaBuffer buffer, uint32_t binding)
+		VkDescriptorBufferInfo& desc_buffer_info, VmaBuffer buffer, uint32_t binding, VkDescriptorType descriptor_type)
+	{
+		addBufferDescriptorSet(desc_writes, desc_buffer_info, buffer.range(), binding, descriptor_type);
+	}
+
+	void RenderPass::addBufferDescriptorSet(std::vector<VkWriteDescriptorSet>& desc_writes,
+		VkDescriptorBufferInfo& desc_buffer_info, const VmaBufferRange& buffer_range, uint32_t binding, VkDescriptorType descriptor_type)
 	{
-		desc_buffer_info.buffer = buffer.buffer;
-		desc_buffer_info.offset = 0;
-		desc_buffer_info.range = buffer.size;
+		// push descriptors can't be dynamic, so sub allocated buffers pass their offset here
+		desc_buffer_info.buffer = buffer_range.buffer;
+		desc_buffer_info.offset = buffer_range.offset;
+		desc_buffer_info.range = buffer_range.size;
 
 		VkWriteDescriptorSet desc_write{};
 		desc_write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
 		desc_write.dstSet = 0;
 		desc_write.dstBinding = binding;
 		desc_write.dstArrayElement = 0;
-		desc_write.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+		desc_write.descriptorType = descriptor_type;
 		desc_write.descriptorCount = 1;
 		desc_write.pBufferInfo = &desc_buffer_info;
 		desc_writes.push_back(desc_write);
@@ -223,4 +272,37 @@ namespace Bamboo
 		desc_writes.push_back(desc_write);
 	}
 
+	void RenderPass::renderGPUSceneDepth(DrawStateCache& draw_state_cache, const GPUSceneView& gpu_scene_view, const glm::mat4& view_proj)
+	{
+		VkCommandBuffer command_buffer = VulkanRHI::get().getCommandBuffer();
+		VkPipelineLayout pipeline_layout = m_pipeline_layouts[0];
+		TransformPCO transform_pco = DrawList::makeInstanceTransformPCO(view_proj);
+		VmaBufferRange object_buffer = m_gpu_scene->getObjectBuffer().range();
+
+		const std::vector<GPUSceneBatch>& batches = m_gpu_scene->getBatches();
+		for (uint32_t batch_index : m_gpu_scene->getDrawBatchIndices())
+		{
+			const GPUSceneBatch& batch = batches[batch_index];
+			draw_state_cache.bindPipeline(m_pipelines[0]);
+			draw_state_cache.bindVertexBuffer(batch.vertex_buffer);
+			draw_state_cache.bindIndexBuffer(batch.index_buffer, batch.index_type);
+			updatePushConstants(command_buffer, pipeline_layout, { &transform_pco });
+
+			PBRTexture pbr_texture{};
+			pbr_texture.base_color_texure = batch.base_color_texture;
+			if (draw_state_cache.needPushDescriptors(pipeline_layout, pbr_texture, object_buffer))
+			{
+				std::vector<VkWriteDescriptorSet> desc_writes;
+				VkDescriptorBufferInfo desc_buffer_info{};
+				VkDescriptorImageInfo desc_image_info{};
+				addBufferDescriptorSet(desc_writes, desc_buffer_info, object_buffer, 0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER);
+				addImageDescriptorSet(desc_writes, desc_image_info, batch.base_color_texture, 1);
+				VulkanRHI::get().getVkCmdPushDescriptorSetKHR()(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+					pipeline_layout, 0, static_cast<uint32_t>(desc_writes.size()), desc_writes.data());
+			}
+
+			draw_state_cache.drawIndexedIndirectCount(gpu_scene_view, batch, batch_index);
+		}
+	}
+
 }
\ No newline at end of file
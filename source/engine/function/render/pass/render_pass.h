@@ -1,12 +1,17 @@
 #pragma once
 
 #include "engine/function/render/render_data.h"
+#include "engine/function/render/draw_list.h"
+#include "engine/function/render/render_graph.h"
+#include <set>
 
 namespace Bamboo
 {
 	class RenderPass
 	{
 	public:
+		// creates everything but the pipelines, which are built and committed afterwards,
+		// so the render system can create the pipelines of all passes concurrently
 		virtual void init();
 		virtual void render() = 0;
 		virtual void destroy();
@@ -20,27 +25,44 @@ namespace Bamboo
 		virtual void createResizableObjects(uint32_t width, uint32_t height);
 		virtual void destroyResizableObjects();
 
+		// createPipelines creates the pending pipelines, which are used for rendering once they are committed.
+		// building can run on a worker thread while the pass renders with its committed pipelines
+		void buildPipelines();
+		virtual std::vector<VkPipeline> commitPipelines();
+		bool usesAnyShader(const std::vector<std::string>& shader_names);
+
 		void setRenderDatas(const std::vector<std::shared_ptr<RenderData>>& render_datas) { m_render_datas = render_datas; }
+		void setCullingPass(const std::shared_ptr<class CullingPass>& culling_pass) { m_culling_pass = culling_pass; }
+		void setGPUScene(const std::shared_ptr<class GPUScene>& gpu_scene) { m_gpu_scene = gpu_scene; }
 		void onResize(uint32_t width, uint32_t height);
 		virtual bool isEnabled();
+		const DrawStats& getDrawStats() { return m_draw_stats; }
 
 	protected:
 		void updatePushConstants(VkCommandBuffer command_buffer, VkPipelineLayout pipeline_layout, 
 			const std::vector<const void*>& pcos, std::vector<VkPushConstantRange> push_constant_ranges = {});
 		void addBufferDescriptorSet(std::vector<VkWriteDescriptorSet>& desc_writes, 
-			VkDescriptorBufferInfo& desc_buffer_info, VmaBuffer buffer, uint32_t binding);
+			VkDescriptorBufferInfo& desc_buffer_info, VmaBuffer buffer, uint32_t binding, 
+			VkDescriptorType descriptor_type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER);
+		void addBufferDescriptorSet(std::vector<VkWriteDescriptorSet>& desc_writes, 
+			VkDescriptorBufferInfo& desc_buffer_info, const VmaBufferRange& buffer_range, uint32_t binding, 
+			VkDescriptorType descriptor_type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER);
 		void addImageDescriptorSet(std::vector<VkWriteDescriptorSet>& desc_writes, 
 			VkDescriptorImageInfo& desc_image_info, VmaImageViewSampler texture, uint32_t binding);
 		void addImagesDescriptorSet(std::vector<VkWriteDescriptorSet>& desc_writes,
 			VkDescriptorImageInfo* p_desc_image_info, const std::vector<VmaImageViewSampler>& textures, uint32_t binding);
 
+		// draw the gpu scene's culled static meshes with the first pipeline of a depth only pass,
+		// which reads the object buffer and alpha tests the base color texture
+		void renderGPUSceneDepth(DrawStateCache& draw_state_cache, const class GPUSceneView& gpu_scene_view, const glm::mat4& view_proj);
+
 		// vulkan objects
 		VkRenderPass m_render_pass = VK_NULL_HANDLE;
 		VkDescriptorPool m_descriptor_pool = VK_NULL_HANDLE;
 		std::vector<VkDescriptorSetLayout> m_desc_set_layouts;
 		std::vector<VkPushConstantRange> m_push_constant_ranges;
 		std::vector<VkPipelineLayout> m_pipeline_layouts;
-		VkPipelineCache m_pipeline_cache;
+		VkPipelineCache m_pipeline_cache = VK_NULL_HANDLE;
 
 		// pipeline create info structures
 		VkGraphicsPipelineCreateInfo m_pipeline_ci{};
@@ -55,11 +77,23 @@ namespace Bamboo
 		VkPipelineDynamicStateCreateInfo m_dynamic_state_ci{};
 
 		std::vector<VkPipeline> m_pipelines;
+		std::vector<VkPipeline> m_pending_pipelines;
+
+		// shaders of the pipelines, recorded while building them
+		std::set<std::string> m_shader_names;
 		VkFramebuffer m_framebuffer = VK_NULL_HANDLE;
 
 		// render dependent data
 		std::vector<std::shared_ptr<RenderData>> m_render_datas;
 
+		// the static meshes of the gpu scene are culled by the culling pass and drawn with indirect draw counts,
+		// the gpu scene is set every frame the pass draws it
+		std::shared_ptr<class CullingPass> m_culling_pass;
+		std::shared_ptr<class GPUScene> m_gpu_scene;
+
+		// draw statistics of the last recorded frame
+		DrawStats m_draw_stats;
+
 		// render target size
 		uint32_t m_width = 0, m_height = 0;
 	};
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "render_pass.h"
+#include "engine/function/render/gpu_scene.h"
 
 namespace Bamboo
 {
@@ -11,26 +12,31 @@ namespace Bamboo
 
 		virtual void init() override;
 		virtual void render() override;
+		virtual void destroy() override;
 
 		virtual void createRenderPass() override;
 		virtual void createDescriptorSetLayouts() override;
 		virtual void createPipelineLayouts() override;
 		virtual void createPipelines() override;
-		virtual void createFramebuffer() override {}
-		virtual void destroyResizableObjects() override;
+		virtual void createFramebuffer() override;
 
+		void setShadowAtlas(const std::shared_ptr<class ShadowAtlas>& shadow_atlas) { m_shadow_atlas = shadow_atlas; }
 		void updateFrustums(const std::vector<ShadowFrustumCreateInfo>& shadow_frustum_cis);
-		const std::vector<VmaImageViewSampler>& getShadowImageViewSamplers();
 
-		std::vector<glm::mat4> m_light_view_projs;
+		// one view per frustum, and whether any of them has to be rendered this frame
+		const std::vector<ShadowView>& getShadowViews() { return m_shadow_views; }
+		bool hasDirtyViews() { return !m_dirty_views.empty(); }
 
 	private:
-		void createDynamicBuffers(size_t size);
+		std::shared_ptr<class ShadowAtlas> m_shadow_atlas;
 
-		VkFormat m_format;
-		uint32_t m_size;
+		std::vector<ShadowView> m_shadow_views;
 
-		std::vector<VmaImageViewSampler> m_shadow_image_view_samplers;
-		std::vector<VkFramebuffer> m_framebuffers;
+		// atlas tiles of the shadow views rendered this frame
+		std::vector<std::pair<uint32_t, VkRect2D>> m_dirty_views;
+
+		// frustum culled draw lists and gpu scene views of the dirty views, kept to reuse their buffers
+		std::vector<DrawList> m_draw_lists;
+		std::vector<GPUSceneView> m_scene_views;
 	};
 }
\ No newline at end of file
@@ -50,7 +50,7 @@ namespace Bamboo
 		init_info.Device = VulkanRHI::get().getDevice();
 		init_info.QueueFamily = VulkanRHI::get().getGraphicsQueueFamily();
 		init_info.Queue = VulkanRHI::get().getGraphicsQueue();
-		init_info.PipelineCache = VK_NULL_HANDLE;
+		init_info.PipelineCache = m_pipeline_cache;
 		init_info.DescriptorPool = m_descriptor_pool;
 		init_info.Subpass = 0;
 		init_info.MinImageCount = VulkanRHI::get().getSwapchainImageCount();
@@ -98,7 +98,7 @@ namespace Bamboo
 		LOG_INFO("ui pass init time: {}ms", stop_watch.stopMs());
 	}
 
-	void UIPass::prepare()
+	std::shared_ptr<ImDrawData> UIPass::prepare()
 	{
 		// process imgui frame and get draw data
 		ImGui_ImplVulkan_NewFrame();
@@ -114,6 +114,20 @@ namespace Bamboo
 
 		// calculate imgui draw data
 		ImGui::Render();
+
+		// the clone is released on the thread constructing the ui, as imgui's allocations are counted by its context
+		ImDrawData* draw_data = IM_NEW(ImDrawData)(*ImGui::GetDrawData());
+		for (ImDrawList*& draw_list : draw_data->CmdLists)
+		{
+			draw_list = draw_list->CloneOutput();
+		}
+		return std::shared_ptr<ImDrawData>(draw_data, [](ImDrawData* draw_data) {
+			for (ImDrawList* draw_list : draw_data->CmdLists)
+			{
+				IM_DELETE(draw_list);
+			}
+			IM_DELETE(draw_data);
+		});
 	}
 
 	void UIPass::render()
@@ -136,7 +150,10 @@ namespace Bamboo
 		vkCmdBeginRenderPass(command_buffer, &renderpass_bi, VK_SUBPASS_CONTENTS_INLINE);
 
 		// record dear imgui primitives into command buffer
-		ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), command_buffer);
+		if (m_draw_data)
+		{
+			ImGui_ImplVulkan_RenderDrawData(m_draw_data, command_buffer);
+		}
 
 		vkCmdEndRenderPass(command_buffer);
 	}
@@ -3,13 +3,17 @@
 #include "render_pass.h"
 #include <functional>
 
+struct ImDrawData;
+
 namespace Bamboo
 {
 	class UIPass : public RenderPass
 	{
 	public:
 		virtual void init() override;
-		void prepare();
+		// constructs the ui and returns a clone of its draw data, which can be rendered after the next ui is constructed
+		std::shared_ptr<ImDrawData> prepare();
+		void setDrawData(ImDrawData* draw_data) { m_draw_data = draw_data; }
 		virtual void render() override;
 		virtual void destroy() override;
 
@@ -23,5 +27,6 @@ namespace Bamboo
 
 	private:
 		std::vector<VkFramebuffer> m_framebuffers;
+		ImDrawData* m_draw_data = nullptr;
 	};
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "engine/core/vulkan/vulkan_util.h"
+#include "engine/core/math/bounding_box.h"
 #include "host_device.h"
 
 namespace Bamboo
@@ -29,31 +30,45 @@ namespace Bamboo
 
 		glm::mat4 camera_view_proj;
 
-		std::vector<VmaBuffer> lighting_ubs;
+		VmaBufferRange lighting_ub;
+		VmaBufferRange point_light_sb;
+		VmaBufferRange spot_light_sb;
+		VmaBufferRange light_cluster_sb;
+		VmaBufferRange light_index_sb;
 
 		VmaImageViewSampler irradiance_texture;
 		VmaImageViewSampler prefilter_texture;
 		VmaImageViewSampler brdf_lut_texture;
 
 		VmaImageViewSampler directional_light_shadow_texture;
-		std::vector<VmaImageViewSampler> point_light_shadow_textures;
-		std::vector<VmaImageViewSampler> spot_light_shadow_textures;
+		VmaImageViewSampler shadow_atlas_texture;
+		VmaBufferRange shadow_view_sb;
 	};
 
 	struct MeshRenderData : public RenderData
 	{
 		VmaBuffer vertex_buffer;
 		VmaBuffer index_buffer;
+		VkIndexType index_type;
 		std::vector<uint32_t> index_counts;
 		std::vector<uint32_t> index_offsets;
+
+		// sub mesh index ranges of the lod selected for shadow passes, which may be coarser than the view's lod
+		std::vector<uint32_t> shadow_index_counts;
+		std::vector<uint32_t> shadow_index_offsets;
 		TransformPCO transform_pco;
+		BoundingBox bounding_box;
 	};
 
 	struct StaticMeshRenderData : public MeshRenderData
 	{
 		StaticMeshRenderData() { type = ERenderDataType::StaticMesh; }
 
-		std::vector<MaterialPCO> material_pcos;
+		// indices into the bindless manager's materials, pbr textures are still pushed by the passes which sample them directly
+		std::vector<uint32_t> material_indices;
+
+		// MATERIAL_FEATURE_* bits of every sub mesh, selecting the specialized material pipelines
+		std::vector<uint32_t> material_features;
 		std::vector<PBRTexture> pbr_textures;
 	};
 
@@ -61,7 +76,7 @@ namespace Bamboo
 	{
 		SkeletalMeshRenderData() { type = ERenderDataType::SkeletalMesh; }
 
-		std::vector<VmaBuffer> bone_ubs;
+		VmaBufferRange bone_ub;
 	};
 
 	struct SkyboxRenderData : public RenderData
@@ -70,6 +85,7 @@ namespace Bamboo
 
 		VmaBuffer vertex_buffer;
 		VmaBuffer index_buffer;
+		VkIndexType index_type;
 		uint32_t index_count;
 		TransformPCO transform_pco;
 		VmaImageViewSampler env_texture;
@@ -84,6 +100,15 @@ namespace Bamboo
 		VmaImageViewSampler texture;
 	};
 
+	// cpu pick target of a mesh entity, skeletal meshes have no bvh and are picked by the id buffer
+	struct PickMeshData
+	{
+		uint32_t entity_id;
+		std::shared_ptr<class StaticMesh> static_mesh;
+		mat4 model_matrix;
+		BoundingBox bounding_box;
+	};
+
 	struct PostProcessRenderData : public RenderData
 	{
 		PostProcessRenderData() { type = ERenderDataType::PostProcess; }
@@ -100,6 +125,10 @@ namespace Bamboo
 
 		vec3 light_dir;
 		float light_cascade_frustum_near;
+		bool light_cast_shadow;
+
+		// blends the split distances between uniform (0) and logarithmic (1)
+		float cascade_split_lambda;
 	};
 
 	struct ShadowCubeCreateInfo
@@ -107,6 +136,11 @@ namespace Bamboo
 		vec3 light_pos;
 		float light_near;
 		float light_far;
+
+		// shadow atlas tiles of the cube faces, which are only rendered if dirty
+		uint32_t tile_size;
+		std::vector<glm::uvec2> tile_offsets;
+		bool dirty;
 	};
 
 	struct ShadowFrustumCreateInfo
@@ -116,5 +150,10 @@ namespace Bamboo
 		float light_angle;
 		float light_near;
 		float light_far;
+
+		// shadow atlas tile, which is only rendered if dirty
+		uint32_t tile_size;
+		glm::uvec2 tile_offset;
+		bool dirty;
 	};
 }
\ No newline at end of file
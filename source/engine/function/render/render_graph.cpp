@@ -0,0 +1,340 @@
+#include "render_graph.h"
+#include "engine/core/vulkan/vulkan_rhi.h"
+#include <algorithm>
+
+namespace Bamboo
+{
+	const VkAccessFlags k_write_access_mask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT |
+		VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+
+	static void getAccessInfo(ERenderGraphAccess access, VkImageLayout sampled_layout,
+		VkImageLayout& layout, VkPipelineStageFlags& stage_mask, VkAccessFlags& access_mask)
+	{
+		switch (access)
+		{
+		case ERenderGraphAccess::ColorAttachmentWrite:
+			layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+			stage_mask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+			access_mask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+			break;
+		case ERenderGraphAccess::DepthAttachmentWrite:
+			layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+			stage_mask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+			access_mask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+			break;
+		case ERenderGraphAccess::FragmentShaderRead:
+			layout = sampled_layout;
+			stage_mask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+			access_mask = VK_ACCESS_SHADER_READ_BIT;
+			break;
+		case ERenderGraphAccess::ComputeShaderRead:
+			layout = sampled_layout;
+			stage_mask = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+			access_mask = VK_ACCESS_SHADER_READ_BIT;
+			break;
+		case ERenderGraphAccess::TransferRead:
+			layout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+			stage_mask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+			access_mask = VK_ACCESS_TRANSFER_READ_BIT;
+			break;
+		}
+	}
+
+	void RenderGraph::destroy()
+	{
+		destroyImages();
+		m_images.clear();
+		m_passes.clear();
+	}
+
+	RenderGraphImage RenderGraph::createImage(const std::string& name, VkFormat format, VkImageUsageFlags usage, VkFilter filter)
+	{
+		Image image{};
+		image.name = name;
+		image.is_transient = true;
+		image.format = format;
+		image.usage = usage | VK_IMAGE_USAGE_SAMPLED_BIT;
+		image.filter = filter;
+		image.first_pass = UINT32_MAX;
+		image.last_pass = 0;
+		image.layout = VK_IMAGE_LAYOUT_UNDEFINED;
+		m_images.push_back(image);
+		return static_cast<RenderGraphImage>(m_images.size() - 1);
+	}
+
+	RenderGraphImage RenderGraph::importImage(const std::string& name)
+	{
+		Image image{};
+		image.name = name;
+		image.is_transient = false;
+		image.first_pass = UINT32_MAX;
+		image.last_pass = 0;
+		m_images.push_back(image);
+		return static_cast<RenderGraphImage>(m_images.size() - 1);
+	}
+
+	void RenderGraph::addPass(const std::string& name, const std::vector<RenderGraphImageAccess>& reads, const std::vector<RenderGraphImageAccess>& writes,
+		const std::function<void()>& execute, const std::function<bool()>& is_enabled, bool has_side_effects)
+	{
+		uint32_t pass_index = static_cast<uint32_t>(m_passes.size());
+		for (const auto* image_accesses : { &reads, &writes })
+		{
+			for (const RenderGraphImageAccess& image_access : *image_accesses)
+			{
+				Image& image = m_images[image_access.image];
+				image.first_pass = std::min(image.first_pass, pass_index);
+				image.last_pass = std::max(image.last_pass, pass_index);
+			}
+		}
+
+		m_passes.push_back({ name, reads, writes, execute, is_enabled, has_side_effects });
+	}
+
+	void RenderGraph::resize(uint32_t width, uint32_t height)
+	{
+		VulkanRHI::get().waitDeviceIdle();
+		destroyImages();
+
+		VkDevice device = VulkanRHI::get().getDevice();
+		std::vector<RenderGraphImage> transient_images;
+		std::vector<VkMemoryRequirements> image_memory_requirements(m_images.size());
+		for (size_t i = 0; i < m_images.size(); ++i)
+		{
+			Image& image = m_images[i];
+			if (!image.is_transient)
+			{
+				continue;
+			}
+
+			VkImageCreateInfo image_ci{};
+			image_ci.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+			image_ci.imageType = VK_IMAGE_TYPE_2D;
+			image_ci.extent = { width, height, 1 };
+			image_ci.mipLevels = 1;
+			image_ci.arrayLayers = 1;
+			image_ci.format = image.format;
+			image_ci.tiling = VK_IMAGE_TILING_OPTIMAL;
+			image_ci.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+			image_ci.usage = image.usage;
+			image_ci.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+			image_ci.samples = VK_SAMPLE_COUNT_1_BIT;
+
+			VkResult result = vkCreateImage(device, &image_ci, nullptr, &image.image_view_sampler.vma_image.image);
+			CHECK_VULKAN_RESULT(result, "create render graph image");
+			image.image_view_sampler.vma_image.allocation = VK_NULL_HANDLE;
+
+			vkGetImageMemoryRequirements(device, image.image_view_sampler.image(), &image_memory_requirements[i]);
+			transient_images.push_back(static_cast<RenderGraphImage>(i));
+		}
+
+		// place the largest images first, each into the first memory none of whose images are used by the same passes
+		std::sort(transient_images.begin(), transient_images.end(), [&](RenderGraphImage a, RenderGraphImage b) {
+			return image_memory_requirements[a].size > image_memory_requirements[b].size;
+		});
+
+		std::vector<VkMemoryRequirements> memory_requirements;
+		VkDeviceSize image_size = 0;
+		for (RenderGraphImage i : transient_images)
+		{
+			Image& image = m_images[i];
+			const VkMemoryRequirements& requirements = image_memory_requirements[i];
+			image_size += requirements.size;
+
+			image.memory_index = static_cast<uint32_t>(m_memories.size());
+			for (size_t m = 0; m < m_memories.size(); ++m)
+			{
+				bool is_overlapped = std::any_of(m_memories[m].images.begin(), m_memories[m].images.end(), [&](RenderGraphImage other) {
+					return image.first_pass <= m_images[other].last_pass && m_images[other].first_pass <= image.last_pass;
+				});
+				if (!is_overlapped && (memory_requirements[m].memoryTypeBits & requirements.memoryTypeBits))
+				{
+					image.memory_index = static_cast<uint32_t>(m);
+					break;
+				}
+			}
+
+			if (image.memory_index == m_memories.size())
+			{
+				m_memories.emplace_back();
+				memory_requirements.push_back(requirements);
+			}
+			VkMemoryRequirements& shared_requirements = memory_requirements[image.memory_index];
+			shared_requirements.size = std::max(shared_requirements.size, requirements.size);
+			shared_requirements.alignment = std::max(shared_requirements.alignment, requirements.alignment);
+			shared_requirements.memoryTypeBits &= requirements.memoryTypeBits;
+			m_memories[image.memory_index].images.push_back(i);
+		}
+
+		// allocate the shared memories and bind their images
+		VmaAllocator allocator = VulkanRHI::get().getAllocator();
+		VkDeviceSize memory_size = 0;
+		for (size_t m = 0; m < m_memories.size(); ++m)
+		{
+			VmaAllocationCreateInfo vma_alloc_ci{};
+			vma_alloc_ci.preferredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+			VkResult result = vmaAllocateMemory(allocator, &memory_requirements[m], &vma_alloc_ci, &m_memories[m].allocation, nullptr);
+			CHECK_VULKAN_RESULT(result, "allocate render graph memory");
+			memory_size += memory_requirements[m].size;
+
+			for (RenderGraphImage i : m_memories[m].images)
+			{
+				Image& image = m_images[i];
+				result = vmaBindImageMemory(allocator, m_memories[m].allocation, image.image_view_sampler.image());
+				CHECK_VULKAN_RESULT(result, "bind render graph image memory");
+
+				VmaImageViewSampler& image_view_sampler = image.image_view_sampler;
+				image_view_sampler.view = VulkanUtil::createImageView(image_view_sampler.image(), image.format, VulkanUtil::calcImageAspectFlags(image.format), 1, 1);
+				image_view_sampler.sampler = VulkanUtil::createSampler(image.filter, image.filter, 1,
+					VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE, VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE, VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE);
+				image_view_sampler.image_layout = (image.usage & VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT) ?
+					VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+				image_view_sampler.descriptor_type = (image.usage & VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT) ?
+					VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT : VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+			}
+		}
+
+		LOG_INFO("render graph aliased {} transient images into {} allocations, {:.1f}MB instead of {:.1f}MB",
+			transient_images.size(), m_memories.size(), memory_size / 1048576.0f, image_size / 1048576.0f);
+	}
+
+	void RenderGraph::execute(VkCommandBuffer command_buffer)
+	{
+		std::vector<bool> live_passes = cullPasses();
+
+		// transient images don't keep their content across frames
+		for (Image& image : m_images)
+		{
+			image.layout = VK_IMAGE_LAYOUT_UNDEFINED;
+		}
+
+		for (size_t p = 0; p < m_passes.size(); ++p)
+		{
+			if (!live_passes[p])
+			{
+				continue;
+			}
+
+			// transition the pass's transient images in one barrier
+			const Pass& pass = m_passes[p];
+			std::vector<VkImageMemoryBarrier> image_barriers;
+			VkPipelineStageFlags src_stage_mask = 0, dst_stage_mask = 0;
+			for (const auto* image_accesses : { &pass.reads, &pass.writes })
+			{
+				for (const RenderGraphImageAccess& image_access : *image_accesses)
+				{
+					addBarrier(image_access, image_barriers, src_stage_mask, dst_stage_mask);
+				}
+			}
+
+			if (!image_barriers.empty())
+			{
+				// images without a previous access only wait for the top of the pipe
+				if (src_stage_mask == 0)
+				{
+					src_stage_mask = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+				}
+				vkCmdPipelineBarrier(command_buffer, src_stage_mask, dst_stage_mask,
+					0, 0, nullptr, 0, nullptr, static_cast<uint32_t>(image_barriers.size()), image_barriers.data());
+			}
+
+			pass.execute();
+		}
+	}
+
+	void RenderGraph::destroyImages()
+	{
+		for (Image& image : m_images)
+		{
+			image.image_view_sampler.destroy();
+			image.image_view_sampler = {};
+		}
+
+		for (Memory& memory : m_memories)
+		{
+			vmaFreeMemory(VulkanRHI::get().getAllocator(), memory.allocation);
+		}
+		m_memories.clear();
+	}
+
+	std::vector<bool> RenderGraph::cullPasses()
+	{
+		// walk the passes backwards, a pass is live if it has side effects or a later live pass reads one of its writes
+		std::vector<bool> live_passes(m_passes.size(), false);
+		std::vector<bool> read_images(m_images.size(), false);
+		for (size_t p = m_passes.size(); p-- > 0;)
+		{
+			const Pass& pass = m_passes[p];
+			if (pass.is_enabled && !pass.is_enabled())
+			{
+				continue;
+			}
+
+			live_passes[p] = pass.has_side_effects || std::any_of(pass.writes.begin(), pass.writes.end(), [&](const RenderGraphImageAccess& image_access) {
+				return read_images[image_access.image];
+			});
+			if (live_passes[p])
+			{
+				for (const RenderGraphImageAccess& image_access : pass.reads)
+				{
+					read_images[image_access.image] = true;
+				}
+			}
+		}
+		return live_passes;
+	}
+
+	void RenderGraph::addBarrier(const RenderGraphImageAccess& image_access, std::vector<VkImageMemoryBarrier>& image_barriers,
+		VkPipelineStageFlags& src_stage_mask, VkPipelineStageFlags& dst_stage_mask)
+	{
+		// imported images are synchronized by their passes
+		Image& image = m_images[image_access.image];
+		if (!image.is_transient)
+		{
+			return;
+		}
+
+		VkImageLayout layout;
+		VkPipelineStageFlags stage_mask;
+		VkAccessFlags access_mask;
+		getAccessInfo(image_access.access, image.image_view_sampler.image_layout, layout, stage_mask, access_mask);
+
+		// the first access of a frame waits for the last access of any image aliasing the same memory
+		Memory& memory = m_memories[image.memory_index];
+		bool is_first_access = image.layout == VK_IMAGE_LAYOUT_UNDEFINED;
+		VkPipelineStageFlags last_stage_mask = is_first_access ? memory.stage_mask : image.stage_mask;
+		VkAccessFlags last_access_mask = is_first_access ? memory.access_mask : image.access_mask;
+
+		// reads following reads in the same layout don't need a barrier
+		bool is_write = access_mask & k_write_access_mask;
+		bool was_written = last_access_mask & k_write_access_mask;
+		if (!is_first_access && !is_write && !was_written && image.layout == layout)
+		{
+			image.stage_mask |= stage_mask;
+			image.access_mask |= access_mask;
+			memory.stage_mask |= stage_mask;
+			memory.access_mask |= access_mask;
+			return;
+		}
+
+		VkImageMemoryBarrier image_barrier{};
+		image_barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		image_barrier.srcAccessMask = last_access_mask & k_write_access_mask;
+		image_barrier.dstAccessMask = access_mask;
+		image_barrier.oldLayout = image.layout;
+		image_barrier.newLayout = layout;
+		image_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		image_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		image_barrier.image = image.image_view_sampler.image();
+		image_barrier.subresourceRange = { VulkanUtil::calcImageAspectFlags(image.format), 0, 1, 0, 1 };
+		image_barriers.push_back(image_barrier);
+
+		src_stage_mask |= last_stage_mask;
+		dst_stage_mask |= stage_mask;
+
+		image.layout = layout;
+		image.stage_mask = stage_mask;
+		image.access_mask = access_mask;
+		memory.stage_mask = stage_mask;
+		memory.access_mask = access_mask;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,95 @@
+#pragma once
+
+#include "engine/core/vulkan/vulkan_util.h"
+#include <functional>
+#include <string>
+
+namespace Bamboo
+{
+	// how a pass accesses an image, which implies the image layout, pipeline stages and access flags of its barriers
+	enum class ERenderGraphAccess
+	{
+		ColorAttachmentWrite, DepthAttachmentWrite, FragmentShaderRead, ComputeShaderRead, TransferRead
+	};
+
+	using RenderGraphImage = uint32_t;
+
+	struct RenderGraphImageAccess
+	{
+		RenderGraphImage image;
+		ERenderGraphAccess access;
+	};
+
+	// passes declare the images they read and write in execution order, every frame the graph culls the passes
+	// whose writes nobody reads, and transitions the transient images between their accesses.
+	// transient images are owned by the graph and have the render size, images whose pass ranges don't overlap alias
+	// the same memory. imported images are owned by their passes, which still synchronize them, they only order and cull passes
+	class RenderGraph
+	{
+	public:
+		void destroy();
+
+		RenderGraphImage createImage(const std::string& name, VkFormat format, VkImageUsageFlags usage, VkFilter filter = VK_FILTER_LINEAR);
+		RenderGraphImage importImage(const std::string& name);
+
+		// is_enabled is queried every frame, passes with side effects are never culled
+		void addPass(const std::string& name, const std::vector<RenderGraphImageAccess>& reads, const std::vector<RenderGraphImageAccess>& writes,
+			const std::function<void()>& execute, const std::function<bool()>& is_enabled = nullptr, bool has_side_effects = false);
+
+		// recreates the transient images and their shared memory, all passes have to be added before
+		void resize(uint32_t width, uint32_t height);
+
+		void execute(VkCommandBuffer command_buffer);
+
+		const VmaImageViewSampler& getImage(RenderGraphImage image) { return m_images[image].image_view_sampler; }
+
+	private:
+		struct Image
+		{
+			std::string name;
+			bool is_transient;
+			VkFormat format;
+			VkImageUsageFlags usage;
+			VkFilter filter;
+			VmaImageViewSampler image_view_sampler;
+
+			// first and last pass using the image, and the shared memory it's bound to
+			uint32_t first_pass;
+			uint32_t last_pass;
+			uint32_t memory_index;
+
+			// state after the last access, reset to undefined every frame since aliased memory doesn't keep the content
+			VkImageLayout layout;
+			VkPipelineStageFlags stage_mask;
+			VkAccessFlags access_mask;
+		};
+
+		struct Pass
+		{
+			std::string name;
+			std::vector<RenderGraphImageAccess> reads;
+			std::vector<RenderGraphImageAccess> writes;
+			std::function<void()> execute;
+			std::function<bool()> is_enabled;
+			bool has_side_effects;
+		};
+
+		// memory shared by transient images, the last access of any of them guards the next image's first access
+		struct Memory
+		{
+			VmaAllocation allocation = VK_NULL_HANDLE;
+			std::vector<RenderGraphImage> images;
+			VkPipelineStageFlags stage_mask = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+			VkAccessFlags access_mask = 0;
+		};
+
+		void destroyImages();
+		std::vector<bool> cullPasses();
+		void addBarrier(const RenderGraphImageAccess& image_access, std::vector<VkImageMemoryBarrier>& image_barriers,
+			VkPipelineStageFlags& src_stage_mask, VkPipelineStageFlags& dst_stage_mask);
+
+		std::vector<Image> m_images;
+		std::vector<Pass> m_passes;
+		std::vector<Memory> m_memories;
+	};
+}
\ No newline at end of file
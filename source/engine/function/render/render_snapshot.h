@@ -0,0 +1,133 @@
+#pragma once
+
+#include "engine/function/render/render_data.h"
+#include "engine/function/render/debug_draw_manager.h"
+
+#include <memory>
+#include <vector>
+
+struct ImDrawData;
+
+namespace Bamboo
+{
+	enum class ELightType
+	{
+		DirectionalLight, SkyLight, PointLight, SpotLight
+	};
+
+	struct CameraSnapshot
+	{
+		glm::vec3 position;
+		glm::vec3 forward;
+		glm::mat4 view;
+		glm::mat4 projection;
+		glm::mat4 view_proj;
+
+		// perspective projection of the view without translation
+		glm::mat4 skybox_view_proj;
+
+		float fovy;
+		float aspect_ratio;
+		float near_plane;
+		float far_plane;
+		float exposure;
+	};
+
+	// the property ui edits materials on the game thread, so their factors and textures are copied per frame
+	struct MaterialSnapshot
+	{
+		std::shared_ptr<class Texture2D> base_color_texture;
+		std::shared_ptr<class Texture2D> metallic_roughness_occlusion_texture;
+		std::shared_ptr<class Texture2D> normal_texture;
+		std::shared_ptr<class Texture2D> emissive_texture;
+
+		glm::vec4 base_color_factor;
+		glm::vec4 emissive_factor;
+		float metallic_factor;
+		float roughness_factor;
+		bool contains_occlusion_channel;
+	};
+
+	struct MeshSnapshot
+	{
+		uint32_t entity_id;
+		std::shared_ptr<class Mesh> mesh;
+
+		// one material per sub mesh
+		std::vector<MaterialSnapshot> materials;
+
+		// static meshes are also kept as such for picking them on the cpu, skeletal meshes have bone matrices instead
+		std::shared_ptr<class StaticMesh> static_mesh;
+		std::shared_ptr<BoneUBO> bone_ubo;
+		glm::mat4 model_matrix;
+
+		// static meshes drawn from the gpu scene, their snapshots are only rendered for picking and outlining
+		bool is_scene_object = false;
+	};
+
+	// the parameters of all light types, only those of the light's type are set
+	struct LightSnapshot
+	{
+		ELightType type;
+		uint32_t entity_id;
+		glm::vec3 position;
+		glm::vec3 direction;
+		glm::vec3 color;
+		bool cast_shadow = false;
+
+		// directional light
+		float cascade_frustum_near = 0.0f;
+
+		// point and spot lights
+		float radius = 0.0f;
+		float linear_attenuation = 0.0f;
+		float quadratic_attenuation = 0.0f;
+		float inner_cone_angle = 0.0f;
+		float outer_cone_angle = 0.0f;
+
+		// sky light
+		std::shared_ptr<class StaticMesh> cube_mesh;
+		VmaImageViewSampler irradiance_texture;
+		VmaImageViewSampler prefilter_texture;
+		VmaImageViewSampler brdf_lut_texture;
+		uint32_t prefilter_mip_levels = 0;
+	};
+
+	// everything the render thread needs of a game thread frame, copied out of the world when the frame is ticked.
+	// snapshots are released on the game thread, so the assets they reference are never destroyed by the render thread
+	struct RenderSnapshot
+	{
+		float delta_time = 0.0f;
+
+		CameraSnapshot camera;
+		std::vector<MeshSnapshot> meshes;
+		std::vector<LightSnapshot> lights;
+
+		// static meshes added to or changed in the gpu scene since the last snapshot, and the entities removed from it.
+		// the replaced snapshots are kept until this snapshot is released, so their assets outlive the scene's references
+		std::vector<MeshSnapshot> scene_meshes;
+		std::vector<uint32_t> removed_scene_entity_ids;
+		std::vector<MeshSnapshot> released_scene_meshes;
+
+		// editor state
+		std::vector<uint32_t> selected_entity_ids;
+		bool is_simulating = false;
+
+		// render options
+		int shader_debug_option = 0;
+		float lod_bias = 0.0f;
+		float shadow_lod_bias = 0.0f;
+		float shadow_cascade_split_lambda = 0.0f;
+
+		// pick request in window coordinates
+		bool has_pick = false;
+		uint32_t pick_x = 0;
+		uint32_t pick_y = 0;
+
+		// debug lines drawn since the last snapshot, including the bounding boxes drawn while extracting it
+		DebugDrawLines debug_lines;
+
+		// ui constructed on the game thread, its draw lists are cloned as imgui reuses them for the next frame
+		std::shared_ptr<ImDrawData> ui_draw_data;
+	};
+}
\ No newline at end of file
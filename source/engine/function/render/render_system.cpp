@@ -5,7 +5,18 @@
 #include "engine/function/framework/world/world_manager.h"
 #include "engine/resource/asset/asset_manager.h"
 #include "engine/function/render/debug_draw_manager.h"
+#include "engine/function/render/bindless_manager.h"
+#include "engine/function/render/gpu_scene.h"
+#include "engine/function/render/light_grid.h"
+#include "engine/function/render/shadow_atlas.h"
+#include "engine/function/render/render_graph.h"
+#include "engine/function/render/gpu_profiler.h"
+#include "engine/function/render/render_thread.h"
+#include "engine/function/render/window_system.h"
+#include "engine/core/config/config_manager.h"
+#include "engine/resource/shader/shader_manager.h"
 #include "engine/platform/timer/timer.h"
+#include "engine/core/profile/cpu_profiler.h"
 
 #include "engine/core/vulkan/vulkan_rhi.h"
 #include "engine/function/render/pass/directional_light_shadow_pass.h"
@@ -14,6 +25,7 @@
 #include "engine/function/render/pass/pick_pass.h"
 #include "engine/function/render/pass/outline_pass.h"
 #include "engine/function/render/pass/main_pass.h"
+#include "engine/function/render/pass/culling_pass.h"
 #include "engine/function/render/pass/postprocess_pass.h"
 #include "engine/function/render/pass/ui_pass.h"
 
@@ -31,17 +43,54 @@
 
 namespace Bamboo
 {
+	const uint64_t k_fnv_offset_basis = 0xcbf29ce484222325ull;
+
+	// fnv-1a hash of bytes, continued from the given hash
+	static void hashBytes(uint64_t& hash, const void* data, size_t size)
+	{
+		const uint8_t* p_data = reinterpret_cast<const uint8_t*>(data);
+		for (size_t i = 0; i < size; ++i)
+		{
+			hash = (hash ^ p_data[i]) * 0x100000001b3ull;
+		}
+	}
 
 	void RenderSystem::init()
 	{
+		// the bindless descriptor set layout is referenced by the main pass's pipeline layouts
+		m_bindless_manager = std::make_shared<BindlessManager>();
+		m_bindless_manager->init();
+
+		// static meshes are culled into indirect draws on the gpu where indirect draw count is supported,
+		// otherwise they're instanced by the passes' draw lists
+		if (VulkanRHI::get().isGPUDrivenSupported())
+		{
+			m_gpu_scene = std::make_shared<GPUScene>();
+			m_gpu_scene->init(m_bindless_manager);
+		}
+
+		m_light_grid = std::make_shared<LightGrid>();
+
+		// point and spot light shadow passes render into the shared shadow atlas
+		m_shadow_atlas = std::make_shared<ShadowAtlas>();
+		m_shadow_atlas->init();
+
+		// per pass gpu times and pipeline statistics for the editor's profiler
+		m_gpu_profiler = std::make_shared<GPUProfiler>();
+		m_gpu_profiler->init();
+
 		m_directional_light_shadow_pass = std::make_shared<DirectionalLightShadowPass>();
 		m_point_light_shadow_pass = std::make_shared<PointLightShadowPass>();
 		m_spot_light_shadow_pass = std::make_shared<SpotLightShadowPass>();
 		m_pick_pass = std::make_shared<PickPass>();
 		m_outline_pass = std::make_shared<OutlinePass>();
 		m_main_pass = std::make_shared<MainPass>();
+		m_culling_pass = std::make_shared<CullingPass>();
 		m_postprocess_pass = std::make_shared<class PostprocessPass>();
-		m_ui_pass = std::make_shared<UIPass>();
+		m_main_pass->setBindlessManager(m_bindless_manager);
+		m_main_pass->setGPUScene(m_gpu_scene);
+		m_point_light_shadow_pass->setShadowAtlas(m_shadow_atlas);
+		m_spot_light_shadow_pass->setShadowAtlas(m_shadow_atlas);
 
 		m_render_passes = {
 			m_directional_light_shadow_pass, 
@@ -50,14 +99,50 @@ namespace Bamboo
 			m_pick_pass,
 			m_outline_pass,
 			m_main_pass,
-			m_postprocess_pass,
-			m_ui_pass
+			m_culling_pass,
+			m_postprocess_pass
 		};
+
+		// headless runs have no window to draw the ui into and no swapchain to present
+		if (!g_engine.isHeadless())
+		{
+			m_ui_pass = std::make_shared<UIPass>();
+			m_render_passes.push_back(m_ui_pass);
+		}
 		for (auto& render_pass : m_render_passes)
 		{
 			render_pass->init();
 		}
 
+		// create the pipelines of all passes concurrently, the driver compiles them from the shared pipeline cache
+		StopWatch stop_watch;
+		stop_watch.start();
+		std::vector<std::future<void>> pipeline_futures;
+		for (auto& render_pass : m_render_passes)
+		{
+			pipeline_futures.push_back(std::async(std::launch::async, [render_pass]() { render_pass->buildPipelines(); }));
+		}
+		for (auto& pipeline_future : pipeline_futures)
+		{
+			pipeline_future.get();
+		}
+		for (auto& render_pass : m_render_passes)
+		{
+			render_pass->commitPipelines();
+		}
+		VulkanRHI::get().getPipelineCache().save();
+		LOG_INFO("created pipelines of {} render passes in {}ms from a {} pipeline cache", 
+			m_render_passes.size(), stop_watch.stopMs(), VulkanRHI::get().getPipelineCache().isWarm() ? "warm" : "cold");
+
+		// the culling pass culls gpu driven draw lists and builds the hi-z pyramid from the main pass's depth
+		m_culling_pass->setDepthTexture(m_main_pass->getDepthTexture());
+		m_directional_light_shadow_pass->setCullingPass(m_culling_pass);
+		m_point_light_shadow_pass->setCullingPass(m_culling_pass);
+		m_spot_light_shadow_pass->setCullingPass(m_culling_pass);
+		m_main_pass->setCullingPass(m_culling_pass);
+
+		createRenderGraph();
+
 		// set vulkan rhi callback functions
 		g_engine.eventSystem()->addListener(EEventType::RenderCreateSwapchainObjects, 
 			std::bind(&RenderSystem::onCreateSwapchainObjects, this, std::placeholders::_1));
@@ -74,39 +159,64 @@ namespace Bamboo
 		const auto& as = g_engine.assetManager();
 		m_default_texture_cube = as->loadAsset<TextureCube>(DEFAULT_TEXTURE_CUBE_URL);
 
-		// create lighting uniform buffers
-		m_lighting_ubs.resize(MAX_FRAMES_IN_FLIGHT);
-		for (VmaBuffer& uniform_buffer : m_lighting_ubs)
-		{
-			VulkanUtil::createBuffer(sizeof(LightingUBO), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VMA_MEMORY_USAGE_AUTO_PREFER_HOST, uniform_buffer);
-		}
 		m_lighting_icons = {
 			{ ELightType::DirectionalLight, VulkanUtil::loadImageViewSampler("asset/engine/texture/gizmo/directional_light.png") },
 			{ ELightType::SkyLight, VulkanUtil::loadImageViewSampler("asset/engine/texture/gizmo/sky_light.png") },
 			{ ELightType::PointLight, VulkanUtil::loadImageViewSampler("asset/engine/texture/gizmo/point_light.png") },
 			{ ELightType::SpotLight, VulkanUtil::loadImageViewSampler("asset/engine/texture/gizmo/spot_light.png") }
 		};
+
+		// render the frame snapshots of the game thread on a dedicated thread
+		if (g_engine.configManager()->isRenderThreadEnabled())
+		{
+			m_render_thread = std::make_shared<RenderThread>();
+			m_render_thread->init([this](const RenderSnapshot& snapshot) { renderFrame(snapshot); });
+		}
 	}
 
 	void RenderSystem::tick(float delta_time)
 	{
-		// collect render data from entities of current world
-		collectRenderDatas();
+		// copy the frame's render state out of the current world on the game thread
+		std::shared_ptr<RenderSnapshot> snapshot = extractSnapshot(delta_time);
 
-		// vulkan rendering
-		VulkanRHI::get().render();
+		// the render thread renders it while the game thread ticks the next frame
+		if (m_render_thread)
+		{
+			m_render_thread->push(snapshot);
+		}
+		else
+		{
+			renderFrame(*snapshot);
+		}
 	}
 
 	void RenderSystem::destroy()
 	{
+		// the queued frames are rendered before the render thread exits
+		if (m_render_thread)
+		{
+			m_render_thread->destroy();
+		}
+
+		// the pending pipelines of an unfinished shader reload are destroyed with their passes
+		if (m_shader_reload_future.valid())
+		{
+			m_shader_reload_future.wait();
+		}
+
 		for (auto& render_pass : m_render_passes)
 		{
 			render_pass->destroy();
 		}
-		for (VmaBuffer& uniform_buffer : m_lighting_ubs)
+		m_render_graph->destroy();
+		m_gpu_profiler->destroy();
+		if (m_gpu_scene)
 		{
-			uniform_buffer.destroy();
+			m_gpu_scene->destroy();
 		}
+		m_bindless_manager->destroy();
+		m_scene_meshes.clear();
+		m_shadow_atlas->destroy();
 
 		for (auto& iter : m_lighting_icons)
 		{
@@ -116,14 +226,42 @@ namespace Bamboo
 		m_default_texture_cube.reset();
 	}
 
+	void RenderSystem::flush()
+	{
+		if (m_render_thread)
+		{
+			m_render_thread->flush();
+		}
+	}
+
+	void RenderSystem::waitForGPU()
+	{
+		// the render thread can't be ahead once it has been flushed, so its flight index is safe to read
+		PROFILE_SCOPE("RenderSystem::waitForGPU");
+		flush();
+		VulkanRHI::get().waitFrameFence();
+	}
+
 	void RenderSystem::resize(uint32_t width, uint32_t height)
 	{
+		// the render thread mustn't record frames with the images being recreated
+		flush();
+
+		// the transient images have to exist before the passes create their framebuffers
+		m_render_graph->resize(width, height);
 		m_pick_pass->onResize(width, height);
 		m_outline_pass->onResize(width, height);
 		m_main_pass->onResize(width, height);
+		m_culling_pass->onResize(width, height);
 		m_postprocess_pass->onResize(width, height);
 	}
 
+	DrawStats RenderSystem::getDrawStats()
+	{
+		std::lock_guard<std::mutex> lock(m_draw_stats_mutex);
+		return m_last_draw_stats;
+	}
+
 	VkImageView RenderSystem::getColorImageView()
 	{
 		return m_postprocess_pass->getColorTexture().view;
@@ -132,38 +270,184 @@ namespace Bamboo
 	void RenderSystem::onCreateSwapchainObjects(const std::shared_ptr<class Event>& event)
 	{
 		const RenderCreateSwapchainObjectsEvent* p_event = static_cast<const RenderCreateSwapchainObjectsEvent*>(event.get());
-		m_ui_pass->createResizableObjects(p_event->width, p_event->height);
+		if (m_ui_pass)
+		{
+			m_ui_pass->createResizableObjects(p_event->width, p_event->height);
+		}
 	}
 
 	void RenderSystem::onDestroySwapchainObjects(const std::shared_ptr<class Event>& event)
 	{
-		m_ui_pass->destroyResizableObjects();
+		if (m_ui_pass)
+		{
+			m_ui_pass->destroyResizableObjects();
+		}
 	}
 
 	void RenderSystem::onRecordFrame(const std::shared_ptr<class Event>& event)
 	{
+		PROFILE_SCOPE("RenderSystem::onRecordFrame");
 		const RenderRecordFrameEvent* p_event = static_cast<const RenderRecordFrameEvent*>(event.get());
 
-		// ui render pass preparation
-		if (m_ui_pass->isEnabled())
+		// upload this frame's bindless materials and textures
+		m_bindless_manager->update();
+
+		// copy the gpu scene's changed objects before any view culls them
+		VkCommandBuffer command_buffer = VulkanRHI::get().getCommandBuffer();
+		if (m_gpu_scene)
 		{
-			m_ui_pass->prepare();
+			m_gpu_scene->upload(command_buffer);
 		}
 
+		// upload the debug lines of the snapshot being rendered
+		g_engine.debugDrawSystem()->endFrame(m_render_snapshot->debug_lines);
+
 		// render pass rendering
-		for (auto& render_pass : m_render_passes)
+		m_draw_stats.reset();
+		m_gpu_profiler->beginFrame(command_buffer);
+		m_render_graph->execute(command_buffer);
+	}
+
+	void RenderSystem::createRenderGraph()
+	{
+		// passes own the images which persist across frames or are sampled outside of the graph, they're imported
+		m_render_graph = std::make_shared<RenderGraph>();
+		m_outline_pass->setRenderGraph(m_render_graph);
+		m_main_pass->setRenderGraph(m_render_graph);
+		RenderGraphImage directional_light_shadow = m_render_graph->importImage("directional_light_shadow");
+		RenderGraphImage shadow_atlas = m_render_graph->importImage("shadow_atlas");
+		RenderGraphImage main_color = m_render_graph->importImage("main_color");
+		RenderGraphImage main_depth = m_render_graph->importImage("main_depth");
+		RenderGraphImage postprocess_color = m_render_graph->importImage("postprocess_color");
+		RenderGraphImage outline_mask = m_outline_pass->getMaskImage();
+		RenderGraphImage outline_color = m_outline_pass->getColorImage();
+
+		auto addRenderPass = [this](const std::string& name, const std::shared_ptr<RenderPass>& render_pass,
+			const std::vector<RenderGraphImageAccess>& reads, const std::vector<RenderGraphImageAccess>& writes, bool has_side_effects = false) {
+			const char* profile_name = CPUProfiler::get().internName(name);
+			m_render_graph->addPass(name, reads, writes, [this, name, profile_name, render_pass]() {
+				PROFILE_SCOPE(profile_name);
+				VkCommandBuffer command_buffer = VulkanRHI::get().getCommandBuffer();
+				m_gpu_profiler->beginScope(command_buffer, name);
+				render_pass->render();
+				m_gpu_profiler->endScope(command_buffer);
+				m_draw_stats += render_pass->getDrawStats();
+			}, [render_pass]() { return render_pass->isEnabled(); }, has_side_effects);
+		};
+
+		addRenderPass("directional_light_shadow", m_directional_light_shadow_pass, {},
+			{ { directional_light_shadow, ERenderGraphAccess::DepthAttachmentWrite } });
+		addRenderPass("point_light_shadow", m_point_light_shadow_pass, {},
+			{ { shadow_atlas, ERenderGraphAccess::DepthAttachmentWrite } });
+		addRenderPass("spot_light_shadow", m_spot_light_shadow_pass, {},
+			{ { shadow_atlas, ERenderGraphAccess::DepthAttachmentWrite } });
+
+		// picking renders on its own instant command buffer and reads back the entity ids
+		addRenderPass("pick", m_pick_pass, {}, {}, true);
+
+		addRenderPass("outline", m_outline_pass, {},
+			{ { outline_mask, ERenderGraphAccess::ColorAttachmentWrite } });
+		std::shared_ptr<OutlinePass> outline_pass = m_outline_pass;
+		m_render_graph->addPass("outline_blur", { { outline_mask, ERenderGraphAccess::FragmentShaderRead } },
+			{ { outline_color, ERenderGraphAccess::ColorAttachmentWrite } }, [this, outline_pass]() {
+				PROFILE_SCOPE("outline_blur");
+				VkCommandBuffer command_buffer = VulkanRHI::get().getCommandBuffer();
+				m_gpu_profiler->beginScope(command_buffer, "outline_blur");
+				outline_pass->renderBlur();
+				m_gpu_profiler->endScope(command_buffer);
+			}, [outline_pass]() { return outline_pass->isEnabled(); });
+
+		std::vector<RenderGraphImageAccess> main_writes = { 
+			{ main_color, ERenderGraphAccess::ColorAttachmentWrite }, 
+			{ main_depth, ERenderGraphAccess::DepthAttachmentWrite } 
+		};
+		for (RenderGraphImage gbuffer_image : m_main_pass->getGBufferImages())
 		{
-			if (render_pass->isEnabled())
+			main_writes.push_back({ gbuffer_image, ERenderGraphAccess::ColorAttachmentWrite });
+		}
+		addRenderPass("main", m_main_pass, { 
+			{ directional_light_shadow, ERenderGraphAccess::FragmentShaderRead }, 
+			{ shadow_atlas, ERenderGraphAccess::FragmentShaderRead } 
+		}, main_writes);
+
+		// the hi-z pyramid built from the main depth culls the next frame's draws
+		addRenderPass("culling", m_culling_pass, { { main_depth, ERenderGraphAccess::ComputeShaderRead } }, {}, true);
+
+		addRenderPass("postprocess", m_postprocess_pass, {
+			{ main_color, ERenderGraphAccess::FragmentShaderRead },
+			{ outline_color, ERenderGraphAccess::FragmentShaderRead }
+		}, { { postprocess_color, ERenderGraphAccess::ColorAttachmentWrite } }, !m_ui_pass);
+
+		// the ui pass presents the swapchain image, headless runs keep the postprocess color as their offscreen target
+		if (m_ui_pass)
+		{
+			addRenderPass("ui", m_ui_pass, { { postprocess_color, ERenderGraphAccess::FragmentShaderRead } }, {}, true);
+		}
+	}
+
+	void RenderSystem::updateShaderHotReload(float delta_time)
+	{
+		// commit the rebuilt pipelines at the frame boundary, the replaced ones may still be used by frames in flight
+		const auto& shader_manager = g_engine.shaderManager();
+		if (m_shader_reload_future.valid())
+		{
+			if (m_shader_reload_future.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
 			{
-				render_pass->render();
+				return;
 			}
+
+			std::vector<std::shared_ptr<RenderPass>> rebuilt_render_passes = m_shader_reload_future.get();
+			if (!rebuilt_render_passes.empty())
+			{
+				VulkanRHI::get().waitDeviceIdle();
+				for (auto& render_pass : rebuilt_render_passes)
+				{
+					for (VkPipeline pipeline : render_pass->commitPipelines())
+					{
+						vkDestroyPipeline(VulkanRHI::get().getDevice(), pipeline, nullptr);
+					}
+				}
+				LOG_INFO("reloaded pipelines of {} render passes", rebuilt_render_passes.size());
+			}
+			shader_manager->destroyRetiredShaderModules();
+			return;
+		}
+
+		const float k_shader_poll_interval = 0.5f;
+		m_shader_poll_time += delta_time;
+		if (m_shader_poll_time < k_shader_poll_interval)
+		{
+			return;
+		}
+		m_shader_poll_time = 0.0f;
+		if (!shader_manager->pollShaderChanges())
+		{
+			return;
 		}
+
+		// compile the changed shaders and rebuild the pipelines of the passes using them on a worker thread
+		std::vector<std::shared_ptr<RenderPass>> render_passes = m_render_passes;
+		m_shader_reload_future = std::async(std::launch::async, [render_passes]() {
+			std::vector<std::shared_ptr<RenderPass>> rebuilt_render_passes;
+			std::vector<std::string> shader_names = g_engine.shaderManager()->compileShaders();
+			for (const auto& render_pass : render_passes)
+			{
+				if (render_pass->usesAnyShader(shader_names))
+				{
+					render_pass->buildPipelines();
+					rebuilt_render_passes.push_back(render_pass);
+				}
+			}
+			return rebuilt_render_passes;
+		});
 	}
 
 	void RenderSystem::onPickEntity(const std::shared_ptr<class Event>& event)
 	{
 		const PickEntityEvent* p_event = static_cast<const PickEntityEvent*>(event.get());
-		m_pick_pass->pick(p_event->mouse_x, p_event->mouse_y);
+		m_has_pick = true;
+		m_pick_x = p_event->mouse_x;
+		m_pick_y = p_event->mouse_y;
 	}
 
 	void RenderSystem::onSelectEntity(const std::shared_ptr<class Event>& event)
@@ -173,12 +457,29 @@ namespace Bamboo
 		m_selected_entity_ids = { p_event->entity_id };
 	}
 
-	void RenderSystem::collectRenderDatas()
+	std::shared_ptr<RenderSnapshot> RenderSystem::extractSnapshot(float delta_time)
 	{
-		// mesh render datas
-		std::vector<std::shared_ptr<RenderData>> mesh_render_datas, selected_mesh_render_datas;
-		std::vector<std::shared_ptr<BillboardRenderData>> billboard_render_datas, selected_billboard_render_datas;
-		std::vector<uint32_t> mesh_entity_ids, billboard_entity_ids;
+		PROFILE_SCOPE("RenderSystem::extractSnapshot");
+		std::shared_ptr<RenderSnapshot> snapshot = std::make_shared<RenderSnapshot>();
+		snapshot->delta_time = delta_time;
+
+		// construct the ui first, so its edits, selections and picks are part of this frame
+		if (m_ui_pass && m_ui_pass->isEnabled())
+		{
+			snapshot->ui_draw_data = m_ui_pass->prepare();
+		}
+
+		// editor state and render options
+		snapshot->selected_entity_ids = m_selected_entity_ids;
+		snapshot->is_simulating = g_engine.isSimulating();
+		snapshot->shader_debug_option = m_shader_debug_option;
+		snapshot->lod_bias = m_lod_bias;
+		snapshot->shadow_lod_bias = m_shadow_lod_bias;
+		snapshot->shadow_cascade_split_lambda = m_shadow_cascade_split_lambda;
+		snapshot->has_pick = m_has_pick;
+		snapshot->pick_x = m_pick_x;
+		snapshot->pick_y = m_pick_y;
+		m_has_pick = false;
 
 		// get current active world
 		const auto& current_world = g_engine.worldManager()->getCurrentWorld();
@@ -188,49 +489,33 @@ namespace Bamboo
 		auto camera_transform_component = camera_entity.lock()->getComponent(TransformComponent);
 		auto camera_component = camera_entity.lock()->getComponent(CameraComponent);
 
-		// set render datas
-		const VmaImageViewSampler& default_texture_2d = g_engine.assetManager()->getDefaultTexture2D();
-		std::shared_ptr<LightingRenderData> lighting_render_data = std::make_shared<LightingRenderData>();
-		lighting_render_data->camera_view_proj = camera_component->getViewProjectionMatrix();
-		lighting_render_data->brdf_lut_texture = default_texture_2d;
-		lighting_render_data->irradiance_texture = m_default_texture_cube->m_image_view_sampler;
-		lighting_render_data->prefilter_texture = m_default_texture_cube->m_image_view_sampler;
-		lighting_render_data->directional_light_shadow_texture = m_directional_light_shadow_pass->getShadowImageViewSampler();
-		lighting_render_data->point_light_shadow_textures.resize(MAX_POINT_LIGHT_NUM);
-		lighting_render_data->spot_light_shadow_textures.resize(MAX_SPOT_LIGHT_NUM);
-		for (uint32_t i = 0; i < MAX_POINT_LIGHT_NUM; ++i)
-		{
-			lighting_render_data->point_light_shadow_textures[i] = m_default_texture_cube->m_image_view_sampler;
-		}
-		for (uint32_t i = 0; i < MAX_SPOT_LIGHT_NUM; ++i)
-		{
-			lighting_render_data->spot_light_shadow_textures[i] = default_texture_2d;
-		}
-		std::shared_ptr<SkyboxRenderData> skybox_render_data = nullptr;
-
-		// shadow create infos
-		ShadowCascadeCreateInfo shadow_cascade_ci{};
-		shadow_cascade_ci.camera_near = camera_component->m_near;
-		shadow_cascade_ci.camera_far = camera_component->m_far;
-		shadow_cascade_ci.inv_camera_view_proj = glm::inverse(camera_component->getViewProjectionMatrix());
-
-		std::vector<ShadowCubeCreateInfo> shadow_cube_cis;
-		std::vector<ShadowFrustumCreateInfo> shadow_frustum_cis;
-
-		// set lighting uniform buffer object
-		LightingUBO lighting_ubo;
-		lighting_ubo.camera_pos = camera_transform_component->m_position;
-		lighting_ubo.camera_dir = camera_transform_component->getForwardVector();
-		lighting_ubo.exposure = camera_component->m_exposure;
-		lighting_ubo.camera_view = camera_component->getViewMatrix();
-		lighting_ubo.inv_camera_view_proj = glm::inverse(camera_component->getViewProjectionMatrix());
-		lighting_ubo.has_sky_light = lighting_ubo.has_directional_light = false;
-		lighting_ubo.point_light_num = lighting_ubo.spot_light_num = 0;
-		lighting_ubo.shader_debug_option = m_shader_debug_option;
-
-		// get debug draw manager
+		CameraSnapshot& camera = snapshot->camera;
+		camera.position = camera_transform_component->m_position;
+		camera.forward = camera_transform_component->getForwardVector();
+		camera.view = camera_component->getViewMatrix();
+		camera.projection = camera_component->getProjectionMatrix();
+		camera.view_proj = camera_component->getViewProjectionMatrix();
+		camera.skybox_view_proj = camera_component->getProjectionMatrix(EProjectionType::Perspective) * camera_component->getViewMatrixNoTranslation();
+		camera.fovy = camera_component->m_fovy;
+		camera.aspect_ratio = camera_component->m_aspect_ratio;
+		camera.near_plane = camera_component->m_near;
+		camera.far_plane = camera_component->m_far;
+		camera.exposure = camera_component->m_exposure;
+
+		// get debug draw manager, its lines are taken into the snapshot after all of them have been drawn
 		const auto& ddm = g_engine.debugDrawSystem();
-		ddm->clear();
+
+		auto addLight = [&snapshot](ELightType type, uint32_t entity_id, const std::shared_ptr<TransformComponent>& transform_component,
+			const std::shared_ptr<LightComponent>& light_component) -> LightSnapshot& {
+			LightSnapshot& light = snapshot->lights.emplace_back();
+			light.type = type;
+			light.entity_id = entity_id;
+			light.position = transform_component->m_position;
+			light.direction = transform_component->getForwardVector();
+			light.color = light_component->getColor();
+			light.cast_shadow = light_component->m_cast_shadow;
+			return light;
+		};
 
 		// traverse all entities
 		const auto& entities = current_world->getEntities();
@@ -238,207 +523,490 @@ namespace Bamboo
 		{
 			const auto& entity = iter.second;
 
-			// get static/skeletal mesh component render data
+			// get static/skeletal mesh component
 			auto static_mesh_component = entity->getComponent(StaticMeshComponent);
 			auto skeletal_mesh_component = entity->getComponent(SkeletalMeshComponent);
 
-			if (static_mesh_component || skeletal_mesh_component)
+			std::shared_ptr<Mesh> mesh = nullptr;
+			if (static_mesh_component)
+			{
+				mesh = static_mesh_component->getStaticMesh();
+			}
+			else if (skeletal_mesh_component)
+			{
+				mesh = skeletal_mesh_component->getSkeletalMesh();
+			}
+
+			if (mesh)
 			{
-				// get transform component
 				auto transform_component = entity->getComponent(TransformComponent);
 
-				std::shared_ptr<Mesh> mesh = nullptr;
-				if (static_mesh_component)
+				MeshSnapshot mesh_snapshot;
+				mesh_snapshot.entity_id = entity->getID();
+				mesh_snapshot.mesh = mesh;
+				mesh_snapshot.model_matrix = transform_component->getGlobalMatrix();
+				for (const SubMesh& sub_mesh : mesh->m_sub_meshes)
 				{
-					mesh = static_mesh_component->getStaticMesh();
+					mesh_snapshot.materials.push_back(snapshotMaterial(*sub_mesh.m_material));
+				}
+				if (skeletal_mesh_component)
+				{
+					auto animator_component = entity->getComponent(AnimatorComponent);
+					mesh_snapshot.bone_ubo = std::make_shared<BoneUBO>(animator_component->getBoneUBO());
 				}
 				else
 				{
-					mesh = skeletal_mesh_component->getSkeletalMesh();
+					mesh_snapshot.static_mesh = static_mesh_component->getStaticMesh();
+				}
+
+				// draw mesh bounding boxes
+				if ((m_show_debug_option & (1 << 1)) == (1 << 1))
+				{
+					BoundingBox bounding_box = mesh->m_bounding_box.transform(mesh_snapshot.model_matrix);
+					ddm->drawBox(bounding_box.center(), bounding_box.extent(), k_zero_vector, Color3::Yellow);
 				}
 
-				if (mesh)
+				// static meshes of the gpu scene are only passed to the render thread when they change,
+				// and for picking and outlining them
+				bool needs_render_data = true;
+				if (m_gpu_scene && !skeletal_mesh_component)
 				{
-					// draw mesh bounding boxes
-					BoundingBox bounding_box = mesh->m_bounding_box.transform(transform_component->getGlobalMatrix());
-					if ((m_show_debug_option & (1 << 1)) == (1 << 1))
+					mesh_snapshot.is_scene_object = true;
+					SceneMesh& scene_mesh = m_scene_meshes[mesh_snapshot.entity_id];
+					if (!scene_mesh.mesh_snapshot.mesh || !isMeshSnapshotEqual(scene_mesh.mesh_snapshot, mesh_snapshot))
 					{
-						ddm->drawBox(bounding_box.center(), bounding_box.extent(), k_zero_vector, Color3::Yellow);
+						if (scene_mesh.mesh_snapshot.mesh)
+						{
+							snapshot->released_scene_meshes.push_back(std::move(scene_mesh.mesh_snapshot));
+						}
+						scene_mesh.mesh_snapshot = mesh_snapshot;
+						snapshot->scene_meshes.push_back(mesh_snapshot);
 					}
+					scene_mesh.snapshot_index = m_snapshot_index;
 
-					// create mesh render data
-					bool is_skeletal_mesh = skeletal_mesh_component != nullptr;
-					std::shared_ptr<StaticMeshRenderData> static_mesh_render_data = nullptr;
-					std::shared_ptr<SkeletalMeshRenderData> skeletal_mesh_render_data = nullptr;
+					const std::vector<uint32_t>& selected_entity_ids = snapshot->selected_entity_ids;
+					needs_render_data = snapshot->has_pick ||
+						std::find(selected_entity_ids.begin(), selected_entity_ids.end(), mesh_snapshot.entity_id) != selected_entity_ids.end();
+				}
+				if (needs_render_data)
+				{
+					snapshot->meshes.push_back(std::move(mesh_snapshot));
+				}
+			}
 
-					if (is_skeletal_mesh)
-					{
-						skeletal_mesh_render_data = std::make_shared<SkeletalMeshRenderData>();
-						static_mesh_render_data = skeletal_mesh_render_data;
-					}
-					else
-					{
-						static_mesh_render_data = std::make_shared<StaticMeshRenderData>();
-					}
+			// get directional light component
+			auto directional_light_component = entity->getComponent(DirectionalLightComponent);
+			if (directional_light_component)
+			{
+				LightSnapshot& light = addLight(ELightType::DirectionalLight, entity->getID(),
+					entity->getComponent(TransformComponent), directional_light_component);
+				light.cascade_frustum_near = directional_light_component->m_cascade_frustum_near;
+			}
 
-					static_mesh_render_data->type = is_skeletal_mesh ? ERenderDataType::SkeletalMesh : ERenderDataType::StaticMesh;
-					static_mesh_render_data->vertex_buffer = mesh->m_vertex_buffer;
-					static_mesh_render_data->index_buffer = mesh->m_index_buffer;
+			// get sky light component
+			auto sky_light_component = entity->getComponent(SkyLightComponent);
+			if (sky_light_component)
+			{
+				LightSnapshot& light = addLight(ELightType::SkyLight, entity->getID(),
+					entity->getComponent(TransformComponent), sky_light_component);
+				light.cube_mesh = sky_light_component->m_cube_mesh;
+				light.irradiance_texture = sky_light_component->m_irradiance_texture_sampler;
+				light.prefilter_texture = sky_light_component->m_prefilter_texture_sampler;
+				light.brdf_lut_texture = sky_light_component->m_brdf_lut_texture_sampler;
+				light.prefilter_mip_levels = sky_light_component->m_prefilter_mip_levels;
+			}
 
-					// update uniform buffers
-					if (is_skeletal_mesh)
-					{
-						auto animator_component = entity->getComponent(AnimatorComponent);
-						skeletal_mesh_render_data->bone_ubs = animator_component->m_bone_ubs;
-					}
+			// get point light component
+			auto point_light_component = entity->getComponent(PointLightComponent);
+			if (point_light_component)
+			{
+				LightSnapshot& light = addLight(ELightType::PointLight, entity->getID(),
+					entity->getComponent(TransformComponent), point_light_component);
+				light.radius = point_light_component->m_radius;
+				light.linear_attenuation = point_light_component->m_linear_attenuation;
+				light.quadratic_attenuation = point_light_component->m_quadratic_attenuation;
+			}
 
-					// update push constants
-					static_mesh_render_data->transform_pco.m = transform_component->getGlobalMatrix();
-					static_mesh_render_data->transform_pco.nm = glm::transpose(glm::inverse(glm::mat3(static_mesh_render_data->transform_pco.m)));
-					static_mesh_render_data->transform_pco.mvp = camera_component->getViewProjectionMatrix() * static_mesh_render_data->transform_pco.m;
+			// get spot light component
+			auto spot_light_component = entity->getComponent(SpotLightComponent);
+			if (spot_light_component)
+			{
+				LightSnapshot& light = addLight(ELightType::SpotLight, entity->getID(),
+					entity->getComponent(TransformComponent), spot_light_component);
+				light.radius = spot_light_component->m_radius;
+				light.linear_attenuation = spot_light_component->m_linear_attenuation;
+				light.quadratic_attenuation = spot_light_component->m_quadratic_attenuation;
+				light.inner_cone_angle = spot_light_component->m_inner_cone_angle;
+				light.outer_cone_angle = spot_light_component->m_outer_cone_angle;
+			}
+		}
 
-					// traverse all sub meshes
-					for (size_t i = 0; i < mesh->m_sub_meshes.size(); ++i)
-					{
-						const auto& sub_mesh = mesh->m_sub_meshes[i];
-
-						static_mesh_render_data->index_counts.push_back(sub_mesh.m_index_count);
-						static_mesh_render_data->index_offsets.push_back(sub_mesh.m_index_offset);
-
-						MaterialPCO material_pco;
-						material_pco.base_color_factor = sub_mesh.m_material->m_base_color_factor;
-						material_pco.emissive_factor = sub_mesh.m_material->m_emissive_factor;
-						material_pco.m_metallic_factor = sub_mesh.m_material->m_metallic_factor;
-						material_pco.m_roughness_factor = sub_mesh.m_material->m_roughness_factor;
-						material_pco.has_base_color_texture = sub_mesh.m_material->m_base_color_texure != nullptr;
-						material_pco.has_emissive_texture = sub_mesh.m_material->m_emissive_texure != nullptr;
-						material_pco.has_metallic_roughness_occlusion_texture = sub_mesh.m_material->m_metallic_roughness_occlusion_texure != nullptr;
-						material_pco.contains_occlusion_channel = sub_mesh.m_material->m_contains_occlusion_channel;
-						material_pco.has_normal_texture = sub_mesh.m_material->m_normal_texure != nullptr;
-						static_mesh_render_data->material_pcos.push_back(material_pco);
-
-						static_mesh_render_data->pbr_textures.push_back({
-							sub_mesh.m_material->m_base_color_texure ? sub_mesh.m_material->m_base_color_texure->m_image_view_sampler : default_texture_2d,
-							sub_mesh.m_material->m_metallic_roughness_occlusion_texure ? sub_mesh.m_material->m_metallic_roughness_occlusion_texure->m_image_view_sampler : default_texture_2d,
-							sub_mesh.m_material->m_normal_texure ? sub_mesh.m_material->m_normal_texure->m_image_view_sampler : default_texture_2d,
-							sub_mesh.m_material->m_emissive_texure ? sub_mesh.m_material->m_emissive_texure->m_image_view_sampler : default_texture_2d
-						});
-					}
+		// entities which weren't visited have been destroyed or had their static mesh removed
+		for (auto iter = m_scene_meshes.begin(); iter != m_scene_meshes.end();)
+		{
+			if (iter->second.snapshot_index != m_snapshot_index)
+			{
+				snapshot->removed_scene_entity_ids.push_back(iter->first);
+				snapshot->released_scene_meshes.push_back(std::move(iter->second.mesh_snapshot));
+				iter = m_scene_meshes.erase(iter);
+			}
+			else
+			{
+				++iter;
+			}
+		}
+		m_snapshot_index++;
 
-					mesh_render_datas.push_back(static_mesh_render_data);
-					if (std::find(m_selected_entity_ids.begin(), m_selected_entity_ids.end(), entity->getID()) != m_selected_entity_ids.end())
-					{
-						selected_mesh_render_datas.push_back(static_mesh_render_data);
-					}
-				}
+		// lines drawn after this belong to the next snapshot
+		ddm->takeLines(snapshot->debug_lines);
+
+		return snapshot;
+	}
+
+	MaterialSnapshot RenderSystem::snapshotMaterial(const Material& material)
+	{
+		MaterialSnapshot material_snapshot;
+		material_snapshot.base_color_texture = material.m_base_color_texure;
+		material_snapshot.metallic_roughness_occlusion_texture = material.m_metallic_roughness_occlusion_texure;
+		material_snapshot.normal_texture = material.m_normal_texure;
+		material_snapshot.emissive_texture = material.m_emissive_texure;
+		material_snapshot.base_color_factor = material.m_base_color_factor;
+		material_snapshot.emissive_factor = material.m_emissive_factor;
+		material_snapshot.metallic_factor = material.m_metallic_factor;
+		material_snapshot.roughness_factor = material.m_roughness_factor;
+		material_snapshot.contains_occlusion_channel = material.m_contains_occlusion_channel;
+		return material_snapshot;
+	}
 
-				mesh_entity_ids.push_back(entity->getID());
+	bool RenderSystem::isMeshSnapshotEqual(const MeshSnapshot& a, const MeshSnapshot& b)
+	{
+		// compares what the gpu scene's objects are built from
+		if (a.mesh != b.mesh || a.model_matrix != b.model_matrix || a.materials.size() != b.materials.size())
+		{
+			return false;
+		}
+
+		for (size_t i = 0; i < a.materials.size(); ++i)
+		{
+			const MaterialSnapshot& ma = a.materials[i];
+			const MaterialSnapshot& mb = b.materials[i];
+			if (ma.base_color_texture != mb.base_color_texture ||
+				ma.metallic_roughness_occlusion_texture != mb.metallic_roughness_occlusion_texture ||
+				ma.normal_texture != mb.normal_texture ||
+				ma.emissive_texture != mb.emissive_texture ||
+				ma.base_color_factor != mb.base_color_factor ||
+				ma.emissive_factor != mb.emissive_factor ||
+				ma.metallic_factor != mb.metallic_factor ||
+				ma.roughness_factor != mb.roughness_factor ||
+				ma.contains_occlusion_channel != mb.contains_occlusion_channel)
+			{
+				return false;
 			}
+		}
+		return true;
+	}
 
-			// get directional light component
-			auto directional_light_component = entity->getComponent(DirectionalLightComponent);
-			if (directional_light_component)
+	void RenderSystem::renderFrame(const RenderSnapshot& snapshot)
+	{
+		PROFILE_SCOPE("RenderSystem::renderFrame");
+		// apply the gpu scene's changes of every snapshot, including those of frames which aren't rendered
+		if (m_gpu_scene)
+		{
+			for (uint32_t entity_id : snapshot.removed_scene_entity_ids)
 			{
-				auto transform_component = entity->getComponent(TransformComponent);
+				m_gpu_scene->removeEntity(entity_id);
+			}
+			for (const MeshSnapshot& mesh_snapshot : snapshot.scene_meshes)
+			{
+				m_gpu_scene->updateEntity(mesh_snapshot);
+			}
+		}
 
-				// set lighting uniform buffer object
-				lighting_ubo.has_directional_light = true;
-				lighting_ubo.directional_light.direction = transform_component->getForwardVector();
-				lighting_ubo.directional_light.color = directional_light_component->getColor();
-				lighting_ubo.directional_light.cast_shadow = directional_light_component->m_cast_shadow;
+		// a minimized window has no swapchain to render to, the render thread can't wait for it to be restored
+		int width, height;
+		g_engine.windowSystem()->getFramebufferSize(width, height);
+		if (m_render_thread && (width == 0 || height == 0))
+		{
+			return;
+		}
+
+		// swap in pipelines rebuilt from changed shaders
+		updateShaderHotReload(snapshot.delta_time);
 
-				shadow_cascade_ci.light_dir = transform_component->getForwardVector();
-				shadow_cascade_ci.light_cascade_frustum_near = directional_light_component->m_cascade_frustum_near;
+		// collect render data from the snapshot of the current world
+		collectRenderDatas(snapshot);
 
-				addBillboardRenderData(transform_component, camera_component, billboard_render_datas,
-					selected_billboard_render_datas, billboard_entity_ids, ELightType::DirectionalLight);
+		// picking reads back this frame's render datas
+		if (snapshot.has_pick)
+		{
+			m_pick_pass->pick(snapshot.pick_x, snapshot.pick_y);
+		}
+
+		// the snapshot's ui draw data outlives the recording of the frame
+		if (m_ui_pass)
+		{
+			m_ui_pass->setDrawData(snapshot.ui_draw_data.get());
+		}
+
+		// vulkan rendering, the frame is recorded from the snapshot
+		m_render_snapshot = &snapshot;
+		VulkanRHI::get().render();
+		m_render_snapshot = nullptr;
+
+		std::lock_guard<std::mutex> lock(m_draw_stats_mutex);
+		m_last_draw_stats = m_draw_stats;
+	}
+
+	void RenderSystem::collectRenderDatas(const RenderSnapshot& snapshot)
+	{
+		PROFILE_SCOPE("RenderSystem::collectRenderDatas");
+		// bindless materials and textures of the meshes outside of the gpu scene are collected again every frame
+		m_bindless_manager->reset();
+
+		// mesh render datas, the gpu scene's objects are only collected for picking and outlining them
+		std::vector<std::shared_ptr<RenderData>> mesh_render_datas, selected_mesh_render_datas, pick_render_datas;
+		std::vector<std::shared_ptr<BillboardRenderData>> billboard_render_datas, selected_billboard_render_datas;
+		std::vector<uint32_t> mesh_entity_ids, billboard_entity_ids;
+		std::vector<PickMeshData> pick_mesh_datas;
+
+		const CameraSnapshot& camera = snapshot.camera;
+		const std::vector<uint32_t>& selected_entity_ids = snapshot.selected_entity_ids;
+
+		// set render datas
+		const VmaImageViewSampler& default_texture_2d = g_engine.assetManager()->getDefaultTexture2D();
+		std::shared_ptr<LightingRenderData> lighting_render_data = std::make_shared<LightingRenderData>();
+		lighting_render_data->camera_view_proj = camera.view_proj;
+		lighting_render_data->brdf_lut_texture = default_texture_2d;
+		lighting_render_data->irradiance_texture = m_default_texture_cube->m_image_view_sampler;
+		lighting_render_data->prefilter_texture = m_default_texture_cube->m_image_view_sampler;
+		lighting_render_data->directional_light_shadow_texture = m_directional_light_shadow_pass->getShadowImageViewSampler();
+		lighting_render_data->shadow_atlas_texture = m_shadow_atlas->getImageViewSampler();
+		std::shared_ptr<SkyboxRenderData> skybox_render_data = nullptr;
+
+		// shadow create infos
+		ShadowCascadeCreateInfo shadow_cascade_ci{};
+		shadow_cascade_ci.camera_near = camera.near_plane;
+		shadow_cascade_ci.camera_far = camera.far_plane;
+		shadow_cascade_ci.inv_camera_view_proj = glm::inverse(camera.view_proj);
+		shadow_cascade_ci.cascade_split_lambda = snapshot.shadow_cascade_split_lambda;
+
+		std::vector<ShadowCubeCreateInfo> shadow_cube_cis;
+		std::vector<ShadowFrustumCreateInfo> shadow_frustum_cis;
+
+		// point and spot lights are uploaded to storage buffers, shadow casting lights are kept
+		// as their light index and entity id until all shadow casters are collected
+		std::vector<PointLight> point_lights;
+		std::vector<SpotLight> spot_lights;
+		std::vector<std::pair<uint32_t, uint32_t>> shadow_point_lights, shadow_spot_lights;
+
+		// set lighting uniform buffer object
+		LightingUBO lighting_ubo;
+		lighting_ubo.camera_pos = camera.position;
+		lighting_ubo.camera_dir = camera.forward;
+		lighting_ubo.exposure = camera.exposure;
+		lighting_ubo.camera_view = camera.view;
+		lighting_ubo.camera_view_proj = camera.view_proj;
+		lighting_ubo.inv_camera_view_proj = glm::inverse(camera.view_proj);
+		lighting_ubo.has_sky_light = lighting_ubo.has_directional_light = false;
+		lighting_ubo.point_light_num = lighting_ubo.spot_light_num = 0;
+		lighting_ubo.shader_debug_option = snapshot.shader_debug_option;
+
+		// traverse all meshes
+		for (const MeshSnapshot& mesh_snapshot : snapshot.meshes)
+		{
+			const std::shared_ptr<Mesh>& mesh = mesh_snapshot.mesh;
+			BoundingBox bounding_box = mesh->m_bounding_box.transform(mesh_snapshot.model_matrix);
+
+			// create mesh render data
+			bool is_skeletal_mesh = mesh_snapshot.bone_ubo != nullptr;
+			std::shared_ptr<StaticMeshRenderData> static_mesh_render_data = nullptr;
+			std::shared_ptr<SkeletalMeshRenderData> skeletal_mesh_render_data = nullptr;
+
+			if (is_skeletal_mesh)
+			{
+				skeletal_mesh_render_data = std::make_shared<SkeletalMeshRenderData>();
+				static_mesh_render_data = skeletal_mesh_render_data;
+			}
+			else
+			{
+				static_mesh_render_data = std::make_shared<StaticMeshRenderData>();
 			}
 
-			// get sky light component
-			auto sky_light_component = entity->getComponent(SkyLightComponent);
-			if (sky_light_component)
+			static_mesh_render_data->type = is_skeletal_mesh ? ERenderDataType::SkeletalMesh : ERenderDataType::StaticMesh;
+			static_mesh_render_data->vertex_buffer = mesh->m_vertex_buffer;
+			static_mesh_render_data->index_buffer = mesh->m_index_buffer;
+			static_mesh_render_data->index_type = mesh->m_index_type;
+			static_mesh_render_data->bounding_box = bounding_box;
+
+			// upload bone matrices
+			if (is_skeletal_mesh)
 			{
-				auto transform_component = entity->getComponent(TransformComponent);
+				BoneUBO bone_ubo = *mesh_snapshot.bone_ubo;
+				bone_ubo.position_offset = glm::vec4(mesh->m_position_offset, 0.0f);
+				bone_ubo.position_scale = glm::vec4(mesh->m_position_scale, 0.0f);
+				skeletal_mesh_render_data->bone_ub = VulkanRHI::get().getUploadRing().allocate(&bone_ubo, sizeof(BoneUBO));
+			}
+
+			// select lods of the view and shadow passes from the projected bounding sphere size
+			uint32_t lod = selectMeshLOD(bounding_box, camera, snapshot.lod_bias);
+			uint32_t shadow_lod = selectMeshLOD(bounding_box, camera, snapshot.shadow_lod_bias);
 
+			// update push constants, packed static mesh positions are dequantized by their model matrix,
+			// skeletal meshes dequantize before skinning, so their model matrix stays untouched
+			const glm::mat4& model_matrix = mesh_snapshot.model_matrix;
+			static_mesh_render_data->transform_pco.m = is_skeletal_mesh ? model_matrix : model_matrix * mesh->getDequantizeMatrix();
+			static_mesh_render_data->transform_pco.nm = glm::transpose(glm::inverse(glm::mat3(model_matrix)));
+			static_mesh_render_data->transform_pco.mvp = camera.view_proj * static_mesh_render_data->transform_pco.m;
+
+			// traverse all sub meshes
+			for (size_t i = 0; i < mesh->m_sub_meshes.size(); ++i)
+			{
+				const auto& sub_mesh = mesh->m_sub_meshes[i];
+
+				uint32_t index_offset, index_count;
+				sub_mesh.getLODIndexRange(lod, index_offset, index_count);
+				static_mesh_render_data->index_counts.push_back(index_count);
+				static_mesh_render_data->index_offsets.push_back(index_offset);
+
+				sub_mesh.getLODIndexRange(shadow_lod, index_offset, index_count);
+				static_mesh_render_data->shadow_index_counts.push_back(index_count);
+				static_mesh_render_data->shadow_index_offsets.push_back(index_offset);
+
+				auto addTexture = [this](const std::shared_ptr<Texture2D>& texture) {
+					return texture ? m_bindless_manager->addTexture(texture->m_image_view_sampler) : INVALID_TEXTURE_INDEX;
+				};
+
+				MaterialData material_data{};
+				const MaterialSnapshot& material = mesh_snapshot.materials[i];
+				material_data.base_color_factor = material.base_color_factor;
+				material_data.emissive_factor = material.emissive_factor;
+				material_data.metallic_factor = material.metallic_factor;
+				material_data.roughness_factor = material.roughness_factor;
+				material_data.contains_occlusion_channel = material.contains_occlusion_channel;
+				material_data.base_color_texture_index = addTexture(material.base_color_texture);
+				material_data.metallic_roughness_occlusion_texture_index = addTexture(material.metallic_roughness_occlusion_texture);
+				material_data.normal_texture_index = addTexture(material.normal_texture);
+				material_data.emissive_texture_index = addTexture(material.emissive_texture);
+				static_mesh_render_data->material_indices.push_back(m_bindless_manager->addMaterial(material_data));
+
+				static_mesh_render_data->material_features.push_back(BindlessManager::getMaterialFeatures(material_data));
+
+				static_mesh_render_data->pbr_textures.push_back({
+					material.base_color_texture ? material.base_color_texture->m_image_view_sampler : default_texture_2d,
+					material.metallic_roughness_occlusion_texture ? material.metallic_roughness_occlusion_texture->m_image_view_sampler : default_texture_2d,
+					material.normal_texture ? material.normal_texture->m_image_view_sampler : default_texture_2d,
+					material.emissive_texture ? material.emissive_texture->m_image_view_sampler : default_texture_2d
+				});
+			}
+
+			// static meshes are picked by their bvh on the cpu
+			PickMeshData pick_mesh_data;
+			pick_mesh_data.entity_id = mesh_snapshot.entity_id;
+			pick_mesh_data.static_mesh = mesh_snapshot.static_mesh;
+			pick_mesh_data.model_matrix = model_matrix;
+			pick_mesh_data.bounding_box = bounding_box;
+			pick_mesh_datas.push_back(pick_mesh_data);
+
+			// the main and shadow passes draw the gpu scene's objects from its object buffer
+			if (!mesh_snapshot.is_scene_object)
+			{
+				mesh_render_datas.push_back(static_mesh_render_data);
+			}
+			pick_render_datas.push_back(static_mesh_render_data);
+			if (std::find(selected_entity_ids.begin(), selected_entity_ids.end(), mesh_snapshot.entity_id) != selected_entity_ids.end())
+			{
+				selected_mesh_render_datas.push_back(static_mesh_render_data);
+			}
+			mesh_entity_ids.push_back(mesh_snapshot.entity_id);
+		}
+
+		// traverse all lights
+		for (const LightSnapshot& light : snapshot.lights)
+		{
+			if (light.type == ELightType::DirectionalLight)
+			{
+				// set lighting uniform buffer object
+				lighting_ubo.has_directional_light = true;
+				lighting_ubo.directional_light.direction = light.direction;
+				lighting_ubo.directional_light.color = light.color;
+				lighting_ubo.directional_light.cast_shadow = light.cast_shadow;
+
+				shadow_cascade_ci.light_dir = light.direction;
+				shadow_cascade_ci.light_cascade_frustum_near = light.cascade_frustum_near;
+				shadow_cascade_ci.light_cast_shadow = light.cast_shadow;
+			}
+			else if (light.type == ELightType::SkyLight)
+			{
 				// set lighting render data
-				lighting_render_data->brdf_lut_texture = sky_light_component->m_brdf_lut_texture_sampler;
-				lighting_render_data->irradiance_texture = sky_light_component->m_irradiance_texture_sampler;
-				lighting_render_data->prefilter_texture = sky_light_component->m_prefilter_texture_sampler;
+				lighting_render_data->brdf_lut_texture = light.brdf_lut_texture;
+				lighting_render_data->irradiance_texture = light.irradiance_texture;
+				lighting_render_data->prefilter_texture = light.prefilter_texture;
 
 				// set skybox render data
 				skybox_render_data = std::make_shared<SkyboxRenderData>();
-				std::shared_ptr<StaticMesh> skybox_cube_mesh = sky_light_component->m_cube_mesh;
+				const std::shared_ptr<StaticMesh>& skybox_cube_mesh = light.cube_mesh;
 				skybox_render_data->vertex_buffer = skybox_cube_mesh->m_vertex_buffer;
 				skybox_render_data->index_buffer = skybox_cube_mesh->m_index_buffer;
+				skybox_render_data->index_type = skybox_cube_mesh->m_index_type;
 				skybox_render_data->index_count = skybox_cube_mesh->m_sub_meshes.front().m_index_count;
-				skybox_render_data->transform_pco.mvp = camera_component->getProjectionMatrix(EProjectionType::Perspective) * camera_component->getViewMatrixNoTranslation();
-				skybox_render_data->env_texture = sky_light_component->m_prefilter_texture_sampler;
+				skybox_render_data->transform_pco.m = skybox_cube_mesh->getDequantizeMatrix();
+				skybox_render_data->transform_pco.mvp = camera.skybox_view_proj * skybox_render_data->transform_pco.m;
+				skybox_render_data->env_texture = light.prefilter_texture;
 
 				// set lighting uniform buffer object
 				lighting_ubo.has_sky_light = true;
-				lighting_ubo.sky_light.color = sky_light_component->getColor();
-				lighting_ubo.sky_light.prefilter_mip_levels = sky_light_component->m_prefilter_mip_levels;
-
-				addBillboardRenderData(transform_component, camera_component, billboard_render_datas,
-					selected_billboard_render_datas, billboard_entity_ids, ELightType::SkyLight);
+				lighting_ubo.sky_light.color = light.color;
+				lighting_ubo.sky_light.prefilter_mip_levels = light.prefilter_mip_levels;
 			}
-
-			// get point light component
-			auto point_light_component = entity->getComponent(PointLightComponent);
-			if (point_light_component)
+			else if (light.type == ELightType::PointLight)
 			{
-				auto transform_component = entity->getComponent(TransformComponent);
+				if (point_lights.size() == MAX_POINT_LIGHT_NUM)
+				{
+					continue;
+				}
 
-				// set lighting uniform buffer object
-				PointLight& point_light = lighting_ubo.point_lights[lighting_ubo.point_light_num++];
-				point_light.position = transform_component->m_position;
-				point_light.color = point_light_component->getColor();
-				point_light.radius = point_light_component->m_radius;
-				point_light.linear_attenuation = point_light_component->m_linear_attenuation;
-				point_light.quadratic_attenuation = point_light_component->m_quadratic_attenuation;
-				point_light.cast_shadow = point_light_component->m_cast_shadow;
-
-				ShadowCubeCreateInfo shadow_cube_ci;
-				shadow_cube_ci.light_pos = transform_component->m_position;
-				shadow_cube_ci.light_far =point_light_component->m_radius;
-				shadow_cube_ci.light_near = camera_component->m_near;
-				shadow_cube_cis.push_back(shadow_cube_ci);
-
-				addBillboardRenderData(transform_component, camera_component, billboard_render_datas,
-					selected_billboard_render_datas, billboard_entity_ids, ELightType::PointLight);
-			}
+				// set point light
+				PointLight& point_light = point_lights.emplace_back();
+				point_light.position = light.position;
+				point_light.color = light.color;
+				point_light.radius = light.radius;
+				point_light.linear_attenuation = light.linear_attenuation;
+				point_light.quadratic_attenuation = light.quadratic_attenuation;
+				point_light.shadow_index = INVALID_SHADOW_INDEX;
 
-			// get point light component
-			auto spot_light_component = entity->getComponent(SpotLightComponent);
-			if (spot_light_component)
+				if (light.cast_shadow)
+				{
+					shadow_point_lights.push_back({ static_cast<uint32_t>(point_lights.size() - 1), light.entity_id });
+				}
+			}
+			else if (light.type == ELightType::SpotLight)
 			{
-				auto transform_component = entity->getComponent(TransformComponent);
+				if (spot_lights.size() == MAX_SPOT_LIGHT_NUM)
+				{
+					continue;
+				}
 
-				// set lighting uniform buffer object
-				SpotLight& spot_light = lighting_ubo.spot_lights[lighting_ubo.spot_light_num++];
+				// set spot light
+				SpotLight& spot_light = spot_lights.emplace_back();
 				PointLight& point_light = spot_light._pl;
-				point_light.position = transform_component->m_position;
-				point_light.color = spot_light_component->getColor();
-				point_light.radius = spot_light_component->m_radius;
-				point_light.linear_attenuation = spot_light_component->m_linear_attenuation;
-				point_light.quadratic_attenuation = spot_light_component->m_quadratic_attenuation;
-				point_light.cast_shadow = spot_light_component->m_cast_shadow;
-				point_light.padding0 = std::cos(glm::radians(spot_light_component->m_inner_cone_angle));
-				point_light.padding1 = std::cos(glm::radians(spot_light_component->m_outer_cone_angle));
-
-				spot_light.direction = transform_component->getForwardVector();
-
-				ShadowFrustumCreateInfo shadow_frustum_ci;
-				shadow_frustum_ci.light_pos = transform_component->m_position;
-				shadow_frustum_ci.light_dir = spot_light.direction;
-				shadow_frustum_ci.light_angle = spot_light_component->m_outer_cone_angle;
-				shadow_frustum_ci.light_far = spot_light_component->m_radius;
-				shadow_frustum_ci.light_near = camera_component->m_near;
-				shadow_frustum_cis.push_back(shadow_frustum_ci);
-
-				addBillboardRenderData(transform_component, camera_component, billboard_render_datas, 
-					selected_billboard_render_datas, billboard_entity_ids, ELightType::SpotLight);
+				point_light.position = light.position;
+				point_light.color = light.color;
+				point_light.radius = light.radius;
+				point_light.linear_attenuation = light.linear_attenuation;
+				point_light.quadratic_attenuation = light.quadratic_attenuation;
+				point_light.shadow_index = INVALID_SHADOW_INDEX;
+				point_light.padding0 = std::cos(glm::radians(light.inner_cone_angle));
+				point_light.padding1 = std::cos(glm::radians(light.outer_cone_angle));
+
+				spot_light.direction = light.direction;
+
+				if (light.cast_shadow)
+				{
+					shadow_spot_lights.push_back({ static_cast<uint32_t>(spot_lights.size() - 1), light.entity_id });
+				}
 			}
+
+			addBillboardRenderData(light, snapshot, billboard_render_datas, selected_billboard_render_datas, billboard_entity_ids);
 		}
 
 		// directional light shadow pass: n mesh datas
@@ -449,88 +1017,154 @@ namespace Bamboo
 			for (uint32_t i = 0; i < SHADOW_CASCADE_NUM; ++i)
 			{
 				lighting_ubo.directional_light.cascade_splits[i] = m_directional_light_shadow_pass->m_cascade_splits[i];
-				lighting_ubo.directional_light.cascade_view_projs[i] = m_directional_light_shadow_pass->m_shadow_cascade_ubo.cascade_view_projs[i];
+				lighting_ubo.directional_light.cascade_view_projs[i] = m_directional_light_shadow_pass->m_cascade_view_projs[i];
 			}
 
 			if (lighting_ubo.directional_light.cast_shadow)
 			{
 				m_directional_light_shadow_pass->setRenderDatas(mesh_render_datas);
+				m_directional_light_shadow_pass->setGPUScene(m_gpu_scene);
 			}
 		}
 
-		// point light shadow pass: n mesh datas
-		if (lighting_ubo.point_light_num > 0)
+		// allocate shadow atlas tiles sized by the lights' screen coverage, tiles keep their cached depth
+		// while the light and the shadow casters in its range don't change
+		m_shadow_atlas->beginFrame();
+		for (const auto& shadow_point_light : shadow_point_lights)
 		{
-			m_point_light_shadow_pass->updateCubes(shadow_cube_cis);
-			const auto& point_light_shadow_textures = m_point_light_shadow_pass->getShadowImageViewSamplers();
-			for (size_t i = 0; i < point_light_shadow_textures.size(); ++i)
+			PointLight& point_light = point_lights[shadow_point_light.first];
+
+			ShadowCubeCreateInfo shadow_cube_ci;
+			shadow_cube_ci.light_pos = point_light.position;
+			shadow_cube_ci.light_far = point_light.radius;
+			shadow_cube_ci.light_near = camera.near_plane;
+
+			uint64_t content_hash = k_fnv_offset_basis;
+			hashBytes(content_hash, &shadow_cube_ci.light_pos, sizeof(glm::vec3));
+			hashBytes(content_hash, &shadow_cube_ci.light_near, sizeof(float));
+			hashBytes(content_hash, &shadow_cube_ci.light_far, sizeof(float));
+			bool is_dynamic = hashShadowCasters(content_hash, point_light.position, point_light.radius, mesh_render_datas);
+
+			uint64_t light_id = static_cast<uint64_t>(shadow_point_light.second) << 1;
+			uint32_t tile_size = ShadowAtlas::calcTileSize(calcScreenSize(point_light.position, point_light.radius, camera));
+			const ShadowAtlasAllocation* allocation = m_shadow_atlas->allocate(light_id, tile_size, SHADOW_FACE_NUM, content_hash, is_dynamic);
+			if (!allocation)
 			{
-				lighting_render_data->point_light_shadow_textures[i] = point_light_shadow_textures[i];
+				continue;
 			}
 
-			bool cast_shadow = false;
-			for (uint32_t i = 0; i < lighting_ubo.point_light_num; ++i)
-			{
-				if (lighting_ubo.point_lights[i].cast_shadow)
-				{
-					cast_shadow = true;
-					break;
-				}
-			}
-
-			if (cast_shadow)
-			{
-				m_point_light_shadow_pass->setRenderDatas(mesh_render_datas);
-			}
+			point_light.shadow_index = static_cast<int>(shadow_cube_cis.size() * SHADOW_FACE_NUM);
+			shadow_cube_ci.tile_size = allocation->tile_size;
+			shadow_cube_ci.tile_offsets = allocation->tile_offsets;
+			shadow_cube_ci.dirty = allocation->dirty;
+			shadow_cube_cis.push_back(shadow_cube_ci);
 		}
 
-		// spot light shadow pass: n mesh datas
-		if (lighting_ubo.spot_light_num > 0)
+		for (const auto& shadow_spot_light : shadow_spot_lights)
 		{
-			m_spot_light_shadow_pass->updateFrustums(shadow_frustum_cis);
-			const auto& spot_light_shadow_textures = m_spot_light_shadow_pass->getShadowImageViewSamplers();
-			for (size_t i = 0; i < spot_light_shadow_textures.size(); ++i)
+			SpotLight& spot_light = spot_lights[shadow_spot_light.first];
+			PointLight& point_light = spot_light._pl;
+
+			ShadowFrustumCreateInfo shadow_frustum_ci;
+			shadow_frustum_ci.light_pos = point_light.position;
+			shadow_frustum_ci.light_dir = spot_light.direction;
+			shadow_frustum_ci.light_angle = glm::degrees(std::acos(point_light.padding1));
+			shadow_frustum_ci.light_far = point_light.radius;
+			shadow_frustum_ci.light_near = camera.near_plane;
+
+			uint64_t content_hash = k_fnv_offset_basis;
+			hashBytes(content_hash, &shadow_frustum_ci.light_pos, sizeof(glm::vec3));
+			hashBytes(content_hash, &shadow_frustum_ci.light_dir, sizeof(glm::vec3));
+			hashBytes(content_hash, &shadow_frustum_ci.light_angle, sizeof(float));
+			hashBytes(content_hash, &shadow_frustum_ci.light_near, sizeof(float));
+			hashBytes(content_hash, &shadow_frustum_ci.light_far, sizeof(float));
+			bool is_dynamic = hashShadowCasters(content_hash, point_light.position, point_light.radius, mesh_render_datas);
+
+			uint64_t light_id = (static_cast<uint64_t>(shadow_spot_light.second) << 1) | 1;
+			uint32_t tile_size = ShadowAtlas::calcTileSize(calcScreenSize(point_light.position, point_light.radius, camera));
+			const ShadowAtlasAllocation* allocation = m_shadow_atlas->allocate(light_id, tile_size, 1, content_hash, is_dynamic);
+			if (!allocation)
 			{
-				lighting_render_data->spot_light_shadow_textures[i] = spot_light_shadow_textures[i];
+				continue;
 			}
 
-			bool cast_shadow = false;
-			for (uint32_t i = 0; i < lighting_ubo.spot_light_num; ++i)
-			{
-				lighting_ubo.spot_lights[i].view_proj = m_spot_light_shadow_pass->m_light_view_projs[i];
-				if (lighting_ubo.spot_lights[i]._pl.cast_shadow)
-				{
-					cast_shadow = true;
-				}
-			}
+			// spot light shadow views follow the point light shadow views
+			point_light.shadow_index = static_cast<int>(shadow_cube_cis.size() * SHADOW_FACE_NUM + shadow_frustum_cis.size());
+			shadow_frustum_ci.tile_size = allocation->tile_size;
+			shadow_frustum_ci.tile_offset = allocation->tile_offsets.front();
+			shadow_frustum_ci.dirty = allocation->dirty;
+			shadow_frustum_cis.push_back(shadow_frustum_ci);
+		}
+		m_shadow_atlas->endFrame();
 
-			if (cast_shadow)
-			{
-				m_spot_light_shadow_pass->setRenderDatas(mesh_render_datas);
-			}
+		// point light shadow pass: n mesh datas, only dirty cube faces are rendered
+		m_point_light_shadow_pass->updateCubes(shadow_cube_cis);
+		if (m_point_light_shadow_pass->hasDirtyViews())
+		{
+			m_point_light_shadow_pass->setRenderDatas(mesh_render_datas);
+			m_point_light_shadow_pass->setGPUScene(m_gpu_scene);
 		}
 
-		// update lighting uniform buffers
-		VmaBuffer uniform_buffer = m_lighting_ubs[VulkanRHI::get().getFlightIndex()];
-		VulkanUtil::updateBuffer(uniform_buffer, (void*)&lighting_ubo, sizeof(LightingUBO));
-		lighting_render_data->lighting_ubs = m_lighting_ubs;
+		// spot light shadow pass: n mesh datas, only dirty frustums are rendered
+		m_spot_light_shadow_pass->updateFrustums(shadow_frustum_cis);
+		if (m_spot_light_shadow_pass->hasDirtyViews())
+		{
+			m_spot_light_shadow_pass->setRenderDatas(mesh_render_datas);
+			m_spot_light_shadow_pass->setGPUScene(m_gpu_scene);
+		}
+
+		std::vector<ShadowView> shadow_views = m_point_light_shadow_pass->getShadowViews();
+		const auto& spot_light_shadow_views = m_spot_light_shadow_pass->getShadowViews();
+		shadow_views.insert(shadow_views.end(), spot_light_shadow_views.begin(), spot_light_shadow_views.end());
+
+		// cull point and spot lights into the light clusters
+		m_light_grid->build(point_lights, spot_lights, camera.view, camera.projection, camera.near_plane, camera.far_plane);
+		lighting_ubo.point_light_num = static_cast<int>(point_lights.size());
+		lighting_ubo.spot_light_num = static_cast<int>(spot_lights.size());
+		lighting_ubo.light_cluster_z_scale = m_light_grid->getZScale();
+		lighting_ubo.light_cluster_z_bias = m_light_grid->getZBias();
+
+		// storage buffers can't be empty, so they keep one unreferenced element
+		point_lights.resize(std::max(point_lights.size(), size_t(1)));
+		spot_lights.resize(std::max(spot_lights.size(), size_t(1)));
+		std::vector<uint32_t> light_indices = m_light_grid->getLightIndices();
+		light_indices.resize(std::max(light_indices.size(), size_t(1)));
+		shadow_views.resize(std::max(shadow_views.size(), size_t(1)));
+
+		// upload lighting uniform buffer and light storage buffers
+		UploadRing& upload_ring = VulkanRHI::get().getUploadRing();
+		lighting_render_data->lighting_ub = upload_ring.allocate(&lighting_ubo, sizeof(LightingUBO));
+		lighting_render_data->point_light_sb = upload_ring.allocate(point_lights.data(), sizeof(PointLight) * point_lights.size());
+		lighting_render_data->spot_light_sb = upload_ring.allocate(spot_lights.data(), sizeof(SpotLight) * spot_lights.size());
+		lighting_render_data->light_cluster_sb = upload_ring.allocate(m_light_grid->getClusters().data(), sizeof(LightCluster) * m_light_grid->getClusters().size());
+		lighting_render_data->light_index_sb = upload_ring.allocate(light_indices.data(), sizeof(uint32_t) * light_indices.size());
+		lighting_render_data->shadow_view_sb = upload_ring.allocate(shadow_views.data(), sizeof(ShadowView) * shadow_views.size());
 
 		// pick pass
-		m_pick_pass->setRenderDatas(mesh_render_datas);
+		m_pick_pass->setRenderDatas(pick_render_datas);
 		m_pick_pass->setBillboardRenderDatas(billboard_render_datas);
 		mesh_entity_ids.insert(mesh_entity_ids.end(), billboard_entity_ids.begin(), billboard_entity_ids.end());
 		m_pick_pass->setEntityIDs(mesh_entity_ids);
+		m_pick_pass->setPickMeshDatas(pick_mesh_datas);
+		m_pick_pass->setCameraViewProj(camera.view_proj);
 
 		// outline pass
-		m_outline_pass->setRenderDatas(!g_engine.isSimulating() ? selected_mesh_render_datas : std::vector<std::shared_ptr<RenderData>>{});
-		m_outline_pass->setBillboardRenderDatas(!g_engine.isSimulating() ? selected_billboard_render_datas : std::vector<std::shared_ptr<BillboardRenderData>>{});
+		m_outline_pass->setRenderDatas(!snapshot.is_simulating ? selected_mesh_render_datas : std::vector<std::shared_ptr<RenderData>>{});
+		m_outline_pass->setBillboardRenderDatas(!snapshot.is_simulating ? selected_billboard_render_datas : std::vector<std::shared_ptr<BillboardRenderData>>{});
 
 		// main pass
 		m_main_pass->setLightingRenderData(lighting_render_data);
 		m_main_pass->setSkyboxRenderData(skybox_render_data);
-		m_main_pass->setBillboardRenderDatas(!g_engine.isSimulating() ? billboard_render_datas : std::vector<std::shared_ptr<BillboardRenderData>>{});
+		m_main_pass->setBillboardRenderDatas(!snapshot.is_simulating ? billboard_render_datas : std::vector<std::shared_ptr<BillboardRenderData>>{});
 		m_main_pass->setRenderDatas(mesh_render_datas);
 
+		// the culling pass selects the gpu scene's lods like selectMeshLOD, from the camera and the lod biases
+		m_culling_pass->setLODCamera(camera.position, camera.fovy, snapshot.lod_bias, snapshot.shadow_lod_bias);
+		if (m_gpu_scene)
+		{
+			m_gpu_scene->clearChanges();
+		}
+
 		// postprocess pass
 		std::shared_ptr<PostProcessRenderData> postprocess_render_data = std::make_shared<PostProcessRenderData>();
 		postprocess_render_data->p_color_texture = m_main_pass->getColorTexture();
@@ -539,16 +1173,15 @@ namespace Bamboo
 	}
 
 	void RenderSystem::addBillboardRenderData(
-		std::shared_ptr<class TransformComponent> transform_component,
-		std::shared_ptr<class CameraComponent> camera_component,
+		const LightSnapshot& light,
+		const RenderSnapshot& snapshot,
 		std::vector<std::shared_ptr<BillboardRenderData>>& billboard_render_datas,
 		std::vector<std::shared_ptr<BillboardRenderData>>& selected_billboard_render_datas,
-		std::vector<uint32_t>& billboard_entity_ids,
-		ELightType light_type)
+		std::vector<uint32_t>& billboard_entity_ids)
 	{
 		std::shared_ptr<BillboardRenderData> billboard_render_data = std::make_shared<BillboardRenderData>();
-		const glm::vec3& billboard_pos = transform_component->m_position;
-		const glm::vec3& camera_pos = camera_component->getPosition();
+		const glm::vec3& billboard_pos = light.position;
+		const glm::vec3& camera_pos = snapshot.camera.position;
 
 		const float k_min_size = 0.005f;
 		const float k_max_size = 0.05f;
@@ -557,18 +1190,72 @@ namespace Bamboo
 
 		float dist = glm::distance(billboard_pos, camera_pos);
 		float size = MathUtil::mapRangeValueClamped(dist, k_min_dist, k_max_dist, k_max_size, k_min_size);
-		billboard_render_data->position = camera_component->getViewProjectionMatrix() * glm::vec4(billboard_pos, 1.0f);
+		billboard_render_data->position = snapshot.camera.view_proj * glm::vec4(billboard_pos, 1.0f);
 		billboard_render_data->position /= billboard_render_data->position.w;
-		billboard_render_data->size = glm::vec2(size, size * camera_component->m_aspect_ratio);
-		billboard_render_data->texture = m_lighting_icons[light_type];
+		billboard_render_data->size = glm::vec2(size, size * snapshot.camera.aspect_ratio);
+		billboard_render_data->texture = m_lighting_icons[light.type];
 
-		uint32_t entity_id = transform_component->getParent().lock()->getID();
+		const std::vector<uint32_t>& selected_entity_ids = snapshot.selected_entity_ids;
 		billboard_render_datas.push_back(billboard_render_data);
-		if (std::find(m_selected_entity_ids.begin(), m_selected_entity_ids.end(), entity_id) != m_selected_entity_ids.end())
+		if (std::find(selected_entity_ids.begin(), selected_entity_ids.end(), light.entity_id) != selected_entity_ids.end())
 		{
 			selected_billboard_render_datas.push_back(billboard_render_data);
 		}
-		billboard_entity_ids.push_back(entity_id);
+		billboard_entity_ids.push_back(light.entity_id);
+	}
+
+	uint32_t RenderSystem::selectMeshLOD(const BoundingBox& bounding_box, const CameraSnapshot& camera, float lod_bias)
+	{
+		// lod 0 is kept while the bounding sphere covers at least this fraction of the screen height,
+		// every coarser lod halves the covered fraction
+		const float k_lod0_screen_size = 0.5f;
+		const uint32_t k_max_lod = 8;
+
+		float screen_size = calcScreenSize(bounding_box.center(), glm::length(bounding_box.extent()), camera);
+		float lod = std::log2(k_lod0_screen_size / screen_size) + lod_bias;
+		return static_cast<uint32_t>(std::clamp(lod, 0.0f, static_cast<float>(k_max_lod)));
+	}
+
+	float RenderSystem::calcScreenSize(const glm::vec3& center, float radius, const CameraSnapshot& camera)
+	{
+		// fraction of the half screen height covered by a bounding sphere, spheres around the camera cover all of it
+		float distance = glm::distance(center, camera.position);
+		if (distance <= radius)
+		{
+			return std::numeric_limits<float>::max();
+		}
+
+		return radius / (distance * std::tan(glm::radians(camera.fovy) * 0.5f));
+	}
+
+	bool RenderSystem::hashShadowCasters(uint64_t& hash, const glm::vec3& light_pos, float light_radius,
+		const std::vector<std::shared_ptr<RenderData>>& mesh_render_datas)
+	{
+		// hash the meshes, transforms and shadow lods of the casters whose bounds overlap the light's range,
+		// skinned casters change every frame, so a shadow containing them is never cached.
+		// the gpu scene's casters aren't hashed, their changes within the range re-render the shadow once
+		bool has_skeletal_mesh = false;
+		for (const auto& render_data : mesh_render_datas)
+		{
+			const auto& static_mesh_render_data = std::static_pointer_cast<StaticMeshRenderData>(render_data);
+			const BoundingBox& bounding_box = static_mesh_render_data->bounding_box;
+			glm::vec3 d = glm::clamp(light_pos, bounding_box.m_min, bounding_box.m_max) - light_pos;
+			if (glm::dot(d, d) > light_radius * light_radius)
+			{
+				continue;
+			}
+
+			has_skeletal_mesh |= static_mesh_render_data->type == ERenderDataType::SkeletalMesh;
+			hashBytes(hash, &static_mesh_render_data->vertex_buffer.buffer, sizeof(VkBuffer));
+			hashBytes(hash, &static_mesh_render_data->transform_pco.m, sizeof(glm::mat4));
+			hashBytes(hash, static_mesh_render_data->shadow_index_offsets.data(), sizeof(uint32_t) * static_mesh_render_data->shadow_index_offsets.size());
+			hashBytes(hash, static_mesh_render_data->shadow_index_counts.data(), sizeof(uint32_t) * static_mesh_render_data->shadow_index_counts.size());
+			for (const PBRTexture& pbr_texture : static_mesh_render_data->pbr_textures)
+			{
+				hashBytes(hash, &pbr_texture.base_color_texure.view, sizeof(VkImageView));
+			}
+		}
+		return has_skeletal_mesh || (m_gpu_scene && m_gpu_scene->isChangedInRange(light_pos, light_radius));
 	}
 
 }
\ No newline at end of file
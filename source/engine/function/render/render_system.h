@@ -1,18 +1,17 @@
 #pragma once
 
 #include "engine/function/render/pass/render_pass.h"
+#include "engine/function/render/render_snapshot.h"
 
 #include <map>
 #include <memory>
 #include <functional>
+#include <future>
+#include <mutex>
+#include <unordered_map>
 
 namespace Bamboo
 {
-	enum class ELightType
-	{
-		DirectionalLight, SkyLight, PointLight, SpotLight
-	};
-
 	class RenderSystem
 	{
 	public:
@@ -20,9 +19,25 @@ namespace Bamboo
 		void tick(float delta_time);
 		void destroy();
 
+		// waits until the render thread has rendered all ticked frames, before render resources are changed from the game thread
+		void flush();
+
+		// waits until the gpu can take the next frame, so input sampled afterwards isn't queued behind other frames
+		void waitForGPU();
+
 		void resize(uint32_t width, uint32_t height);
 		void setShaderDebugOption(int option) { m_shader_debug_option = option; }
 		void setShowDebugOption(int option) { m_show_debug_option = option; }
+		int getShowDebugOption() { return m_show_debug_option; }
+		DrawStats getDrawStats();
+		std::shared_ptr<class GPUProfiler> getGPUProfiler() { return m_gpu_profiler; }
+
+		// positive biases select coarser mesh lods, shadow passes have their own bias
+		void setLODBias(float lod_bias) { m_lod_bias = lod_bias; }
+		void setShadowLODBias(float shadow_lod_bias) { m_shadow_lod_bias = shadow_lod_bias; }
+
+		// blends the directional light shadow cascade splits between uniform (0) and logarithmic (1)
+		void setShadowCascadeSplitLambda(float shadow_cascade_split_lambda) { m_shadow_cascade_split_lambda = shadow_cascade_split_lambda; }
 
 		VkImageView getColorImageView();
 
@@ -32,15 +47,30 @@ namespace Bamboo
 		void onRecordFrame(const std::shared_ptr<class Event>& event);
 		void onPickEntity(const std::shared_ptr<class Event>& event);
 		void onSelectEntity(const std::shared_ptr<class Event>& event);
+		void updateShaderHotReload(float delta_time);
+		void createRenderGraph();
+
+		// copies the current world and the editor state on the game thread
+		std::shared_ptr<RenderSnapshot> extractSnapshot(float delta_time);
+		static MaterialSnapshot snapshotMaterial(const class Material& material);
+		static bool isMeshSnapshotEqual(const MeshSnapshot& a, const MeshSnapshot& b);
+
+		// renders a snapshot on the render thread, or on the game thread if there is none
+		void renderFrame(const RenderSnapshot& snapshot);
 
-		void collectRenderDatas();
+		void collectRenderDatas(const RenderSnapshot& snapshot);
 		void addBillboardRenderData(
-			std::shared_ptr<class TransformComponent> transform_component,
-			std::shared_ptr<class CameraComponent> camera_component,
+			const LightSnapshot& light,
+			const RenderSnapshot& snapshot,
 			std::vector<std::shared_ptr<BillboardRenderData>>& billboard_render_datas, 
 			std::vector<std::shared_ptr<BillboardRenderData>>& selected_billboard_render_datas,
-			std::vector<uint32_t>& billboard_entity_ids,
-			ELightType light_type);
+			std::vector<uint32_t>& billboard_entity_ids);
+		uint32_t selectMeshLOD(const BoundingBox& bounding_box, const CameraSnapshot& camera, float lod_bias);
+		float calcScreenSize(const glm::vec3& center, float radius, const CameraSnapshot& camera);
+
+		// continues a shadow's content hash with its casters, returns whether any of them is skinned or a gpu scene object in range changed
+		bool hashShadowCasters(uint64_t& hash, const glm::vec3& light_pos, float light_radius,
+			const std::vector<std::shared_ptr<RenderData>>& mesh_render_datas);
 
 		// render passes
 		std::shared_ptr<class DirectionalLightShadowPass> m_directional_light_shadow_pass;
@@ -49,20 +79,68 @@ namespace Bamboo
 		std::shared_ptr<class PickPass> m_pick_pass;
 		std::shared_ptr<class OutlinePass> m_outline_pass;
 		std::shared_ptr<class MainPass> m_main_pass;
+		std::shared_ptr<class CullingPass> m_culling_pass;
 		std::shared_ptr<class PostprocessPass> m_postprocess_pass;
 		std::shared_ptr<class UIPass> m_ui_pass;
 		std::vector<std::shared_ptr<RenderPass>> m_render_passes;
 
+		// orders and culls the render passes every frame, and owns their transient images
+		std::shared_ptr<class RenderGraph> m_render_graph;
+
+		// bindless materials and textures of the main pass
+		std::shared_ptr<class BindlessManager> m_bindless_manager;
+
+		// static meshes culled and drawn on the gpu, null if indirect draw count isn't supported
+		std::shared_ptr<class GPUScene> m_gpu_scene;
+
+		// the game thread's copies of the gpu scene's meshes, with the index of the last snapshot containing their entity
+		struct SceneMesh
+		{
+			MeshSnapshot mesh_snapshot;
+			uint32_t snapshot_index = 0;
+		};
+		std::unordered_map<uint32_t, SceneMesh> m_scene_meshes;
+		uint32_t m_snapshot_index = 0;
+
+		// clustered point and spot lights of the main pass
+		std::shared_ptr<class LightGrid> m_light_grid;
+
+		// cached point and spot light shadows
+		std::shared_ptr<class ShadowAtlas> m_shadow_atlas;
+
 		// render datas
-		std::vector<VmaBuffer> m_lighting_ubs;
 		std::shared_ptr<class TextureCube> m_default_texture_cube;
 		std::map<ELightType, VmaImageViewSampler> m_lighting_icons;
 
 		// render options
 		int m_shader_debug_option = 0;
 		int m_show_debug_option = 0;
+		float m_lod_bias = 0.0f;
+		float m_shadow_lod_bias = 1.0f;
+		float m_shadow_cascade_split_lambda = 0.95f;
 
-		// selection
+		// draw statistics of all render passes in the frame being recorded, and of the last recorded frame
+		DrawStats m_draw_stats;
+		DrawStats m_last_draw_stats;
+		std::mutex m_draw_stats_mutex;
+
+		// the snapshot whose frame is being recorded
+		const RenderSnapshot* m_render_snapshot = nullptr;
+
+		// renders the snapshots of the game thread, null if frames are rendered on the game thread
+		std::shared_ptr<class RenderThread> m_render_thread;
+
+		// gpu timestamps and pipeline statistics of the render passes
+		std::shared_ptr<class GPUProfiler> m_gpu_profiler;
+
+		// selection, picks are requested on the game thread and rendered with the next snapshot
 		std::vector<uint32_t> m_selected_entity_ids;
+		bool m_has_pick = false;
+		uint32_t m_pick_x = 0;
+		uint32_t m_pick_y = 0;
+
+		// shader hot reload, shader files are polled and changed shaders are compiled on a worker thread
+		float m_shader_poll_time = 0.0f;
+		std::future<std::vector<std::shared_ptr<RenderPass>>> m_shader_reload_future;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,101 @@
+#include "render_thread.h"
+#include "engine/core/profile/cpu_profiler.h"
+
+namespace Bamboo
+{
+	const size_t k_max_queued_snapshot_count = 1;
+
+	void RenderThread::init(const std::function<void(const RenderSnapshot&)>& render_func)
+	{
+		m_render_func = render_func;
+		m_is_exiting = false;
+		m_thread = std::thread(&RenderThread::run, this);
+	}
+
+	void RenderThread::destroy()
+	{
+		if (!m_thread.joinable())
+		{
+			return;
+		}
+
+		// queued snapshots are still rendered before the thread exits
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_is_exiting = true;
+		}
+		m_condition.notify_all();
+		m_thread.join();
+
+		releaseSnapshots();
+	}
+
+	void RenderThread::push(const std::shared_ptr<RenderSnapshot>& snapshot)
+	{
+		PROFILE_SCOPE("RenderThread::push");
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_condition.wait(lock, [this]() { return m_snapshots.size() < k_max_queued_snapshot_count; });
+			m_snapshots.push_back(snapshot);
+		}
+		m_condition.notify_all();
+
+		releaseSnapshots();
+	}
+
+	void RenderThread::flush()
+	{
+		if (!m_thread.joinable() || isRenderThread())
+		{
+			return;
+		}
+
+		PROFILE_SCOPE("RenderThread::flush");
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_condition.wait(lock, [this]() { return m_snapshots.empty() && !m_is_rendering; });
+		}
+
+		releaseSnapshots();
+	}
+
+	void RenderThread::run()
+	{
+		CPUProfiler::get().setThreadName("render");
+		while (true)
+		{
+			std::shared_ptr<RenderSnapshot> snapshot;
+			{
+				std::unique_lock<std::mutex> lock(m_mutex);
+				m_condition.wait(lock, [this]() { return !m_snapshots.empty() || m_is_exiting; });
+				if (m_snapshots.empty())
+				{
+					return;
+				}
+
+				snapshot = m_snapshots.front();
+				m_snapshots.pop_front();
+				m_is_rendering = true;
+			}
+			m_condition.notify_all();
+
+			m_render_func(*snapshot);
+
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				m_rendered_snapshots.push_back(std::move(snapshot));
+				m_is_rendering = false;
+			}
+			m_condition.notify_all();
+		}
+	}
+
+	void RenderThread::releaseSnapshots()
+	{
+		std::vector<std::shared_ptr<RenderSnapshot>> rendered_snapshots;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			rendered_snapshots.swap(m_rendered_snapshots);
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "engine/function/render/render_snapshot.h"
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace Bamboo
+{
+	// renders the frame snapshots of the game thread on its own thread. one snapshot is queued while the previous one
+	// is rendered, so the game thread ticks frame n + 1 while frame n is rendered, and waits when it gets further ahead
+	class RenderThread
+	{
+	public:
+		void init(const std::function<void(const RenderSnapshot&)>& render_func);
+		void destroy();
+
+		// queues a snapshot, blocks while another one is still queued
+		void push(const std::shared_ptr<RenderSnapshot>& snapshot);
+
+		// blocks until all queued snapshots have been rendered, does nothing on the render thread itself
+		void flush();
+
+		bool isRenderThread() { return std::this_thread::get_id() == m_thread.get_id(); }
+
+	private:
+		void run();
+		void releaseSnapshots();
+
+		std::thread m_thread;
+		std::mutex m_mutex;
+		std::condition_variable m_condition;
+		std::function<void(const RenderSnapshot&)> m_render_func;
+
+		std::deque<std::shared_ptr<RenderSnapshot>> m_snapshots;
+		bool m_is_rendering = false;
+		bool m_is_exiting = false;
+
+		// rendered snapshots are handed back and released by the game thread
+		std::vector<std::shared_ptr<RenderSnapshot>> m_rendered_snapshots;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,189 @@
+#include "shadow_atlas.h"
+#include "engine/core/vulkan/vulkan_rhi.h"
+#include <algorithm>
+
+namespace Bamboo
+{
+	const uint32_t k_max_tile_size = 1024;
+	const uint32_t k_min_tile_size = 128;
+
+	void ShadowAtlas::init()
+	{
+		m_format = VulkanRHI::get().getDepthFormat();
+		m_size = 4096;
+
+		VulkanUtil::createImageViewSampler(m_size, m_size, nullptr, 1, 1, m_format,
+			VK_FILTER_LINEAR, VK_FILTER_LINEAR, VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE, m_image_view_sampler,
+			VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT);
+
+		// shadow passes load the cached tiles, so the atlas always stays readable between them
+		VulkanUtil::transitionImageLayout(m_image_view_sampler.image(), VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL, m_format);
+
+		m_free_tiles.resize(getLevel(k_min_tile_size) + 1);
+		m_free_tiles[0].push_back(glm::uvec2(0));
+	}
+
+	void ShadowAtlas::destroy()
+	{
+		m_image_view_sampler.destroy();
+	}
+
+	uint32_t ShadowAtlas::calcTileSize(float screen_size)
+	{
+		// the largest tile is used while the light covers the whole screen height, every halving halves the tile size
+		const float k_max_tile_screen_size = 1.0f;
+
+		uint32_t tile_size = k_max_tile_size;
+		while (tile_size > k_min_tile_size && screen_size < k_max_tile_screen_size * tile_size / k_max_tile_size)
+		{
+			tile_size >>= 1;
+		}
+		return tile_size;
+	}
+
+	void ShadowAtlas::beginFrame()
+	{
+		m_frame_index++;
+	}
+
+	const ShadowAtlasAllocation* ShadowAtlas::allocate(uint64_t light_id, uint32_t tile_size, uint32_t tile_num, uint64_t content_hash, bool is_dynamic)
+	{
+		// lights changing their tile size or count get new tiles
+		auto iter = m_entries.find(light_id);
+		if (iter != m_entries.end() && (iter->second.requested_tile_size != tile_size || iter->second.allocation.tile_offsets.size() != tile_num))
+		{
+			freeAllocation(iter->second.allocation);
+			m_entries.erase(iter);
+			iter = m_entries.end();
+		}
+
+		if (iter != m_entries.end())
+		{
+			Entry& entry = iter->second;
+			entry.allocation.dirty = is_dynamic || entry.content_hash != content_hash;
+			entry.content_hash = content_hash;
+			entry.frame_index = m_frame_index;
+			return &entry.allocation;
+		}
+
+		// shrink the tiles until all of them fit
+		Entry entry;
+		entry.requested_tile_size = tile_size;
+		entry.content_hash = content_hash;
+		entry.frame_index = m_frame_index;
+		for (uint32_t size = tile_size; size >= k_min_tile_size; size >>= 1)
+		{
+			entry.allocation.tile_size = size;
+			entry.allocation.tile_offsets.clear();
+
+			glm::uvec2 tile_offset;
+			while (entry.allocation.tile_offsets.size() < tile_num && allocateTile(getLevel(size), tile_offset))
+			{
+				entry.allocation.tile_offsets.push_back(tile_offset);
+			}
+
+			if (entry.allocation.tile_offsets.size() == tile_num)
+			{
+				return &m_entries.emplace(light_id, entry).first->second.allocation;
+			}
+			freeAllocation(entry.allocation);
+		}
+
+		return nullptr;
+	}
+
+	void ShadowAtlas::endFrame()
+	{
+		for (auto iter = m_entries.begin(); iter != m_entries.end();)
+		{
+			if (iter->second.frame_index != m_frame_index)
+			{
+				freeAllocation(iter->second.allocation);
+				iter = m_entries.erase(iter);
+			}
+			else
+			{
+				++iter;
+			}
+		}
+	}
+
+	glm::vec4 ShadowAtlas::calcTileRect(const glm::uvec2& tile_offset, uint32_t tile_size) const
+	{
+		float inv_size = 1.0f / m_size;
+		return glm::vec4(glm::vec2(tile_offset) * inv_size, glm::vec2(tile_size * inv_size));
+	}
+
+	bool ShadowAtlas::allocateTile(uint32_t level, glm::uvec2& tile_offset)
+	{
+		auto& free_tiles = m_free_tiles[level];
+		if (!free_tiles.empty())
+		{
+			tile_offset = free_tiles.back();
+			free_tiles.pop_back();
+			return true;
+		}
+
+		// split a free tile of the parent level into four
+		glm::uvec2 parent_offset;
+		if (level == 0 || !allocateTile(level - 1, parent_offset))
+		{
+			return false;
+		}
+
+		uint32_t tile_size = m_size >> level;
+		free_tiles.push_back(parent_offset + glm::uvec2(tile_size, tile_size));
+		free_tiles.push_back(parent_offset + glm::uvec2(0, tile_size));
+		free_tiles.push_back(parent_offset + glm::uvec2(tile_size, 0));
+		tile_offset = parent_offset;
+		return true;
+	}
+
+	void ShadowAtlas::freeTile(uint32_t level, const glm::uvec2& tile_offset)
+	{
+		auto& free_tiles = m_free_tiles[level];
+		if (level == 0)
+		{
+			free_tiles.push_back(tile_offset);
+			return;
+		}
+
+		// merge the tile with its three free siblings into the parent tile
+		uint32_t parent_size = m_size >> (level - 1);
+		glm::uvec2 parent_offset = tile_offset / parent_size * parent_size;
+		uint32_t free_sibling_count = 0;
+		for (const glm::uvec2& free_tile : free_tiles)
+		{
+			free_sibling_count += free_tile / parent_size * parent_size == parent_offset;
+		}
+
+		if (free_sibling_count < 3)
+		{
+			free_tiles.push_back(tile_offset);
+			return;
+		}
+
+		free_tiles.erase(std::remove_if(free_tiles.begin(), free_tiles.end(), [&](const glm::uvec2& free_tile) {
+			return free_tile / parent_size * parent_size == parent_offset;
+		}), free_tiles.end());
+		freeTile(level - 1, parent_offset);
+	}
+
+	void ShadowAtlas::freeAllocation(const ShadowAtlasAllocation& allocation)
+	{
+		for (const glm::uvec2& tile_offset : allocation.tile_offsets)
+		{
+			freeTile(getLevel(allocation.tile_size), tile_offset);
+		}
+	}
+
+	uint32_t ShadowAtlas::getLevel(uint32_t tile_size) const
+	{
+		uint32_t level = 0;
+		while ((m_size >> level) > tile_size)
+		{
+			level++;
+		}
+		return level;
+	}
+}
\ No newline at end of file
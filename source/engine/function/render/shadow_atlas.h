@@ -0,0 +1,66 @@
+#pragma once
+
+#include "engine/core/vulkan/vulkan_util.h"
+#include <glm/glm.hpp>
+#include <unordered_map>
+
+namespace Bamboo
+{
+	// atlas tiles of a light's shadow views, all tiles of a light have the same size
+	struct ShadowAtlasAllocation
+	{
+		uint32_t tile_size = 0;
+		std::vector<glm::uvec2> tile_offsets;
+
+		// the tiles' cached depth is outdated and has to be rendered again
+		bool dirty = true;
+	};
+
+	// depth atlas shared by point and spot light shadows, tiles are power of two squares of a quadtree buddy allocator.
+	// lights keep their tiles and cached depth across frames while their shadow content hash doesn't change
+	class ShadowAtlas
+	{
+	public:
+		void init();
+		void destroy();
+
+		// tile size of a light whose bounding sphere covers screen_size of the half screen height
+		static uint32_t calcTileSize(float screen_size);
+
+		// lights are requested every frame, the tiles of lights which weren't requested are freed in endFrame.
+		// tiles are shrunk if the atlas is full, nullptr is returned if even the smallest tiles don't fit
+		void beginFrame();
+		const ShadowAtlasAllocation* allocate(uint64_t light_id, uint32_t tile_size, uint32_t tile_num, uint64_t content_hash, bool is_dynamic);
+		void endFrame();
+
+		// uv offset and scale of a tile in the atlas
+		glm::vec4 calcTileRect(const glm::uvec2& tile_offset, uint32_t tile_size) const;
+
+		const VmaImageViewSampler& getImageViewSampler() { return m_image_view_sampler; }
+		VkFormat getFormat() { return m_format; }
+		uint32_t getSize() { return m_size; }
+
+	private:
+		struct Entry
+		{
+			ShadowAtlasAllocation allocation;
+			uint32_t requested_tile_size = 0;
+			uint64_t content_hash = 0;
+			uint32_t frame_index = 0;
+		};
+
+		bool allocateTile(uint32_t level, glm::uvec2& tile_offset);
+		void freeTile(uint32_t level, const glm::uvec2& tile_offset);
+		void freeAllocation(const ShadowAtlasAllocation& allocation);
+		uint32_t getLevel(uint32_t tile_size) const;
+
+		VkFormat m_format;
+		uint32_t m_size;
+		VmaImageViewSampler m_image_view_sampler;
+
+		// free tiles of every quadtree level, level 0 is the whole atlas
+		std::vector<std::vector<glm::uvec2>> m_free_tiles;
+		std::unordered_map<uint64_t, Entry> m_entries;
+		uint32_t m_frame_index = 0;
+	};
+}
\ No newline at end of file
@@ -9,6 +9,17 @@ namespace Bamboo
 {
 	void WindowSystem::init()
 	{
+		// headless runs don't open a window, the window size comes from the config
+		m_window = nullptr;
+		m_focus = false;
+		m_fullscreen = false;
+		if (g_engine.isHeadless())
+		{
+			m_framebuffer_width = g_engine.configManager()->getWindowWidth();
+			m_framebuffer_height = g_engine.configManager()->getWindowHeight();
+			return;
+		}
+
 		// initialize glfw
 		if (!glfwInit())
 		{
@@ -16,7 +27,6 @@ namespace Bamboo
 			return;
 		}
 
-		m_focus = false;
 		m_fullscreen = g_engine.configManager()->isFullscreen();
 		GLFWmonitor* monitor = glfwGetPrimaryMonitor();
 		const GLFWvidmode* mode = glfwGetVideoMode(monitor);
@@ -55,8 +65,14 @@ namespace Bamboo
 		glfwSetScrollCallback(m_window, scrollCallback);
 		glfwSetDropCallback(m_window, dropCallback);
 		glfwSetWindowSizeCallback(m_window, windowSizeCallback);
+		glfwSetFramebufferSizeCallback(m_window, framebufferSizeCallback);
 		glfwSetWindowCloseCallback(m_window, windowCloseCallback);
 
+		int framebuffer_width, framebuffer_height;
+		glfwGetFramebufferSize(m_window, &framebuffer_width, &framebuffer_height);
+		m_framebuffer_width = framebuffer_width;
+		m_framebuffer_height = framebuffer_height;
+
 		// set input mode
 		glfwSetInputMode(m_window, GLFW_RAW_MOUSE_MOTION, GLFW_FALSE);
 
@@ -69,30 +85,53 @@ namespace Bamboo
 
 	void WindowSystem::destroy()
 	{
+		if (!m_window)
+		{
+			return;
+		}
+
 		glfwDestroyWindow(m_window);
 		glfwTerminate();
 	}
 
 	void WindowSystem::pollEvents()
 	{
-		glfwPollEvents();
+		if (m_window)
+		{
+			glfwPollEvents();
+		}
 	}
 
 	bool WindowSystem::shouldClose()
 	{
-		return (bool)glfwWindowShouldClose(m_window);
+		return m_window && glfwWindowShouldClose(m_window);
 	}
 
 	void WindowSystem::setTitle(const std::string& title)
 	{
-		glfwSetWindowTitle(m_window, title.c_str());
+		if (m_window)
+		{
+			glfwSetWindowTitle(m_window, title.c_str());
+		}
 	}
 
 	void WindowSystem::getWindowSize(int& width, int& height)
 	{
+		if (!m_window)
+		{
+			width = g_engine.configManager()->getWindowWidth();
+			height = g_engine.configManager()->getWindowHeight();
+			return;
+		}
 		glfwGetWindowSize(m_window, &width, &height);
 	}
 
+	void WindowSystem::getFramebufferSize(int& width, int& height)
+	{
+		width = m_framebuffer_width;
+		height = m_framebuffer_height;
+	}
+
 	void WindowSystem::getScreenSize(int& width, int& height)
 	{
 		const GLFWvidmode* mode = glfwGetVideoMode(glfwGetPrimaryMonitor());
@@ -109,7 +148,7 @@ namespace Bamboo
 
 	bool WindowSystem::isMouseButtonDown(int button)
 	{
-		if (button < GLFW_MOUSE_BUTTON_1 || button > GLFW_MOUSE_BUTTON_LAST)
+		if (!m_window || button < GLFW_MOUSE_BUTTON_1 || button > GLFW_MOUSE_BUTTON_LAST)
 		{
 			return false;
 		}
@@ -191,6 +230,13 @@ namespace Bamboo
 		g_engine.eventSystem()->asyncDispatch(std::make_shared<WindowSizeEvent>(width, height));
 	}
 
+	void WindowSystem::framebufferSizeCallback(GLFWwindow* window, int width, int height)
+	{
+		WindowSystem* window_system = (WindowSystem*)glfwGetWindowUserPointer(window);
+		window_system->m_framebuffer_width = width;
+		window_system->m_framebuffer_height = height;
+	}
+
 	void WindowSystem::windowCloseCallback(GLFWwindow* window)
 	{
 		glfwSetWindowShouldClose(window, true);
@@ -3,6 +3,7 @@
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
 
+#include <atomic>
 #include <string>
 #include <functional>
 #include <vector>
@@ -20,6 +21,9 @@ namespace Bamboo
 		void setTitle(const std::string& title);
 		GLFWwindow* getWindow() { return m_window; }
 		void getWindowSize(int& width, int& height);
+
+		// the framebuffer size is updated by the event polling thread, and can be read from any thread
+		void getFramebufferSize(int& width, int& height);
 		void getScreenSize(int& width, int& height);
 		void getMousePos(int& x, int& y);
 
@@ -39,6 +43,7 @@ namespace Bamboo
 		static void scrollCallback(GLFWwindow* window, double xoffset, double yoffset);
 		static void dropCallback(GLFWwindow* window, int count, const char** paths);
 		static void windowSizeCallback(GLFWwindow* window, int width, int height);
+		static void framebufferSizeCallback(GLFWwindow* window, int width, int height);
 		static void windowCloseCallback(GLFWwindow* window);
 
 		GLFWwindow* m_window;
@@ -46,6 +51,8 @@ namespace Bamboo
 		int m_mouse_pos_y;
 		bool m_focus;
 		bool m_fullscreen;
+		std::atomic<int> m_framebuffer_width = 0;
+		std::atomic<int> m_framebuffer_height = 0;
 
 		int m_windowed_width, m_windowed_height;
 		int m_windowed_pos_x, m_windowed_pos_y;
@@ -299,6 +299,21 @@ namespace Bamboo
 		return true;
 	}
 
+	bool FileSystem::writeBinary(const std::string& filename, const std::vector<uint8_t>& data)
+	{
+		std::ofstream file(filename, std::ios::binary);
+		if (!file.is_open())
+		{
+			LOG_FATAL("failed to write binary file {}", filename);
+			return false;
+		}
+
+		file.write((const char*)data.data(), data.size());
+		file.close();
+
+		return true;
+	}
+
 	bool FileSystem::writeString(const std::string& filename, const std::string& str)
 	{
 		std::ofstream file(filename);
@@ -48,6 +48,7 @@ namespace Bamboo
 		void renameFile(const std::string& dir, const std::string& old_name, const std::string& new_name);
 
 		bool loadBinary(const std::string& filename, std::vector<uint8_t>& data);
+		bool writeBinary(const std::string& filename, const std::vector<uint8_t>& data);
 		bool writeString(const std::string& filename, const std::string& str);
 		bool loadString(const std::string& filename, std::string& str);
 
@@ -2,6 +2,7 @@
 #include "engine/resource/asset/texture_2d.h"
 #include "engine/resource/asset/texture_cube.h"
 #include "engine/function/framework/world/world.h"
+#include "engine/core/profile/cpu_profiler.h"
 
 #include "importer/gltf_importer.h"
 #define STB_IMAGE_IMPLEMENTATION
@@ -180,6 +181,7 @@ namespace Bamboo
 			return m_assets[url];
 		}
 
+		PROFILE_SCOPE(CPUProfiler::get().internName(url.str()));
 		EAssetType asset_type = getAssetType(url);
 		EArchiveType archive_type = m_asset_archive_types[asset_type];
 		const std::string& asset_ext = m_asset_type_exts[asset_type];
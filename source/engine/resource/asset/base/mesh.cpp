@@ -1,12 +1,131 @@
 #include "mesh.h"
+#include "engine/core/vulkan/vulkan_rhi.h"
+
+#include <glm/gtc/packing.hpp>
+#include <glm/gtc/matrix_transform.hpp>
 
 namespace Bamboo
 {
+	static_assert(offsetof(PackedStaticVertex, m_position) == offsetof(PackedSkeletalVertex, m_position) &&
+		offsetof(PackedStaticVertex, m_tex_coord) == offsetof(PackedSkeletalVertex, m_tex_coord) &&
+		offsetof(PackedStaticVertex, m_normal) == offsetof(PackedSkeletalVertex, m_normal),
+		"packed static and skeletal vertices must share their static attributes' layout");
+
+	template<typename PackedVertex>
+	static void packStaticAttributes(const StaticVertex& vertex, const glm::vec3& position_offset, const glm::vec3& position_scale,
+		PackedVertex& packed_vertex)
+	{
+		glm::vec3 position = glm::clamp((vertex.m_position - position_offset) / position_scale, 0.0f, 1.0f);
+		for (int i = 0; i < 3; ++i)
+		{
+			packed_vertex.m_position[i] = static_cast<uint16_t>(std::round(position[i] * 65535.0f));
+		}
+		packed_vertex.m_position[3] = UINT16_MAX;
+
+		packed_vertex.m_tex_coord[0] = glm::packHalf1x16(vertex.m_tex_coord.x);
+		packed_vertex.m_tex_coord[1] = glm::packHalf1x16(vertex.m_tex_coord.y);
+
+		// octahedral encoding, projects the normal onto the octahedron and folds its lower half over the upper half
+		glm::vec3 normal = vertex.m_normal / (std::abs(vertex.m_normal.x) + std::abs(vertex.m_normal.y) + std::abs(vertex.m_normal.z));
+		glm::vec2 oct = glm::vec2(normal);
+		if (normal.z < 0.0f)
+		{
+			oct.x = (1.0f - std::abs(normal.y)) * (normal.x >= 0.0f ? 1.0f : -1.0f);
+			oct.y = (1.0f - std::abs(normal.x)) * (normal.y >= 0.0f ? 1.0f : -1.0f);
+		}
+		for (int i = 0; i < 2; ++i)
+		{
+			packed_vertex.m_normal[i] = static_cast<int16_t>(std::round(glm::clamp(oct[i], -1.0f, 1.0f) * 32767.0f));
+		}
+	}
 
 	Mesh::~Mesh()
 	{
+		VulkanRHI::get().getUploadManager().wait(m_upload_handle);
 		m_vertex_buffer.destroy();
 		m_index_buffer.destroy();
 	}
 
+	glm::mat4 Mesh::getDequantizeMatrix() const
+	{
+		return glm::scale(glm::translate(glm::mat4(1.0f), m_position_offset), m_position_scale);
+	}
+
+	uint32_t Mesh::getVertexStride(bool is_skeletal_mesh)
+	{
+#if PACKED_MESH_VERTEX
+		return is_skeletal_mesh ? sizeof(PackedSkeletalVertex) : sizeof(PackedStaticVertex);
+#else
+		return is_skeletal_mesh ? sizeof(SkeletalVertex) : sizeof(StaticVertex);
+#endif
+	}
+
+	std::vector<VkVertexInputAttributeDescription> Mesh::getVertexInputAttributeDescriptions(bool is_skeletal_mesh)
+	{
+		std::vector<VkVertexInputAttributeDescription> vertex_input_attribute_descriptions;
+#if PACKED_MESH_VERTEX
+		vertex_input_attribute_descriptions = {
+			{ 0, 0, VK_FORMAT_R16G16B16A16_UNORM, offsetof(PackedStaticVertex, m_position) },
+			{ 1, 0, VK_FORMAT_R16G16_SFLOAT, offsetof(PackedStaticVertex, m_tex_coord) },
+			{ 2, 0, VK_FORMAT_R16G16_SNORM, offsetof(PackedStaticVertex, m_normal) }
+		};
+		if (is_skeletal_mesh)
+		{
+			vertex_input_attribute_descriptions.push_back({ 3, 0, VK_FORMAT_R8G8B8A8_UINT, offsetof(PackedSkeletalVertex, m_bones) });
+			vertex_input_attribute_descriptions.push_back({ 4, 0, VK_FORMAT_R16G16B16A16_UNORM, offsetof(PackedSkeletalVertex, m_weights) });
+		}
+#else
+		vertex_input_attribute_descriptions = {
+			{ 0, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(StaticVertex, m_position) },
+			{ 1, 0, VK_FORMAT_R32G32_SFLOAT, offsetof(StaticVertex, m_tex_coord) },
+			{ 2, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(StaticVertex, m_normal) }
+		};
+		if (is_skeletal_mesh)
+		{
+			vertex_input_attribute_descriptions.push_back({ 3, 0, VK_FORMAT_R32G32B32A32_SINT, offsetof(SkeletalVertex, m_bones) });
+			vertex_input_attribute_descriptions.push_back({ 4, 0, VK_FORMAT_R32G32B32A32_SFLOAT, offsetof(SkeletalVertex, m_weights) });
+		}
+#endif
+		return vertex_input_attribute_descriptions;
+	}
+
+	void Mesh::calcDequantization()
+	{
+		// avoid zero scales of flat meshes
+		m_position_offset = m_bounding_box.m_min;
+		m_position_scale = glm::max(m_bounding_box.m_max - m_bounding_box.m_min, glm::vec3(std::numeric_limits<float>::epsilon()));
+	}
+
+	void Mesh::packVertex(const StaticVertex& vertex, PackedStaticVertex& packed_vertex) const
+	{
+		packStaticAttributes(vertex, m_position_offset, m_position_scale, packed_vertex);
+	}
+
+	void Mesh::packVertex(const SkeletalVertex& vertex, PackedSkeletalVertex& packed_vertex) const
+	{
+		packStaticAttributes(vertex, m_position_offset, m_position_scale, packed_vertex);
+
+		// renormalize the quantized weights, so their sum stays one
+		glm::vec4 weights = vertex.m_weights / std::max(vertex.m_weights.x + vertex.m_weights.y + vertex.m_weights.z + vertex.m_weights.w, std::numeric_limits<float>::epsilon());
+		for (int i = 0; i < BONE_NUM_PER_VERTEX; ++i)
+		{
+			ASSERT(vertex.m_bones[i] >= 0 && vertex.m_bones[i] <= UINT8_MAX, "bone index {} doesn't fit in a packed vertex", vertex.m_bones[i]);
+			packed_vertex.m_bones[i] = static_cast<uint8_t>(vertex.m_bones[i]);
+			packed_vertex.m_weights[i] = static_cast<uint16_t>(std::round(glm::clamp(weights[i], 0.0f, 1.0f) * 65535.0f));
+		}
+	}
+
+	UploadHandle Mesh::createIndexBuffer(size_t vertex_count)
+	{
+		if (vertex_count > UINT16_MAX + 1)
+		{
+			m_index_type = VK_INDEX_TYPE_UINT32;
+			return VulkanUtil::createIndexBuffer(m_indices, m_index_buffer);
+		}
+
+		m_index_type = VK_INDEX_TYPE_UINT16;
+		std::vector<uint16_t> indices(m_indices.begin(), m_indices.end());
+		return VulkanUtil::createIndexBuffer(indices, m_index_buffer);
+	}
+
 }
\ No newline at end of file
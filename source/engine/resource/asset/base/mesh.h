@@ -36,6 +36,24 @@ private:
 	}
 };
 
+// vertex buffer layouts of packed mesh vertices
+struct PackedStaticVertex
+{
+	uint16_t m_position[4];
+	uint16_t m_tex_coord[2];
+	int16_t m_normal[2];
+};
+
+// standalone instead of derived from the static vertex, so it stays standard layout for offsetof
+struct PackedSkeletalVertex
+{
+	uint16_t m_position[4];
+	uint16_t m_tex_coord[2];
+	int16_t m_normal[2];
+	uint8_t m_bones[4];
+	uint16_t m_weights[4];
+};
+
 namespace Bamboo
 {
 	class Mesh
@@ -48,12 +66,32 @@ namespace Bamboo
 
 		VmaBuffer m_vertex_buffer;
 		VmaBuffer m_index_buffer;
+		VkIndexType m_index_type = VK_INDEX_TYPE_UINT32;
+		UploadHandle m_upload_handle;
 		
 		BoundingBox m_bounding_box;
 
+		// packed vertex positions are dequantized by offset + position * scale
+		glm::vec3 m_position_offset = glm::vec3(0.0f);
+		glm::vec3 m_position_scale = glm::vec3(1.0f);
+
+		// maps packed vertex positions back to mesh space, it's identity if vertices aren't packed
+		glm::mat4 getDequantizeMatrix() const;
+
+		// vertex buffer stride and attributes of static or skeletal mesh pipelines
+		static uint32_t getVertexStride(bool is_skeletal_mesh);
+		static std::vector<VkVertexInputAttributeDescription> getVertexInputAttributeDescriptions(bool is_skeletal_mesh);
+
 	protected:
 		virtual void calcBoundingBox() = 0;
 
+		void calcDequantization();
+		void packVertex(const StaticVertex& vertex, PackedStaticVertex& packed_vertex) const;
+		void packVertex(const SkeletalVertex& vertex, PackedSkeletalVertex& packed_vertex) const;
+
+		// use 16-bit indices if all vertices are addressable by them
+		UploadHandle createIndexBuffer(size_t vertex_count);
+
 	private:
 		friend class cereal::access;
 		template<class Archive>
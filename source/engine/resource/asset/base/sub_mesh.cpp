@@ -16,4 +16,18 @@ namespace Bamboo
 		BIND_ASSET(m_material, Material)
 	}
 
+	void SubMesh::getLODIndexRange(uint32_t lod, uint32_t& index_offset, uint32_t& index_count) const
+	{
+		if (lod == 0 || m_lods.empty())
+		{
+			index_offset = m_index_offset;
+			index_count = m_index_count;
+			return;
+		}
+
+		const SubMeshLOD& sub_mesh_lod = m_lods[std::min(lod, static_cast<uint32_t>(m_lods.size())) - 1];
+		index_offset = sub_mesh_lod.m_index_offset;
+		index_count = sub_mesh_lod.m_index_count;
+	}
+
 }
\ No newline at end of file
@@ -5,15 +5,39 @@
 
 namespace Bamboo
 {
+	// index range of a simplified level of detail, whose indices are appended after all sub meshes' full detail indices
+	struct SubMeshLOD
+	{
+		uint32_t m_index_offset;
+		uint32_t m_index_count;
+
+	private:
+		friend class cereal::access;
+		template<class Archive>
+		void serialize(Archive& ar)
+		{
+			ar(cereal::make_nvp("index_offset", m_index_offset));
+			ar(cereal::make_nvp("index_count", m_index_count));
+		}
+	};
+
 	class SubMesh : public IAssetRef
 	{
 	public:
 		uint32_t m_index_offset;
 		uint32_t m_index_count;
 		uint32_t m_vertex_count;
+
+		// lod 0 is the full detail index range above, m_lods holds lod 1 and coarser
+		std::vector<SubMeshLOD> m_lods;
 		
 		std::shared_ptr<Material> m_material;
 
+		uint32_t getLODCount() const { return static_cast<uint32_t>(m_lods.size()) + 1; }
+
+		// get the index range of a lod, which is clamped to the coarsest one
+		void getLODIndexRange(uint32_t lod, uint32_t& index_offset, uint32_t& index_count) const;
+
 	private:
 		friend class cereal::access;
 		template<class Archive>
@@ -23,6 +47,7 @@ namespace Bamboo
 			ar(cereal::make_nvp("index_offset", m_index_offset));
 			ar(cereal::make_nvp("index_count", m_index_count));
 			ar(cereal::make_nvp("vertex_count", m_vertex_count));
+			ar(cereal::make_nvp("lods", m_lods));
 		}
 
 		virtual void bindRefs() override;
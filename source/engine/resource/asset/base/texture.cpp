@@ -1,4 +1,5 @@
 #include "texture.h"
+#include "engine/core/vulkan/vulkan_rhi.h"
 #include <ktx.h>
 
 namespace Bamboo
@@ -16,6 +17,7 @@ namespace Bamboo
 
 	Texture::~Texture()
 	{
+		VulkanRHI::get().getUploadManager().wait(m_upload_handle);
 		m_image_view_sampler.destroy();
 	}
 
@@ -63,13 +65,6 @@ namespace Bamboo
 		ktx_uint8_t* ktx_texture_data = ktxTexture_GetData(ktx_texture);
 		ktx_size_t ktx_texture_size = ktxTexture_GetDataSize(ktx_texture);
 
-		// create a staging buffer
-		VmaBuffer staging_buffer;
-		VulkanUtil::createBuffer(ktx_texture_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_AUTO_PREFER_HOST, staging_buffer);
-
-		// copy image pixel data to staging buffer
-		VulkanUtil::updateBuffer(staging_buffer, ktx_texture_data, ktx_texture_size);
-
 		// create buffer image copy regions
 		std::vector<VkBufferImageCopy> buffer_image_copies;
 		for (uint32_t f = 0; f < m_layers; ++f)
@@ -100,22 +95,13 @@ namespace Bamboo
 			m_min_filter, m_mag_filter, m_address_mode_u, m_image_view_sampler,
 			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
 
-		// transition texture to transfer dst optimal
-		VkImage vk_image = m_image_view_sampler.image();
-		VulkanUtil::transitionImageLayout(vk_image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, format, m_mip_levels, m_layers);
-
-		// copy staging buffer to texture
-		VkCommandBuffer command_buffer = VulkanUtil::beginInstantCommands();
-		vkCmdCopyBufferToImage(command_buffer, staging_buffer.buffer, vk_image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-			static_cast<uint32_t>(buffer_image_copies.size()), buffer_image_copies.data());
-		VulkanUtil::endInstantCommands(command_buffer);
-
-		// transition texture to shader read only optimal
-		VulkanUtil::transitionImageLayout(vk_image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, format, m_mip_levels, m_layers);
+		// copy all mip levels and layers to the texture on the transfer queue, which leaves it in shader read only optimal,
+		// the pixel data is copied to the staging ring right away
+		m_upload_handle = VulkanRHI::get().getUploadManager().uploadImage(m_image_view_sampler.image(), ktx_texture_data, ktx_texture_size,
+			buffer_image_copies, m_mip_levels, m_layers);
 
-		// clean up staging resources
+		// clean up ktx texture
 		ktxTexture_Destroy(ktx_texture);
-		staging_buffer.destroy();
 	}
 
 }
\ No newline at end of file
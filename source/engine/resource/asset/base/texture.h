@@ -30,6 +30,7 @@ namespace Bamboo
 		uint32_t m_mip_levels;
 		uint32_t m_layers;
 		VmaImageViewSampler m_image_view_sampler;
+		UploadHandle m_upload_handle;
 
 		std::vector<uint8_t> m_image_data;
 
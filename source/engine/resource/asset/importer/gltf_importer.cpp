@@ -1,6 +1,8 @@
 #define TINYGLTF_IMPLEMENTATION
 #define TINYGLTF_NO_STB_IMAGE_WRITE
 #include "gltf_importer.h"
+#include "mesh_simplifier.h"
+#include "mesh_optimizer.h"
 
 #include "engine/core/base/macro.h"
 #include "engine/resource/asset/asset_manager.h"
@@ -222,7 +224,8 @@ namespace Bamboo
 		const std::vector<std::pair<tinygltf::Primitive, glm::mat4>>& primitives,
 		const std::vector<std::shared_ptr<Material>>& materials,
 		std::shared_ptr<StaticMesh>& static_mesh,
-		std::shared_ptr<SkeletalMesh>& skeletal_mesh)
+		std::shared_ptr<SkeletalMesh>& skeletal_mesh,
+		const GltfImportOption& option)
 	{
 		size_t vertex_count = 0, index_count = 0;
 		size_t primitive_count = primitives.size();
@@ -422,6 +425,190 @@ namespace Bamboo
 			vertex_start += primitive_vertex_count;
 			index_start += primitive_index_count;
 		}
+
+		// weld and reorder vertices and triangles, then simplify sub meshes into lod chains
+		if (static_mesh)
+		{
+			optimizeMesh(static_mesh->m_vertices, mesh, option);
+		}
+		else
+		{
+			optimizeMesh(skeletal_mesh->m_vertices, mesh, option);
+		}
+	}
+
+	template<typename VertexType>
+	void GltfImporter::optimizeMesh(std::vector<VertexType>& vertices, std::shared_ptr<Mesh> mesh, const GltfImportOption& option)
+	{
+		if (!option.optimize_meshes && !option.generate_lods)
+		{
+			return;
+		}
+
+		size_t vertex_count = vertices.size();
+		size_t index_count = mesh->m_indices.size();
+		float acmr = MeshOptimizer::calcACMR(mesh->m_indices, vertex_count);
+
+		std::vector<VertexType> optimized_vertices;
+		std::vector<uint32_t> optimized_indices;
+		std::vector<std::vector<std::vector<uint32_t>>> sub_mesh_lods;
+		optimized_vertices.reserve(vertex_count);
+		optimized_indices.reserve(index_count);
+
+		// sub meshes own consecutive vertex ranges, which are optimized with local indices
+		uint32_t vertex_start = 0;
+		for (SubMesh& sub_mesh : mesh->m_sub_meshes)
+		{
+			std::vector<uint32_t> indices(mesh->m_indices.begin() + sub_mesh.m_index_offset,
+				mesh->m_indices.begin() + sub_mesh.m_index_offset + sub_mesh.m_index_count);
+			for (uint32_t& index : indices)
+			{
+				index -= vertex_start;
+			}
+			std::vector<VertexType> sub_mesh_vertices(vertices.begin() + vertex_start, vertices.begin() + vertex_start + sub_mesh.m_vertex_count);
+			vertex_start += sub_mesh.m_vertex_count;
+
+			// weld identical vertices and drop unreferenced ones
+			std::vector<uint32_t> remap;
+			if (option.optimize_meshes)
+			{
+				size_t unique_vertex_count = MeshOptimizer::generateVertexRemap(remap, indices,
+					sub_mesh_vertices.data(), sub_mesh_vertices.size(), sizeof(VertexType));
+				std::vector<VertexType> unique_vertices(unique_vertex_count);
+				for (size_t v = 0; v < sub_mesh_vertices.size(); ++v)
+				{
+					if (remap[v] != UINT32_MAX)
+					{
+						unique_vertices[remap[v]] = sub_mesh_vertices[v];
+					}
+				}
+				for (uint32_t& index : indices)
+				{
+					index = remap[index];
+				}
+				sub_mesh_vertices = std::move(unique_vertices);
+			}
+
+			std::vector<glm::vec3> positions(sub_mesh_vertices.size());
+			for (size_t v = 0; v < sub_mesh_vertices.size(); ++v)
+			{
+				positions[v] = sub_mesh_vertices[v].m_position;
+			}
+
+			// reorder triangles for the post transform cache, then clusters of them for overdraw
+			if (option.optimize_meshes)
+			{
+				std::vector<uint32_t> cluster_offsets;
+				indices = MeshOptimizer::optimizeVertexCache(indices, sub_mesh_vertices.size(), &cluster_offsets);
+				indices = MeshOptimizer::optimizeOverdraw(indices, positions, cluster_offsets);
+			}
+
+			std::vector<std::vector<uint32_t>> lods;
+			if (option.generate_lods)
+			{
+				lods = generateMeshLODs(positions, indices);
+			}
+
+			// number vertices in order of their first use by lod 0, coarser lods only use a subset of its vertices
+			if (option.optimize_meshes)
+			{
+				for (std::vector<uint32_t>& lod : lods)
+				{
+					lod = MeshOptimizer::optimizeVertexCache(lod, sub_mesh_vertices.size());
+				}
+
+				MeshOptimizer::generateVertexFetchRemap(remap, indices, sub_mesh_vertices.size());
+				std::vector<VertexType> fetch_ordered_vertices(sub_mesh_vertices.size());
+				for (size_t v = 0; v < sub_mesh_vertices.size(); ++v)
+				{
+					fetch_ordered_vertices[remap[v]] = sub_mesh_vertices[v];
+				}
+				sub_mesh_vertices = std::move(fetch_ordered_vertices);
+
+				for (uint32_t& index : indices)
+				{
+					index = remap[index];
+				}
+				for (std::vector<uint32_t>& lod : lods)
+				{
+					for (uint32_t& index : lod)
+					{
+						index = remap[index];
+					}
+				}
+			}
+
+			uint32_t base_vertex = static_cast<uint32_t>(optimized_vertices.size());
+			sub_mesh.m_index_offset = static_cast<uint32_t>(optimized_indices.size());
+			sub_mesh.m_vertex_count = static_cast<uint32_t>(sub_mesh_vertices.size());
+			for (uint32_t index : indices)
+			{
+				optimized_indices.push_back(index + base_vertex);
+			}
+			for (std::vector<uint32_t>& lod : lods)
+			{
+				for (uint32_t& index : lod)
+				{
+					index += base_vertex;
+				}
+			}
+			optimized_vertices.insert(optimized_vertices.end(), sub_mesh_vertices.begin(), sub_mesh_vertices.end());
+			sub_mesh_lods.push_back(std::move(lods));
+		}
+
+		if (option.optimize_meshes)
+		{
+			LOG_INFO("optimize mesh, vertex count: {} -> {}, acmr: {:.3f} -> {:.3f}", vertex_count, optimized_vertices.size(),
+				acmr, MeshOptimizer::calcACMR(optimized_indices, optimized_vertices.size()));
+		}
+
+		// lod indices follow the lod 0 indices of all sub meshes
+		for (size_t s = 0; s < mesh->m_sub_meshes.size(); ++s)
+		{
+			SubMesh& sub_mesh = mesh->m_sub_meshes[s];
+			sub_mesh.m_lods.clear();
+			for (const std::vector<uint32_t>& lod : sub_mesh_lods[s])
+			{
+				SubMeshLOD sub_mesh_lod;
+				sub_mesh_lod.m_index_offset = static_cast<uint32_t>(optimized_indices.size());
+				sub_mesh_lod.m_index_count = static_cast<uint32_t>(lod.size());
+				sub_mesh.m_lods.push_back(sub_mesh_lod);
+
+				optimized_indices.insert(optimized_indices.end(), lod.begin(), lod.end());
+			}
+		}
+
+		vertices = std::move(optimized_vertices);
+		mesh->m_indices = std::move(optimized_indices);
+	}
+
+	std::vector<std::vector<uint32_t>> GltfImporter::generateMeshLODs(const std::vector<glm::vec3>& positions, const std::vector<uint32_t>& indices)
+	{
+		// every lod halves the triangle count of the previous one, within a relative error that doubles per lod
+		const uint32_t k_max_lod_count = 4;
+		const uint32_t k_min_lod_index_count = 3 * 32;
+		const float k_lod_base_error = 0.01f;
+		const float k_lod_min_reduction = 0.8f;
+
+		std::vector<std::vector<uint32_t>> lods;
+		for (uint32_t lod = 1; lod < k_max_lod_count; ++lod)
+		{
+			const std::vector<uint32_t>& lod_indices = lods.empty() ? indices : lods.back();
+			size_t target_index_count = lod_indices.size() / 6 * 3;
+			if (target_index_count < k_min_lod_index_count)
+			{
+				break;
+			}
+
+			std::vector<uint32_t> simplified_indices = MeshSimplifier::simplify(positions, lod_indices, target_index_count, k_lod_base_error * (1 << lod));
+			if (simplified_indices.size() > lod_indices.size() * k_lod_min_reduction)
+			{
+				break;
+			}
+
+			lods.push_back(std::move(simplified_indices));
+		}
+		return lods;
 	}
 
 	bool GltfImporter::importGltf(const std::string& filename, const URL& folder, const GltfImportOption& option)
@@ -606,7 +793,7 @@ namespace Bamboo
 				}
 			}
 
-			importGltfPrimitives(gltf_model, primitives, materials, static_mesh, skeletal_mesh);
+			importGltfPrimitives(gltf_model, primitives, materials, static_mesh, skeletal_mesh, option);
 
 			if (is_skeletal_mesh)
 			{
@@ -647,7 +834,7 @@ namespace Bamboo
 				{
 					primitives.push_back(std::make_pair(primitive, node_pair.first));
 				}
-				importGltfPrimitives(gltf_model, primitives, materials, static_mesh, skeletal_mesh);
+				importGltfPrimitives(gltf_model, primitives, materials, static_mesh, skeletal_mesh, option);
 
 				if (is_skeletal_mesh)
 				{
@@ -32,7 +32,11 @@ namespace Bamboo
 			const std::vector<std::pair<tinygltf::Primitive, glm::mat4>>& primitives,
 			const std::vector<std::shared_ptr<Material>>& materials,
 			std::shared_ptr<StaticMesh>& static_mesh,
-			std::shared_ptr<SkeletalMesh>& skeletal_mesh);
+			std::shared_ptr<SkeletalMesh>& skeletal_mesh,
+			const GltfImportOption& option);
+		template<typename VertexType>
+		static void optimizeMesh(std::vector<VertexType>& vertices, std::shared_ptr<Mesh> mesh, const GltfImportOption& option);
+		static std::vector<std::vector<uint32_t>> generateMeshLODs(const std::vector<glm::vec3>& positions, const std::vector<uint32_t>& indices);
 
 		static bool importGltf(const std::string& filename, const URL& folder, const GltfImportOption& option);
 	};
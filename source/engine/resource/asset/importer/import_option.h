@@ -5,6 +5,8 @@ struct GltfImportOption
 	// mesh
 	bool combine_meshes;
 	bool force_static_mesh;
+	bool optimize_meshes;
+	bool generate_lods;
 
 	// material
 	bool contains_occlusion_channel;
@@ -0,0 +1,320 @@
+#include "mesh_optimizer.h"
+
+#include <algorithm>
+#include <numeric>
+#include <string_view>
+#include <unordered_map>
+
+namespace Bamboo
+{
+	// fifo post transform cache, a vertex is cached if it was transformed within the last cache_size misses
+	class VertexCache
+	{
+	public:
+		VertexCache(size_t vertex_count, uint32_t cache_size) :
+			m_timestamps(vertex_count, 0), m_time(cache_size + 1), m_cache_size(cache_size) {}
+
+		bool contains(uint32_t vertex) const { return m_time - m_timestamps[vertex] <= m_cache_size; }
+		uint32_t getTime() const { return m_time; }
+		uint32_t getTimestamp(uint32_t vertex) const { return m_timestamps[vertex]; }
+
+		// return true if the vertex missed the cache
+		bool fetch(uint32_t vertex)
+		{
+			if (contains(vertex))
+			{
+				return false;
+			}
+
+			m_timestamps[vertex] = m_time++;
+			return true;
+		}
+
+		void reset()
+		{
+			m_time += m_cache_size + 1;
+		}
+
+	private:
+		std::vector<uint32_t> m_timestamps;
+		uint32_t m_time;
+		uint32_t m_cache_size;
+	};
+
+	float MeshOptimizer::calcACMR(const std::vector<uint32_t>& indices, size_t vertex_count, uint32_t cache_size)
+	{
+		if (indices.empty())
+		{
+			return 0.0f;
+		}
+
+		VertexCache cache(vertex_count, cache_size);
+		size_t miss_count = 0;
+		for (uint32_t index : indices)
+		{
+			miss_count += cache.fetch(index);
+		}
+		return static_cast<float>(miss_count) / (indices.size() / 3);
+	}
+
+	size_t MeshOptimizer::generateVertexRemap(std::vector<uint32_t>& remap, const std::vector<uint32_t>& indices,
+		const void* vertices, size_t vertex_count, size_t vertex_size)
+	{
+		remap.assign(vertex_count, UINT32_MAX);
+
+		// hash the raw vertex bytes, vertex structs are tightly packed floats and ints
+		const char* vertex_bytes = static_cast<const char*>(vertices);
+		std::unordered_map<std::string_view, uint32_t> vertex_map;
+		vertex_map.reserve(vertex_count);
+
+		uint32_t unique_count = 0;
+		for (uint32_t index : indices)
+		{
+			if (remap[index] != UINT32_MAX)
+			{
+				continue;
+			}
+
+			auto iter = vertex_map.emplace(std::string_view(vertex_bytes + index * vertex_size, vertex_size), unique_count);
+			remap[index] = iter.first->second;
+			if (iter.second)
+			{
+				unique_count++;
+			}
+		}
+		return unique_count;
+	}
+
+	std::vector<uint32_t> MeshOptimizer::optimizeVertexCache(const std::vector<uint32_t>& indices, size_t vertex_count,
+		std::vector<uint32_t>* cluster_offsets, uint32_t cache_size)
+	{
+		size_t triangle_count = indices.size() / 3;
+		if (cluster_offsets)
+		{
+			cluster_offsets->clear();
+		}
+
+		// vertex to triangle adjacency, live triangle counts are the number of adjacent triangles not emitted yet
+		std::vector<uint32_t> live_triangle_counts(vertex_count, 0);
+		for (uint32_t index : indices)
+		{
+			live_triangle_counts[index]++;
+		}
+
+		std::vector<uint32_t> adjacency_offsets(vertex_count + 1, 0);
+		for (size_t v = 0; v < vertex_count; ++v)
+		{
+			adjacency_offsets[v + 1] = adjacency_offsets[v] + live_triangle_counts[v];
+		}
+
+		std::vector<uint32_t> adjacency(indices.size());
+		std::vector<uint32_t> adjacency_heads(adjacency_offsets.begin(), adjacency_offsets.end() - 1);
+		for (size_t i = 0; i < indices.size(); ++i)
+		{
+			adjacency[adjacency_heads[indices[i]]++] = static_cast<uint32_t>(i / 3);
+		}
+
+		std::vector<uint32_t> result;
+		result.reserve(indices.size());
+
+		VertexCache cache(vertex_count, cache_size);
+		std::vector<bool> emitted(triangle_count, false);
+		std::vector<uint32_t> dead_ends;
+		std::vector<uint32_t> candidates;
+		uint32_t input_cursor = 0;
+
+		// dead ends are skipped by restarting from the most recently referenced vertex with live triangles,
+		// or from the next vertex in input order
+		auto skipDeadEnd = [&]() -> uint32_t {
+			while (!dead_ends.empty())
+			{
+				uint32_t vertex = dead_ends.back();
+				dead_ends.pop_back();
+				if (live_triangle_counts[vertex] > 0)
+				{
+					return vertex;
+				}
+			}
+
+			while (input_cursor < vertex_count)
+			{
+				if (live_triangle_counts[input_cursor] > 0)
+				{
+					return input_cursor;
+				}
+				input_cursor++;
+			}
+			return UINT32_MAX;
+		};
+
+		uint32_t fanning_vertex = vertex_count > 0 ? skipDeadEnd() : UINT32_MAX;
+		bool is_dead_end = true;
+		while (fanning_vertex != UINT32_MAX)
+		{
+			if (is_dead_end && cluster_offsets)
+			{
+				cluster_offsets->push_back(static_cast<uint32_t>(result.size() / 3));
+			}
+
+			// emit all live triangles around the fanning vertex
+			candidates.clear();
+			for (uint32_t a = adjacency_offsets[fanning_vertex]; a < adjacency_offsets[fanning_vertex + 1]; ++a)
+			{
+				uint32_t triangle = adjacency[a];
+				if (emitted[triangle])
+				{
+					continue;
+				}
+
+				for (uint32_t e = 0; e < 3; ++e)
+				{
+					uint32_t vertex = indices[triangle * 3 + e];
+					result.push_back(vertex);
+					dead_ends.push_back(vertex);
+					candidates.push_back(vertex);
+					live_triangle_counts[vertex]--;
+					cache.fetch(vertex);
+				}
+				emitted[triangle] = true;
+			}
+
+			// the next fanning vertex is the candidate which stays in cache for its remaining triangles,
+			// preferring the oldest one, which is about to be evicted
+			uint32_t next_vertex = UINT32_MAX;
+			int max_priority = -1;
+			for (uint32_t vertex : candidates)
+			{
+				if (live_triangle_counts[vertex] == 0)
+				{
+					continue;
+				}
+
+				int priority = 0;
+				uint32_t age = cache.getTime() - cache.getTimestamp(vertex);
+				if (age + 2 * live_triangle_counts[vertex] <= cache_size)
+				{
+					priority = static_cast<int>(age);
+				}
+				if (priority > max_priority)
+				{
+					max_priority = priority;
+					next_vertex = vertex;
+				}
+			}
+
+			is_dead_end = next_vertex == UINT32_MAX;
+			fanning_vertex = is_dead_end ? skipDeadEnd() : next_vertex;
+		}
+
+		return result;
+	}
+
+	std::vector<uint32_t> MeshOptimizer::optimizeOverdraw(const std::vector<uint32_t>& indices, const std::vector<glm::vec3>& positions,
+		const std::vector<uint32_t>& cluster_offsets, float threshold, uint32_t cache_size)
+	{
+		size_t triangle_count = indices.size() / 3;
+		if (triangle_count == 0 || cluster_offsets.empty())
+		{
+			return indices;
+		}
+
+		// split hard clusters at soft boundaries, where the acmr of the cluster so far is already below its threshold,
+		// a cache reset at a soft boundary costs at most threshold times of the cluster's misses
+		std::vector<uint32_t> clusters;
+		VertexCache cache(positions.size(), cache_size);
+		for (size_t c = 0; c < cluster_offsets.size(); ++c)
+		{
+			uint32_t cluster_begin = cluster_offsets[c];
+			uint32_t cluster_end = c + 1 < cluster_offsets.size() ? cluster_offsets[c + 1] : static_cast<uint32_t>(triangle_count);
+
+			cache.reset();
+			uint32_t cluster_miss_count = 0;
+			for (uint32_t t = cluster_begin; t < cluster_end; ++t)
+			{
+				cluster_miss_count += cache.fetch(indices[t * 3]) + cache.fetch(indices[t * 3 + 1]) + cache.fetch(indices[t * 3 + 2]);
+			}
+			float cluster_threshold = threshold * cluster_miss_count / (cluster_end - cluster_begin);
+
+			clusters.push_back(cluster_begin);
+			cache.reset();
+			uint32_t soft_begin = cluster_begin;
+			uint32_t soft_miss_count = 0;
+			for (uint32_t t = cluster_begin; t < cluster_end; ++t)
+			{
+				soft_miss_count += cache.fetch(indices[t * 3]) + cache.fetch(indices[t * 3 + 1]) + cache.fetch(indices[t * 3 + 2]);
+				if (t + 1 < cluster_end && soft_miss_count <= cluster_threshold * (t + 1 - soft_begin))
+				{
+					clusters.push_back(t + 1);
+					cache.reset();
+					soft_begin = t + 1;
+					soft_miss_count = 0;
+				}
+			}
+		}
+
+		// area weighted centroids and normals of the mesh and its clusters
+		glm::vec3 mesh_centroid(0.0f);
+		float mesh_area = 0.0f;
+		std::vector<float> sort_keys(clusters.size());
+		std::vector<glm::vec3> cluster_centroids(clusters.size(), glm::vec3(0.0f));
+		std::vector<glm::vec3> cluster_normals(clusters.size(), glm::vec3(0.0f));
+		for (size_t c = 0; c < clusters.size(); ++c)
+		{
+			uint32_t cluster_end = c + 1 < clusters.size() ? clusters[c + 1] : static_cast<uint32_t>(triangle_count);
+			float cluster_area = 0.0f;
+			for (uint32_t t = clusters[c]; t < cluster_end; ++t)
+			{
+				const glm::vec3& p0 = positions[indices[t * 3]];
+				const glm::vec3& p1 = positions[indices[t * 3 + 1]];
+				const glm::vec3& p2 = positions[indices[t * 3 + 2]];
+				glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+				float area = glm::length(normal);
+
+				cluster_centroids[c] += (p0 + p1 + p2) * (area / 3.0f);
+				cluster_normals[c] += normal;
+				cluster_area += area;
+			}
+
+			mesh_centroid += cluster_centroids[c];
+			mesh_area += cluster_area;
+			cluster_centroids[c] = cluster_area > 0.0f ? cluster_centroids[c] / cluster_area : positions[indices[clusters[c] * 3]];
+		}
+		mesh_centroid = mesh_area > 0.0f ? mesh_centroid / mesh_area : glm::vec3(0.0f);
+
+		// clusters facing away from the center are likely in front of the others
+		for (size_t c = 0; c < clusters.size(); ++c)
+		{
+			float normal_length = glm::length(cluster_normals[c]);
+			glm::vec3 normal = normal_length > 0.0f ? cluster_normals[c] / normal_length : glm::vec3(0.0f);
+			sort_keys[c] = glm::dot(cluster_centroids[c] - mesh_centroid, normal);
+		}
+
+		std::vector<uint32_t> cluster_order(clusters.size());
+		std::iota(cluster_order.begin(), cluster_order.end(), 0);
+		std::stable_sort(cluster_order.begin(), cluster_order.end(), [&sort_keys](uint32_t a, uint32_t b) { return sort_keys[a] > sort_keys[b]; });
+
+		std::vector<uint32_t> result;
+		result.reserve(indices.size());
+		for (uint32_t c : cluster_order)
+		{
+			uint32_t cluster_end = c + 1 < clusters.size() ? clusters[c + 1] : static_cast<uint32_t>(triangle_count);
+			result.insert(result.end(), indices.begin() + clusters[c] * 3, indices.begin() + cluster_end * 3);
+		}
+		return result;
+	}
+
+	size_t MeshOptimizer::generateVertexFetchRemap(std::vector<uint32_t>& remap, const std::vector<uint32_t>& indices, size_t vertex_count)
+	{
+		remap.assign(vertex_count, UINT32_MAX);
+
+		uint32_t next_vertex = 0;
+		for (uint32_t index : indices)
+		{
+			if (remap[index] == UINT32_MAX)
+			{
+				remap[index] = next_vertex++;
+			}
+		}
+		return next_vertex;
+	}
+}
\ No newline at end of file
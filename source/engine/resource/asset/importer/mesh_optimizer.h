@@ -0,0 +1,32 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <vector>
+
+namespace Bamboo
+{
+	class MeshOptimizer
+	{
+	public:
+		// average cache miss ratio, the number of vertices transformed per triangle by a fifo post transform cache
+		static float calcACMR(const std::vector<uint32_t>& indices, size_t vertex_count, uint32_t cache_size = 16);
+
+		// map bitwise identical vertices to one vertex and drop unreferenced vertices, unique vertices are numbered
+		// in order of their first reference, unreferenced vertices are mapped to UINT32_MAX, returns the unique vertex count
+		static size_t generateVertexRemap(std::vector<uint32_t>& remap, const std::vector<uint32_t>& indices,
+			const void* vertices, size_t vertex_count, size_t vertex_size);
+
+		// reorder triangles for the post transform cache with tipsify, cluster_offsets receive the first triangle
+		// of every cluster which restarts from a dead end, where the triangle order can be changed without losing locality
+		static std::vector<uint32_t> optimizeVertexCache(const std::vector<uint32_t>& indices, size_t vertex_count,
+			std::vector<uint32_t>* cluster_offsets = nullptr, uint32_t cache_size = 16);
+
+		// reorder clusters of cache optimized triangles, so clusters facing away from the mesh center are drawn first,
+		// clusters are split further while the acmr of the result stays within threshold times of the input
+		static std::vector<uint32_t> optimizeOverdraw(const std::vector<uint32_t>& indices, const std::vector<glm::vec3>& positions,
+			const std::vector<uint32_t>& cluster_offsets, float threshold = 1.05f, uint32_t cache_size = 16);
+
+		// number vertices in order of their first reference, so vertex fetches walk the vertex buffer linearly
+		static size_t generateVertexFetchRemap(std::vector<uint32_t>& remap, const std::vector<uint32_t>& indices, size_t vertex_count);
+	};
+}
\ No newline at end of file
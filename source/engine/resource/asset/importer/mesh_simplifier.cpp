@@ -0,0 +1,292 @@
+#include "mesh_simplifier.h"
+
+#include <algorithm>
+#include <unordered_map>
+#include <cstring>
+#include <cmath>
+
+namespace Bamboo
+{
+	// symmetric 4x4 matrix of the squared distances to a set of planes
+	struct Quadric
+	{
+		double a00 = 0.0, a01 = 0.0, a02 = 0.0, a03 = 0.0;
+		double a11 = 0.0, a12 = 0.0, a13 = 0.0;
+		double a22 = 0.0, a23 = 0.0;
+		double a33 = 0.0;
+
+		void addPlane(const glm::dvec3& n, double d, double weight)
+		{
+			a00 += weight * n.x * n.x; a01 += weight * n.x * n.y; a02 += weight * n.x * n.z; a03 += weight * n.x * d;
+			a11 += weight * n.y * n.y; a12 += weight * n.y * n.z; a13 += weight * n.y * d;
+			a22 += weight * n.z * n.z; a23 += weight * n.z * d;
+			a33 += weight * d * d;
+		}
+
+		void add(const Quadric& q)
+		{
+			a00 += q.a00; a01 += q.a01; a02 += q.a02; a03 += q.a03;
+			a11 += q.a11; a12 += q.a12; a13 += q.a13;
+			a22 += q.a22; a23 += q.a23;
+			a33 += q.a33;
+		}
+
+		double evaluate(const glm::dvec3& p) const
+		{
+			double error = a00 * p.x * p.x + 2.0 * a01 * p.x * p.y + 2.0 * a02 * p.x * p.z + 2.0 * a03 * p.x +
+				a11 * p.y * p.y + 2.0 * a12 * p.y * p.z + 2.0 * a13 * p.y +
+				a22 * p.z * p.z + 2.0 * a23 * p.z + a33;
+			return std::max(error, 0.0);
+		}
+	};
+
+	struct Collapse
+	{
+		uint32_t from;
+		uint32_t to;
+		double error;
+	};
+
+	struct PositionHash
+	{
+		size_t operator()(const glm::vec3& p) const
+		{
+			uint32_t bits[3];
+			memcpy(bits, &p, sizeof(bits));
+			return (bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u);
+		}
+	};
+
+	static uint64_t makeEdgeKey(uint32_t a, uint32_t b)
+	{
+		return (static_cast<uint64_t>(a) << 32) | b;
+	}
+
+	std::vector<uint32_t> MeshSimplifier::simplify(const std::vector<glm::vec3>& positions, const std::vector<uint32_t>& indices,
+		size_t target_index_count, float target_error, float* result_error)
+	{
+		if (result_error)
+		{
+			*result_error = 0.0f;
+		}
+		if (indices.size() <= target_index_count || indices.empty())
+		{
+			return indices;
+		}
+
+		// work on the vertex range referenced by the indices, normalized to the unit extent so errors are relative
+		uint32_t base_vertex = *std::min_element(indices.begin(), indices.end());
+		uint32_t vertex_count = *std::max_element(indices.begin(), indices.end()) - base_vertex + 1;
+
+		glm::vec3 min_position = positions[indices.front()], max_position = min_position;
+		for (uint32_t index : indices)
+		{
+			min_position = glm::min(min_position, positions[index]);
+			max_position = glm::max(max_position, positions[index]);
+		}
+		glm::vec3 extent = max_position - min_position;
+		double scale = std::max(std::max(extent.x, extent.y), extent.z);
+		scale = scale > 0.0 ? 1.0 / scale : 1.0;
+
+		std::vector<glm::dvec3> local_positions(vertex_count);
+		for (uint32_t v = 0; v < vertex_count; ++v)
+		{
+			local_positions[v] = glm::dvec3(positions[base_vertex + v] - min_position) * scale;
+		}
+
+		std::vector<uint32_t> result(indices.size());
+		for (size_t i = 0; i < indices.size(); ++i)
+		{
+			result[i] = indices[i] - base_vertex;
+		}
+
+		// weld vertices by position, vertices sharing a position sit on a uv or normal seam
+		std::unordered_map<glm::vec3, uint32_t, PositionHash> position_map;
+		std::vector<uint32_t> welds(vertex_count);
+		std::vector<bool> locked(vertex_count, false);
+		for (uint32_t v = 0; v < vertex_count; ++v)
+		{
+			auto iter = position_map.emplace(positions[base_vertex + v], v);
+			welds[v] = iter.first->second;
+			if (!iter.second)
+			{
+				locked[v] = locked[iter.first->second] = true;
+			}
+		}
+
+		// edges without a twin in the welded mesh lie on an open border
+		std::unordered_map<uint64_t, uint32_t> edges;
+		for (size_t i = 0; i < result.size(); i += 3)
+		{
+			for (uint32_t e = 0; e < 3; ++e)
+			{
+				edges[makeEdgeKey(welds[result[i + e]], welds[result[i + (e + 1) % 3]])]++;
+			}
+		}
+		for (size_t i = 0; i < result.size(); i += 3)
+		{
+			for (uint32_t e = 0; e < 3; ++e)
+			{
+				uint32_t a = result[i + e], b = result[i + (e + 1) % 3];
+				if (edges.find(makeEdgeKey(welds[b], welds[a])) == edges.end())
+				{
+					locked[a] = locked[b] = true;
+				}
+			}
+		}
+
+		// accumulate area weighted triangle plane quadrics
+		std::vector<Quadric> quadrics(vertex_count);
+		for (size_t i = 0; i < result.size(); i += 3)
+		{
+			const glm::dvec3& p0 = local_positions[result[i]];
+			glm::dvec3 normal = glm::cross(local_positions[result[i + 1]] - p0, local_positions[result[i + 2]] - p0);
+			double area = glm::length(normal);
+			if (area == 0.0)
+			{
+				continue;
+			}
+
+			normal /= area;
+			for (uint32_t e = 0; e < 3; ++e)
+			{
+				quadrics[result[i + e]].addPlane(normal, -glm::dot(normal, p0), area);
+			}
+		}
+
+		// each pass collapses an independent set of the cheapest edges, then rebuilds the index list
+		double max_error = static_cast<double>(target_error) * target_error;
+		double collapse_error = 0.0;
+		std::vector<uint32_t> adjacency_offsets, adjacency;
+		std::vector<uint32_t> remap(vertex_count);
+		std::vector<bool> touched(vertex_count);
+		std::vector<Collapse> collapses;
+		while (result.size() > target_index_count)
+		{
+			// vertex to triangle adjacency
+			adjacency_offsets.assign(vertex_count + 1, 0);
+			for (uint32_t index : result)
+			{
+				adjacency_offsets[index + 1]++;
+			}
+			for (uint32_t v = 0; v < vertex_count; ++v)
+			{
+				adjacency_offsets[v + 1] += adjacency_offsets[v];
+			}
+			adjacency.resize(result.size());
+			std::vector<uint32_t> adjacency_heads(adjacency_offsets.begin(), adjacency_offsets.end() - 1);
+			for (size_t i = 0; i < result.size(); ++i)
+			{
+				adjacency[adjacency_heads[result[i]]++] = static_cast<uint32_t>(i / 3);
+			}
+
+			// collapse candidates of both directions of every edge
+			collapses.clear();
+			for (size_t i = 0; i < result.size(); i += 3)
+			{
+				for (uint32_t e = 0; e < 3; ++e)
+				{
+					uint32_t a = result[i + e], b = result[i + (e + 1) % 3];
+					if (!locked[a])
+					{
+						collapses.push_back({ a, b, quadrics[a].evaluate(local_positions[b]) + quadrics[b].evaluate(local_positions[b]) });
+					}
+					if (!locked[b])
+					{
+						collapses.push_back({ b, a, quadrics[a].evaluate(local_positions[a]) + quadrics[b].evaluate(local_positions[a]) });
+					}
+				}
+			}
+			std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) { return a.error < b.error; });
+
+			for (uint32_t v = 0; v < vertex_count; ++v)
+			{
+				remap[v] = v;
+			}
+			std::fill(touched.begin(), touched.end(), false);
+
+			size_t triangle_goal = (result.size() - target_index_count + 2) / 3;
+			size_t removed_triangle_count = 0;
+			for (const Collapse& collapse : collapses)
+			{
+				if (collapse.error > max_error || removed_triangle_count >= triangle_goal)
+				{
+					break;
+				}
+				if (touched[collapse.from] || touched[collapse.to])
+				{
+					continue;
+				}
+
+				// reject collapses which would flip the remaining triangles around the removed vertex
+				bool flipped = false;
+				size_t removed_triangles = 0;
+				for (uint32_t a = adjacency_offsets[collapse.from]; a < adjacency_offsets[collapse.from + 1] && !flipped; ++a)
+				{
+					const uint32_t* triangle = &result[adjacency[a] * 3];
+					if (triangle[0] == collapse.to || triangle[1] == collapse.to || triangle[2] == collapse.to)
+					{
+						removed_triangles++;
+						continue;
+					}
+
+					glm::dvec3 p[3], q[3];
+					for (uint32_t e = 0; e < 3; ++e)
+					{
+						p[e] = local_positions[triangle[e]];
+						q[e] = triangle[e] == collapse.from ? local_positions[collapse.to] : p[e];
+					}
+					glm::dvec3 old_normal = glm::cross(p[1] - p[0], p[2] - p[0]);
+					glm::dvec3 new_normal = glm::cross(q[1] - q[0], q[2] - q[0]);
+					flipped = glm::dot(old_normal, new_normal) <= 0.0;
+				}
+				if (flipped)
+				{
+					continue;
+				}
+
+				remap[collapse.from] = collapse.to;
+				quadrics[collapse.to].add(quadrics[collapse.from]);
+				collapse_error = std::max(collapse_error, collapse.error);
+				removed_triangle_count += removed_triangles;
+
+				// the neighborhood of the collapse changed, so its vertices wait for the next pass
+				for (uint32_t a = adjacency_offsets[collapse.from]; a < adjacency_offsets[collapse.from + 1]; ++a)
+				{
+					const uint32_t* triangle = &result[adjacency[a] * 3];
+					touched[triangle[0]] = touched[triangle[1]] = touched[triangle[2]] = true;
+				}
+			}
+
+			if (removed_triangle_count == 0)
+			{
+				break;
+			}
+
+			// remap indices and drop degenerate triangles
+			size_t write_index = 0;
+			for (size_t i = 0; i < result.size(); i += 3)
+			{
+				uint32_t a = remap[result[i]], b = remap[result[i + 1]], c = remap[result[i + 2]];
+				if (a != b && b != c && c != a)
+				{
+					result[write_index++] = a;
+					result[write_index++] = b;
+					result[write_index++] = c;
+				}
+			}
+			result.resize(write_index);
+		}
+
+		for (uint32_t& index : result)
+		{
+			index += base_vertex;
+		}
+
+		if (result_error)
+		{
+			*result_error = static_cast<float>(std::sqrt(collapse_error));
+		}
+		return result;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <vector>
+
+namespace Bamboo
+{
+	class MeshSimplifier
+	{
+	public:
+		// collapse edges of an indexed triangle list in order of their quadric error until target_index_count is reached
+		// or the next collapse would exceed target_error, which is relative to the extent of the indexed vertices,
+		// vertices on open borders or attribute seams are locked, so the result keeps its silhouette and uv layout
+		static std::vector<uint32_t> simplify(const std::vector<glm::vec3>& positions, const std::vector<uint32_t>& indices,
+			size_t target_index_count, float target_error, float* result_error = nullptr);
+	};
+}
\ No newline at end of file
@@ -10,8 +10,19 @@ namespace Bamboo
 	{
 		calcBoundingBox();
 
+		// the index buffer is uploaded last, so its handle covers both buffers
+#if PACKED_MESH_VERTEX
+		calcDequantization();
+		std::vector<PackedSkeletalVertex> packed_vertices(m_vertices.size());
+		for (size_t i = 0; i < m_vertices.size(); ++i)
+		{
+			packVertex(m_vertices[i], packed_vertices[i]);
+		}
+		VulkanUtil::createVertexBuffer(packed_vertices.size() * sizeof(packed_vertices[0]), packed_vertices.data(), m_vertex_buffer);
+#else
 		VulkanUtil::createVertexBuffer(m_vertices.size() * sizeof(m_vertices[0]), m_vertices.data(), m_vertex_buffer);
-		VulkanUtil::createIndexBuffer(m_indices, m_index_buffer);
+#endif
+		m_upload_handle = createIndexBuffer(m_vertices.size());
 	}
 
 	void SkeletalMesh::calcBoundingBox()
@@ -9,9 +9,21 @@ namespace Bamboo
 	void StaticMesh::inflate()
 	{
 		calcBoundingBox();
+		buildBVH();
 
+		// the index buffer is uploaded last, so its handle covers both buffers
+#if PACKED_MESH_VERTEX
+		calcDequantization();
+		std::vector<PackedStaticVertex> packed_vertices(m_vertices.size());
+		for (size_t i = 0; i < m_vertices.size(); ++i)
+		{
+			packVertex(m_vertices[i], packed_vertices[i]);
+		}
+		VulkanUtil::createVertexBuffer(packed_vertices.size() * sizeof(packed_vertices[0]), packed_vertices.data(), m_vertex_buffer);
+#else
 		VulkanUtil::createVertexBuffer(m_vertices.size() * sizeof(m_vertices[0]), m_vertices.data(), m_vertex_buffer);
-		VulkanUtil::createIndexBuffer(m_indices, m_index_buffer);
+#endif
+		m_upload_handle = createIndexBuffer(m_vertices.size());
 	}
 
 	void StaticMesh::calcBoundingBox()
@@ -22,4 +34,22 @@ namespace Bamboo
 		}
 	}
 
+	void StaticMesh::buildBVH()
+	{
+		std::vector<glm::vec3> positions(m_vertices.size());
+		for (size_t i = 0; i < m_vertices.size(); ++i)
+		{
+			positions[i] = m_vertices[i].m_position;
+		}
+
+		// coarser lods are appended after the full detail indices and aren't needed for picking
+		std::vector<uint32_t> indices;
+		for (const auto& sub_mesh : m_sub_meshes)
+		{
+			auto begin = m_indices.begin() + sub_mesh.m_index_offset;
+			indices.insert(indices.end(), begin, begin + sub_mesh.m_index_count);
+		}
+		m_bvh.build(positions, indices);
+	}
+
 }
\ No newline at end of file
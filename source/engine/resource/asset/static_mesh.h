@@ -2,6 +2,7 @@
 
 #include "engine/resource/asset/base/mesh.h"
 #include "engine/resource/asset/base/asset.h"
+#include "engine/core/math/triangle_bvh.h"
 
 namespace Bamboo
 {
@@ -12,8 +13,12 @@ namespace Bamboo
 
 		std::vector<StaticVertex> m_vertices;
 
+		// full detail triangles in mesh space for cpu ray casts, it's rebuilt on load instead of being serialized
+		TriangleBVH m_bvh;
+
 	protected:
 		virtual void calcBoundingBox() override;
+		void buildBVH();
 
 	private:
 		friend class cereal::access;
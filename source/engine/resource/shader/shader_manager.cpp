@@ -1,9 +1,30 @@
 #include "shader_manager.h"
 #include "engine/core/vulkan/vulkan_rhi.h"
+#include "engine/platform/timer/timer.h"
+#include "engine/core/profile/cpu_profiler.h"
 #include <array>
+#include <atomic>
+#include <thread>
 
 namespace Bamboo
 {
+	// compile options are part of the content hash, so changing them recompiles all shaders
+	const char* k_shader_compile_options = "--target-env vulkan1.3 -g";
+
+	// fnv-1a hash of a string
+	static uint64_t hashString(const std::string& str)
+	{
+		uint64_t hash = 0xcbf29ce484222325ull;
+		for (char c : str)
+		{
+			hash = (hash ^ static_cast<uint8_t>(c)) * 0x100000001b3ull;
+		}
+		return hash;
+	}
+
+	// shader names requested on the calling thread are recorded into this set if it's set
+	static thread_local std::set<std::string>* s_shader_name_recorder = nullptr;
+
 	void ShaderManager::init()
 	{
 		// create spv dir if doesn't exist
@@ -14,8 +35,7 @@ namespace Bamboo
 			fs->createDir(spv_dir);
 		}
 
-		// get compiled spv filename and modified time
-		std::map<std::string, std::string> spv_basename_modified_time_map;
+		// get compiled spv filename and source hash
 		std::vector<std::string> spv_filenames = fs->traverse(spv_dir);
 		for (const std::string& spv_filename : spv_filenames)
 		{
@@ -26,7 +46,7 @@ namespace Bamboo
 
 			std::string spv_basename = fs->basename(spv_filename); 
 			std::vector<std::string> splits = StringUtil::split(spv_basename, "-");
-			spv_basename_modified_time_map[splits[0]] = splits[1];
+			m_shader_hashes[splits[0]] = splits[1];
 			m_shader_filenames[splits[0]] = spv_filename;
 		}
 
@@ -36,30 +56,78 @@ namespace Bamboo
 			return;
 		}
 
-		// get shader include directory
-		bool need_compile_all = false;
-		std::string global_shader_include_dir = fs->global(fs->combine(fs->getShaderDir(), std::string("include")));
-		std::string shader_include_dir_modified_time = fs->modifiedTime(global_shader_include_dir);
+		// includes are tracked per shader, the include dir's modified time isn't needed anymore
 		std::string spv_include_filename = fs->combine(spv_dir, std::string("include.txt"));
-		if (!fs->exists(spv_include_filename))
+		if (fs->exists(spv_include_filename))
 		{
-			need_compile_all = true;
-			fs->writeString(spv_include_filename, shader_include_dir_modified_time);
+			fs->removeFile(spv_include_filename);
 		}
-		else
+
+		// remove all spv files whose corresponding glsl file has been removed
+		std::vector<std::string> glsl_filenames = fs->traverse(fs->getShaderDir());
+		auto removing_shader_filenames = m_shader_filenames;
+		for (const std::string& glsl_filename : glsl_filenames)
+		{
+			removing_shader_filenames.erase(fs->filename(glsl_filename));
+		}
+		for (const auto& iter : removing_shader_filenames)
+		{
+			fs->removeFile(iter.second);
+			m_shader_filenames.erase(iter.first);
+			m_shader_hashes.erase(iter.first);
+		}
+
+		m_hot_reload_enabled = true;
+		pollShaderChanges();
+		compileShaders();
+	}
+
+	bool ShaderManager::pollShaderChanges()
+	{
+		if (!m_hot_reload_enabled)
 		{
-			std::string last_shader_include_dir_modified_time;
-			fs->loadString(spv_include_filename, last_shader_include_dir_modified_time);
-			if (shader_include_dir_modified_time != last_shader_include_dir_modified_time)
+			return false;
+		}
+
+		// shaders and their includes are compared by modified time here, compileShaders compares their contents
+		const auto& fs = g_engine.fileSystem();
+		std::string shader_dir = fs->getShaderDir();
+		std::vector<std::string> filenames = fs->traverse(shader_dir);
+		std::vector<std::string> include_filenames = fs->traverse(fs->combine(shader_dir, std::string("include")));
+		filenames.insert(filenames.end(), include_filenames.begin(), include_filenames.end());
+
+		std::map<std::string, std::string> modified_times;
+		for (const std::string& filename : filenames)
+		{
+			if (!fs->isDir(filename))
 			{
-				need_compile_all = true;
-				fs->writeString(spv_include_filename, shader_include_dir_modified_time);
+				modified_times[filename] = fs->modifiedTime(filename);
 			}
 		}
 
-		// compile glsl shader if necessary
+		bool changed = modified_times != m_shader_modified_times;
+		m_shader_modified_times = std::move(modified_times);
+		return changed;
+	}
+
+	std::vector<std::string> ShaderManager::compileShaders()
+	{
+		const auto& fs = g_engine.fileSystem();
+		std::string spv_dir = fs->getSpvDir();
+		std::string global_shader_include_dir = fs->global(fs->combine(fs->getShaderDir(), std::string("include")));
+
+		// a shader is compiled if the hash of its source with all included files expanded has changed
+		struct CompileJob
+		{
+			std::string glsl_basename;
+			std::string source_hash;
+			std::string spv_filename;
+			std::string compile_cmd;
+		};
+		std::vector<CompileJob> compile_jobs;
+		std::map<std::string, std::string> include_sources;
+
 		std::vector<std::string> glsl_filenames = fs->traverse(fs->getShaderDir());
-		auto removing_shader_filenames = m_shader_filenames;
 		for (const std::string& glsl_filename : glsl_filenames)
 		{
 			if (fs->isDir(glsl_filename))
@@ -67,42 +135,109 @@ namespace Bamboo
 				continue;
 			}
 
-			std::string glsl_basename = fs->filename(glsl_filename);
-			std::string modified_time = fs->modifiedTime(glsl_filename);
-			removing_shader_filenames.erase(glsl_basename);
+			std::set<std::string> included_filenames;
+			std::string source = k_shader_compile_options;
+			expandShaderSource(glsl_filename, global_shader_include_dir, include_sources, included_filenames, source);
+
+			CompileJob compile_job;
+			compile_job.glsl_basename = fs->filename(glsl_filename);
+			compile_job.source_hash = StringUtil::format("%016llx", static_cast<unsigned long long>(hashString(source)));
+			auto iter = m_shader_hashes.find(compile_job.glsl_basename);
+			if (iter != m_shader_hashes.end() && iter->second == compile_job.source_hash)
+			{
+				continue;
+			}
+
+			compile_job.spv_filename = StringUtil::format("%s/%s-%s.spv", spv_dir.c_str(), compile_job.glsl_basename.c_str(), compile_job.source_hash.c_str());
+			compile_job.compile_cmd = StringUtil::format("%s %s -I%s -o \"%s\" \"%s\"", VULKAN_SHADER_COMPILER, k_shader_compile_options,
+				global_shader_include_dir.c_str(), fs->global(compile_job.spv_filename).c_str(), fs->global(glsl_filename).c_str());
+			compile_jobs.push_back(compile_job);
+		}
+
+		if (compile_jobs.empty())
+		{
+			return {};
+		}
 
-			bool need_compile = spv_basename_modified_time_map.find(glsl_basename) == spv_basename_modified_time_map.end() ||
-				modified_time != spv_basename_modified_time_map[glsl_basename] || need_compile_all;
-			if (need_compile)
+		// compile with concurrent compiler processes
+		PROFILE_SCOPE("ShaderManager::compileShaders");
+		StopWatch stop_watch;
+		stop_watch.start();
+		std::atomic<size_t> next_job_index = 0;
+		auto compileShaders = [this, &compile_jobs, &next_job_index]() {
+			for (size_t i = next_job_index++; i < compile_jobs.size(); i = next_job_index++)
 			{
-				// remove old spv file
-				fs->removeFile(m_shader_filenames[glsl_basename]);
-
-				std::string global_glsl_filename = fs->global(glsl_filename);
-				std::string spv_filename = StringUtil::format("%s/%s-%s.spv", spv_dir.c_str(), glsl_basename.c_str(), modified_time.c_str());
-				std::string global_spv_filename = fs->global(spv_filename);
-				std::string shader_compile_cmd = StringUtil::format("%s --target-env vulkan1.3 -I%s -g -o \"%s\" \"%s\"", 
-					VULKAN_SHADER_COMPILER, global_shader_include_dir.c_str(), global_spv_filename.c_str(), global_glsl_filename.c_str());
-				std::string result = execute(shader_compile_cmd.c_str());
+				const CompileJob& compile_job = compile_jobs[i];
+				PROFILE_SCOPE(CPUProfiler::get().internName(compile_job.glsl_basename));
+				std::string result = execute(compile_job.compile_cmd.c_str());
 				StringUtil::trim(result);
 				if (!result.empty())
 				{
-					LOG_INFO("finished compiling shader {}, result: {}", glsl_basename, result);
+					LOG_INFO("finished compiling shader {}, result: {}", compile_job.glsl_basename, result);
 				}
 				else
 				{
-					LOG_INFO("finished compiling shader {}", glsl_basename);
+					LOG_INFO("finished compiling shader {}", compile_job.glsl_basename);
 				}
+			}
+		};
+
+		size_t worker_count = std::min(compile_jobs.size(), static_cast<size_t>(std::max(std::thread::hardware_concurrency(), 1u)));
+		std::vector<std::thread> workers;
+		for (size_t i = 0; i < worker_count; ++i)
+		{
+			workers.emplace_back(compileShaders);
+		}
+		for (std::thread& worker : workers)
+		{
+			worker.join();
+		}
+		LOG_INFO("compiled {} of {} shaders in {}ms", compile_jobs.size(), glsl_filenames.size(), stop_watch.stopMs());
+
+		// shaders which failed to compile keep their last spv file,
+		// the modules of recompiled shaders are retired and created again on their next request
+		std::vector<std::string> compiled_shader_names;
+		std::lock_guard<std::mutex> lock(m_mutex);
+		for (const CompileJob& compile_job : compile_jobs)
+		{
+			if (!fs->exists(compile_job.spv_filename))
+			{
+				LOG_ERROR("failed to compile shader {}", compile_job.glsl_basename);
+				continue;
+			}
+
+			auto filename_iter = m_shader_filenames.find(compile_job.glsl_basename);
+			if (filename_iter != m_shader_filenames.end() && filename_iter->second != compile_job.spv_filename)
+			{
+				fs->removeFile(filename_iter->second);
+			}
+			m_shader_filenames[compile_job.glsl_basename] = compile_job.spv_filename;
+			m_shader_hashes[compile_job.glsl_basename] = compile_job.source_hash;
 
-				m_shader_filenames[glsl_basename] = spv_filename;
+			auto module_iter = m_shader_modules.find(compile_job.glsl_basename);
+			if (module_iter != m_shader_modules.end())
+			{
+				m_retired_shader_modules.push_back(module_iter->second);
+				m_shader_modules.erase(module_iter);
 			}
+			compiled_shader_names.push_back(compile_job.glsl_basename);
 		}
+		return compiled_shader_names;
+	}
 
-		// remove all spv files whose corresponding glsl file has been removed
-		for (const auto& iter : removing_shader_filenames)
+	void ShaderManager::destroyRetiredShaderModules()
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		for (VkShaderModule shader_module : m_retired_shader_modules)
 		{
-			fs->removeFile(iter.second);
+			vkDestroyShaderModule(VulkanRHI::get().getDevice(), shader_module, nullptr);
 		}
+		m_retired_shader_modules.clear();
+	}
+
+	void ShaderManager::setShaderNameRecorder(std::set<std::string>* shader_names)
+	{
+		s_shader_name_recorder = shader_names;
 	}
 
 	void ShaderManager::destroy()
@@ -111,10 +246,17 @@ namespace Bamboo
 		{
 			vkDestroyShaderModule(VulkanRHI::get().getDevice(), iter.second, nullptr);
 		}
+		destroyRetiredShaderModules();
 	}
 
 	VkPipelineShaderStageCreateInfo ShaderManager::getShaderStageCI(const std::string& name, VkShaderStageFlagBits stage)
 	{
+		if (s_shader_name_recorder)
+		{
+			s_shader_name_recorder->insert(name);
+		}
+
+		std::lock_guard<std::mutex> lock(m_mutex);
 		if (m_shader_filenames.find(name) == m_shader_filenames.end())
 		{
 			LOG_FATAL("failed to find shader {}", name);
@@ -154,6 +296,51 @@ namespace Bamboo
 		return shader_stage_ci;
 	}
 
+	void ShaderManager::expandShaderSource(const std::string& filename, const std::string& include_dir,
+		std::map<std::string, std::string>& include_sources, std::set<std::string>& included_filenames, std::string& source)
+	{
+		const auto& fs = g_engine.fileSystem();
+
+		// included files are shared by many shaders, so they are only loaded once
+		auto iter = include_sources.find(filename);
+		if (iter == include_sources.end())
+		{
+			std::vector<uint8_t> data;
+			fs->loadBinary(filename, data);
+			iter = include_sources.emplace(filename, std::string(data.begin(), data.end())).first;
+		}
+		const std::string& file_source = iter->second;
+		source += file_source;
+
+		// follow quoted includes like the compiler, first next to the including file, then in the include dir.
+		// conditional includes are followed as well, which at worst recompiles a shader too often
+		size_t pos = 0;
+		while ((pos = file_source.find("#include", pos)) != std::string::npos)
+		{
+			size_t line_end = file_source.find('\n', pos);
+			std::string line = file_source.substr(pos, line_end == std::string::npos ? std::string::npos : line_end - pos);
+			pos += 8;
+
+			size_t name_begin = line.find('"');
+			size_t name_end = name_begin == std::string::npos ? std::string::npos : line.find('"', name_begin + 1);
+			if (name_end == std::string::npos)
+			{
+				continue;
+			}
+
+			std::string include_name = line.substr(name_begin + 1, name_end - name_begin - 1);
+			std::string include_filename = fs->combine(fs->dir(filename), include_name);
+			if (!fs->exists(include_filename))
+			{
+				include_filename = fs->combine(include_dir, include_name);
+			}
+			if (fs->exists(include_filename) && included_filenames.insert(include_filename).second)
+			{
+				expandShaderSource(include_filename, include_dir, include_sources, included_filenames, source);
+			}
+		}
+	}
+
 	std::string ShaderManager::execute(const char* cmd)
 	{
 		std::array<char, 128> buffer;
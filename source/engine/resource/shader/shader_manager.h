@@ -2,6 +2,8 @@
 
 #include "engine/core/vulkan/vulkan_util.h"
 #include <map>
+#include <mutex>
+#include <set>
 
 namespace Bamboo
 {
@@ -13,10 +15,34 @@ namespace Bamboo
 
 		VkPipelineShaderStageCreateInfo getShaderStageCI(const std::string& name, VkShaderStageFlagBits stage);
 
+		// whether any shader or include file was modified since the last poll, always false in game mode
+		bool pollShaderChanges();
+
+		// compile shaders whose expanded sources changed, returns the names of the successfully compiled ones.
+		// their old modules are retired until destroyRetiredShaderModules, as pipelines may still be created from them
+		std::vector<std::string> compileShaders();
+		void destroyRetiredShaderModules();
+
+		// records the names of all shaders requested on the calling thread, nullptr stops recording
+		static void setShaderNameRecorder(std::set<std::string>* shader_names);
+
 	private:
 		std::string execute(const char* cmd);
 
+		// appends the source of a shader and all files it includes, each file is only expanded once
+		void expandShaderSource(const std::string& filename, const std::string& include_dir,
+			std::map<std::string, std::string>& include_sources, std::set<std::string>& included_filenames, std::string& source);
+
+		// guards the shader files and modules, render passes create their pipelines concurrently
+		// and shaders are recompiled on a worker thread
+		std::mutex m_mutex;
 		std::map<std::string, VkShaderModule> m_shader_modules;
 		std::map<std::string, std::string> m_shader_filenames;
+		std::map<std::string, std::string> m_shader_hashes;
+		std::vector<VkShaderModule> m_retired_shader_modules;
+
+		// hot reload is only enabled if the shader sources exist
+		bool m_hot_reload_enabled = false;
+		std::map<std::string, std::string> m_shader_modified_times;
 	};
 }
\ No newline at end of file